@@ -6,8 +6,13 @@
 #include "utilities.h"
 #include "Tasm.h"
 #include "Video.h"
+#include "WorkloadWrappers.h"
 #include <boost/python/numpy.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 namespace p = boost::python;
 namespace np = boost::python::numpy;
 
@@ -21,18 +26,24 @@ public:
     unsigned int width() const { return image_->width(); }
     unsigned int height() const { return image_->height(); }
 
-    np::ndarray array() { return makeArray(); }
+    // A flat view of the RGBA pixels.
+    np::ndarray array() const {
+        return view(p::make_tuple(height() * width() * 4), p::make_tuple(sizeof(uint8_t)));
+    }
+
+    // A (height, width, 4) view of the RGBA pixels.
+    np::ndarray shapedArray() const {
+        return view(p::make_tuple(height(), width(), 4), p::make_tuple(width() * 4 * sizeof(uint8_t), 4 * sizeof(uint8_t), sizeof(uint8_t)));
+    }
 
 private:
-    np::ndarray makeArray() {
+    // The view owns a Python copy of this image, so the pixels stay alive as long as the array does.
+    np::ndarray view(const p::tuple &shape, const p::tuple &stride) const {
         np::dtype dt = np::dtype::get_builtin<uint8_t>();
-        p::tuple shape = p::make_tuple(height() * width() * 4);
-        p::tuple stride = p::make_tuple(sizeof(uint8_t));
-        return np::from_data(image_->pixels(), dt, shape, stride, own_);
+        return np::from_data(image_->pixels(), dt, shape, stride, p::object(*this));
     }
 
     ImagePtr image_;
-    p::object own_;
 };
 
 class SelectionResults {
@@ -41,13 +52,106 @@ public:
             : imageIterator_(std::move(imageIterator)) {}
 
     PythonImage next() {
-        return PythonImage(imageIterator_->next());
+        ImagePtr image;
+        {
+            ScopedGILRelease releaseGIL;
+            image = imageIterator_->next();
+        }
+        return PythonImage(image);
+    }
+
+    // Implements the iterator protocol by returning each object as a (height, width, 4) array.
+    np::ndarray pythonNext() {
+        auto image = next();
+        if (image.isEmpty()) {
+            PyErr_SetString(PyExc_StopIteration, "");
+            p::throw_error_already_set();
+        }
+        return image.shapedArray();
+    }
+
+    // Returns up to `n` objects as a list of (height, width, 4) arrays. The list is shorter than `n` only when the
+    // selection is exhausted.
+    p::list nextBatch(unsigned int n) {
+        p::list batch;
+        for (const auto &image : nextImages(n))
+            batch.append(PythonImage(image).shapedArray());
+        return batch;
+    }
+
+    // Returns up to `n` objects copied into a single (n, height, width, 4) array, where the height and width are the
+    // largest of the objects'. Each object is at the top left of its slice, and the rest of the slice is zero.
+    np::ndarray nextPaddedBatch(unsigned int n) {
+        auto images = nextImages(n);
+        unsigned int maxHeight = 0;
+        unsigned int maxWidth = 0;
+        for (const auto &image : images) {
+            maxHeight = std::max(maxHeight, image->height());
+            maxWidth = std::max(maxWidth, image->width());
+        }
+
+        auto batch = np::zeros(p::make_tuple(images.size(), maxHeight, maxWidth, 4), np::dtype::get_builtin<uint8_t>());
+        auto data = reinterpret_cast<uint8_t*>(batch.get_data());
+        {
+            ScopedGILRelease releaseGIL;
+            auto rowSize = maxWidth * 4;
+            for (auto i = 0u; i < images.size(); ++i) {
+                const auto &image = images[i];
+                for (auto row = 0u; row < image->height(); ++row)
+                    memcpy(data + (i * maxHeight + row) * rowSize, image->pixels() + row * image->width() * 4, image->width() * 4);
+            }
+        }
+        return batch;
+    }
+
+    p::dict stats() const {
+        return statsToDict(*imageIterator_->stats());
+    }
+
+    static p::dict statsToDict(const QueryStats &stats) {
+        auto dict = dictify(stats.counters());
+        dict["operator_time_ns"] = dictify(stats.operatorTimesNs());
+        return dict;
     }
 
 private:
+    std::vector<ImagePtr> nextImages(unsigned int n) {
+        std::vector<ImagePtr> images;
+        images.reserve(n);
+        ScopedGILRelease releaseGIL;
+        while (images.size() < n) {
+            auto image = imageIterator_->next();
+            if (!image)
+                break;
+            images.push_back(std::move(image));
+        }
+        return images;
+    }
+
     std::shared_ptr<ImageIterator> imageIterator_;
 };
 
+// Copies a one-dimensional array of any integer type. Values that do not fit in an unsigned int raise a ValueError
+// rather than wrapping.
+inline std::vector<unsigned int> columnFromArray(const np::ndarray &array) {
+    if (array.get_nd() != 1)
+        throw std::invalid_argument("Metadata columns must be one-dimensional arrays");
+    std::string kind = p::extract<std::string>(array.get_dtype().attr("kind"));
+    if (kind != "i" && kind != "u")
+        throw std::invalid_argument("Metadata columns must be integer arrays");
+    if (array.shape(0) && (array.attr("min")() < 0 || array.attr("max")() > std::numeric_limits<unsigned int>::max()))
+        throw std::invalid_argument("Metadata column values must be between 0 and " + std::to_string(std::numeric_limits<unsigned int>::max()));
+
+    auto column = array.astype(np::dtype::get_builtin<unsigned int>());
+    auto length = column.shape(0);
+    auto stride = column.strides(0);
+    auto data = column.get_data();
+    std::vector<unsigned int> values(length);
+    for (auto i = 0; i < length; ++i)
+        values[i] = *reinterpret_cast<const unsigned int*>(data + i * stride);
+    return values;
+}
+
 class PythonTASM : public TASM {
 public:
     PythonTASM()
@@ -59,15 +163,104 @@ public:
     {}
 
     void addBulkMetadataFromList(boost::python::list metadataInfo) {
-        addBulkMetadata(extract<MetadataInfo>(metadataInfo));
+        auto metadata = extract<MetadataInfo>(metadataInfo);
+        ScopedGILRelease releaseGIL;
+        addBulkMetadata(metadata);
+    }
+
+    // Boxes for a single video, with labels dictionary encoded: labelCodes index into labelNames.
+    void addBulkMetadataFromArrays(const std::string &video,
+                                   boost::python::list labelNames,
+                                   const np::ndarray &labelCodes,
+                                   const np::ndarray &frames,
+                                   const np::ndarray &x1s,
+                                   const np::ndarray &y1s,
+                                   const np::ndarray &x2s,
+                                   const np::ndarray &y2s) {
+        auto labelIds = columnFromArray(labelCodes);
+        auto metadata = BulkMetadata::fromColumns(
+                {video},
+                extract<std::string>(labelNames),
+                std::vector<unsigned int>(labelIds.size(), 0),
+                std::move(labelIds),
+                columnFromArray(frames),
+                columnFromArray(x1s),
+                columnFromArray(y1s),
+                columnFromArray(x2s),
+                columnFromArray(y2s));
+
+        ScopedGILRelease releaseGIL;
+        addBulkMetadata(metadata);
+    }
+
+    void pythonAddBulkMetadataFromCSV(const std::string &path) {
+        ScopedGILRelease releaseGIL;
+        addBulkMetadataFromCSV(path);
+    }
+
+    void pythonAddBulkMetadataFromCSV(const std::string &path, unsigned int numberOfThreads) {
+        ScopedGILRelease releaseGIL;
+        addBulkMetadataFromCSV(path, numberOfThreads);
+    }
+
+    void pythonStore(const std::string &videoPath, const std::string &savedName) {
+        ScopedGILRelease releaseGIL;
+        store(videoPath, savedName);
+    }
+
+    void pythonStoreWithUniformLayout(const std::string &videoPath, const std::string &savedName, unsigned int rows, unsigned int columns) {
+        ScopedGILRelease releaseGIL;
+        storeWithUniformLayout(videoPath, savedName, rows, columns);
+    }
+
+    void pythonStoreWithWorkloadLayout(const std::string &videoPath, const std::string &savedName, const PythonWorkload &workload) {
+        pythonStoreWithWorkloadLayout(videoPath, savedName, workload, false);
+    }
+
+    void pythonStoreWithWorkloadLayout(const std::string &videoPath, const std::string &savedName, const PythonWorkload &workload, bool adaptiveLayoutIntervals) {
+        auto tasmWorkload = workload.toWorkload(*this);
+        ScopedGILRelease releaseGIL;
+        storeWithWorkloadLayout(videoPath, savedName, tasmWorkload, adaptiveLayoutIntervals);
+    }
+
+    void pythonRetileWithWorkloadLayout(const std::string &video, const PythonWorkload &workload) {
+        auto tasmWorkload = workload.toWorkload(*this);
+        ScopedGILRelease releaseGIL;
+        retileWithWorkloadLayout(video, tasmWorkload);
+    }
+
+    void pythonRetileVideoBasedOnRegret(const std::string &video) {
+        ScopedGILRelease releaseGIL;
+        retileVideoBasedOnRegret(video);
+    }
+
+    void pythonStartBackgroundRetiling() {
+        startBackgroundRetiling();
+    }
+
+    void pythonStartBackgroundRetilingWithBudget(double gpuMillisecondsPerWindow, unsigned long long bytesPerWindow, double windowSeconds, double quietPeriodSeconds) {
+        RetileBudget budget;
+        budget.window = std::chrono::milliseconds(static_cast<long long>(windowSeconds * 1000));
+        budget.gpuMillisecondsPerWindow = gpuMillisecondsPerWindow;
+        budget.bytesPerWindow = bytesPerWindow;
+        budget.quietPeriod = std::chrono::milliseconds(static_cast<long long>(quietPeriodSeconds * 1000));
+        startBackgroundRetiling(budget);
+    }
+
+    void pythonStopBackgroundRetiling() {
+        // Waits for the GOP that is being re-tiled, which can take a while.
+        ScopedGILRelease releaseGIL;
+        stopBackgroundRetiling();
     }
 
     void pythonStoreWithNonUniformLayout(const std::string &videoPath, const std::string &savedName, const std::string &metadataIdentifier, const std::string &labelToTileAround) {
         // If "force" isn't specified, do the tiling.
+        ScopedGILRelease releaseGIL;
         storeWithNonUniformLayout(videoPath, savedName, metadataIdentifier, labelToTileAround, true);
     }
 
     void pythonStoreWithNonUniformLayout(const std::string &videoPath, const std::string &savedName, const std::string &metadataIdentifier, const std::string &labelToTileAround, bool force) {
+        ScopedGILRelease releaseGIL;
         storeWithNonUniformLayout(videoPath, savedName, metadataIdentifier, labelToTileAround, force);
     }
 
@@ -75,17 +268,20 @@ public:
                                        const std::string &label,
                                        unsigned int firstFrameInclusive,
                                        unsigned int lastFrameExclusive) {
+        ScopedGILRelease releaseGIL;
         return SelectionResults(select(video, label, firstFrameInclusive, lastFrameExclusive));
     }
 
     SelectionResults pythonSelect(const std::string &video,
                                   const std::string &label) {
+        ScopedGILRelease releaseGIL;
         return SelectionResults(select(video, label));
     }
 
     SelectionResults pythonSelect(const std::string &video,
                                   const std::string &label,
                                   unsigned int frame) {
+        ScopedGILRelease releaseGIL;
         return SelectionResults(select(video, label, frame));
     }
 
@@ -94,12 +290,14 @@ public:
                                   const std::string &label,
                                   unsigned int firstFrameInclusive,
                                   unsigned int lastFrameExclusive) {
+        ScopedGILRelease releaseGIL;
         return SelectionResults(select(video, label, firstFrameInclusive, lastFrameExclusive, metadataIdentifier));
     }
 
     SelectionResults pythonSelect(const std::string &video,
                                   const std::string &metadataIdentifier,
                                   const std::string &label) {
+        ScopedGILRelease releaseGIL;
         return SelectionResults(select(video, label, metadataIdentifier));
     }
 
@@ -107,26 +305,81 @@ public:
                                   const std::string &metadataIdentifier,
                                   const std::string &label,
                                   unsigned int frame) {
+        ScopedGILRelease releaseGIL;
         return SelectionResults(select(video, label, frame, metadataIdentifier));
     }
 
+    SelectionResults pythonSelectWithLimit(const std::string &video,
+                                           const std::string &label,
+                                           unsigned int limit) {
+        ScopedGILRelease releaseGIL;
+        return SelectionResults(select(video, label, "", limit));
+    }
+
+    SelectionResults pythonSelectWithLimit(const std::string &video,
+                                           const std::string &label,
+                                           unsigned int frame,
+                                           unsigned int limit) {
+        ScopedGILRelease releaseGIL;
+        return SelectionResults(select(video, label, frame, "", limit));
+    }
+
+    SelectionResults pythonSelectWithLimit(const std::string &video,
+                                           const std::string &label,
+                                           unsigned int firstFrameInclusive,
+                                           unsigned int lastFrameExclusive,
+                                           unsigned int limit) {
+        ScopedGILRelease releaseGIL;
+        return SelectionResults(select(video, label, firstFrameInclusive, lastFrameExclusive, "", limit));
+    }
+
+    SelectionResults pythonSelectWithLimit(const std::string &video,
+                                           const std::string &metadataIdentifier,
+                                           const std::string &label,
+                                           unsigned int limit) {
+        ScopedGILRelease releaseGIL;
+        return SelectionResults(select(video, label, metadataIdentifier, limit));
+    }
+
+    SelectionResults pythonSelectWithLimit(const std::string &video,
+                                           const std::string &metadataIdentifier,
+                                           const std::string &label,
+                                           unsigned int frame,
+                                           unsigned int limit) {
+        ScopedGILRelease releaseGIL;
+        return SelectionResults(select(video, label, frame, metadataIdentifier, limit));
+    }
+
+    SelectionResults pythonSelectWithLimit(const std::string &video,
+                                           const std::string &metadataIdentifier,
+                                           const std::string &label,
+                                           unsigned int firstFrameInclusive,
+                                           unsigned int lastFrameExclusive,
+                                           unsigned int limit) {
+        ScopedGILRelease releaseGIL;
+        return SelectionResults(select(video, label, firstFrameInclusive, lastFrameExclusive, metadataIdentifier, limit));
+    }
+
     SelectionResults pythonSelectTiles(const std::string &video,
                                         const std::string &metadataIdentifier,
                                         const std::string &label,
                                         unsigned int firstFrameInclusive,
                                         unsigned int lastFrameExclusive) {
+        ScopedGILRelease releaseGIL;
         return SelectionResults(selectTiles(video, label, firstFrameInclusive, lastFrameExclusive, metadataIdentifier));
     }
 
     SelectionResults pythonSelectTiles(const std::string &video,
                                        const std::string &metadataIdentifier,
                                        const std::string &label) {
+        ScopedGILRelease releaseGIL;
         return SelectionResults(selectTiles(video, label, metadataIdentifier));
     }
 
     SelectionResults pythonSelectFrames(const std::string &video,
                                         const std::string &metadataIdentifier,
                                         const std::string &label) {
+        ScopedGILRelease releaseGIL;
         return SelectionResults(selectFrames(video, label, metadataIdentifier));
     }
 
@@ -135,26 +388,136 @@ public:
                                         const std::string &label,
                                         unsigned int firstFrameInclusive,
                                         unsigned int lastFrameExclusive) {
+        ScopedGILRelease releaseGIL;
         return SelectionResults(selectFrames(video, label, firstFrameInclusive, lastFrameExclusive, metadataIdentifier));
     }
 
+    SelectionResults pythonSelectEveryNthFrame(const std::string &video,
+                                               const std::string &metadataIdentifier,
+                                               const std::string &label,
+                                               unsigned int n) {
+        ScopedGILRelease releaseGIL;
+        return SelectionResults(selectEveryNthFrame(video, label, n, metadataIdentifier));
+    }
+
+    SelectionResults pythonSelectEveryNthFrame(const std::string &video,
+                                               const std::string &metadataIdentifier,
+                                               const std::string &label,
+                                               unsigned int n,
+                                               unsigned int firstFrameInclusive,
+                                               unsigned int lastFrameExclusive) {
+        ScopedGILRelease releaseGIL;
+        return SelectionResults(selectEveryNthFrame(video, label, n, firstFrameInclusive, lastFrameExclusive, metadataIdentifier));
+    }
+
+    SelectionResults pythonSelectFramesPerGOP(const std::string &video,
+                                              const std::string &metadataIdentifier,
+                                              const std::string &label,
+                                              unsigned int framesPerGOP) {
+        ScopedGILRelease releaseGIL;
+        return SelectionResults(selectFramesPerGOP(video, label, framesPerGOP, metadataIdentifier));
+    }
+
+    SelectionResults pythonSelectFramesPerGOP(const std::string &video,
+                                              const std::string &metadataIdentifier,
+                                              const std::string &label,
+                                              unsigned int framesPerGOP,
+                                              unsigned int firstFrameInclusive,
+                                              unsigned int lastFrameExclusive) {
+        ScopedGILRelease releaseGIL;
+        return SelectionResults(selectFramesPerGOP(video, label, framesPerGOP, firstFrameInclusive, lastFrameExclusive, metadataIdentifier));
+    }
+
+    unsigned int pythonCount(const std::string &video,
+                             const std::string &metadataIdentifier,
+                             const std::string &label) {
+        ScopedGILRelease releaseGIL;
+        return count(video, label, metadataIdentifier);
+    }
+
+    unsigned int pythonCount(const std::string &video,
+                             const std::string &metadataIdentifier,
+                             const std::string &label,
+                             unsigned int firstFrameInclusive,
+                             unsigned int lastFrameExclusive) {
+        ScopedGILRelease releaseGIL;
+        return count(video, label, firstFrameInclusive, lastFrameExclusive, metadataIdentifier);
+    }
+
+    boost::python::list pythonFramesContaining(const std::string &video,
+                                               const std::string &metadataIdentifier,
+                                               const std::string &label) {
+        std::unique_ptr<std::vector<int>> frames;
+        {
+            ScopedGILRelease releaseGIL;
+            frames = framesContaining(video, label, metadataIdentifier);
+        }
+        return listify(*frames);
+    }
+
+    boost::python::list pythonFramesContaining(const std::string &video,
+                                               const std::string &metadataIdentifier,
+                                               const std::string &label,
+                                               unsigned int firstFrameInclusive,
+                                               unsigned int lastFrameExclusive) {
+        std::unique_ptr<std::vector<int>> frames;
+        {
+            ScopedGILRelease releaseGIL;
+            frames = framesContaining(video, label, firstFrameInclusive, lastFrameExclusive, metadataIdentifier);
+        }
+        return listify(*frames);
+    }
+
+    boost::python::dict pythonHistogram(const std::string &video,
+                                        const std::string &metadataIdentifier,
+                                        const std::string &label,
+                                        unsigned int bucketFrames) {
+        std::unique_ptr<std::map<int, unsigned int>> buckets;
+        {
+            ScopedGILRelease releaseGIL;
+            buckets = histogram(video, label, bucketFrames, metadataIdentifier);
+        }
+        return dictify(*buckets);
+    }
+
+    boost::python::dict pythonHistogram(const std::string &video,
+                                        const std::string &metadataIdentifier,
+                                        const std::string &label,
+                                        unsigned int bucketFrames,
+                                        unsigned int firstFrameInclusive,
+                                        unsigned int lastFrameExclusive) {
+        std::unique_ptr<std::map<int, unsigned int>> buckets;
+        {
+            ScopedGILRelease releaseGIL;
+            buckets = histogram(video, label, bucketFrames, firstFrameInclusive, lastFrameExclusive, metadataIdentifier);
+        }
+        return dictify(*buckets);
+    }
+
     void pythonActivateRegretBasedTilingForVideo(const std::string &video) {
+        ScopedGILRelease releaseGIL;
         return activateRegretBasedTilingForVideo(video);
     }
 
     void pythonActivateRegretBasedTilingForVideo(const std::string &video,
                                                 const std::string &metadataIdentifier) {
+        ScopedGILRelease releaseGIL;
         return activateRegretBasedTilingForVideo(video, metadataIdentifier);
     }
 
     void pythonActivateRegretBasedTilingForVideo(const std::string &video,
                                                  const std::string &metadataIdentifier,
                                                  double threshold) {
+        ScopedGILRelease releaseGIL;
         return activateRegretBasedTilingForVideo(video, metadataIdentifier, threshold);
     }
 
 };
 
+p::dict processStats() {
+    return SelectionResults::statsToDict(QueryStats::processWide());
+}
+
 PythonTASM *tasmFromWH(const std::string &whDBPath) {
     return new PythonTASM(SemanticIndex::IndexType::LegacyWH, whDBPath);
 }
@@ -165,6 +528,20 @@ void configureEnvironment(const boost::python::dict &kwargs) {
         options[EnvironmentConfiguration::DefaultLabelsDB] = boost::python::extract<std::string>(kwargs["default_db_path"]);
     if (kwargs.contains("catalog_path"))
         options[EnvironmentConfiguration::CatalogPath] = boost::python::extract<std::string>(kwargs["catalog_path"]);
+    if (kwargs.contains("tile_storage_format"))
+        options[EnvironmentConfiguration::TileFormat] = boost::python::extract<std::string>(kwargs["tile_storage_format"]);
+    if (kwargs.contains("read_ahead_depth"))
+        options[EnvironmentConfiguration::ReadAheadDepth] = std::to_string(boost::python::extract<unsigned int>(kwargs["read_ahead_depth"])());
+    if (kwargs.contains("read_ahead_bytes"))
+        options[EnvironmentConfiguration::ReadAheadBytes] = std::to_string(boost::python::extract<unsigned long long>(kwargs["read_ahead_bytes"])());
+    if (kwargs.contains("cost_profile_path"))
+        options[EnvironmentConfiguration::CostProfilePath] = boost::python::extract<std::string>(kwargs["cost_profile_path"]);
+    if (kwargs.contains("object_tile_qp"))
+        options[EnvironmentConfiguration::ObjectTileQP] = std::to_string(boost::python::extract<unsigned int>(kwargs["object_tile_qp"])());
+    if (kwargs.contains("background_tile_qp"))
+        options[EnvironmentConfiguration::BackgroundTileQP] = std::to_string(boost::python::extract<unsigned int>(kwargs["background_tile_qp"])());
+    if (kwargs.contains("compact_tiles"))
+        options[EnvironmentConfiguration::CompactTiles] = boost::python::extract<bool>(kwargs["compact_tiles"])() ? "true" : "false";
     EnvironmentConfiguration::instance(EnvironmentConfiguration(options));
 }
 
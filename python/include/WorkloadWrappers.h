@@ -11,6 +11,8 @@
 #include "Video.h"
 #include <boost/python/wrapper.hpp>
 
+#include <optional>
+
 namespace tasm::python {
 class Query {
 public:
@@ -114,30 +116,50 @@ public:
 
 class PythonTiledVideo {
 public:
+    // Uses the layout intervals that the video was stored with, or one-second intervals for videos that did not
+    // record them.
+    PythonTiledVideo(const std::string &metadataIdentifier,
+            const std::string &resourcesPath)
+        : PythonTiledVideo(metadataIdentifier, resourcesPath, std::nullopt)
+    {}
+
+    // gopLength is only used for videos that did not record their layout intervals.
     PythonTiledVideo(const std::string &metadataIdentifier,
             const std::string &resourcesPath,
             unsigned int gopLength)
-        : gopLength_(gopLength) {
-        auto tiledEntry = std::make_shared<TiledEntry>("", resourcesPath, metadataIdentifier);
-        auto tiledVideoManager = std::make_shared<TiledVideoManager>(tiledEntry);
-        tileLocationProvider_ = std::make_shared<SingleTileLocationProvider>(tiledVideoManager);
-    }
+        : PythonTiledVideo(metadataIdentifier, resourcesPath, std::optional<unsigned int>(gopLength))
+    {}
 
     std::shared_ptr<TileLayoutProvider> tileLayoutProvider() const { return tileLocationProvider_; }
-    unsigned int gopLength() const { return gopLength_; }
+    const LayoutIntervals &layoutIntervals() const { return layoutIntervals_; }
+    // The length of the intervals after the last explicit one; for uniform intervals, the length of every GOP.
+    unsigned int gopLength() const { return layoutIntervals_.lengthAfterLastInterval(); }
     std::shared_ptr<PythonTileLayout> tileLayoutForFrame(unsigned int frame) {
         return std::make_shared<PythonTileLayout>(*tileLocationProvider_->tileLayoutForFrame(frame));
     }
 
 private:
+    PythonTiledVideo(const std::string &metadataIdentifier,
+            const std::string &resourcesPath,
+            std::optional<unsigned int> defaultGOPLength)
+        : layoutIntervals_(1) {
+        auto tiledEntry = std::make_shared<TiledEntry>("", resourcesPath, metadataIdentifier);
+        auto tiledVideoManager = std::make_shared<TiledVideoManager>(tiledEntry);
+        tileLocationProvider_ = std::make_shared<SingleTileLocationProvider>(tiledVideoManager);
+        if (!defaultGOPLength)
+            defaultGOPLength = Video(tiledVideoManager->locationOfTileForId(0, 0)).configuration().frameRate;
+        layoutIntervals_ = LayoutIntervals::read(tiledEntry->path(), *defaultGOPLength);
+    }
+
     std::shared_ptr<SingleTileLocationProvider> tileLocationProvider_;
-    unsigned int gopLength_;
+    LayoutIntervals layoutIntervals_;
 };
 
 class PythonWorkloadCostEstimator {
 public:
     static CostElements estimateCostForWorkload(PythonWorkload &workload, PythonTiledVideo &video, TASM &tasm) {
-        auto workloadCostEstimator = WorkloadCostEstimator(video.tileLayoutProvider(), workload.toWorkload(tasm), video.gopLength());
+        ScopedGILRelease releaseGIL;
+        auto workloadCostEstimator = WorkloadCostEstimator(video.tileLayoutProvider(), workload.toWorkload(tasm), video.layoutIntervals());
         return workloadCostEstimator.estimateCostForWorkload();
     }
 };
@@ -1,8 +1,11 @@
 #ifndef PYTASM_UTILITIES_H
 #define PYTASM_UTILITIES_H
 
+#include <map>
 #include <vector>
+#include <boost/python/dict.hpp>
 #include <boost/python/list.hpp>
+#include <Python.h>
 
 template <typename T>
 std::vector<T> extract(boost::python::list l) {
@@ -21,4 +24,30 @@ boost::python::list listify(std::vector<T> vec) {
     return list;
 }
 
+template <typename Map>
+boost::python::dict dictify(const Map &map) {
+    auto dict = boost::python::dict();
+    for (const auto &kv : map)
+        dict[kv.first] = kv.second;
+    return dict;
+}
+
+// Releases the GIL for the lifetime of the object so that other Python threads can run while TASM works.
+// Nothing that touches Python objects may run while it is released.
+class ScopedGILRelease {
+public:
+    ScopedGILRelease()
+        : state_(PyEval_SaveThread())
+    {}
+
+    ScopedGILRelease(const ScopedGILRelease&) = delete;
+
+    ~ScopedGILRelease() {
+        PyEval_RestoreThread(state_);
+    }
+
+private:
+    PyThreadState *state_;
+};
+
 #endif //PYTASM_UTILITIES_H
@@ -4,4 +4,24 @@ from tasm._tasm import *
 def numpy_array(self):
     return self.array().reshape(self.height(), self.width(), -1)[:,:,:3]
 
-Image.numpy_array = numpy_array
\ No newline at end of file
+Image.numpy_array = numpy_array
+
+# Iterating over a selection yields each object as a (height, width, 4) RGBA array that shares the decoded pixels.
+ObjectIterator.__iter__ = lambda self: self
+
+_select = TASM.select
+def select(self, *args, limit=0):
+    # Stop scanning and decoding once `limit` objects have been returned.
+    if limit:
+        return self._select_with_limit(*args, limit)
+    return _select(self, *args)
+
+TASM.select = select
+
+def add_bulk_metadata_columns(self, video, labels, frames, x1, y1, x2, y2):
+    # Dictionary encode the labels so that only their codes cross into native code.
+    import numpy as np
+    label_names, label_codes = np.unique(np.asarray(labels), return_inverse=True)
+    self.add_bulk_metadata_arrays(video, [str(name) for name in label_names], label_codes, frames, x1, y1, x2, y2)
+
+TASM.add_bulk_metadata_columns = add_bulk_metadata_columns
@@ -16,12 +16,32 @@ tasm::python::SelectionResults (tasm::python::PythonTASM::*selectAll)(const std:
 tasm::python::SelectionResults (tasm::python::PythonTASM::*selectRangeWithMetadataID)(const std::string&, const std::string&, const std::string&, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonSelect;
 tasm::python::SelectionResults (tasm::python::PythonTASM::*selectEqualWithMetadataID)(const std::string&, const std::string&, const std::string&, unsigned int) = &tasm::python::PythonTASM::pythonSelect;
 tasm::python::SelectionResults (tasm::python::PythonTASM::*selectAllWithMetadataID)(const std::string&, const std::string&, const std::string&) = &tasm::python::PythonTASM::pythonSelect;
+tasm::python::SelectionResults (tasm::python::PythonTASM::*selectAllWithLimit)(const std::string&, const std::string&, unsigned int) = &tasm::python::PythonTASM::pythonSelectWithLimit;
+tasm::python::SelectionResults (tasm::python::PythonTASM::*selectEqualWithLimit)(const std::string&, const std::string&, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonSelectWithLimit;
+tasm::python::SelectionResults (tasm::python::PythonTASM::*selectRangeWithLimit)(const std::string&, const std::string&, unsigned int, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonSelectWithLimit;
+tasm::python::SelectionResults (tasm::python::PythonTASM::*selectAllWithMetadataIDAndLimit)(const std::string&, const std::string&, const std::string&, unsigned int) = &tasm::python::PythonTASM::pythonSelectWithLimit;
+tasm::python::SelectionResults (tasm::python::PythonTASM::*selectEqualWithMetadataIDAndLimit)(const std::string&, const std::string&, const std::string&, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonSelectWithLimit;
+tasm::python::SelectionResults (tasm::python::PythonTASM::*selectRangeWithMetadataIDAndLimit)(const std::string&, const std::string&, const std::string&, unsigned int, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonSelectWithLimit;
 tasm::python::SelectionResults (tasm::python::PythonTASM::*selectAllTiles)(const std::string&, const std::string&, const std::string&) = &tasm::python::PythonTASM::pythonSelectTiles;
 tasm::python::SelectionResults (tasm::python::PythonTASM::*selectRangeTiles)(const std::string&, const std::string&, const std::string&, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonSelectTiles;
 tasm::python::SelectionResults (tasm::python::PythonTASM::*selectAllFrames)(const std::string&, const std::string&, const std::string&) = &tasm::python::PythonTASM::pythonSelectFrames;
 tasm::python::SelectionResults (tasm::python::PythonTASM::*selectRangeFrames)(const std::string&, const std::string&, const std::string&, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonSelectFrames;
+tasm::python::SelectionResults (tasm::python::PythonTASM::*selectEveryNthFrameAll)(const std::string&, const std::string&, const std::string&, unsigned int) = &tasm::python::PythonTASM::pythonSelectEveryNthFrame;
+tasm::python::SelectionResults (tasm::python::PythonTASM::*selectEveryNthFrameRange)(const std::string&, const std::string&, const std::string&, unsigned int, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonSelectEveryNthFrame;
+tasm::python::SelectionResults (tasm::python::PythonTASM::*selectFramesPerGOPAll)(const std::string&, const std::string&, const std::string&, unsigned int) = &tasm::python::PythonTASM::pythonSelectFramesPerGOP;
+tasm::python::SelectionResults (tasm::python::PythonTASM::*selectFramesPerGOPRange)(const std::string&, const std::string&, const std::string&, unsigned int, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonSelectFramesPerGOP;
+unsigned int (tasm::python::PythonTASM::*countAll)(const std::string&, const std::string&, const std::string&) = &tasm::python::PythonTASM::pythonCount;
+unsigned int (tasm::python::PythonTASM::*countRange)(const std::string&, const std::string&, const std::string&, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonCount;
+boost::python::list (tasm::python::PythonTASM::*framesContainingAll)(const std::string&, const std::string&, const std::string&) = &tasm::python::PythonTASM::pythonFramesContaining;
+boost::python::list (tasm::python::PythonTASM::*framesContainingRange)(const std::string&, const std::string&, const std::string&, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonFramesContaining;
+boost::python::dict (tasm::python::PythonTASM::*histogramAll)(const std::string&, const std::string&, const std::string&, unsigned int) = &tasm::python::PythonTASM::pythonHistogram;
+boost::python::dict (tasm::python::PythonTASM::*histogramRange)(const std::string&, const std::string&, const std::string&, unsigned int, unsigned int, unsigned int) = &tasm::python::PythonTASM::pythonHistogram;
 void (tasm::python::PythonTASM::*storeForceNonUniformLayout)(const std::string&, const std::string&, const std::string&, const std::string&) = &tasm::python::PythonTASM::pythonStoreWithNonUniformLayout;
 void (tasm::python::PythonTASM::*storeDoNotForceNonUniformLayout)(const std::string&, const std::string&, const std::string&, const std::string&, bool) = &tasm::python::PythonTASM::pythonStoreWithNonUniformLayout;
+void (tasm::python::PythonTASM::*storeWithWorkloadLayout)(const std::string&, const std::string&, const tasm::python::PythonWorkload&) = &tasm::python::PythonTASM::pythonStoreWithWorkloadLayout;
+void (tasm::python::PythonTASM::*storeWithWorkloadLayoutAndIntervals)(const std::string&, const std::string&, const tasm::python::PythonWorkload&, bool) = &tasm::python::PythonTASM::pythonStoreWithWorkloadLayout;
+void (tasm::python::PythonTASM::*addBulkMetadataFromCSV)(const std::string&) = &tasm::python::PythonTASM::pythonAddBulkMetadataFromCSV;
+void (tasm::python::PythonTASM::*addBulkMetadataFromCSVWithThreads)(const std::string&, unsigned int) = &tasm::python::PythonTASM::pythonAddBulkMetadataFromCSV;
 void (tasm::python::PythonTASM::*activateRegretBasedTilingWithoutMetadataIdentifier)(const std::string&) = &tasm::python::PythonTASM::pythonActivateRegretBasedTilingForVideo;
 void (tasm::python::PythonTASM::*activateRegretBasedTilingWithMetadataIdentifier)(const std::string&, const std::string&) = &tasm::python::PythonTASM::pythonActivateRegretBasedTilingForVideo;
 void (tasm::python::PythonTASM::*activateRegretBasedTilingWithThreshold)(const std::string&, const std::string&, double) = &tasm::python::PythonTASM::pythonActivateRegretBasedTilingForVideo;
@@ -36,10 +56,17 @@ BOOST_PYTHON_MODULE(_tasm) {
             .def("is_empty", &tasm::python::PythonImage::isEmpty)
             .def("width", &tasm::python::PythonImage::width)
             .def("height", &tasm::python::PythonImage::height)
-            .def("array", &tasm::python::PythonImage::array);
+            .def("array", &tasm::python::PythonImage::array)
+            .def("shaped_array", &tasm::python::PythonImage::shapedArray);
 
+    // ObjectIterator.__iter__ is defined in tasm/__init__.py.
     class_<tasm::python::SelectionResults>("ObjectIterator", no_init)
-            .def("next", &tasm::python::SelectionResults::next);
+            .def("next", &tasm::python::SelectionResults::next)
+            .def("__next__", &tasm::python::SelectionResults::pythonNext)
+            .def("next_batch", &tasm::python::SelectionResults::nextBatch)
+            .def("next_padded_batch", &tasm::python::SelectionResults::nextPaddedBatch)
+            .def("stats", &tasm::python::SelectionResults::stats);
+
 
     class_<tasm::MetadataInfo>("MetadataInfo", init<std::string, std::string, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int>())
             .def_readonly("video", &tasm::MetadataInfo::video)
@@ -59,31 +86,61 @@ BOOST_PYTHON_MODULE(_tasm) {
     // Warning: The WH-type of index does not have a "video" column for legacy reasons.
     def("tasm_from_db", &tasm::python::tasmFromWH, return_value_policy<manage_new_object>());
     def("configure_environment", &tasm::python::configureEnvironment);
+    def("process_stats", &tasm::python::processStats);
 
     class_<tasm::python::PythonTASM, std::shared_ptr<tasm::python::PythonTASM>, bases<tasm::TASM>, boost::noncopyable>("TASM")
         .def(init<>())
         .def(init<tasm::SemanticIndex::IndexType, optional<std::string>>())
         .def("add_metadata", &tasm::python::PythonTASM::addMetadata)
         .def("add_bulk_metadata", &tasm::python::PythonTASM::addBulkMetadataFromList)
-        .def("store", &tasm::python::PythonTASM::store)
-        .def("store_with_uniform_layout", &tasm::python::PythonTASM::storeWithUniformLayout)
+        // Labels are dictionary encoded; see add_bulk_metadata_columns in tasm/__init__.py for plain label arrays.
+        .def("add_bulk_metadata_arrays", &tasm::python::PythonTASM::addBulkMetadataFromArrays)
+        .def("add_bulk_metadata_from_csv", addBulkMetadataFromCSV)
+        .def("add_bulk_metadata_from_csv", addBulkMetadataFromCSVWithThreads)
+        .def("store", &tasm::python::PythonTASM::pythonStore)
+        .def("store_with_uniform_layout", &tasm::python::PythonTASM::pythonStoreWithUniformLayout)
         .def("store_with_nonuniform_layout", storeForceNonUniformLayout)
         .def("store_with_nonuniform_layout", storeDoNotForceNonUniformLayout)
+        .def("store_with_workload_layout", storeWithWorkloadLayout)
+        .def("store_with_workload_layout", storeWithWorkloadLayoutAndIntervals)
         .def("select", selectRange)
         .def("select", selectEqual)
         .def("select", selectAll)
         .def("select", selectRangeWithMetadataID)
         .def("select", selectEqualWithMetadataID)
         .def("select", selectAllWithMetadataID)
+        // The limit is appended to the positional arguments by the Python package; see tasm/__init__.py.
+        .def("_select_with_limit", selectAllWithLimit)
+        .def("_select_with_limit", selectEqualWithLimit)
+        .def("_select_with_limit", selectRangeWithLimit)
+        .def("_select_with_limit", selectAllWithMetadataIDAndLimit)
+        .def("_select_with_limit", selectEqualWithMetadataIDAndLimit)
+        .def("_select_with_limit", selectRangeWithMetadataIDAndLimit)
         .def("select_tiles", selectAllTiles)
         .def("select_tiles", selectRangeTiles)
         .def("select_frames", selectAllFrames)
         .def("select_frames", selectRangeFrames)
+        .def("select_every_nth_frame", selectEveryNthFrameAll)
+        .def("select_every_nth_frame", selectEveryNthFrameRange)
+        .def("select_frames_per_gop", selectFramesPerGOPAll)
+        .def("select_frames_per_gop", selectFramesPerGOPRange)
+        .def("count", countAll)
+        .def("count", countRange)
+        .def("frames_containing", framesContainingAll)
+        .def("frames_containing", framesContainingRange)
+        .def("histogram", histogramAll)
+        .def("histogram", histogramRange)
         .def("activate_regret_based_tiling", activateRegretBasedTilingWithMetadataIdentifier)
         .def("activate_regret_based_tiling", activateRegretBasedTilingWithoutMetadataIdentifier)
         .def("activate_regret_based_tiling", activateRegretBasedTilingWithThreshold)
         .def("deactivate_regret_based_tiling", &tasm::python::PythonTASM::deactivateRegretBasedTilingForVideo)
-        .def("retile_based_on_regret", &tasm::python::PythonTASM::retileVideoBasedOnRegret);
+        .def("retile_based_on_regret", &tasm::python::PythonTASM::pythonRetileVideoBasedOnRegret)
+        .def("retile_with_workload_layout", &tasm::python::PythonTASM::pythonRetileWithWorkloadLayout)
+        .def("start_background_retiling", &tasm::python::PythonTASM::pythonStartBackgroundRetiling)
+        .def("start_background_retiling", &tasm::python::PythonTASM::pythonStartBackgroundRetilingWithBudget)
+        .def("stop_background_retiling", &tasm::python::PythonTASM::pythonStopBackgroundRetiling)
+        .def("start_tracing", &tasm::python::PythonTASM::startTracing)
+        .def("stop_tracing", &tasm::python::PythonTASM::stopTracing);
 
     class_<tasm::python::Query>("Query", init<std::string, std::string, unsigned int, unsigned int>())
         .def(init<std::string, std::string>())
@@ -103,7 +160,8 @@ BOOST_PYTHON_MODULE(_tasm) {
         .def("heights_of_rows", &tasm::python::PythonTileLayout::heightsAsList)
         .def("widths_of_cols", &tasm::python::PythonTileLayout::widthsAsList);
 
-    class_<tasm::python::PythonTiledVideo>("TiledVideo", init<std::string, std::string, unsigned int>())
+    class_<tasm::python::PythonTiledVideo>("TiledVideo", init<std::string, std::string>())
+         .def(init<std::string, std::string, unsigned int>())
          .def("gop_length", &tasm::python::PythonTiledVideo::gopLength)
          .def("layout_for_frame", &tasm::python::PythonTiledVideo::tileLayoutForFrame);
 
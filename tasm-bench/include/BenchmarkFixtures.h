@@ -0,0 +1,73 @@
+#ifndef TASM_BENCHMARKFIXTURES_H
+#define TASM_BENCHMARKFIXTURES_H
+
+#include "SemanticIndex.h"
+#include "bytestring.h"
+
+#include <algorithm>
+#include <experimental/filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tasm::bench {
+
+static const unsigned int FrameWidth = 1920;
+static const unsigned int FrameHeight = 1080;
+static const unsigned int GOPLength = 30;
+
+// Generates bounding boxes for objects that drift across the frame, which resembles the output of an object
+// tracker more closely than independent random boxes. The seed is fixed so that runs are comparable.
+inline std::vector<MetadataInfo> syntheticMetadata(const std::string &video,
+        const std::vector<std::string> &labels,
+        unsigned int numberOfFrames,
+        unsigned int objectsPerLabel) {
+    std::mt19937 generator(17);
+    std::uniform_int_distribution<int> position(0, FrameWidth - 1);
+    std::uniform_int_distribution<int> velocity(-8, 8);
+    std::uniform_int_distribution<int> size(32, 256);
+
+    struct Object {
+        int x, y, dx, dy, width, height;
+    };
+
+    std::vector<MetadataInfo> metadata;
+    for (const auto &label : labels) {
+        for (auto i = 0u; i < objectsPerLabel; ++i) {
+            Object object{position(generator), position(generator) % static_cast<int>(FrameHeight),
+                          velocity(generator), velocity(generator), size(generator), size(generator)};
+            for (auto frame = 0u; frame < numberOfFrames; ++frame) {
+                auto x1 = std::clamp(object.x + object.dx * static_cast<int>(frame), 0, static_cast<int>(FrameWidth) - object.width);
+                auto y1 = std::clamp(object.y + object.dy * static_cast<int>(frame), 0, static_cast<int>(FrameHeight) - object.height);
+                metadata.emplace_back(video, label, frame, x1, y1, x1 + object.width, y1 + object.height);
+            }
+        }
+    }
+    return metadata;
+}
+
+inline std::shared_ptr<SemanticIndex> syntheticIndex(const std::string &video,
+        const std::vector<std::string> &labels,
+        unsigned int numberOfFrames,
+        unsigned int objectsPerLabel) {
+    auto index = SemanticIndexFactory::createInMemory();
+    index->addBulkMetadata(syntheticMetadata(video, labels, numberOfFrames, objectsPerLabel));
+    return index;
+}
+
+// The checked-in tile streams are Annex B HEVC. birds-5frames.hevc holds the parameter sets and the first five
+// frames of python/Examples/data/birds.mp4.
+inline stitching::bytestring readTileStream(const std::string &name) {
+    auto path = std::experimental::filesystem::path(TASM_BENCH_DATA_DIR) / name;
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        throw std::runtime_error("Failed to open benchmark data " + path.string());
+    return stitching::bytestring((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+}
+
+} // namespace tasm::bench
+
+#endif //TASM_BENCHMARKFIXTURES_H
@@ -0,0 +1,82 @@
+#include "BenchmarkFixtures.h"
+#include "SemanticIndex.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace tasm;
+using namespace tasm::bench;
+
+static const std::string Video = "bench";
+static const unsigned int NumberOfFrames = 3000;
+
+static std::shared_ptr<SemanticIndex> sharedIndex() {
+    static auto index = syntheticIndex(Video, {"car", "person", "bird"}, NumberOfFrames, 4);
+    return index;
+}
+
+static void BM_SemanticIndexAddBulkMetadata(benchmark::State &state) {
+    auto metadata = syntheticMetadata(Video, {"car"}, state.range(0), 4);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto index = SemanticIndexFactory::createInMemory();
+        state.ResumeTiming();
+
+        index->addBulkMetadata(metadata);
+    }
+    state.SetItemsProcessed(state.iterations() * metadata.size());
+}
+BENCHMARK(BM_SemanticIndexAddBulkMetadata)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+static void BM_SemanticIndexAddBulkMetadataColumns(benchmark::State &state) {
+    BulkMetadata metadata;
+    for (const auto &m : syntheticMetadata(Video, {"car"}, state.range(0), 4))
+        metadata.add(m.video, m.label, m.frame, m.x1, m.y1, m.x2, m.y2);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto index = SemanticIndexFactory::createInMemory();
+        state.ResumeTiming();
+
+        index->addBulkMetadata(metadata);
+    }
+    state.SetItemsProcessed(state.iterations() * metadata.size());
+}
+BENCHMARK(BM_SemanticIndexAddBulkMetadataColumns)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+static void BM_SemanticIndexOrderedFramesForSelection(benchmark::State &state) {
+    auto index = sharedIndex();
+    auto selection = std::make_shared<SingleMetadataSelection>("car");
+    auto temporalSelection = std::make_shared<RangeTemporalSelection>(0, state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(index->orderedFramesForSelection(Video, selection, temporalSelection));
+}
+BENCHMARK(BM_SemanticIndexOrderedFramesForSelection)->Arg(30)->Arg(NumberOfFrames);
+
+static void BM_SemanticIndexRectanglesForFrame(benchmark::State &state) {
+    auto index = sharedIndex();
+    auto selection = std::make_shared<SingleMetadataSelection>("person");
+    auto frame = 0u;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index->rectanglesForFrame(Video, selection, frame, FrameWidth, FrameHeight));
+        frame = (frame + 1) % NumberOfFrames;
+    }
+}
+BENCHMARK(BM_SemanticIndexRectanglesForFrame);
+
+static void BM_SemanticIndexRectanglesForFrames(benchmark::State &state) {
+    auto index = sharedIndex();
+    auto selection = std::make_shared<SingleMetadataSelection>("person");
+    auto firstFrame = 0u;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index->rectanglesForFrames(Video, selection, firstFrame, firstFrame + GOPLength));
+        firstFrame = (firstFrame + GOPLength) % NumberOfFrames;
+    }
+}
+BENCHMARK(BM_SemanticIndexRectanglesForFrames);
+
+static void BM_SemanticIndexCountForSelection(benchmark::State &state) {
+    auto index = sharedIndex();
+    auto selection = std::make_shared<SingleMetadataSelection>("bird");
+    for (auto _ : state)
+        benchmark::DoNotOptimize(index->countForSelection(Video, selection, std::shared_ptr<TemporalSelection>()));
+}
+BENCHMARK(BM_SemanticIndexCountForSelection);
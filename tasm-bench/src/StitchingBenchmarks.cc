@@ -0,0 +1,71 @@
+#include "BenchmarkFixtures.h"
+#include "BitStream.h"
+#include "Emulation.h"
+#include "Golombs.h"
+#include "Stitcher.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace tasm::bench;
+using namespace stitching;
+
+static const std::string TileStream = "birds-5frames.hevc";
+
+static void BM_StitcherGetStitchedSegments(benchmark::State &state) {
+    auto numberOfColumns = static_cast<unsigned int>(state.range(0));
+    auto tile = readTileStream(TileStream);
+
+    // Every column holds the same tile stream; the stitched stream is only parsed and rewritten, never decoded.
+    StitchContext context({1, numberOfColumns},
+            {1088, FrameWidth * numberOfColumns},
+            {FrameHeight, FrameWidth * numberOfColumns});
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<bytestring> tiles(numberOfColumns, tile);
+        state.ResumeTiming();
+
+        Stitcher stitcher(context, tiles);
+        benchmark::DoNotOptimize(stitcher.GetStitchedSegments());
+    }
+    state.SetBytesProcessed(state.iterations() * tile.size() * numberOfColumns);
+}
+BENCHMARK(BM_StitcherGetStitchedSegments)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond);
+
+static void BM_RemoveEmulationPrevention(benchmark::State &state) {
+    auto tile = readTileStream(TileStream);
+    bytestring data(tile.begin(), tile.begin() + std::min<size_t>(tile.size(), state.range(0)));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(RemoveEmulationPrevention(data, 0, data.size()));
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_RemoveEmulationPrevention)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 17);
+
+static std::vector<unsigned long> syntheticGolombs(unsigned int count) {
+    std::mt19937 generator(17);
+    std::geometric_distribution<unsigned long> value(0.1);
+    std::vector<unsigned long> golombs(count);
+    for (auto &golomb : golombs)
+        golomb = value(generator);
+    return golombs;
+}
+
+static void BM_EncodeGolombs(benchmark::State &state) {
+    auto golombs = syntheticGolombs(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(EncodeGolombs(golombs));
+    state.SetItemsProcessed(state.iterations() * golombs.size());
+}
+BENCHMARK(BM_EncodeGolombs)->Arg(64)->Arg(4096);
+
+static void BM_DecodeGolomb(benchmark::State &state) {
+    auto golombs = syntheticGolombs(state.range(0));
+    auto encoded = EncodeGolombs(golombs);
+    for (auto _ : state) {
+        BitStream stream(encoded.begin(), encoded.begin());
+        for (auto i = 0u; i < golombs.size(); ++i)
+            benchmark::DoNotOptimize(DecodeGolomb(stream));
+    }
+    state.SetItemsProcessed(state.iterations() * golombs.size());
+}
+BENCHMARK(BM_DecodeGolomb)->Arg(64)->Arg(4096);
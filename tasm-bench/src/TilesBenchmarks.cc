@@ -0,0 +1,178 @@
+#include "BenchmarkFixtures.h"
+#include "HashMapIntervalTree.h"
+#include "IntervalTree.h"
+#include "RegretAccumulator.h"
+#include "SemanticDataManager.h"
+#include "TileConfigurationProvider.h"
+#include "WorkloadCostEstimator.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace tasm;
+using namespace tasm::bench;
+
+static const std::string Video = "bench";
+static const unsigned int NumberOfFrames = 300;
+
+static std::shared_ptr<SemanticIndex> sharedIndex() {
+    static auto index = syntheticIndex(Video, {"car", "person", "bird"}, NumberOfFrames, 4);
+    return index;
+}
+
+static std::shared_ptr<SemanticDataManager> semanticDataManagerForLabel(const std::string &label) {
+    return std::make_shared<SemanticDataManager>(sharedIndex(), Video, std::make_shared<SingleMetadataSelection>(label));
+}
+
+static std::vector<IntervalEntry<int>> syntheticIntervals(int numberOfIntervals) {
+    std::mt19937 generator(17);
+    std::uniform_int_distribution<int> start(0, 10 * numberOfIntervals);
+    std::uniform_int_distribution<int> length(1, 30);
+
+    std::vector<IntervalEntry<int>> intervals;
+    for (auto i = 0; i < numberOfIntervals; ++i) {
+        auto l = start(generator);
+        intervals.emplace_back(l, l + length(generator), i);
+    }
+    return intervals;
+}
+
+template <typename Tree>
+static void BM_IntervalTreeQuery(benchmark::State &state) {
+    auto numberOfIntervals = static_cast<int>(state.range(0));
+    auto intervals = syntheticIntervals(numberOfIntervals);
+    Tree tree(0, 10 * numberOfIntervals + 30, intervals);
+
+    std::mt19937 generator(17);
+    std::uniform_int_distribution<int> point(0, 10 * numberOfIntervals);
+    std::vector<IntervalEntry<int>> results;
+    for (auto _ : state) {
+        results.clear();
+        tree.query(point(generator), results);
+        benchmark::DoNotOptimize(results.data());
+    }
+}
+BENCHMARK_TEMPLATE(BM_IntervalTreeQuery, IntervalTree<int>)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_IntervalTreeQuery, HashMapIntervalTree<int>)->Arg(16)->Arg(256)->Arg(4096);
+
+static TileLayout uniformLayout(unsigned int numberOfColumns, unsigned int numberOfRows) {
+    return TileLayout(numberOfColumns, numberOfRows,
+            std::vector<unsigned int>(numberOfColumns, FrameWidth / numberOfColumns),
+            std::vector<unsigned int>(numberOfRows, FrameHeight / numberOfRows));
+}
+
+static std::vector<Rectangle> syntheticRectangles(unsigned int numberOfRectangles) {
+    std::vector<Rectangle> rectangles;
+    for (auto &metadata : syntheticMetadata(Video, {"car"}, 1, numberOfRectangles))
+        rectangles.emplace_back(rectangles.size(), metadata.x1, metadata.y1, metadata.x2 - metadata.x1, metadata.y2 - metadata.y1);
+    return rectangles;
+}
+
+static void BM_TileLayoutRectangleForTile(benchmark::State &state) {
+    auto layout = uniformLayout(state.range(0), state.range(0));
+    for (auto _ : state) {
+        for (auto tile = 0u; tile < layout.numberOfTiles(); ++tile)
+            benchmark::DoNotOptimize(layout.rectangleForTile(tile));
+    }
+    state.SetItemsProcessed(state.iterations() * layout.numberOfTiles());
+}
+BENCHMARK(BM_TileLayoutRectangleForTile)->Arg(2)->Arg(8)->Arg(32);
+
+static void BM_TileLayoutRectangleIdsThatIntersectTile(benchmark::State &state) {
+    auto layout = uniformLayout(state.range(0), state.range(0));
+    auto rectangles = syntheticRectangles(64);
+
+    for (auto _ : state) {
+        for (auto tile = 0u; tile < layout.numberOfTiles(); ++tile)
+            benchmark::DoNotOptimize(layout.rectangleIdsThatIntersectTile(rectangles, tile));
+    }
+    state.SetItemsProcessed(state.iterations() * layout.numberOfTiles());
+}
+BENCHMARK(BM_TileLayoutRectangleIdsThatIntersectTile)->Arg(2)->Arg(8)->Arg(32);
+
+// Compares finding the tiles that contain any of a frame's rectangles by testing every tile against every rectangle
+// with finding them through the layout's column and row offsets.
+static void BM_TileLayoutTilesForRectanglesByIntersection(benchmark::State &state) {
+    auto layout = uniformLayout(state.range(0), state.range(0));
+    auto rectangles = syntheticRectangles(state.range(1));
+    for (auto _ : state) {
+        TileMask tiles(layout.numberOfTiles());
+        for (auto tile = 0u; tile < layout.numberOfTiles(); ++tile) {
+            auto tileRectangle = layout.rectangleForTile(tile);
+            if (std::any_of(rectangles.begin(), rectangles.end(), [&](auto &rectangle) { return tileRectangle.intersects(rectangle); }))
+                tiles.set(tile);
+        }
+        benchmark::DoNotOptimize(tiles);
+    }
+    state.SetItemsProcessed(state.iterations() * rectangles.size());
+}
+BENCHMARK(BM_TileLayoutTilesForRectanglesByIntersection)->Args({2, 4})->Args({8, 4})->Args({20, 4})->Args({2, 64})->Args({8, 64})->Args({20, 64});
+
+static void BM_TileLayoutTilesForRectangles(benchmark::State &state) {
+    auto layout = uniformLayout(state.range(0), state.range(0));
+    auto rectangles = syntheticRectangles(state.range(1));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(layout.tilesForRectangles(rectangles));
+    state.SetItemsProcessed(state.iterations() * rectangles.size());
+}
+BENCHMARK(BM_TileLayoutTilesForRectangles)->Args({2, 4})->Args({8, 4})->Args({20, 4})->Args({2, 64})->Args({8, 64})->Args({20, 64});
+
+static void BM_FineGrainedTileLayoutForFrame(benchmark::State &state) {
+    auto semanticDataManager = semanticDataManagerForLabel("car");
+    for (auto _ : state) {
+        // Layouts are cached per GOP, so use a new provider to measure computing them.
+        FineGrainedTileConfigurationProvider provider(GOPLength, semanticDataManager, FrameWidth, FrameHeight);
+        for (auto frame = 0u; frame < NumberOfFrames; frame += GOPLength)
+            benchmark::DoNotOptimize(provider.tileLayoutForFrame(frame));
+    }
+    state.SetItemsProcessed(state.iterations() * NumberOfFrames / GOPLength);
+}
+BENCHMARK(BM_FineGrainedTileLayoutForFrame);
+
+static void BM_WorkloadCostEstimatorEstimateCostForQuery(benchmark::State &state) {
+    auto semanticDataManager = semanticDataManagerForLabel("person");
+    auto layoutProvider = std::make_shared<FineGrainedTileConfigurationProvider>(GOPLength, semanticDataManagerForLabel("car"), FrameWidth, FrameHeight);
+    auto workload = std::make_shared<Workload>(semanticDataManager);
+
+    // Warm the semantic data manager and layout caches so that only the estimate is measured.
+    WorkloadCostEstimator(layoutProvider, workload, GOPLength).estimateCostForQuery(0);
+
+    for (auto _ : state) {
+        WorkloadCostEstimator estimator(layoutProvider, workload, GOPLength);
+        std::unordered_map<unsigned int, CostElements> costByGOP;
+        benchmark::DoNotOptimize(estimator.estimateCostForQuery(0, &costByGOP));
+    }
+}
+BENCHMARK(BM_WorkloadCostEstimatorEstimateCostForQuery);
+
+static void BM_RegretAccumulatorAddRegretForQuery(benchmark::State &state) {
+    auto currentLayout = std::make_shared<SingleTileConfigurationProvider>(FrameWidth, FrameHeight);
+    std::vector<std::shared_ptr<Workload>> workloads{
+        std::make_shared<Workload>(semanticDataManagerForLabel("car")),
+        std::make_shared<Workload>(semanticDataManagerForLabel("person")),
+        std::make_shared<Workload>(semanticDataManagerForLabel("bird")),
+    };
+
+    for (auto _ : state) {
+        // Regret from earlier queries is re-evaluated for every new label, so start from an empty history.
+        RegretAccumulator accumulator(sharedIndex(), Video, FrameWidth, FrameHeight, GOPLength);
+        for (auto &workload : workloads)
+            accumulator.addRegretForQuery(workload, currentLayout);
+    }
+    state.SetItemsProcessed(state.iterations() * workloads.size());
+}
+BENCHMARK(BM_RegretAccumulatorAddRegretForQuery)->Unit(benchmark::kMillisecond);
+
+// A long history of repeated queries, followed by a new label that replays the history for its layouts.
+static void BM_RegretAccumulatorLongHistory(benchmark::State &state) {
+    auto currentLayout = std::make_shared<SingleTileConfigurationProvider>(FrameWidth, FrameHeight);
+    auto numberOfQueries = static_cast<unsigned int>(state.range(0));
+
+    for (auto _ : state) {
+        RegretAccumulator accumulator(sharedIndex(), Video, FrameWidth, FrameHeight, GOPLength);
+        for (auto i = 0u; i < numberOfQueries; ++i)
+            accumulator.addRegretForQuery(std::make_shared<Workload>(semanticDataManagerForLabel(i % 2 ? "car" : "person")), currentLayout);
+        accumulator.addRegretForQuery(std::make_shared<Workload>(semanticDataManagerForLabel("bird")), currentLayout);
+    }
+    state.SetItemsProcessed(state.iterations() * (numberOfQueries + 1));
+}
+BENCHMARK(BM_RegretAccumulatorLongHistory)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
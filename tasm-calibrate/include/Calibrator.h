@@ -0,0 +1,70 @@
+#ifndef TASM_CALIBRATOR_H
+#define TASM_CALIBRATOR_H
+
+#include "CostModel.h"
+
+#include <experimental/filesystem>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tasm {
+class TASM;
+} // namespace tasm
+
+namespace tasm::calibrate {
+
+// A query's decode time and what it decoded.
+struct DecodeSample {
+    double pixels;
+    double frames;
+    double reconfigurations;
+    double milliseconds;
+};
+
+// The average time to decode and re-encode one GOP of a stored video.
+struct EncodeSample {
+    double pixelsPerGOP;
+    double millisecondsPerGOP;
+};
+
+// Measures the cost model's coefficients on this machine. Each video is stored untiled, with uniform layouts, and with
+// a non-uniform layout, and the time per GOP of each store is an encode sample. Tiles are then selected around
+// synthetic objects of several sizes, so that queries decode different numbers of pixels, tiles, and tile dimensions,
+// and each query's statistics are a decode sample.
+// The videos are stored in a scratch catalog in the working directory, which is removed afterwards.
+class Calibrator {
+public:
+    Calibrator(std::vector<std::experimental::filesystem::path> videos, std::experimental::filesystem::path workingDirectory);
+    ~Calibrator();
+
+    CostProfile run(std::ostream &log);
+
+    // Least-squares fits with non-negative coefficients.
+    static CostProfile fitDecodeCoefficients(const std::vector<DecodeSample> &samples, CostProfile profile);
+    // The intercept can only be separated from the per-pixel cost when the videos have different resolutions.
+    // Otherwise the intercept keeps the profile's value.
+    static CostProfile fitEncodeCoefficients(const std::vector<EncodeSample> &samples, CostProfile profile);
+    // Tiling a frame into the four tiles of the smallest uniform layout costs more than decoding it whole, so a layout
+    // must decode at most this fraction of the untiled pixels to pay off.
+    static double tilingPixelThreshold(const CostProfile &profile, unsigned int frameWidth, unsigned int frameHeight);
+
+    // The number of times each query runs. The first run only warms up the decoder and the file system cache.
+    static constexpr unsigned int Repetitions = 3;
+    // How many GOPs at the start of each video are queried.
+    static constexpr unsigned int NumberOfGOPs = 4;
+
+private:
+    void calibrateVideo(const std::experimental::filesystem::path &video, unsigned int index, std::ostream &log);
+
+    std::vector<std::experimental::filesystem::path> videos_;
+    std::experimental::filesystem::path workingDirectory_;
+    std::unique_ptr<TASM> tasm_;
+    std::vector<DecodeSample> decodeSamples_;
+    std::vector<EncodeSample> encodeSamples_;
+};
+
+} // namespace tasm::calibrate
+
+#endif //TASM_CALIBRATOR_H
@@ -0,0 +1,259 @@
+#include "Calibrator.h"
+
+#include "Tasm.h"
+#include "TiledVideoManager.h"
+#include "Video.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <set>
+
+namespace tasm::calibrate {
+
+namespace {
+
+// Solves the n x n system whose rows are followed by their right-hand sides, by Gaussian elimination with partial
+// pivoting.
+std::vector<double> solve(std::vector<double> system, unsigned int n) {
+    auto at = [&](unsigned int row, unsigned int column) -> double& { return system[row * (n + 1) + column]; };
+    for (auto pivot = 0u; pivot < n; ++pivot) {
+        auto best = pivot;
+        for (auto row = pivot + 1; row < n; ++row) {
+            if (std::abs(at(row, pivot)) > std::abs(at(best, pivot)))
+                best = row;
+        }
+        for (auto column = 0u; column <= n; ++column)
+            std::swap(at(pivot, column), at(best, column));
+        if (at(pivot, pivot) == 0)
+            throw std::runtime_error("The calibration samples do not determine the cost model");
+        for (auto row = 0u; row < n; ++row) {
+            if (row == pivot)
+                continue;
+            auto factor = at(row, pivot) / at(pivot, pivot);
+            for (auto column = pivot; column <= n; ++column)
+                at(row, column) -= factor * at(pivot, column);
+        }
+    }
+
+    std::vector<double> solution(n);
+    for (auto row = 0u; row < n; ++row)
+        solution[row] = at(row, n) / at(row, row);
+    return solution;
+}
+
+// Least squares over the given columns of `terms`. Terms whose coefficients come out negative are dropped, most
+// negative first, until the rest are non-negative. Returns a coefficient for every column; dropped ones are 0.
+std::vector<double> fitNonNegative(const std::vector<std::vector<double>> &terms, const std::vector<double> &values, std::vector<unsigned int> columns) {
+    auto numberOfColumns = terms.empty() ? 0 : terms.front().size();
+    std::vector<double> coefficients(numberOfColumns, 0);
+    while (!columns.empty()) {
+        auto n = columns.size();
+        std::vector<double> system(n * (n + 1), 0);
+        for (auto sample = 0u; sample < terms.size(); ++sample) {
+            for (auto row = 0u; row < n; ++row) {
+                for (auto column = 0u; column < n; ++column)
+                    system[row * (n + 1) + column] += terms[sample][columns[row]] * terms[sample][columns[column]];
+                system[row * (n + 1) + n] += terms[sample][columns[row]] * values[sample];
+            }
+        }
+
+        auto solution = solve(std::move(system), n);
+        auto mostNegative = std::min_element(solution.begin(), solution.end());
+        if (*mostNegative >= 0) {
+            for (auto i = 0u; i < n; ++i)
+                coefficients[columns[i]] = solution[i];
+            break;
+        }
+        columns.erase(columns.begin() + std::distance(solution.begin(), mostNegative));
+    }
+    return coefficients;
+}
+
+} // namespace
+
+Calibrator::Calibrator(std::vector<std::experimental::filesystem::path> videos, std::experimental::filesystem::path workingDirectory)
+    : videos_(std::move(videos)),
+    workingDirectory_(std::move(workingDirectory)) {
+    if (videos_.empty())
+        throw std::invalid_argument("Calibration needs at least one video");
+
+    std::experimental::filesystem::remove_all(workingDirectory_);
+    std::experimental::filesystem::create_directories(workingDirectory_ / "catalog");
+
+    // Queries refine the cost model as they run, so point it at a scratch profile rather than the one being replaced.
+    EnvironmentConfiguration::instance(EnvironmentConfiguration({
+        {EnvironmentConfiguration::CatalogPath, (workingDirectory_ / "catalog").string()},
+        {EnvironmentConfiguration::DefaultLabelsDB, (workingDirectory_ / "labels.db").string()},
+        {EnvironmentConfiguration::CostProfilePath, (workingDirectory_ / "cost-profile").string()},
+    }));
+    tasm_ = std::make_unique<TASM>(workingDirectory_ / "labels.db");
+}
+
+Calibrator::~Calibrator() {
+    tasm_.reset();
+    std::experimental::filesystem::remove_all(workingDirectory_);
+}
+
+CostProfile Calibrator::run(std::ostream &log) {
+    for (auto i = 0u; i < videos_.size(); ++i)
+        calibrateVideo(videos_[i], i, log);
+
+    CostProfile profile;
+    profile = fitDecodeCoefficients(decodeSamples_, profile);
+    profile = fitEncodeCoefficients(encodeSamples_, profile);
+    Video firstVideo(videos_.front());
+    profile.tilingPixelThreshold = tilingPixelThreshold(profile, firstVideo.configuration().displayWidth, firstVideo.configuration().displayHeight);
+
+    std::set<double> resolutions;
+    for (const auto &sample : encodeSamples_)
+        resolutions.insert(sample.pixelsPerGOP);
+    if (resolutions.size() < 2)
+        log << "All videos have the same resolution and GOP length, so the fixed cost of encoding a GOP was not measured" << std::endl;
+    return profile;
+}
+
+void Calibrator::calibrateVideo(const std::experimental::filesystem::path &videoPath, unsigned int index, std::ostream &log) {
+    Video video(videoPath);
+    auto width = video.configuration().displayWidth;
+    auto height = video.configuration().displayHeight;
+    auto gopLength = video.configuration().frameRate;
+    auto name = "calibration-" + std::to_string(index);
+
+    auto timeStore = [&](const std::string &storedName, const std::function<void()> &store) {
+        auto start = std::chrono::steady_clock::now();
+        store();
+        auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        auto numberOfFrames = TiledVideoManager(std::make_shared<TiledEntry>(storedName)).maximumFrame() + 1;
+        auto numberOfGOPs = (numberOfFrames + gopLength - 1) / gopLength;
+        encodeSamples_.push_back({static_cast<double>(width) * height * gopLength, milliseconds / numberOfGOPs});
+        log << "Stored " << storedName << ": " << milliseconds / numberOfGOPs << " ms per GOP" << std::endl;
+        return numberOfFrames;
+    };
+
+    std::vector<std::string> storedNames{name};
+    auto numberOfFrames = timeStore(name, [&] { tasm_->store(videoPath, name); });
+    auto lastFrameExclusive = std::min(numberOfFrames, NumberOfGOPs * gopLength);
+
+    // Objects of several sizes, so that queries decode different fractions of each layout. The moving object also
+    // gives the non-uniform layout tiles of different dimensions.
+    std::vector<std::string> labels{"whole", "quarter", "corner", "moving"};
+    for (auto frame = 0u; frame < lastFrameExclusive; ++frame) {
+        tasm_->addMetadata(name, "whole", frame, 0, 0, width, height);
+        tasm_->addMetadata(name, "quarter", frame, width / 4, height / 4, 3 * width / 4, 3 * height / 4);
+        tasm_->addMetadata(name, "corner", frame, 0, 0, width / 8, height / 8);
+        auto x = (frame % gopLength) * (width - width / 8) / gopLength;
+        tasm_->addMetadata(name, "moving", frame, x, height / 2, x + width / 8, height / 2 + height / 8);
+    }
+
+    // HEVC tiles must be at least 256 pixels wide and 64 pixels tall.
+    for (auto tiles : {2u, 4u}) {
+        if (width / tiles < 256 || height / tiles < 64)
+            continue;
+        auto storedName = name + "-" + std::to_string(tiles) + "x" + std::to_string(tiles);
+        timeStore(storedName, [&] { tasm_->storeWithUniformLayout(videoPath, storedName, tiles, tiles); });
+        storedNames.push_back(storedName);
+    }
+    auto nonUniformName = name + "-nonuniform";
+    timeStore(nonUniformName, [&] { tasm_->storeWithNonUniformLayout(videoPath, nonUniformName, name, "moving", true); });
+    storedNames.push_back(nonUniformName);
+
+    for (const auto &storedName : storedNames) {
+        for (const auto &label : labels) {
+            for (auto repetition = 0u; repetition < Repetitions; ++repetition) {
+                auto images = tasm_->selectTiles(storedName, label, 0, lastFrameExclusive, name);
+                while (images->next()) {}
+                if (!repetition)
+                    continue;
+
+                const auto &stats = *images->stats();
+                decodeSamples_.push_back({
+                    static_cast<double>(stats.get(QueryStats::Counter::PixelsDecoded)),
+                    static_cast<double>(stats.get(QueryStats::Counter::FramesDecoded)),
+                    static_cast<double>(stats.get(QueryStats::Counter::DecoderReconfigurations)),
+                    CostModel::decodeTimeInMilliseconds(stats),
+                });
+            }
+        }
+        log << "Selected from " << storedName << std::endl;
+    }
+}
+
+CostProfile Calibrator::fitDecodeCoefficients(const std::vector<DecodeSample> &samples, CostProfile profile) {
+    if (samples.empty())
+        return profile;
+
+    // Fit multiples of the profile's coefficients so that the terms are of similar magnitude.
+    std::vector<double> scales{
+        profile.decodeCostPerPixel > 0 ? profile.decodeCostPerPixel : CostProfile().decodeCostPerPixel,
+        profile.decodeCostPerTile > 0 ? profile.decodeCostPerTile : CostProfile().decodeCostPerTile,
+        profile.decodeCostPerReconfiguration > 0 ? profile.decodeCostPerReconfiguration : CostProfile().decodeCostPerTile,
+    };
+    std::vector<std::vector<double>> terms;
+    std::vector<double> values;
+    std::vector<bool> isExercised(scales.size(), false);
+    for (const auto &sample : samples) {
+        terms.push_back({scales[0] * sample.pixels, scales[1] * sample.frames, scales[2] * sample.reconfigurations});
+        values.push_back(sample.milliseconds);
+        for (auto i = 0u; i < scales.size(); ++i)
+            isExercised[i] = isExercised[i] || terms.back()[i] > 0;
+    }
+
+    // Terms that no sample exercised keep the profile's coefficients.
+    std::vector<unsigned int> columns;
+    for (auto i = 0u; i < scales.size(); ++i) {
+        if (isExercised[i])
+            columns.push_back(i);
+    }
+    auto multiples = fitNonNegative(terms, values, columns);
+    if (isExercised[0])
+        profile.decodeCostPerPixel = multiples[0] * scales[0];
+    if (isExercised[1])
+        profile.decodeCostPerTile = multiples[1] * scales[1];
+    if (isExercised[2])
+        profile.decodeCostPerReconfiguration = multiples[2] * scales[2];
+    return profile;
+}
+
+CostProfile Calibrator::fitEncodeCoefficients(const std::vector<EncodeSample> &samples, CostProfile profile) {
+    if (samples.empty())
+        return profile;
+
+    std::set<double> resolutions;
+    double totalPixels = 0;
+    double totalMilliseconds = 0;
+    for (const auto &sample : samples) {
+        resolutions.insert(sample.pixelsPerGOP);
+        totalPixels += sample.pixelsPerGOP;
+        totalMilliseconds += sample.millisecondsPerGOP;
+    }
+
+    if (resolutions.size() < 2) {
+        auto pixels = totalPixels / samples.size();
+        auto milliseconds = totalMilliseconds / samples.size();
+        profile.encodeCostPerGOP = std::min(profile.encodeCostPerGOP, milliseconds);
+        profile.encodeCostPerPixel = (milliseconds - profile.encodeCostPerGOP) / pixels;
+        return profile;
+    }
+
+    // Fit millions of pixels so that both terms are of similar magnitude.
+    std::vector<std::vector<double>> terms;
+    std::vector<double> values;
+    for (const auto &sample : samples) {
+        terms.push_back({sample.pixelsPerGOP / 1e6, 1});
+        values.push_back(sample.millisecondsPerGOP);
+    }
+    auto coefficients = fitNonNegative(terms, values, {0, 1});
+    profile.encodeCostPerPixel = coefficients[0] / 1e6;
+    profile.encodeCostPerGOP = coefficients[1];
+    return profile;
+}
+
+double Calibrator::tilingPixelThreshold(const CostProfile &profile, unsigned int frameWidth, unsigned int frameHeight) {
+    double pixels = static_cast<double>(frameWidth) * frameHeight;
+    return std::clamp(profile.decodeCost(pixels, 1) / profile.decodeCost(pixels, 4), 0.5, 1.0);
+}
+
+} // namespace tasm::calibrate
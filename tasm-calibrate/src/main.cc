@@ -0,0 +1,45 @@
+#include "Calibrator.h"
+
+#include <iostream>
+
+using namespace tasm;
+using namespace tasm::calibrate;
+
+static void printUsage(const char *program) {
+    std::cerr << "Usage: " << program << " <cost profile path> <video path> [<video path> ...]" << std::endl
+              << "Videos with different resolutions let the fixed cost of encoding a GOP be measured." << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::experimental::filesystem::path profilePath = std::experimental::filesystem::absolute(argv[1]);
+    std::vector<std::experimental::filesystem::path> videos;
+    for (auto i = 2; i < argc; ++i)
+        videos.push_back(std::experimental::filesystem::absolute(argv[i]));
+
+    try {
+        CostProfile profile;
+        {
+            Calibrator calibrator(videos, std::experimental::filesystem::temp_directory_path() / "tasm-calibration");
+            profile = calibrator.run(std::cout);
+        }
+        profile.write(profilePath);
+
+        std::cout << "decode: " << profile.decodeCostPerPixel << " ms/pixel, "
+                  << profile.decodeCostPerTile << " ms/tile frame, "
+                  << profile.decodeCostPerReconfiguration << " ms/reconfiguration" << std::endl
+                  << "encode: " << profile.encodeCostPerPixel << " ms/pixel, "
+                  << profile.encodeCostPerGOP << " ms/GOP" << std::endl
+                  << "tiling pixel threshold: " << profile.tilingPixelThreshold << std::endl
+                  << "Wrote " << profilePath.string() << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef TASM_REPLAYWORKLOAD_H
+#define TASM_REPLAYWORKLOAD_H
+
+#include <experimental/filesystem>
+#include <istream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tasm::replay {
+
+struct ReplayQuery {
+    enum class Strategy {
+        Objects,
+        Tiles,
+        Frames,
+    };
+
+    double weight;
+    Strategy strategy;
+    std::string video;
+    std::string metadataIdentifier;
+    std::string label;
+    // Half-open [first, last) range of frames. When not set, every frame is selected.
+    std::optional<std::pair<unsigned int, unsigned int>> frames;
+};
+
+// A workload file is line based. Blank lines and text after '#' are ignored. Every other line is either a setting
+// or a query:
+//   arrival_rate <queries per second>   Poisson arrivals; 0 (the default) issues the next query as soon as a worker is free.
+//   concurrency <workers>               Number of queries that may execute at once. Defaults to 1.
+//   number_of_queries <n>               Number of queries to issue. Defaults to 100.
+//   seed <seed>                         Seeds the query mix and the arrivals. Defaults to 17.
+//   retile_after <n>                    Activate regret-based tiling once n queries have been issued.
+//   retile_every <n>                    Once activated, re-tile based on regret after every n completed queries. Defaults to 10.
+//   regret_threshold <threshold>        Threshold passed to activateRegretBasedTilingForVideo. Defaults to 0.
+//   query <weight> <objects|tiles|frames> <video> <metadata identifier|-> <label> [<first frame> <last frame>]
+// A metadata identifier of "-" means that it is the same as the video name.
+class ReplayWorkload {
+public:
+    explicit ReplayWorkload(const std::experimental::filesystem::path &path);
+    explicit ReplayWorkload(std::istream &stream) {
+        parse(stream);
+    }
+
+    const std::vector<ReplayQuery> &queries() const { return queries_; }
+    double arrivalRate() const { return arrivalRate_; }
+    unsigned int concurrency() const { return concurrency_; }
+    unsigned int numberOfQueries() const { return numberOfQueries_; }
+    unsigned int seed() const { return seed_; }
+    const std::optional<unsigned int> &retileAfter() const { return retileAfter_; }
+    unsigned int retileEvery() const { return retileEvery_; }
+    double regretThreshold() const { return regretThreshold_; }
+
+private:
+    void parse(std::istream &stream);
+
+    std::vector<ReplayQuery> queries_;
+    double arrivalRate_ = 0;
+    unsigned int concurrency_ = 1;
+    unsigned int numberOfQueries_ = 100;
+    unsigned int seed_ = 17;
+    std::optional<unsigned int> retileAfter_;
+    unsigned int retileEvery_ = 10;
+    double regretThreshold_ = 0;
+};
+
+} // namespace tasm::replay
+
+#endif //TASM_REPLAYWORKLOAD_H
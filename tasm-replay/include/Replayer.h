@@ -0,0 +1,107 @@
+#ifndef TASM_REPLAYER_H
+#define TASM_REPLAYER_H
+
+#include "ReplayWorkload.h"
+
+#include <atomic>
+#include <chrono>
+#include <experimental/filesystem>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tasm {
+class TASM;
+} // namespace tasm
+
+namespace tasm::replay {
+
+struct QueryResult {
+    unsigned int queryIndex;
+    unsigned int workloadQuery;
+    // Whether the query was issued after regret-based tiling was activated.
+    bool afterRetilingActivated;
+    std::chrono::steady_clock::time_point arrival;
+    std::chrono::steady_clock::time_point completion;
+    unsigned long long images;
+    unsigned long long pixelsDecoded;
+    unsigned long long bytesRead;
+
+    // Latency includes the time spent waiting for a free worker, so it grows when the arrival rate exceeds the
+    // throughput.
+    std::chrono::nanoseconds latency() const { return completion - arrival; }
+};
+
+class ReplaySummary {
+public:
+    explicit ReplaySummary(const std::vector<QueryResult> &results);
+
+    std::chrono::nanoseconds latencyPercentile(double percentile) const;
+    double imagesPerSecond() const { return images_ / seconds(); }
+    double pixelsDecodedPerSecond() const { return pixelsDecoded_ / seconds(); }
+    unsigned long long bytesRead() const { return bytesRead_; }
+    unsigned int numberOfQueries() const { return latencies_.size(); }
+
+    void print(std::ostream &stream, const std::string &title) const;
+
+private:
+    double seconds() const { return std::chrono::duration<double>(duration_).count(); }
+
+    // Sorted.
+    std::vector<std::chrono::nanoseconds> latencies_;
+    std::chrono::nanoseconds duration_;
+    unsigned long long images_;
+    unsigned long long pixelsDecoded_;
+    unsigned long long bytesRead_;
+};
+
+// Replays a workload against a catalog and metadata database.
+// Each worker owns its own TASM instance because the semantic index reuses prepared statements. Regret-based tiling is
+// only activated on the first worker's instance, so each video has one regret accumulator and is re-tiled once per
+// round rather than once per worker. Its regret comes from the queries that the first worker executes, which are a
+// random sample of the workload. Re-tiling waits for in-flight queries to finish so that queries never read a GOP that
+// is being re-tiled, and the other workers see the new tiles through the video's manifest.
+class Replayer {
+public:
+    Replayer(const ReplayWorkload &workload, const std::experimental::filesystem::path &labelsDatabasePath);
+    ~Replayer();
+
+    std::vector<QueryResult> run();
+
+    std::chrono::nanoseconds retilingTime() const { return retilingTime_; }
+    unsigned int numberOfRetilings() const { return numberOfRetilings_; }
+
+private:
+    void runWorker(unsigned int worker);
+    QueryResult execute(unsigned int worker, unsigned int queryIndex, bool afterActivation);
+    void activateRegretBasedTiling();
+    void retileBasedOnRegret();
+
+    static constexpr unsigned int RegretWorker = 0;
+
+    const ReplayWorkload &workload_;
+    std::vector<std::unique_ptr<TASM>> workers_;
+    // Written by the regret worker while holding retileMutex_ shared, and read while holding it exclusively.
+    bool regretActivated_;
+    // Regret is accumulated for each video using the metadata identifier of the first query against it.
+    std::unordered_map<std::string, std::string> videoToMetadataIdentifier_;
+    std::vector<unsigned int> schedule_;
+    std::vector<std::chrono::nanoseconds> arrivalOffsets_;
+    std::chrono::steady_clock::time_point start_;
+
+    std::atomic<unsigned int> nextQuery_;
+    std::atomic<unsigned int> completedAfterActivation_;
+    std::shared_mutex retileMutex_;
+    std::mutex resultsMutex_;
+    std::vector<QueryResult> results_;
+    std::chrono::nanoseconds retilingTime_;
+    unsigned int numberOfRetilings_;
+};
+
+} // namespace tasm::replay
+
+#endif //TASM_REPLAYER_H
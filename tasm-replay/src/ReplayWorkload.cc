@@ -0,0 +1,92 @@
+#include "ReplayWorkload.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace tasm::replay {
+
+ReplayWorkload::ReplayWorkload(const std::experimental::filesystem::path &path) {
+    std::ifstream stream(path);
+    if (!stream)
+        throw std::runtime_error("Failed to open workload " + path.string());
+    parse(stream);
+}
+
+static ReplayQuery::Strategy strategyFromString(const std::string &strategy, unsigned int lineNumber) {
+    if (strategy == "objects")
+        return ReplayQuery::Strategy::Objects;
+    else if (strategy == "tiles")
+        return ReplayQuery::Strategy::Tiles;
+    else if (strategy == "frames")
+        return ReplayQuery::Strategy::Frames;
+
+    throw std::runtime_error("Line " + std::to_string(lineNumber) + ": unknown strategy \"" + strategy + "\"");
+}
+
+template <typename T>
+static T readValue(std::istringstream &line, const std::string &key, unsigned int lineNumber) {
+    T value;
+    if (!(line >> value))
+        throw std::runtime_error("Line " + std::to_string(lineNumber) + ": missing or invalid value for " + key);
+    return value;
+}
+
+void ReplayWorkload::parse(std::istream &stream) {
+    std::string text;
+    unsigned int lineNumber = 0;
+    while (std::getline(stream, text)) {
+        ++lineNumber;
+        auto comment = text.find('#');
+        if (comment != std::string::npos)
+            text.erase(comment);
+
+        std::istringstream line(text);
+        std::string key;
+        if (!(line >> key))
+            continue;
+
+        if (key == "arrival_rate")
+            arrivalRate_ = readValue<double>(line, key, lineNumber);
+        else if (key == "concurrency")
+            concurrency_ = readValue<unsigned int>(line, key, lineNumber);
+        else if (key == "number_of_queries")
+            numberOfQueries_ = readValue<unsigned int>(line, key, lineNumber);
+        else if (key == "seed")
+            seed_ = readValue<unsigned int>(line, key, lineNumber);
+        else if (key == "retile_after")
+            retileAfter_ = readValue<unsigned int>(line, key, lineNumber);
+        else if (key == "retile_every")
+            retileEvery_ = readValue<unsigned int>(line, key, lineNumber);
+        else if (key == "regret_threshold")
+            regretThreshold_ = readValue<double>(line, key, lineNumber);
+        else if (key == "query") {
+            ReplayQuery query;
+            query.weight = readValue<double>(line, "query weight", lineNumber);
+            query.strategy = strategyFromString(readValue<std::string>(line, "query strategy", lineNumber), lineNumber);
+            query.video = readValue<std::string>(line, "query video", lineNumber);
+            query.metadataIdentifier = readValue<std::string>(line, "query metadata identifier", lineNumber);
+            if (query.metadataIdentifier == "-")
+                query.metadataIdentifier = query.video;
+            query.label = readValue<std::string>(line, "query label", lineNumber);
+
+            unsigned int firstFrame;
+            if (line >> firstFrame)
+                query.frames = std::make_pair(firstFrame, readValue<unsigned int>(line, "query last frame", lineNumber));
+
+            if (query.weight <= 0)
+                throw std::runtime_error("Line " + std::to_string(lineNumber) + ": query weights must be positive");
+            queries_.push_back(std::move(query));
+        } else
+            throw std::runtime_error("Line " + std::to_string(lineNumber) + ": unknown setting \"" + key + "\"");
+    }
+
+    if (queries_.empty())
+        throw std::runtime_error("Workload does not contain any queries");
+    if (!concurrency_)
+        throw std::runtime_error("concurrency must be at least 1");
+    if (!retileEvery_)
+        throw std::runtime_error("retile_every must be at least 1");
+}
+
+} // namespace tasm::replay
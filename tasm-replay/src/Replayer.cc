@@ -0,0 +1,193 @@
+#include "Replayer.h"
+
+#include "Tasm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <thread>
+
+namespace tasm::replay {
+
+ReplaySummary::ReplaySummary(const std::vector<QueryResult> &results)
+    : duration_(0), images_(0), pixelsDecoded_(0), bytesRead_(0) {
+    if (results.empty())
+        return;
+
+    auto firstArrival = results.front().arrival;
+    auto lastCompletion = results.front().completion;
+    for (const auto &result : results) {
+        latencies_.push_back(result.latency());
+        firstArrival = std::min(firstArrival, result.arrival);
+        lastCompletion = std::max(lastCompletion, result.completion);
+        images_ += result.images;
+        pixelsDecoded_ += result.pixelsDecoded;
+        bytesRead_ += result.bytesRead;
+    }
+    std::sort(latencies_.begin(), latencies_.end());
+    duration_ = lastCompletion - firstArrival;
+}
+
+std::chrono::nanoseconds ReplaySummary::latencyPercentile(double percentile) const {
+    if (latencies_.empty())
+        return std::chrono::nanoseconds(0);
+
+    // Nearest-rank percentile.
+    auto rank = static_cast<unsigned int>(std::ceil(percentile / 100 * latencies_.size()));
+    return latencies_[std::clamp(rank, 1u, static_cast<unsigned int>(latencies_.size())) - 1];
+}
+
+void ReplaySummary::print(std::ostream &stream, const std::string &title) const {
+    auto milliseconds = [](std::chrono::nanoseconds duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    };
+
+    stream << title << " (" << numberOfQueries() << " queries)" << std::endl;
+    if (!numberOfQueries())
+        return;
+
+    stream << std::fixed << std::setprecision(2)
+           << "  latency p50: " << milliseconds(latencyPercentile(50)) << " ms" << std::endl
+           << "  latency p95: " << milliseconds(latencyPercentile(95)) << " ms" << std::endl
+           << "  latency p99: " << milliseconds(latencyPercentile(99)) << " ms" << std::endl
+           << "  images/s: " << imagesPerSecond() << std::endl
+           << "  decoded pixels/s: " << pixelsDecodedPerSecond() << std::endl
+           << "  bytes read: " << bytesRead() << std::endl;
+}
+
+Replayer::Replayer(const ReplayWorkload &workload, const std::experimental::filesystem::path &labelsDatabasePath)
+    : workload_(workload),
+    regretActivated_(false),
+    nextQuery_(0),
+    completedAfterActivation_(0),
+    retilingTime_(0),
+    numberOfRetilings_(0) {
+    for (auto i = 0u; i < workload_.concurrency(); ++i)
+        workers_.push_back(std::make_unique<TASM>(labelsDatabasePath));
+
+    for (const auto &query : workload_.queries())
+        videoToMetadataIdentifier_.emplace(query.video, query.metadataIdentifier);
+
+    // Draw the query mix and arrivals up front so that a seed always produces the same sequence, regardless of how
+    // queries are spread across workers.
+    std::mt19937 generator(workload_.seed());
+    std::vector<double> weights;
+    for (const auto &query : workload_.queries())
+        weights.push_back(query.weight);
+    std::discrete_distribution<unsigned int> queryDistribution(weights.begin(), weights.end());
+
+    std::exponential_distribution<double> interarrival(workload_.arrivalRate() > 0 ? workload_.arrivalRate() : 1);
+    double arrival = 0;
+    for (auto i = 0u; i < workload_.numberOfQueries(); ++i) {
+        schedule_.push_back(queryDistribution(generator));
+        if (workload_.arrivalRate() > 0)
+            arrival += interarrival(generator);
+        arrivalOffsets_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(arrival)));
+    }
+}
+
+Replayer::~Replayer() = default;
+
+std::vector<QueryResult> Replayer::run() {
+    start_ = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (auto i = 0u; i < workers_.size(); ++i)
+        threads.emplace_back(&Replayer::runWorker, this, i);
+    for (auto &thread : threads)
+        thread.join();
+
+    std::sort(results_.begin(), results_.end(), [](const QueryResult &a, const QueryResult &b) {
+        return a.queryIndex < b.queryIndex;
+    });
+    return results_;
+}
+
+void Replayer::runWorker(unsigned int worker) {
+    Tracer::instance().setCurrentThreadName("replay worker " + std::to_string(worker));
+
+    for (auto queryIndex = nextQuery_++; queryIndex < schedule_.size(); queryIndex = nextQuery_++) {
+        bool afterActivation = workload_.retileAfter().has_value() && queryIndex >= *workload_.retileAfter();
+        if (afterActivation && worker == RegretWorker && !regretActivated_) {
+            std::shared_lock lock(retileMutex_);
+            activateRegretBasedTiling();
+        }
+
+        auto result = execute(worker, queryIndex, afterActivation);
+        {
+            std::scoped_lock lock(resultsMutex_);
+            results_.push_back(result);
+        }
+
+        if (afterActivation && !(++completedAfterActivation_ % workload_.retileEvery()))
+            retileBasedOnRegret();
+    }
+}
+
+QueryResult Replayer::execute(unsigned int worker, unsigned int queryIndex, bool afterActivation) {
+    const auto &query = workload_.queries()[schedule_[queryIndex]];
+    auto &tasm = *workers_[worker];
+
+    QueryResult result{};
+    result.queryIndex = queryIndex;
+    result.workloadQuery = schedule_[queryIndex];
+    result.afterRetilingActivated = afterActivation;
+
+    if (workload_.arrivalRate() > 0) {
+        result.arrival = start_ + arrivalOffsets_[queryIndex];
+        std::this_thread::sleep_until(result.arrival);
+    } else
+        result.arrival = std::chrono::steady_clock::now();
+
+    // Hold off re-tiling until this query has read every GOP that it needs.
+    std::shared_lock lock(retileMutex_);
+    std::unique_ptr<ImageIterator> images;
+    switch (query.strategy) {
+        case ReplayQuery::Strategy::Objects:
+            images = query.frames
+                    ? tasm.select(query.video, query.label, query.frames->first, query.frames->second, query.metadataIdentifier)
+                    : tasm.select(query.video, query.label, query.metadataIdentifier);
+            break;
+        case ReplayQuery::Strategy::Tiles:
+            images = query.frames
+                    ? tasm.selectTiles(query.video, query.label, query.frames->first, query.frames->second, query.metadataIdentifier)
+                    : tasm.selectTiles(query.video, query.label, query.metadataIdentifier);
+            break;
+        case ReplayQuery::Strategy::Frames:
+            images = query.frames
+                    ? tasm.selectFrames(query.video, query.label, query.frames->first, query.frames->second, query.metadataIdentifier)
+                    : tasm.selectFrames(query.video, query.label, query.metadataIdentifier);
+            break;
+    }
+
+    while (images->next())
+        ++result.images;
+    result.completion = std::chrono::steady_clock::now();
+
+    auto stats = images->stats();
+    result.pixelsDecoded = stats->get(QueryStats::Counter::PixelsDecoded);
+    result.bytesRead = stats->get(QueryStats::Counter::BytesRead);
+    return result;
+}
+
+void Replayer::activateRegretBasedTiling() {
+    for (const auto &videoAndMetadataIdentifier : videoToMetadataIdentifier_)
+        workers_[RegretWorker]->activateRegretBasedTilingForVideo(videoAndMetadataIdentifier.first, videoAndMetadataIdentifier.second, workload_.regretThreshold());
+    regretActivated_ = true;
+}
+
+void Replayer::retileBasedOnRegret() {
+    std::unique_lock lock(retileMutex_);
+    // The regret worker may not have picked up a query since regret-based tiling was activated.
+    if (!regretActivated_)
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &videoAndMetadataIdentifier : videoToMetadataIdentifier_)
+        workers_[RegretWorker]->retileVideoBasedOnRegret(videoAndMetadataIdentifier.first);
+    retilingTime_ += std::chrono::steady_clock::now() - start;
+    ++numberOfRetilings_;
+}
+
+} // namespace tasm::replay
@@ -0,0 +1,50 @@
+#include "EnvironmentConfiguration.h"
+#include "Replayer.h"
+
+#include <iomanip>
+#include <iostream>
+
+using namespace tasm;
+using namespace tasm::replay;
+
+static void printUsage(const char *program) {
+    std::cerr << "Usage: " << program << " <catalog path> <labels database path> <workload file>" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 4) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string catalogPath = argv[1];
+    std::string labelsDatabasePath = argv[2];
+    EnvironmentConfiguration::instance(EnvironmentConfiguration({
+        {EnvironmentConfiguration::CatalogPath, catalogPath},
+        {EnvironmentConfiguration::DefaultLabelsDB, labelsDatabasePath},
+    }));
+
+    try {
+        ReplayWorkload workload{std::experimental::filesystem::path(argv[3])};
+        Replayer replayer(workload, labelsDatabasePath);
+        auto results = replayer.run();
+
+        ReplaySummary(results).print(std::cout, "All queries");
+        if (workload.retileAfter()) {
+            std::vector<QueryResult> before, after;
+            for (const auto &result : results)
+                (result.afterRetilingActivated ? after : before).push_back(result);
+
+            ReplaySummary(before).print(std::cout, "Before regret-based tiling");
+            ReplaySummary(after).print(std::cout, "After regret-based tiling");
+            std::cout << std::fixed << std::setprecision(2)
+                      << "Re-tiled " << replayer.numberOfRetilings() << " times in "
+                      << std::chrono::duration<double>(replayer.retilingTime()).count() << " s" << std::endl;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
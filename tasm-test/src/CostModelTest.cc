@@ -0,0 +1,123 @@
+#include "CostModel.h"
+#include <gtest/gtest.h>
+
+#include "QueryStats.h"
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <random>
+
+using namespace tasm;
+
+class CostModelTestFixture : public testing::Test {
+public:
+    CostModelTestFixture() {}
+};
+
+static void addObservation(CostModel &costModel, unsigned long long pixels, unsigned long long frames, unsigned long long reconfigurations, double decodeTimeMs) {
+    QueryStats stats;
+    stats.add(QueryStats::Counter::PixelsDecoded, pixels);
+    stats.add(QueryStats::Counter::FramesDecoded, frames);
+    stats.add(QueryStats::Counter::DecoderReconfigurations, reconfigurations);
+    stats.add(QueryStats::Counter::DecodeTimeNs, static_cast<unsigned long long>(decodeTimeMs * 1e6));
+    // Operator times do not affect the decode time.
+    stats.addOperatorTime("GPUDecodeFromCPU", std::chrono::milliseconds(5));
+    costModel.observe(stats);
+}
+
+static bool isClose(double actual, double expected, double tolerance) {
+    return std::abs(actual - expected) <= tolerance * expected;
+}
+
+TEST_F(CostModelTestFixture, testReadWriteProfile) {
+    auto path = std::experimental::filesystem::temp_directory_path() / "cost-profile-test";
+    CostProfile profile;
+    profile.decodeCostPerPixel = 2.5e-06;
+    profile.decodeCostPerReconfiguration = 1.25;
+    profile.tilingPixelThreshold = 0.7;
+    profile.write(path);
+
+    auto read = CostProfile::read(path);
+    assert(read.decodeCostPerPixel == profile.decodeCostPerPixel);
+    assert(read.decodeCostPerTile == profile.decodeCostPerTile);
+    assert(read.decodeCostPerReconfiguration == profile.decodeCostPerReconfiguration);
+    assert(read.encodeCostPerPixel == profile.encodeCostPerPixel);
+    assert(read.encodeCostPerGOP == profile.encodeCostPerGOP);
+    assert(read.tilingPixelThreshold == profile.tilingPixelThreshold);
+
+    std::ofstream(path) << "decode_cost_per_frame 1\n";
+    bool threw = false;
+    try {
+        CostProfile::read(path);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+    std::experimental::filesystem::remove(path);
+}
+
+TEST_F(CostModelTestFixture, testObservationsRefineDecodeCoefficients) {
+    CostModel costModel;
+    static const double costPerPixel = 3e-06;
+    static const double costPerTile = 0.05;
+    static const double costPerReconfiguration = 2;
+
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<unsigned long long> pixels(1'000'000, 200'000'000);
+    std::uniform_int_distribution<unsigned long long> frames(30, 3000);
+    std::uniform_int_distribution<unsigned long long> reconfigurations(0, 50);
+    for (auto i = 0u; i < 500; ++i) {
+        auto p = pixels(generator);
+        auto f = frames(generator);
+        auto r = reconfigurations(generator);
+        addObservation(costModel, p, f, r, costPerPixel * p + costPerTile * f + costPerReconfiguration * r);
+    }
+    assert(costModel.numberOfObservations() == 500);
+
+    auto profile = costModel.profile();
+    assert(isClose(profile.decodeCostPerPixel, costPerPixel, 0.05));
+    assert(isClose(profile.decodeCostPerTile, costPerTile, 0.25));
+    assert(isClose(profile.decodeCostPerReconfiguration, costPerReconfiguration, 0.1));
+    // Observations do not change the encode coefficients.
+    assert(profile.encodeCostPerGOP == CostProfile().encodeCostPerGOP);
+}
+
+TEST_F(CostModelTestFixture, testPriorLimitsFewObservations) {
+    CostProfile prior;
+    CostModel costModel(prior);
+
+    // Queries without decoded pixels are ignored.
+    addObservation(costModel, 0, 0, 0, 10);
+    assert(costModel.numberOfObservations() == 0);
+
+    // A single query that took twice as long as expected moves the coefficients only part of the way.
+    unsigned long long pixels = 60'000'000;
+    unsigned long long frames = 300;
+    addObservation(costModel, pixels, frames, 0, 2 * prior.decodeCost(pixels, frames));
+    auto profile = costModel.profile();
+    assert(profile.decodeCostPerPixel > prior.decodeCostPerPixel);
+    assert(profile.decodeCostPerPixel < 2 * prior.decodeCostPerPixel);
+    assert(profile.decodeCostPerReconfiguration == prior.decodeCostPerReconfiguration);
+
+    costModel.setProfile(prior);
+    assert(!costModel.numberOfObservations());
+    assert(costModel.profile().decodeCostPerPixel == prior.decodeCostPerPixel);
+}
+
+TEST_F(CostModelTestFixture, testRefinementsAreSaved) {
+    auto path = std::experimental::filesystem::temp_directory_path() / "cost-profile-save-test";
+    std::experimental::filesystem::remove(path);
+    CostProfile prior;
+    prior.decodeCostPerTile = 0.1;
+    prior.write(path);
+
+    CostModel costModel(path);
+    assert(costModel.profile().decodeCostPerTile == 0.1);
+    for (auto i = 0u; i < CostModel::ObservationsPerSave; ++i)
+        addObservation(costModel, 10'000'000 * (i + 1), 100, 0, 3 * prior.decodeCost(10'000'000 * (i + 1), 100));
+
+    auto saved = CostProfile::read(path);
+    assert(saved.decodeCostPerPixel == costModel.profile().decodeCostPerPixel);
+    assert(saved.decodeCostPerPixel > prior.decodeCostPerPixel);
+    std::experimental::filesystem::remove(path);
+}
@@ -0,0 +1,63 @@
+#include "IntervalTree.h"
+#include <gtest/gtest.h>
+
+#include <cassert>
+#include <random>
+#include <set>
+
+using namespace tasm;
+
+class IntervalTreeTestFixture : public testing::Test {
+public:
+    IntervalTreeTestFixture() {}
+};
+
+static std::set<int> idsContaining(const std::vector<IntervalEntry<unsigned int>> &intervals, unsigned int point) {
+    std::set<int> ids;
+    for (const auto &interval : intervals) {
+        if (interval.l() <= point && point <= interval.r())
+            ids.insert(interval.id());
+    }
+    return ids;
+}
+
+static std::set<int> queryIds(const IntervalTree<unsigned int> &tree, unsigned int point) {
+    std::vector<IntervalEntry<unsigned int>> results;
+    tree.query(point, results);
+    std::set<int> ids;
+    for (const auto &result : results)
+        ids.insert(result.id());
+    // Each interval is returned at most once.
+    assert(ids.size() == results.size());
+    return ids;
+}
+
+TEST_F(IntervalTreeTestFixture, testQuery) {
+    // Tile directories cover closed ranges of frames, and re-tiled GOPs overlap the original directory.
+    std::vector<IntervalEntry<unsigned int>> intervals{{0, 29, 0}, {30, 59, 1}, {60, 89, 2}, {0, 89, 3}, {30, 59, 4}};
+    IntervalTree<unsigned int> tree(0, 89, intervals);
+
+    assert(queryIds(tree, 0) == std::set<int>({0, 3}));
+    assert(queryIds(tree, 29) == std::set<int>({0, 3}));
+    assert(queryIds(tree, 30) == std::set<int>({1, 3, 4}));
+    assert(queryIds(tree, 89) == std::set<int>({2, 3}));
+    assert(queryIds(tree, 90).empty());
+    assert(queryIds(IntervalTree<unsigned int>(), 0).empty());
+}
+
+TEST_F(IntervalTreeTestFixture, testQueryMatchesLinearScan) {
+    std::mt19937 generator(17);
+    std::uniform_int_distribution<unsigned int> start(0, 3000);
+    std::uniform_int_distribution<unsigned int> length(0, 60);
+
+    std::vector<IntervalEntry<unsigned int>> intervals;
+    for (auto i = 0; i < 400; ++i) {
+        auto l = start(generator);
+        intervals.emplace_back(l, l + length(generator), i);
+    }
+    IntervalTree<unsigned int> tree(0, 3060, intervals);
+
+    assert(tree.size() == intervals.size());
+    for (auto point = 0u; point < 3100; ++point)
+        assert(queryIds(tree, point) == idsContaining(intervals, point));
+}
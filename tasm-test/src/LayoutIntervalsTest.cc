@@ -0,0 +1,89 @@
+#include "LayoutIntervalSegmenter.h"
+#include <gtest/gtest.h>
+
+#include "SemanticDataManager.h"
+#include <cassert>
+
+using namespace tasm;
+
+class LayoutIntervalsTestFixture : public testing::Test {
+public:
+    LayoutIntervalsTestFixture() {}
+};
+
+static const unsigned int width = 1920;
+static const unsigned int height = 1080;
+
+static std::shared_ptr<Workload> workloadForLabel(std::shared_ptr<SemanticIndex> semanticIndex, const std::string &label) {
+    return std::make_shared<Workload>(std::make_shared<SemanticDataManager>(semanticIndex, "video", std::make_shared<SingleMetadataSelection>(label), nullptr));
+}
+
+TEST_F(LayoutIntervalsTestFixture, testFramesMapToIntervals) {
+    LayoutIntervals uniform(30);
+    assert(uniform.isUniform());
+    assert(uniform.intervalForFrame(29) == 0);
+    assert(uniform.intervalForFrame(30) == 1);
+    assert(uniform.firstFrameOfInterval(2) == 60);
+
+    LayoutIntervals intervals({0, 15, 75}, 30);
+    assert(!intervals.isUniform());
+    assert(intervals.intervalForFrame(14) == 0);
+    assert(intervals.intervalForFrame(15) == 1);
+    assert(intervals.intervalForFrame(74) == 1);
+    assert(intervals.intervalForFrame(75) == 2);
+    assert(intervals.intervalForFrame(105) == 3);
+    assert(intervals.firstFrameOfInterval(3) == 105);
+    assert(intervals.lengthOfInterval(0) == 15);
+    assert(intervals.lengthOfInterval(1) == 60);
+    assert(intervals.lengthOfInterval(2) == 30);
+    assert(intervals.longestInterval() == 60);
+    assert(intervals.isFirstFrameOfInterval(105));
+    assert(!intervals.isFirstFrameOfInterval(106));
+
+    bool threw = false;
+    try {
+        LayoutIntervals({0, 15, 15}, 30);
+    } catch (const std::invalid_argument &) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+TEST_F(LayoutIntervalsTestFixture, testReadWrite) {
+    auto path = std::experimental::filesystem::temp_directory_path() / "layout-intervals-test";
+    std::experimental::filesystem::remove_all(path);
+    std::experimental::filesystem::create_directories(path);
+
+    assert(LayoutIntervals::read(path, 30) == LayoutIntervals(30));
+
+    LayoutIntervals intervals({0, 15, 75}, 120);
+    intervals.write(path);
+    assert(LayoutIntervals::read(path, 30) == intervals);
+
+    std::experimental::filesystem::remove_all(path);
+}
+
+TEST_F(LayoutIntervalsTestFixture, testSlowObjectsGetLongerIntervals) {
+    static const unsigned int numberOfFrames = 240;
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+    for (auto frame = 0u; frame < numberOfFrames; ++frame) {
+        // The car sits in place, while the ball crosses the frame every 60 frames.
+        semanticIndex->addMetadata("video", "car", frame, 200, 200, 400, 300);
+        auto x = (frame % 60) * 28;
+        semanticIndex->addMetadata("video", "ball", frame, x, 500, x + 100, 600);
+    }
+
+    static const unsigned int minimumIntervalLength = 15;
+    static const unsigned int maximumIntervalLength = 120;
+    auto carIntervals = LayoutIntervalSegmenter(workloadForLabel(semanticIndex, "car"), width, height, minimumIntervalLength, maximumIntervalLength).segment();
+    auto ballIntervals = LayoutIntervalSegmenter(workloadForLabel(semanticIndex, "ball"), width, height, minimumIntervalLength, maximumIntervalLength).segment();
+
+    assert(carIntervals.lengthOfInterval(0) == maximumIntervalLength);
+    assert(ballIntervals.intervalForFrame(numberOfFrames - 1) > carIntervals.intervalForFrame(numberOfFrames - 1));
+    for (auto firstFrame : ballIntervals.firstFrames())
+        assert(!(firstFrame % minimumIntervalLength));
+
+    // Without objects, intervals are the maximum length.
+    auto emptyIntervals = LayoutIntervalSegmenter(workloadForLabel(semanticIndex, "bird"), width, height, minimumIntervalLength, maximumIntervalLength).segment();
+    assert(emptyIntervals == LayoutIntervals(maximumIntervalLength));
+}
@@ -0,0 +1,116 @@
+#include "OptimizedTileConfigurationProvider.h"
+#include <gtest/gtest.h>
+
+#include "SemanticDataManager.h"
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+using namespace tasm;
+
+class OptimizedTileConfigurationProviderTestFixture : public testing::Test {
+public:
+    OptimizedTileConfigurationProviderTestFixture() {}
+};
+
+static const unsigned int width = 1920;
+static const unsigned int height = 1080;
+static const unsigned int gopLength = 30;
+
+static std::shared_ptr<Workload> workloadForLabels(std::shared_ptr<SemanticIndex> semanticIndex, const std::vector<std::string> &labels, const std::vector<unsigned int> &counts) {
+    std::vector<std::shared_ptr<SemanticDataManager>> selections;
+    for (const auto &label : labels)
+        selections.push_back(std::make_shared<SemanticDataManager>(semanticIndex, "video", std::make_shared<SingleMetadataSelection>(label)));
+    return std::make_shared<Workload>(selections, counts);
+}
+
+static void assertLayoutIsValid(const TileLayout &layout) {
+    auto &widths = layout.widthsOfColumns();
+    auto &heights = layout.heightsOfRows();
+    assert(std::accumulate(widths.begin(), widths.end(), 0u) == width);
+    assert(std::accumulate(heights.begin(), heights.end(), 0u) == height);
+    for (auto i = 0u; i < widths.size(); ++i) {
+        assert(widths.size() == 1 || widths[i] >= OptimizedTileConfigurationProvider::MinimumTileWidth);
+        assert(i == widths.size() - 1 || !(widths[i] % 32));
+    }
+    for (auto i = 0u; i < heights.size(); ++i) {
+        assert(heights.size() == 1 || heights[i] >= OptimizedTileConfigurationProvider::MinimumTileHeight);
+        assert(i == heights.size() - 1 || !(heights[i] % 32));
+    }
+}
+
+TEST_F(OptimizedTileConfigurationProviderTestFixture, testIsolatesObjects) {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+    for (auto frame = 0u; frame < gopLength; ++frame)
+        semanticIndex->addMetadata("video", "fish", frame, 1500, 900, 1600, 1000);
+
+    auto workload = workloadForLabels(semanticIndex, {"fish"}, {1});
+    auto provider = std::make_shared<OptimizedTileConfigurationProvider>(gopLength, workload, width, height);
+    auto layout = provider->tileLayoutForFrame(0);
+    assertLayoutIsValid(*layout);
+    assert(layout->numberOfTiles() > 1);
+
+    // The object should be in a single tile that is much smaller than the frame.
+    auto tiles = layout->tilesForRectangle(Rectangle(0, 1500, 900, 100, 100));
+    assert(tiles.size() == 1);
+    assert(layout->rectangleForTile(tiles.front()).area() < width * height / 8);
+
+    // The estimate should match the cost model that WorkloadCostEstimator uses.
+    auto costElements = WorkloadCostEstimator(provider, workload, gopLength).estimateCostForWorkload();
+    auto costProfile = CostModel::instance().profile();
+    auto expectedCost = costProfile.decodeCost(costElements.numPixels, costElements.numTiles);
+    assert(std::abs(provider->estimatedCostForFrame(0) - expectedCost) < 1e-6);
+
+    double untiledCost = gopLength * costProfile.decodeCost(width * height, 1);
+    assert(provider->estimatedCostForFrame(0) < untiledCost);
+}
+
+TEST_F(OptimizedTileConfigurationProviderTestFixture, testWeightsQueries) {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+    for (auto frame = 0u; frame < gopLength; ++frame) {
+        semanticIndex->addMetadata("video", "fish", frame, 100, 100, 300, 300);
+        semanticIndex->addMetadata("video", "cat", frame, 1400, 700, 1700, 1000);
+    }
+
+    // Each layout should favor the query that is executed more often.
+    for (const auto &frequentLabel : std::vector<std::string>{"fish", "cat"}) {
+        auto counts = frequentLabel == "fish" ? std::vector<unsigned int>{10, 1} : std::vector<unsigned int>{1, 10};
+        auto workload = workloadForLabels(semanticIndex, {"fish", "cat"}, counts);
+        OptimizedTileConfigurationProvider provider(gopLength, workload, width, height);
+        auto layout = provider.tileLayoutForFrame(gopLength - 1);
+        assertLayoutIsValid(*layout);
+
+        auto fishTiles = layout->tilesForRectangle(Rectangle(0, 100, 100, 200, 200));
+        auto catTiles = layout->tilesForRectangle(Rectangle(0, 1400, 700, 300, 300));
+        assert(fishTiles.size() == 1);
+        assert(catTiles.size() == 1);
+        assert(fishTiles != catTiles);
+    }
+}
+
+TEST_F(OptimizedTileConfigurationProviderTestFixture, testDoesNotTileWithoutObjects) {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+    semanticIndex->addMetadata("video", "fish", gopLength, 0, 0, 100, 100);
+
+    auto workload = workloadForLabels(semanticIndex, {"fish"}, {1});
+    OptimizedTileConfigurationProvider provider(gopLength, workload, width, height);
+    auto layout = provider.tileLayoutForFrame(0);
+    assert(layout->numberOfTiles() == 1);
+    assert(provider.estimatedCostForFrame(0) == 0);
+
+    // An object that covers most of the frame is not worth tiling around.
+    semanticIndex->addMetadata("video", "cat", 0, 0, 0, width - 64, height - 64);
+    auto coveringWorkload = workloadForLabels(semanticIndex, {"cat"}, {1});
+    OptimizedTileConfigurationProvider coveringProvider(gopLength, coveringWorkload, width, height);
+    assert(coveringProvider.tileLayoutForFrame(0)->numberOfTiles() == 1);
+}
+
+TEST_F(OptimizedTileConfigurationProviderTestFixture, testLimitsNumberOfTiles) {
+    auto limits = OptimizedTileConfigurationProvider::maximumNumberOfColumnsAndRows(width, height);
+    assert(limits.first == 5);
+    assert(limits.second == 5);
+
+    limits = OptimizedTileConfigurationProvider::maximumNumberOfColumnsAndRows(3840, 2160);
+    assert(limits.first == 10);
+    assert(limits.second == 11);
+}
@@ -0,0 +1,180 @@
+#include "RegretAccumulator.h"
+#include <gtest/gtest.h>
+
+#include "SemanticDataManager.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <experimental/filesystem>
+#include <fstream>
+
+using namespace tasm;
+
+class RegretAccumulatorTestFixture : public testing::Test {
+public:
+    RegretAccumulatorTestFixture() {}
+};
+
+static const unsigned int width = 1920;
+static const unsigned int height = 1080;
+static const unsigned int gopLength = 30;
+
+static std::shared_ptr<SemanticIndex> indexWithCarAndBall() {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+    for (auto frame = 0u; frame < 2 * gopLength; ++frame) {
+        semanticIndex->addMetadata("video", "car", frame, 200, 200, 400, 300);
+        semanticIndex->addMetadata("video", "ball", frame, 1400, 700, 1500, 800);
+    }
+    return semanticIndex;
+}
+
+static std::shared_ptr<Workload> workloadForLabel(std::shared_ptr<SemanticIndex> semanticIndex, const std::string &label, std::shared_ptr<TemporalSelection> temporalSelection = nullptr) {
+    return std::make_shared<Workload>(std::make_shared<SemanticDataManager>(semanticIndex, "video", std::make_shared<SingleMetadataSelection>(label), temporalSelection, width, height));
+}
+
+static double regretForGOP(const RegretAccumulator &accumulator, unsigned int gop) {
+    for (const auto &candidate : accumulator.retileCandidates()) {
+        if (candidate.gop == gop)
+            return candidate.excessRegret;
+    }
+    return 0;
+}
+
+TEST_F(RegretAccumulatorTestFixture, testRepeatedQueriesReuseLayoutCosts) {
+    auto semanticIndex = indexWithCarAndBall();
+    auto currentLayout = std::make_shared<SingleTileConfigurationProvider>(width, height);
+
+    RegretAccumulator once(semanticIndex, "video", width, height, gopLength, 0);
+    once.addRegretForQuery(workloadForLabel(semanticIndex, "car"), currentLayout);
+
+    static const unsigned int numberOfRepetitions = 10;
+    RegretAccumulator repeated(semanticIndex, "video", width, height, gopLength, 0);
+    for (auto i = 0u; i < numberOfRepetitions; ++i)
+        repeated.addRegretForQuery(workloadForLabel(semanticIndex, "car"), currentLayout);
+
+    // Each repetition adds the same regret, but the layouts' costs are only estimated for the first.
+    assert(regretForGOP(once, 0) > 0);
+    assert(std::abs(regretForGOP(repeated, 0) - numberOfRepetitions * regretForGOP(once, 0)) < 1e-6 * regretForGOP(repeated, 0));
+    assert(repeated.numberOfLayoutCostEstimates() == once.numberOfLayoutCostEstimates());
+
+    // A new label adds layouts, whose costs are estimated once for the historical predicate rather than once for each
+    // historical query.
+    once.addRegretForQuery(workloadForLabel(semanticIndex, "ball"), currentLayout);
+    repeated.addRegretForQuery(workloadForLabel(semanticIndex, "ball"), currentLayout);
+    assert(repeated.numberOfLayoutCostEstimates() == once.numberOfLayoutCostEstimates());
+}
+
+static void assertSameCandidates(const RegretAccumulator &expected, const RegretAccumulator &actual) {
+    auto expectedCandidates = expected.retileCandidates();
+    auto actualCandidates = actual.retileCandidates();
+    assert(expectedCandidates.size() == actualCandidates.size());
+    for (const auto &expectedCandidate : expectedCandidates) {
+        auto matches = std::count_if(actualCandidates.begin(), actualCandidates.end(), [&](const GOPRetileCandidate &candidate) {
+            return candidate.gop == expectedCandidate.gop
+                    && candidate.layoutIdentifier == expectedCandidate.layoutIdentifier
+                    && std::abs(candidate.excessRegret - expectedCandidate.excessRegret) <= 1e-9 * std::abs(expectedCandidate.excessRegret);
+        });
+        assert(matches == 1);
+    }
+}
+
+TEST_F(RegretAccumulatorTestFixture, testRegretIsRestoredFromSavedState) {
+    auto semanticIndex = indexWithCarAndBall();
+    auto currentLayout = std::make_shared<SingleTileConfigurationProvider>(width, height);
+    auto videoPath = std::experimental::filesystem::temp_directory_path() / "regret-accumulator-test";
+    std::experimental::filesystem::remove_all(videoPath);
+    std::experimental::filesystem::create_directories(videoPath);
+
+    auto addQueries = [&](RegretAccumulator &accumulator, unsigned int numberOfQueries) {
+        for (auto i = 0u; i < numberOfQueries; ++i) {
+            std::shared_ptr<TemporalSelection> temporalSelection;
+            if (i % 3 == 1)
+                temporalSelection = std::make_shared<RangeTemporalSelection>(0, gopLength);
+            else if (i % 3 == 2)
+                temporalSelection = std::make_shared<SampledTemporalSelection>(SampledTemporalSelection::Strategy::FramesPerGOP, 2, gopLength);
+            accumulator.addRegretForQuery(workloadForLabel(semanticIndex, i % 2 ? "ball" : "car", temporalSelection), currentLayout);
+        }
+    };
+
+    // Enough queries that the state is restored both from a snapshot and from the log that follows it.
+    auto numberOfQueries = RegretAccumulator::RecordsPerSnapshot + 10;
+    RegretAccumulator saved(semanticIndex, "video", width, height, gopLength, 0);
+    saved.persistTo(videoPath);
+    addQueries(saved, numberOfQueries);
+    assert(!saved.retileCandidates().empty());
+    auto taken = saved.retileCandidates().front();
+    auto isCandidate = [&](unsigned int gop) {
+        auto candidates = saved.retileCandidates();
+        return std::any_of(candidates.begin(), candidates.end(), [&](const GOPRetileCandidate &candidate) { return candidate.gop == gop; });
+    };
+    // The GOP keeps its regret until its new tiles are committed.
+    assert(saved.layoutForGOP(taken.gop, taken.layoutIdentifier));
+    assert(isCandidate(taken.gop));
+    saved.gopWasRetiled(taken.gop);
+    assert(!isCandidate(taken.gop));
+    addQueries(saved, 2);
+
+    RegretAccumulator restored(semanticIndex, "video", width, height, gopLength, 0);
+    restored.persistTo(videoPath);
+    assertSameCandidates(saved, restored);
+
+    // Queries after restoring add the same regret as they would have without restarting.
+    addQueries(saved, 3);
+    addQueries(restored, 3);
+    assertSameCandidates(saved, restored);
+
+    // A record that was only partly written when the process stopped is ignored.
+    {
+        std::ofstream log(videoPath / "regret-log", std::ios::app);
+        log << "1000 query 1 \"car\" \"\" 2 0 1";
+    }
+    RegretAccumulator restoredAfterPartialRecord(semanticIndex, "video", width, height, gopLength, 0);
+    restoredAfterPartialRecord.persistTo(videoPath);
+    assertSameCandidates(saved, restoredAfterPartialRecord);
+
+    // State that was saved for a different selection is discarded.
+    RegretAccumulator otherSelection(semanticIndex, "other-video", width, height, gopLength, 0);
+    otherSelection.persistTo(videoPath);
+    assert(otherSelection.retileCandidates().empty());
+
+    std::experimental::filesystem::remove_all(videoPath);
+}
+
+TEST_F(RegretAccumulatorTestFixture, testSnapshotSizeIsBounded) {
+    auto semanticIndex = indexWithCarAndBall();
+    auto currentLayout = std::make_shared<SingleTileConfigurationProvider>(width, height);
+    auto videoPath = std::experimental::filesystem::temp_directory_path() / "regret-accumulator-bounded-test";
+    std::experimental::filesystem::remove_all(videoPath);
+    std::experimental::filesystem::create_directories(videoPath);
+
+    RegretAccumulator saved(semanticIndex, "video", width, height, gopLength, 0);
+    saved.persistTo(videoPath);
+    // End on a snapshot so that every query is in it.
+    auto numberOfQueries = 2 * RegretAccumulator::MaximumNumberOfRememberedQueries;
+    static_assert(2 * RegretAccumulator::MaximumNumberOfRememberedQueries % RegretAccumulator::RecordsPerSnapshot == 0);
+    for (auto i = 0u; i < numberOfQueries; ++i)
+        saved.addRegretForQuery(workloadForLabel(semanticIndex, "car"), currentLayout);
+
+    // Only the most recent queries are kept, and the queries with the same costs share them.
+    std::ifstream snapshot(videoPath / "regret-snapshot");
+    unsigned int numberOfQueryLines = 0;
+    unsigned int numberOfCostLines = 0;
+    for (std::string line; std::getline(snapshot, line); ) {
+        if (!line.compare(0, 6, "query "))
+            ++numberOfQueryLines;
+        else if (!line.compare(0, 6, "costs "))
+            ++numberOfCostLines;
+    }
+    assert(numberOfQueryLines == RegretAccumulator::MaximumNumberOfRememberedQueries);
+    assert(numberOfCostLines == 1);
+
+    // A new object adds regret from the remembered queries to its layouts, both with and without restarting.
+    RegretAccumulator restored(semanticIndex, "video", width, height, gopLength, 0);
+    restored.persistTo(videoPath);
+    assertSameCandidates(saved, restored);
+    saved.addRegretForQuery(workloadForLabel(semanticIndex, "ball"), currentLayout);
+    restored.addRegretForQuery(workloadForLabel(semanticIndex, "ball"), currentLayout);
+    assertSameCandidates(saved, restored);
+
+    std::experimental::filesystem::remove_all(videoPath);
+}
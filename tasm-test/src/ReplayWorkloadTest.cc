@@ -0,0 +1,97 @@
+#include "ReplayWorkload.h"
+#include <gtest/gtest.h>
+
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+
+using namespace tasm::replay;
+
+class ReplayWorkloadTestFixture : public testing::Test {
+public:
+    ReplayWorkloadTestFixture() {}
+};
+
+static bool failsToParse(const std::string &text) {
+    std::istringstream stream(text);
+    try {
+        ReplayWorkload workload(stream);
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+TEST_F(ReplayWorkloadTestFixture, testParseWorkload) {
+    std::istringstream stream(
+            "# Settings and queries.\n"
+            "arrival_rate 2.5\n"
+            "concurrency 4   # Trailing comments are ignored.\n"
+            "\n"
+            "number_of_queries 30\n"
+            "seed 3\n"
+            "retile_after 10\n"
+            "retile_every 5\n"
+            "regret_threshold 1.5\n"
+            "query 3 objects birds - bird\n"
+            "query 1 tiles birds birds-metadata bird 0 120\n"
+            "query 0.5 frames cars - car 30 60\n");
+    ReplayWorkload workload(stream);
+
+    assert(workload.arrivalRate() == 2.5);
+    assert(workload.concurrency() == 4);
+    assert(workload.numberOfQueries() == 30);
+    assert(workload.seed() == 3);
+    assert(workload.retileAfter() == 10u);
+    assert(workload.retileEvery() == 5);
+    assert(workload.regretThreshold() == 1.5);
+
+    const auto &queries = workload.queries();
+    assert(queries.size() == 3);
+    assert(queries[0].weight == 3);
+    assert(queries[0].strategy == ReplayQuery::Strategy::Objects);
+    assert(queries[0].video == "birds");
+    // "-" means that the metadata identifier is the video name.
+    assert(queries[0].metadataIdentifier == "birds");
+    assert(queries[0].label == "bird");
+    assert(!queries[0].frames);
+
+    assert(queries[1].strategy == ReplayQuery::Strategy::Tiles);
+    assert(queries[1].metadataIdentifier == "birds-metadata");
+    assert(queries[1].frames == std::make_pair(0u, 120u));
+
+    assert(queries[2].weight == 0.5);
+    assert(queries[2].strategy == ReplayQuery::Strategy::Frames);
+    assert(queries[2].frames == std::make_pair(30u, 60u));
+}
+
+TEST_F(ReplayWorkloadTestFixture, testDefaults) {
+    std::istringstream stream("query 1 objects birds - bird\n");
+    ReplayWorkload workload(stream);
+
+    assert(workload.arrivalRate() == 0);
+    assert(workload.concurrency() == 1);
+    assert(workload.numberOfQueries() == 100);
+    assert(workload.seed() == 17);
+    assert(!workload.retileAfter());
+    assert(workload.retileEvery() == 10);
+    assert(workload.regretThreshold() == 0);
+}
+
+TEST_F(ReplayWorkloadTestFixture, testMalformedWorkloads) {
+    static const std::string query = "query 1 objects birds - bird\n";
+
+    assert(failsToParse(""));
+    assert(failsToParse("# Only settings.\nconcurrency 2\n"));
+    assert(failsToParse(query + "unknown_setting 1\n"));
+    assert(failsToParse(query + "concurrency\n"));
+    assert(failsToParse(query + "arrival_rate fast\n"));
+    assert(failsToParse(query + "concurrency 0\n"));
+    assert(failsToParse(query + "retile_every 0\n"));
+    assert(failsToParse("query 1 pixels birds - bird\n"));
+    assert(failsToParse("query 0 objects birds - bird\n"));
+    assert(failsToParse("query -1 objects birds - bird\n"));
+    assert(failsToParse("query 1 objects birds -\n"));
+    // A range needs both its first and last frame.
+    assert(failsToParse("query 1 objects birds - bird 30\n"));
+}
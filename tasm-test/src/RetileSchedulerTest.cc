@@ -0,0 +1,89 @@
+#include "RetileScheduler.h"
+#include <gtest/gtest.h>
+
+#include <cassert>
+
+using namespace tasm;
+
+class RetileSchedulerTestFixture : public testing::Test {
+public:
+    RetileSchedulerTestFixture() {}
+};
+
+static RetileTask task(unsigned int gop, double priority, double estimatedMilliseconds = 10) {
+    return {"video", gop, "layout", priority, estimatedMilliseconds};
+}
+
+TEST_F(RetileSchedulerTestFixture, testRetilesInPriorityOrder) {
+    std::vector<unsigned int> retiledGOPs;
+    RetileScheduler scheduler(
+            [] { return std::vector<RetileTask>{task(0, 1), task(1, 3), task(2, 2)}; },
+            [&](const RetileTask &task) {
+                retiledGOPs.push_back(task.gop);
+                return RetileResult{task.estimatedMilliseconds, 100};
+            },
+            RetileBudget());
+
+    auto numberOfRetiledGOPs = scheduler.runPass(RetileScheduler::Clock::now());
+    assert(numberOfRetiledGOPs == 3);
+    assert(retiledGOPs == std::vector<unsigned int>({1, 2, 0}));
+    assert(scheduler.numberOfRetiledGOPs() == 3);
+}
+
+TEST_F(RetileSchedulerTestFixture, testBudgetLimitsRetilingPerWindow) {
+    RetileBudget budget;
+    budget.window = std::chrono::seconds(10);
+    budget.gpuMillisecondsPerWindow = 100;
+    budget.bytesPerWindow = 1000;
+
+    std::vector<unsigned int> retiledGOPs;
+    RetileScheduler scheduler(
+            [] { return std::vector<RetileTask>{task(0, 2, 60), task(1, 1, 60)}; },
+            [&](const RetileTask &task) {
+                retiledGOPs.push_back(task.gop);
+                return RetileResult{60, 10};
+            },
+            budget);
+
+    // The first GOP is re-tiled because nothing has been spent yet, but the second would exceed the GPU budget.
+    auto now = RetileScheduler::Clock::now();
+    auto firstPass = scheduler.runPass(now);
+    auto secondPass = scheduler.runPass(now + std::chrono::seconds(5));
+    assert(firstPass == 1);
+    assert(secondPass == 0);
+
+    // Spending from the previous window no longer counts.
+    auto nextWindowPass = scheduler.runPass(now + std::chrono::seconds(11));
+    assert(nextWindowPass == 1);
+
+    assert(retiledGOPs == std::vector<unsigned int>({0, 0}));
+
+    // Once the bytes budget is spent, nothing else is re-tiled in the window.
+    budget.gpuMillisecondsPerWindow = 1000;
+    RetileScheduler bytesLimitedScheduler(
+            [] { return std::vector<RetileTask>{task(0, 2, 60), task(1, 1, 60)}; },
+            [](const RetileTask &task) { return RetileResult{60, 1000}; },
+            budget);
+    firstPass = bytesLimitedScheduler.runPass(now);
+    secondPass = bytesLimitedScheduler.runPass(now + std::chrono::seconds(5));
+    nextWindowPass = bytesLimitedScheduler.runPass(now + std::chrono::seconds(11));
+    assert(firstPass == 1);
+    assert(secondPass == 0);
+    assert(nextWindowPass == 1);
+}
+
+TEST_F(RetileSchedulerTestFixture, testWaitsForQuietPeriodAfterQueries) {
+    RetileBudget budget;
+    budget.quietPeriod = std::chrono::seconds(1);
+    RetileScheduler scheduler(
+            [] { return std::vector<RetileTask>{task(0, 1)}; },
+            [](const RetileTask &task) { return RetileResult{task.estimatedMilliseconds, 0}; },
+            budget);
+
+    scheduler.noteQuery();
+    auto now = RetileScheduler::Clock::now();
+    auto passDuringQuery = scheduler.runPass(now);
+    auto passAfterQuietPeriod = scheduler.runPass(now + std::chrono::seconds(2));
+    assert(passDuringQuery == 0);
+    assert(passAfterQuietPeriod == 1);
+}
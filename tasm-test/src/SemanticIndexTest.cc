@@ -5,6 +5,8 @@
 #include "TemporalSelection.h"
 #include <cassert>
 #include <experimental/filesystem>
+#include <fstream>
+#include <thread>
 #include <unordered_set>
 
 using namespace tasm;
@@ -76,6 +78,112 @@ TEST_F(SemanticIndexTestFixture, testSelectRectanglesForFrame) {
     assert(fishFrames->back() == Rectangle(1, 1, 0, 0, 0));
 }
 
+TEST_F(SemanticIndexTestFixture, testAggregateQueries) {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+
+    std::string video("video");
+    for (int i = 0; i < 10; ++i) {
+        semanticIndex->addMetadata(video, "fish", i, 0, 0, 10, 10);
+        if (i % 2)
+            semanticIndex->addMetadata(video, "fish", i, 20, 20, 30, 30);
+    }
+    for (int i = 5; i < 25; ++i) {
+        semanticIndex->addMetadata(video, "cat", i, 0, 0, 10, 10);
+    }
+    semanticIndex->addMetadata("otherVideo", "fish", 3, 0, 0, 10, 10);
+
+    std::shared_ptr<MetadataSelection> selectFish(new SingleMetadataSelection("fish"));
+    assert(semanticIndex->countForSelection(video, selectFish, std::shared_ptr<TemporalSelection>()) == 15);
+
+    std::shared_ptr<TemporalSelection> rangeSelect(new RangeTemporalSelection(3, 6));
+    assert(semanticIndex->countForSelection(video, selectFish, rangeSelect) == 5);
+
+    std::shared_ptr<MetadataSelection> selectMissing(new SingleMetadataSelection("dog"));
+    assert(!semanticIndex->countForSelection(video, selectMissing, std::shared_ptr<TemporalSelection>()));
+
+    auto fishHistogram = semanticIndex->histogramForSelection(video, selectFish, 4, std::shared_ptr<TemporalSelection>());
+    std::map<int, unsigned int> expectedHistogram{{0, 6}, {4, 6}, {8, 3}};
+    assert(*fishHistogram == expectedHistogram);
+
+    std::shared_ptr<MetadataSelection> selectCat(new SingleMetadataSelection("cat"));
+    auto catHistogram = semanticIndex->histogramForSelection(video, selectCat, 10, rangeSelect);
+    expectedHistogram = std::map<int, unsigned int>{{0, 1}};
+    assert(*catHistogram == expectedHistogram);
+}
+
+TEST_F(SemanticIndexTestFixture, testHistogramRejectsEmptyBuckets) {
+    std::experimental::filesystem::path dbPath = "histogram_test.db";
+    for (auto indexType : {SemanticIndex::IndexType::InMemory, SemanticIndex::IndexType::LegacyWH}) {
+        std::experimental::filesystem::remove(dbPath);
+        auto semanticIndex = SemanticIndexFactory::create(indexType, dbPath);
+        semanticIndex->addMetadata("video", "fish", 0, 0, 0, 10, 10);
+
+        bool threw = false;
+        try {
+            semanticIndex->histogramForSelection("video", std::make_shared<SingleMetadataSelection>("fish"), 0, nullptr);
+        } catch (const std::invalid_argument &) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::experimental::filesystem::remove(dbPath);
+}
+
+TEST_F(SemanticIndexTestFixture, testSelectSampledFrames) {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+
+    std::string video("video");
+    for (int i = 0; i < 30; ++i) {
+        // Frames 0 and 1 in each GOP of length 10 do not contain fish.
+        if (i % 10 > 1)
+            semanticIndex->addMetadata(video, "fish", i, 0, 0, 10, 10);
+    }
+
+    std::shared_ptr<MetadataSelection> selectFish(new SingleMetadataSelection("fish"));
+    std::shared_ptr<TemporalSelection> everyFifthFrame(new SampledTemporalSelection(SampledTemporalSelection::Strategy::EveryNthFrame, 5));
+    auto fishFrames = semanticIndex->orderedFramesForSelection(video, selectFish, everyFifthFrame);
+    std::vector<int> expectedFrames{5, 15, 25};
+    assert(*fishFrames == expectedFrames);
+
+    std::shared_ptr<TemporalSelection> twoFramesPerGOP(new SampledTemporalSelection(SampledTemporalSelection::Strategy::FramesPerGOP, 2, 10));
+    fishFrames = semanticIndex->orderedFramesForSelection(video, selectFish, twoFramesPerGOP);
+    expectedFrames = std::vector<int>{2, 3, 12, 13, 22, 23};
+    assert(*fishFrames == expectedFrames);
+
+    std::shared_ptr<TemporalSelection> rangeSelect(new RangeTemporalSelection(5, 15));
+    std::shared_ptr<TemporalSelection> oneFramePerGOPInRange(new SampledTemporalSelection(SampledTemporalSelection::Strategy::FramesPerGOP, 1, 10, rangeSelect));
+    fishFrames = semanticIndex->orderedFramesForSelection(video, selectFish, oneFramePerGOPInRange);
+    expectedFrames = std::vector<int>{5, 12};
+    assert(*fishFrames == expectedFrames);
+
+    // GOPs that follow the stored layout intervals rather than a fixed length.
+    auto oneFramePerAdaptiveGOP = std::make_shared<SampledTemporalSelection>(SampledTemporalSelection::Strategy::FramesPerGOP, 1, LayoutIntervals({0, 15}, 5));
+    fishFrames = semanticIndex->orderedFramesForSelection(video, selectFish, oneFramePerAdaptiveGOP);
+    expectedFrames = std::vector<int>{2, 15, 22, 25};
+    assert(*fishFrames == expectedFrames);
+
+    auto restored = TemporalSelection::fromDescription(oneFramePerAdaptiveGOP->description());
+    assert(restored->description() == oneFramePerAdaptiveGOP->description());
+    fishFrames = semanticIndex->orderedFramesForSelection(video, selectFish, restored);
+    assert(*fishFrames == expectedFrames);
+}
+
+TEST_F(SemanticIndexTestFixture, testRestoreSelectionWithManyGOPs) {
+    // An hour of video with GOPs of about one second.
+    std::vector<unsigned int> firstFrames;
+    for (auto firstFrame = 0u; firstFrames.size() < 3600; firstFrame += 29 + firstFrames.size() % 3)
+        firstFrames.push_back(firstFrame);
+    auto selection = std::make_shared<SampledTemporalSelection>(SampledTemporalSelection::Strategy::FramesPerGOP, 2,
+            LayoutIntervals(firstFrames, 30), std::make_shared<RangeTemporalSelection>(100, 50000));
+    assert(selection->description().length() > 4096);
+
+    auto restored = std::dynamic_pointer_cast<SampledTemporalSelection>(TemporalSelection::fromDescription(selection->description()));
+    assert(restored);
+    assert(restored->description() == selection->description());
+    assert(restored->gops()->firstFrames() == firstFrames);
+    assert(restored->samplingRate() == 2);
+}
+
 std::unordered_set<std::string> InspectSchema(const std::experimental::filesystem::path &dbPath) {
     sqlite3 *db;
     ASSERT_SQLITE_OK(sqlite3_open_v2(dbPath.c_str(), &db, SQLITE_OPEN_READONLY, NULL));
@@ -122,3 +230,159 @@ TEST_F(SemanticIndexTestFixture, testCreateIndexTypes) {
     assert(expectedSchema == seenSchema);
     std::experimental::filesystem::remove(dbPath);
 }
+
+TEST_F(SemanticIndexTestFixture, testAddBulkMetadata) {
+    BulkMetadata metadata;
+    // Add the rows out of index order, and more than fit in one multi-row insert.
+    for (int frame = 499; frame >= 0; --frame) {
+        metadata.add("video", frame % 2 ? "cat" : "fish", frame, 2 * frame, 2, 2 * frame + 10, 12);
+        metadata.add("other", "fish", frame, 0, 0, 5, 5);
+    }
+
+    for (auto indexType : {SemanticIndex::IndexType::InMemory, SemanticIndex::IndexType::LegacyWH}) {
+        std::experimental::filesystem::path dbPath = "bulk_metadata_test.db";
+        std::experimental::filesystem::remove(dbPath);
+        auto semanticIndex = SemanticIndexFactory::create(indexType, dbPath);
+        // A row that is already in the table. The load is larger, so the index is rebuilt after the rows are added.
+        semanticIndex->addMetadata("video", "fish", 1000, 0, 0, 1, 1);
+        semanticIndex->addBulkMetadata(metadata);
+
+        std::shared_ptr<MetadataSelection> selectFish(new SingleMetadataSelection("fish"));
+        if (indexType == SemanticIndex::IndexType::InMemory) {
+            assert(semanticIndex->countForSelection("video", selectFish, nullptr) == 251);
+            assert(semanticIndex->countForSelection("other", selectFish, nullptr) == 500);
+        } else {
+            // The WH index does not store videos.
+            assert(semanticIndex->countForSelection("video", selectFish, nullptr) == 751);
+        }
+
+        auto rectangles = semanticIndex->rectanglesForFrame("video", std::make_shared<SingleMetadataSelection>("cat"), 7);
+        assert(rectangles->size() == 1);
+        assert(rectangles->front().x == 14);
+        assert(rectangles->front().width == 10);
+
+        semanticIndex.reset();
+        std::experimental::filesystem::remove(dbPath);
+    }
+}
+
+// The names of the indexes on the labels table, and the schema version, which changes whenever an index is dropped
+// or created.
+std::pair<std::unordered_set<std::string>, int> InspectIndexes(const std::experimental::filesystem::path &dbPath) {
+    sqlite3 *db;
+    ASSERT_SQLITE_OK(sqlite3_open_v2(dbPath.c_str(), &db, SQLITE_OPEN_READONLY, NULL));
+
+    std::string select = "SELECT name FROM sqlite_master WHERE type = 'index' AND tbl_name = 'labels';";
+    std::unordered_set<std::string> indexNames;
+    ASSERT_SQLITE_OK(sqlite3_exec(db, select.c_str(), [](void *set, int, char **values, char**) {
+            reinterpret_cast<std::unordered_set<std::string> *>(set)->insert(values[0]);
+            return 0;
+        }, &indexNames, nullptr));
+
+    int schemaVersion = 0;
+    ASSERT_SQLITE_OK(sqlite3_exec(db, "pragma schema_version;", [](void *version, int, char **values, char**) {
+            *reinterpret_cast<int *>(version) = std::stoi(values[0]);
+            return 0;
+        }, &schemaVersion, nullptr));
+
+    ASSERT_SQLITE_OK(sqlite3_close(db));
+    return {indexNames, schemaVersion};
+}
+
+TEST_F(SemanticIndexTestFixture, testSmallerBulkLoadKeepsIndex) {
+    std::experimental::filesystem::path dbPath = "bulk_metadata_index_test.db";
+    std::experimental::filesystem::remove(dbPath);
+    auto semanticIndex = SemanticIndexFactory::create(SemanticIndex::IndexType::XY, dbPath);
+
+    BulkMetadata largeLoad;
+    for (int frame = 0; frame < 1000; ++frame)
+        largeLoad.add("video", "fish", frame, 0, 0, 5, 5);
+    semanticIndex->addBulkMetadata(largeLoad);
+    auto indexesBefore = InspectIndexes(dbPath);
+    assert(indexesBefore.first.count("video_index"));
+
+    // The table is much larger than this load, so the index is maintained rather than dropped and rebuilt.
+    BulkMetadata smallLoad;
+    for (int frame = 1000; frame < 1010; ++frame)
+        smallLoad.add("video", "cat", frame, 0, 0, 5, 5);
+    semanticIndex->addBulkMetadata(smallLoad);
+    assert(InspectIndexes(dbPath) == indexesBefore);
+
+    assert(semanticIndex->countForSelection("video", std::make_shared<SingleMetadataSelection>("fish"), nullptr) == 1000);
+    assert(semanticIndex->countForSelection("video", std::make_shared<SingleMetadataSelection>("cat"), nullptr) == 10);
+
+    semanticIndex.reset();
+    std::experimental::filesystem::remove(dbPath);
+}
+
+TEST_F(SemanticIndexTestFixture, testConcurrentWrites) {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+    std::vector<std::thread> writers;
+    for (auto writer = 0u; writer < 4; ++writer) {
+        writers.emplace_back([&, writer] {
+            for (auto frame = 0u; frame < 1000; ++frame)
+                semanticIndex->addMetadata("video", "fish", writer * 2000 + frame, 0, 0, 5, 5);
+            BulkMetadata metadata;
+            for (auto frame = 1000u; frame < 2000; ++frame)
+                metadata.add("video", "fish", writer * 2000 + frame, 0, 0, 5, 5);
+            semanticIndex->addBulkMetadata(metadata);
+        });
+    }
+    for (auto &writer : writers)
+        writer.join();
+
+    // Each row is on its own frame, so a row that was bound over by another writer would repeat a frame.
+    auto frames = semanticIndex->orderedFramesForSelection("video", std::make_shared<SingleMetadataSelection>("fish"), nullptr);
+    assert(frames->size() == 8000);
+}
+
+TEST_F(SemanticIndexTestFixture, testBulkMetadataFromCSV) {
+    auto path = std::experimental::filesystem::temp_directory_path() / "tasm-bulk-metadata-test.csv";
+    {
+        std::ofstream csv(path);
+        csv << "video,label,frame,x1,y1,x2,y2\n";
+        for (auto frame = 0u; frame < 1000; ++frame)
+            csv << "video," << (frame % 3 ? "car" : "bus") << "," << frame << ",1,2,3,4\r\n";
+    }
+
+    for (auto numberOfThreads : {1u, 4u}) {
+        auto metadata = BulkMetadata::fromCSV(path, numberOfThreads);
+        assert(metadata.size() == 1000);
+        assert(metadata.videos() == std::vector<std::string>({"video"}));
+        assert(metadata.labels().size() == 2);
+        assert(metadata.label(0) == "bus" && metadata.label(1) == "car");
+        assert(metadata.frame(999) == 999);
+        assert(metadata.x1(5) == 1 && metadata.y1(5) == 2 && metadata.x2(5) == 3 && metadata.y2(5) == 4);
+
+        // Sorted by label, then by frame.
+        auto rows = metadata.sortedRows();
+        assert(rows.front() == 0);
+        assert(metadata.label(rows.back()) == "car" && metadata.frame(rows.back()) == 998);
+    }
+
+    {
+        std::ofstream csv(path);
+        csv << "video,car,1,1,2,3,4\nvideo,car,x,1,2,3,4\n";
+    }
+    bool didThrow = false;
+    try {
+        BulkMetadata::fromCSV(path);
+    } catch (const std::runtime_error &) {
+        didThrow = true;
+    }
+    assert(didThrow);
+    std::experimental::filesystem::remove(path);
+}
+
+TEST_F(SemanticIndexTestFixture, testBulkMetadataFromColumns) {
+    auto metadata = BulkMetadata::fromColumns({"video"}, {"car", "bus"}, {0, 0}, {1, 0}, {5, 6}, {0, 0}, {0, 0}, {1, 1}, {1, 1});
+    assert(metadata.label(0) == "bus" && metadata.frame(0) == 5);
+
+    bool didThrow = false;
+    try {
+        BulkMetadata::fromColumns({"video"}, {"car"}, {0}, {1}, {5}, {0}, {0}, {1}, {1});
+    } catch (const std::invalid_argument &) {
+        didThrow = true;
+    }
+    assert(didThrow);
+}
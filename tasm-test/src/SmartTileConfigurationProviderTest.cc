@@ -0,0 +1,80 @@
+#include "SmartTileConfigurationProvider.h"
+#include <gtest/gtest.h>
+
+#include "SemanticDataManager.h"
+#include <cassert>
+#include <cmath>
+
+using namespace tasm;
+
+class SmartTileConfigurationProviderTestFixture : public testing::Test {
+public:
+    SmartTileConfigurationProviderTestFixture() {}
+};
+
+static const unsigned int width = 1920;
+static const unsigned int height = 1080;
+static const unsigned int gopLength = 30;
+
+static std::shared_ptr<SemanticDataManager> selectionForLabel(std::shared_ptr<SemanticIndex> semanticIndex, const std::string &label, std::shared_ptr<TemporalSelection> temporalSelection = nullptr) {
+    return std::make_shared<SemanticDataManager>(semanticIndex, "video", std::make_shared<SingleMetadataSelection>(label), temporalSelection);
+}
+
+TEST_F(SmartTileConfigurationProviderTestFixture, testGOPWorkloadMatchesCostEstimator) {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+    for (auto frame = 0u; frame < 2 * gopLength; ++frame) {
+        semanticIndex->addMetadata("video", "fish", frame, frame * 10, 100, frame * 10 + 200, 300);
+        if (frame % 3)
+            semanticIndex->addMetadata("video", "cat", frame, 1200, 600, 1500, 900);
+    }
+
+    auto workload = std::make_shared<Workload>(std::vector<std::shared_ptr<SemanticDataManager>>{
+            selectionForLabel(semanticIndex, "fish"),
+            selectionForLabel(semanticIndex, "cat", std::make_shared<RangeTemporalSelection>(5, 40))}, std::vector<unsigned int>{3, 2});
+    auto layoutProvider = std::make_shared<UniformTileconfigurationProvider>(3, 4, Configuration(width, height, width, height, width, height, 30, Codec::HEVC, 0));
+    auto layout = layoutProvider->tileLayoutForFrame(0);
+
+    CostElements expected = WorkloadCostEstimator(layoutProvider, workload, gopLength).estimateCostForWorkload();
+    CostElements actual(0, 0);
+    for (auto gop = 0u; gop < 2; ++gop)
+        actual.add(GOPWorkload(*workload, gop * gopLength, (gop + 1) * gopLength).estimateCost(*layout));
+    assert(actual.numPixels == expected.numPixels);
+    assert(actual.numTiles == expected.numTiles);
+}
+
+TEST_F(SmartTileConfigurationProviderTestFixture, testWorkloadLayoutFavorsFrequentQueries) {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+    for (auto frame = 0u; frame < gopLength; ++frame) {
+        semanticIndex->addMetadata("video", "fish", frame, 100, 100, 300, 300);
+        semanticIndex->addMetadata("video", "cat", frame, 1400, 700, 1700, 1000);
+        // Birds cover most of the second GOP, so it is not worth tiling.
+        semanticIndex->addMetadata("video", "bird", gopLength + frame, 0, 0, width - 64, height - 64);
+    }
+
+    auto workload = std::make_shared<Workload>(std::vector<std::shared_ptr<SemanticDataManager>>{
+            selectionForLabel(semanticIndex, "fish"),
+            selectionForLabel(semanticIndex, "cat"),
+            selectionForLabel(semanticIndex, "bird")}, std::vector<unsigned int>{10, 1, 1});
+    WorkloadTileConfigurationProvider provider(gopLength, workload, width, height);
+
+    auto layout = provider.tileLayoutForFrame(0);
+    assert(layout->numberOfTiles() > 1);
+    assert(layout->tilesForRectangle(Rectangle(0, 100, 100, 200, 200)).size() == 1);
+
+    // The chosen layout is at least as cheap as not tiling and as the fine-grained layout.
+    GOPWorkload gopWorkload(*workload, 0, gopLength);
+    auto costProfile = CostModel::instance().profile();
+    auto cost = provider.estimatedCostForFrame(0);
+    assert(std::abs(cost - OptimizedTileConfigurationProvider::estimatedCost(gopWorkload.estimateCost(*layout), costProfile)) < 1e-6);
+    TileLayout singleTile(1, 1, {width}, {height});
+    assert(cost < OptimizedTileConfigurationProvider::estimatedCost(gopWorkload.estimateCost(singleTile), costProfile));
+    std::vector<Rectangle> allObjects(gopWorkload.objectsForQuery(0));
+    allObjects.insert(allObjects.end(), gopWorkload.objectsForQuery(1).begin(), gopWorkload.objectsForQuery(1).end());
+    auto fineGrainedLayout = FineGrainedTileConfigurationProvider::layoutForRectangles(allObjects, width, height);
+    assert(cost <= OptimizedTileConfigurationProvider::estimatedCost(gopWorkload.estimateCost(*fineGrainedLayout), costProfile));
+
+    assert(provider.tileLayoutForFrame(gopLength)->numberOfTiles() == 1);
+    // GOPs without objects are not tiled.
+    assert(provider.tileLayoutForFrame(2 * gopLength)->numberOfTiles() == 1);
+    assert(provider.estimatedCostForFrame(2 * gopLength) == 0);
+}
@@ -1,5 +1,9 @@
 #include "Tasm.h"
+#include "CostModel.h"
+#include "TileManifest.h"
 #include "Video.h"
+#include <chrono>
+#include <fstream>
 #include <gtest/gtest.h>
 #include "sqlite3.h"
 
@@ -72,6 +76,63 @@ TEST_F(TasmTestFixture, testTileBird) {
     std::experimental::filesystem::remove_all(tasm::files::PathForVideo("birdsincage-forced"));
 }
 
+TEST_F(TasmTestFixture, testStoreWritesTileManifest) {
+    tasm::TASM tasm(SemanticIndex::IndexType::InMemory);
+    std::string video("birdsincage-manifest");
+    tasm.storeWithUniformLayout("/home/maureen/NFLX_dataset/BirdsInCage_hevc.mp4", video, 2, 2);
+
+    // Every committed tile directory is listed in the manifest.
+    auto videoPath = tasm::files::PathForVideo(video);
+    auto manifest = TileManifest::read(videoPath);
+    unsigned int numberOfTileDirectories = 0;
+    for (auto &dir : std::experimental::filesystem::directory_iterator(videoPath)) {
+        if (std::experimental::filesystem::is_directory(dir.status()))
+            ++numberOfTileDirectories;
+    }
+    assert(numberOfTileDirectories);
+    assert(manifest->directories().size() == numberOfTileDirectories);
+    for (const auto &directory : manifest->directories())
+        assert(directory.layout->numberOfTiles() == 4);
+
+    // Queries share the cached manifest.
+    assert(TileManifestCache::instance().manifest(videoPath) == TileManifestCache::instance().manifest(videoPath));
+
+    std::experimental::filesystem::remove_all(videoPath);
+}
+
+TEST_F(TasmTestFixture, testSelectObjectsAcrossTiles) {
+    tasm::TASM tasm(SemanticIndex::IndexType::InMemory);
+    std::string video("birdsincage-2x2");
+    tasm.storeWithUniformLayout("/home/maureen/NFLX_dataset/BirdsInCage_hevc.mp4", video, 2, 2);
+
+    // The first box spans all four tiles of the 1920x1080 video; the second lies within the top-left tile.
+    static const unsigned int numberOfFrames = 30;
+    for (auto frame = 0u; frame < numberOfFrames; ++frame) {
+        tasm.addMetadata(video, "box", frame, 900, 500, 1020, 580);
+        tasm.addMetadata(video, "box", frame, 100, 100, 200, 160);
+    }
+
+    auto selection = tasm.select(video, "box", 0u, numberOfFrames);
+    unsigned int numberOfSpanningObjects = 0;
+    unsigned int numberOfObjects = 0;
+    ImagePtr next;
+    while ((next = selection->next())) {
+        ++numberOfObjects;
+        if (next->width() == 120) {
+            assert(next->height() == 80);
+            ++numberOfSpanningObjects;
+        } else {
+            assert(next->width() == 100);
+            assert(next->height() == 60);
+        }
+    }
+    assert(numberOfObjects == 2 * numberOfFrames);
+    assert(numberOfSpanningObjects == numberOfFrames);
+    assert(selection->stats()->get(QueryStats::Counter::ObjectsAssembled) == numberOfFrames);
+
+    std::experimental::filesystem::remove_all(tasm::files::PathForVideo(video));
+}
+
 TEST_F(TasmTestFixture, testTileElFuente1) {
     tasm::TASM tasm(SemanticIndex::IndexType::InMemory);
     tasm.storeWithNonUniformLayout("/home/maureen/NFLX_dataset/ElFuente1_hevc.mp4", "elfuente1-not-forced", "elfuente1", "person", false);
@@ -88,6 +149,71 @@ TEST_F(TasmTestFixture, testSelectBird) {
     // assert(count == 360);
 }
 
+TEST_F(TasmTestFixture, testSelectBirdWithLimit) {
+    tasm::TASM tasm(SemanticIndex::IndexType::InMemory);
+    auto selection = tasm.select("birdsincage-bird", "bird", "birdsincage", 10);
+    ImagePtr next;
+    auto count = 0u;
+    while ((next = selection->next()))
+        ++count;
+    // The video has many more than 10 birds, so the limit is what stops the selection.
+    assert(count == 10);
+
+    // Destroying a selection before it is exhausted should stop the scan and decode rather than finishing them.
+    selection = tasm.select("birdsincage-bird", "bird", "birdsincage");
+    selection->next();
+    selection.reset();
+}
+
+TEST_F(TasmTestFixture, testSelectBirdStats) {
+    tasm::TASM tasm(SemanticIndex::IndexType::InMemory);
+    auto processFramesDecoded = QueryStats::processWide().get(QueryStats::Counter::FramesDecoded);
+    auto selection = tasm.select("birdsincage-bird", "bird", 0u, 30u, "birdsincage");
+    while (selection->next()) { }
+
+    auto stats = selection->stats();
+    assert(stats->get(QueryStats::Counter::TilesOpened) > 0);
+    assert(stats->get(QueryStats::Counter::GOPsRead) >= stats->get(QueryStats::Counter::TilesOpened));
+    assert(stats->get(QueryStats::Counter::BytesRead) > 0);
+    assert(stats->get(QueryStats::Counter::FramesDecoded) > 0);
+    assert(stats->get(QueryStats::Counter::PixelsDecoded) > 0);
+    assert(stats->operatorTimesNs().count("GPUDecodeFromCPU"));
+    assert(QueryStats::processWide().get(QueryStats::Counter::FramesDecoded) - processFramesDecoded
+            == stats->get(QueryStats::Counter::FramesDecoded));
+}
+
+TEST_F(TasmTestFixture, testSelectBirdDecodeTime) {
+    tasm::TASM tasm(SemanticIndex::IndexType::InMemory);
+    auto start = std::chrono::steady_clock::now();
+    auto selection = tasm.select("birdsincage-bird", "bird", 0u, 30u, "birdsincage");
+    while (selection->next()) { }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    // The decode is timed on the decoder's worker thread alone, so it cannot take longer than the selection.
+    auto stats = selection->stats();
+    auto decodeTime = stats->get(QueryStats::Counter::DecodeTimeNs);
+    assert(decodeTime > 0);
+    assert(decodeTime <= static_cast<unsigned long long>(elapsed.count()));
+    assert(CostModel::decodeTimeInMilliseconds(*stats) == decodeTime / 1e6);
+}
+
+TEST_F(TasmTestFixture, testTraceSelectBird) {
+    std::experimental::filesystem::path tracePath("testTrace.json");
+    tasm::TASM tasm(SemanticIndex::IndexType::InMemory);
+    tasm.startTracing();
+    auto selection = tasm.select("birdsincage-bird", "bird", 0u, 30u, "birdsincage");
+    while (selection->next()) { }
+    selection.reset();
+    tasm.stopTracing(tracePath);
+
+    std::ifstream trace(tracePath);
+    std::string contents((std::istreambuf_iterator<char>(trace)), std::istreambuf_iterator<char>());
+    assert(contents.find("\"MergeTilesOperator::next\"") != std::string::npos);
+    assert(contents.find("\"EncodedFrameReader::read\"") != std::string::npos);
+    assert(contents.find("\"decoder worker\"") != std::string::npos);
+    std::experimental::filesystem::remove(tracePath);
+}
+
 TEST_F(TasmTestFixture, testScanBirdsFullFrame) {
     tasm::TASM tasm(SemanticIndex::IndexType::XY, "/home/maureen/home_videos/birds_tasm.db");
     auto selection = tasm.selectFrames("birds-birds", "bird", 0, 5, "birds");
@@ -0,0 +1,74 @@
+#include "TileLayout.h"
+#include <gtest/gtest.h>
+
+#include <cassert>
+#include <random>
+#include <vector>
+
+using namespace tasm;
+
+class TileLayoutTestFixture : public testing::Test {
+public:
+    TileLayoutTestFixture() {}
+};
+
+static std::vector<unsigned int> tilesThatIntersect(const TileLayout &layout, const Rectangle &rectangle) {
+    std::vector<unsigned int> tiles;
+    for (auto tile = 0u; tile < layout.numberOfTiles(); ++tile) {
+        if (layout.rectangleForTile(tile).intersects(rectangle))
+            tiles.push_back(tile);
+    }
+    return tiles;
+}
+
+TEST_F(TileLayoutTestFixture, testRectangleForTile) {
+    TileLayout layout(3, 2, {320, 640, 960}, {512, 568});
+    assert(layout.totalWidth() == 1920);
+    assert(layout.totalHeight() == 1080);
+    assert(layout.largestWidth() == 960);
+    assert(layout.largestHeight() == 568);
+    assert(layout.rectangleForTile(0) == Rectangle(0, 0, 0, 320, 512));
+    assert(layout.rectangleForTile(2) == Rectangle(0, 960, 0, 960, 512));
+    assert(layout.rectangleForTile(4) == Rectangle(0, 320, 512, 640, 568));
+}
+
+TEST_F(TileLayoutTestFixture, testTilesForRectangle) {
+    TileLayout layout(3, 2, {320, 640, 960}, {512, 568});
+
+    // Entirely within one tile.
+    assert(layout.tilesForRectangle(Rectangle(0, 10, 10, 100, 100)) == std::vector<unsigned int>({0}));
+    // Touching a tile boundary does not intersect the neighboring tile.
+    assert(layout.tilesForRectangle(Rectangle(0, 220, 412, 100, 100)) == std::vector<unsigned int>({0}));
+    // Spans all four tiles around an interior corner.
+    assert(layout.tilesForRectangle(Rectangle(0, 300, 500, 100, 100)) == std::vector<unsigned int>({0, 1, 3, 4}));
+    // The whole frame.
+    assert(layout.tilesForRectangle(Rectangle(0, 0, 0, 1920, 1080)).size() == 6);
+    // Outside of the frame.
+    assert(layout.tilesForRectangle(Rectangle(0, 1920, 0, 100, 100)).empty());
+}
+
+TEST_F(TileLayoutTestFixture, testTilesForRectanglesMatchesIntersects) {
+    TileLayout layout(5, 4, {256, 384, 512, 384, 384}, {256, 288, 256, 280});
+    std::mt19937 generator(17);
+    std::uniform_int_distribution<unsigned int> x(0, layout.totalWidth() + 64);
+    std::uniform_int_distribution<unsigned int> y(0, layout.totalHeight() + 64);
+    std::uniform_int_distribution<unsigned int> size(0, 600);
+
+    for (auto i = 0u; i < 100; ++i) {
+        std::vector<Rectangle> rectangles;
+        std::vector<bool> expected(layout.numberOfTiles(), false);
+        for (auto j = 0u; j < 4; ++j) {
+            Rectangle rectangle(j, x(generator), y(generator), size(generator), size(generator));
+            auto tiles = tilesThatIntersect(layout, rectangle);
+            assert(layout.tilesForRectangle(rectangle) == tiles);
+
+            for (auto tile : tiles)
+                expected[tile] = true;
+            rectangles.push_back(rectangle);
+        }
+
+        auto mask = layout.tilesForRectangles(rectangles);
+        for (auto tile = 0u; tile < layout.numberOfTiles(); ++tile)
+            assert(mask.test(tile) == expected[tile]);
+    }
+}
@@ -0,0 +1,72 @@
+#include "TileLocationProvider.h"
+#include <gtest/gtest.h>
+
+#include <cassert>
+
+using namespace tasm;
+
+class TileLocationProviderTestFixture : public testing::Test {
+public:
+    TileLocationProviderTestFixture() {}
+};
+
+static std::shared_ptr<TileLayout> layout(unsigned int numberOfColumns) {
+    return std::make_shared<TileLayout>(numberOfColumns, 1, std::vector<unsigned int>(numberOfColumns, 320), std::vector<unsigned int>{240});
+}
+
+static std::vector<std::pair<unsigned int, int>> firstFramesAndLayoutIds(const FrameLayoutRuns &runs) {
+    std::vector<std::pair<unsigned int, int>> firstFramesAndIds;
+    for (const auto &run : runs.runs())
+        firstFramesAndIds.emplace_back(run.firstFrame, run.layoutId);
+    return firstFramesAndIds;
+}
+
+TEST_F(TileLocationProviderTestFixture, testFrameLayoutRuns) {
+    auto videoPath = std::experimental::filesystem::temp_directory_path() / "tile-location-provider-test";
+    std::experimental::filesystem::remove_all(videoPath);
+    std::experimental::filesystem::create_directories(videoPath);
+
+    TileManifest({
+        {0, 29, 0, layout(1)},
+        {30, 59, 1, layout(2)},
+        // Re-tiles part of the first directory.
+        {10, 19, 2, layout(3)},
+        // No directory contains frames 60-89.
+        {90, 119, 3, layout(2)},
+    }).write(videoPath);
+    auto manager = std::make_shared<TiledVideoManager>(std::make_shared<TiledEntry>("video", videoPath));
+
+    auto runs = manager->frameLayoutRuns();
+    assert(firstFramesAndLayoutIds(*runs) == (std::vector<std::pair<unsigned int, int>>{
+        {0, 0}, {10, 2}, {20, 0}, {30, 1}, {60, -1}, {90, 3}, {120, -1}}));
+    assert(!runs->runs()[4].layout);
+
+    // The newest directory that contains a frame wins, including at the edges of each run.
+    SingleTileLocationProvider provider(manager);
+    std::vector<std::pair<unsigned int, unsigned int>> framesAndVersions{
+        {0, 0}, {9, 0}, {10, 2}, {19, 2}, {20, 0}, {29, 0}, {30, 1}, {59, 1}, {90, 3}, {119, 3}};
+    for (const auto &frameAndVersion : framesAndVersions) {
+        auto directory = provider.locationOfTileForFrame(0, frameAndVersion.first).parent_path();
+        assert(TileFiles::tileVersionFromPath(directory) == frameAndVersion.second);
+    }
+    assert(*provider.tileLayoutForFrame(15) == *layout(3));
+    assert(provider.tileLayoutForFrame(30) == provider.tileLayoutForFrame(90));
+    assert(provider.lastFrameWithLayout() == 119);
+
+    // Queries that read the same manifest share its runs.
+    auto otherManager = std::make_shared<TiledVideoManager>(std::make_shared<TiledEntry>("video", videoPath));
+    assert(otherManager->frameLayoutRuns() == runs);
+    assert(otherManager->maximumFrame() == 119);
+    assert(otherManager->largestWidth() == 320);
+    assert(otherManager->totalWidth() == 320);
+
+    // A provider keeps the runs that it was created with, and new ones see directories that were added since.
+    TileManifestCache::instance().addDirectory(videoPath, {60, 89, 4, layout(1)});
+    auto newManager = std::make_shared<TiledVideoManager>(std::make_shared<TiledEntry>("video", videoPath));
+    assert(newManager->frameLayoutRuns() != runs);
+    SingleTileLocationProvider newProvider(newManager);
+    assert(TileFiles::tileVersionFromPath(newProvider.locationOfTileForFrame(0, 60).parent_path()) == 4);
+    assert(TileFiles::tileVersionFromPath(provider.locationOfTileForFrame(0, 59).parent_path()) == 1);
+
+    std::experimental::filesystem::remove_all(videoPath);
+}
@@ -0,0 +1,149 @@
+#include "TileManifest.h"
+#include <gtest/gtest.h>
+
+#include "Files.h"
+#include "TileCompactor.h"
+#include <atomic>
+#include <cassert>
+#include <fstream>
+
+using namespace tasm;
+
+class TileManifestTestFixture : public testing::Test {
+public:
+    TileManifestTestFixture() {}
+};
+
+static std::shared_ptr<TileLayout> layout(unsigned int numberOfColumns) {
+    return std::make_shared<TileLayout>(numberOfColumns, 1, std::vector<unsigned int>(numberOfColumns, 320), std::vector<unsigned int>{240});
+}
+
+static std::vector<unsigned int> versions(const std::vector<TileDirectory> &directories) {
+    std::vector<unsigned int> tileVersions;
+    for (const auto &directory : directories)
+        tileVersions.push_back(directory.tileVersion);
+    std::sort(tileVersions.begin(), tileVersions.end());
+    return tileVersions;
+}
+
+TEST_F(TileManifestTestFixture, testShadowedDirectories) {
+    TileManifest manifest({
+        {0, 89, 0, layout(1)},
+        {0, 29, 1, layout(2)},
+        {30, 59, 2, layout(2)},
+        // Only covers part of the first re-tiled GOP, which stays visible for frames 15-29.
+        {0, 14, 3, layout(3)},
+        {60, 89, 4, layout(3)},
+        {30, 59, 5, layout(1)},
+    });
+
+    // Directories are shadowed by the union of newer directories, even when no single one contains them.
+    assert(versions(manifest.shadowedDirectories()) == std::vector<unsigned int>({0, 2}));
+    // Only directories up to the version are considered.
+    assert(versions(manifest.shadowedDirectories(4)) == std::vector<unsigned int>({0}));
+    assert(manifest.shadowedDirectories(2).empty());
+
+    auto compacted = manifest.withoutDirectories(manifest.shadowedDirectories());
+    assert(versions(compacted->directories()) == std::vector<unsigned int>({1, 3, 4, 5}));
+    assert(compacted->newestTileVersion() == 5);
+}
+
+TEST_F(TileManifestTestFixture, testCompactionKeepsPinnedDirectories) {
+    auto videoPath = std::experimental::filesystem::temp_directory_path() / "tile-manifest-test";
+    std::experimental::filesystem::remove_all(videoPath);
+    std::experimental::filesystem::create_directories(videoPath);
+
+    std::vector<TileDirectory> directories{
+        {0, 29, 0, layout(1)},
+        {0, 29, 1, layout(2)},
+        {0, 29, 2, layout(3)},
+    };
+    for (const auto &directory : directories) {
+        auto directoryPath = TileFiles::directoryForTilesInFrames(videoPath, directory.firstFrame, directory.lastFrame, directory.tileVersion);
+        std::experimental::filesystem::create_directories(directoryPath);
+        std::ofstream(TileFiles::tileFilename(directoryPath, 0)) << "tile";
+    }
+    auto directoryPath = [&](unsigned int tileVersion) {
+        const auto &directory = directories[tileVersion];
+        return TileFiles::directoryForTilesInFrames(videoPath, directory.firstFrame, directory.lastFrame, directory.tileVersion);
+    };
+
+    // A query that started before the newest version may still read the one before it.
+    TileManifest(std::vector<TileDirectory>(directories.begin(), directories.begin() + 2)).write(videoPath);
+    std::unique_ptr<const TileVersionPin> pin;
+    TileManifestCache::instance().pinnedManifest(videoPath, pin);
+    assert(pin->tileVersion() == 1);
+    TileManifestCache::instance().addDirectory(videoPath, directories[2]);
+
+    auto compaction = TileManifestCache::instance().compact(videoPath);
+    assert(!compaction.numberOfDeletedDirectories);
+    assert(compaction.numberOfPinnedDirectories == 1);
+    assert(std::experimental::filesystem::exists(directoryPath(1)));
+
+    pin.reset();
+    compaction = TileManifestCache::instance().compact(videoPath);
+    assert(compaction.numberOfDeletedDirectories == 1);
+    assert(!compaction.numberOfPinnedDirectories);
+    assert(!std::experimental::filesystem::exists(directoryPath(1)));
+    assert(versions(TileManifestCache::instance().manifest(videoPath)->directories()) == std::vector<unsigned int>({0, 2}));
+    // The first version is kept because re-tiling reads from it.
+    assert(std::experimental::filesystem::exists(directoryPath(0)));
+
+    std::experimental::filesystem::remove_all(videoPath);
+}
+
+TEST_F(TileManifestTestFixture, testCompactionKeepsPinnedDirectoriesAfterOlderCommits) {
+    auto videoPath = std::experimental::filesystem::temp_directory_path() / "tile-manifest-older-commit-test";
+    std::experimental::filesystem::remove_all(videoPath);
+    std::experimental::filesystem::create_directories(videoPath);
+
+    TileDirectory original{0, 59, 0, layout(1)};
+    TileDirectory firstHalf{0, 29, 1, layout(2)};
+    TileDirectory secondHalf{30, 59, 3, layout(2)};
+    // Another writer assigned version 2 before version 3 was assigned, but commits it after the manifest is pinned.
+    TileDirectory olderCommit{0, 29, 2, layout(3)};
+    for (const auto &directory : {original, firstHalf, secondHalf, olderCommit})
+        std::experimental::filesystem::create_directories(TileFiles::directoryForTilesInFrames(videoPath, directory.firstFrame, directory.lastFrame, directory.tileVersion));
+    auto firstHalfPath = TileFiles::directoryForTilesInFrames(videoPath, firstHalf.firstFrame, firstHalf.lastFrame, firstHalf.tileVersion);
+
+    TileManifest({original, firstHalf, secondHalf}).write(videoPath);
+    std::unique_ptr<const TileVersionPin> pin;
+    TileManifestCache::instance().pinnedManifest(videoPath, pin);
+    assert(pin->tileVersion() == 3);
+    TileManifestCache::instance().addDirectory(videoPath, olderCommit);
+
+    // The pinned manifest does not list version 2, so its reader still reads version 1.
+    auto compaction = TileManifestCache::instance().compact(videoPath);
+    assert(!compaction.numberOfDeletedDirectories);
+    assert(compaction.numberOfPinnedDirectories == 1);
+    assert(std::experimental::filesystem::exists(firstHalfPath));
+
+    pin.reset();
+    compaction = TileManifestCache::instance().compact(videoPath);
+    assert(compaction.numberOfDeletedDirectories == 1);
+    assert(!std::experimental::filesystem::exists(firstHalfPath));
+
+    std::experimental::filesystem::remove_all(videoPath);
+}
+
+TEST_F(TileManifestTestFixture, testCompactorRetriesPinnedVideos) {
+    std::atomic<unsigned int> numberOfCompactions(0);
+    TileCompactor compactor([&](const std::experimental::filesystem::path&) {
+        // The video's shadowed directory is pinned the first time that it is compacted.
+        TileCompaction compaction;
+        if (numberOfCompactions++)
+            compaction.numberOfDeletedDirectories = 1;
+        else
+            compaction.numberOfPinnedDirectories = 1;
+        return compaction;
+    });
+
+    compactor.requestCompaction("video");
+    auto deadline = std::chrono::steady_clock::now() + 5 * TileCompactor::PollInterval;
+    while (compactor.numberOfDeletedDirectories() < 1 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    assert(compactor.numberOfDeletedDirectories() == 1);
+    assert(numberOfCompactions == 2);
+    assert(!compactor.hasRequestedVideos());
+}
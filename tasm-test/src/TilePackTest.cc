@@ -0,0 +1,94 @@
+#include "TilePack.h"
+#include <gtest/gtest.h>
+
+#include "Files.h"
+#include <cassert>
+#include <fstream>
+
+using namespace tasm;
+
+class TilePackTestFixture : public testing::Test {
+public:
+    TilePackTestFixture() {}
+};
+
+// The two bytes of an HEVC NAL header, a four byte start code, and one byte of payload whose top bit is
+// first_slice_segment_in_pic_flag for slices.
+static std::vector<char> nalUnit(unsigned char type, unsigned char payload = 0x80) {
+    return {0, 0, 0, 1, static_cast<char>(type << 1u), 1, static_cast<char>(payload), 0x2a};
+}
+
+static std::vector<char> concatenate(const std::vector<std::vector<char>> &parts) {
+    std::vector<char> result;
+    for (const auto &part : parts)
+        result.insert(result.end(), part.begin(), part.end());
+    return result;
+}
+
+static void writeStream(const std::experimental::filesystem::path &path, const std::vector<char> &stream) {
+    std::ofstream output(path, std::ios::out | std::ios::binary);
+    output.write(stream.data(), stream.size());
+}
+
+TEST_F(TilePackTestFixture, testSamplesInStream) {
+    static const unsigned char VPS = 32, SPS = 33, PPS = 34, IDR = 19, TRAIL = 1;
+    auto parameterSets = concatenate({nalUnit(VPS), nalUnit(SPS), nalUnit(PPS)});
+    auto first = concatenate({parameterSets, nalUnit(IDR)});
+    // A picture with two slices.
+    auto second = concatenate({nalUnit(TRAIL), nalUnit(TRAIL, 0x00)});
+    auto third = nalUnit(TRAIL);
+    auto fourth = nalUnit(IDR);
+    auto stream = concatenate({first, second, third, fourth});
+
+    auto samples = TilePack::samplesInStream(stream);
+    assert(samples.size() == 4);
+    assert(samples[0].offset == 0 && samples[0].size == first.size() && samples[0].isKeyframe);
+    assert(samples[1].offset == first.size() && samples[1].size == second.size() && !samples[1].isKeyframe);
+    assert(samples[2].size == third.size() && !samples[2].isKeyframe);
+    assert(samples[3].size == fourth.size() && samples[3].isKeyframe);
+}
+
+TEST_F(TilePackTestFixture, testWriteAndRead) {
+    static const unsigned char VPS = 32, SPS = 33, PPS = 34, IDR = 19, TRAIL = 1;
+    auto directory = std::experimental::filesystem::temp_directory_path() / "tasm-tile-pack-test";
+    std::experimental::filesystem::remove_all(directory);
+    std::experimental::filesystem::create_directories(directory);
+
+    auto parameterSets = concatenate({nalUnit(VPS), nalUnit(SPS), nalUnit(PPS)});
+    auto firstTile = concatenate({parameterSets, nalUnit(IDR), nalUnit(TRAIL), nalUnit(TRAIL), nalUnit(IDR), nalUnit(TRAIL)});
+    auto secondTile = concatenate({parameterSets, nalUnit(IDR), nalUnit(IDR)});
+    writeStream(directory / "first.hevc", firstTile);
+    writeStream(directory / "second.hevc", secondTile);
+
+    Configuration firstConfiguration(320, 240, 320, 256, 320, 256, 30, Codec::HEVC, 1000);
+    Configuration secondConfiguration(640, 240, 640, 256, 640, 256, 30, Codec::HEVC, 2000);
+    TilePack::write(directory, {{0, firstConfiguration, directory / "first.hevc"},
+                                {2, secondConfiguration, directory / "second.hevc"}});
+
+    auto pack = TilePack::open(directory);
+    assert(pack->containsTile(0));
+    assert(!pack->containsTile(1));
+    assert(pack->containsTile(2));
+    assert(pack->configurationForTile(2).displayWidth == 640);
+    assert(pack->configurationForTile(0).codedHeight == 256);
+
+    assert(pack->numberOfSamplesForTile(0) == 5);
+    assert(pack->keyframeNumbersForTile(0) == std::vector<int>({0, 3}));
+    // Every sample of the second tile is a keyframe.
+    assert(pack->numberOfSamplesForTile(2) == 2);
+    assert(pack->keyframeNumbersForTile(2).empty());
+
+    // Samples that are read together are contiguous.
+    assert(*pack->dataForSamples(0, 1, 3) == concatenate({parameterSets, nalUnit(IDR), nalUnit(TRAIL), nalUnit(TRAIL)}));
+    // Parameter sets are copied before keyframes that did not have them.
+    assert(*pack->dataForSamples(0, 4, 5) == concatenate({parameterSets, nalUnit(IDR), nalUnit(TRAIL)}));
+    assert(*pack->dataForSamples(2, 2, 2) == concatenate({parameterSets, nalUnit(IDR)}));
+
+    PackedTileReader reader(pack, 2);
+    assert(reader.filename() == TileFiles::tileFilename(directory, 2));
+    assert(reader.allFramesAreKeyframes());
+    reader.setNewFileWithSameKeyframes(TileFiles::tileFilename(directory, 0));
+    assert(reader.numberOfSamples() == 5);
+
+    std::experimental::filesystem::remove_all(directory);
+}
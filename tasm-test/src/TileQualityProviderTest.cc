@@ -0,0 +1,68 @@
+#include "TileQualityProvider.h"
+#include <gtest/gtest.h>
+
+#include "EnvironmentConfiguration.h"
+#include "SemanticDataManager.h"
+#include "WorkloadCostEstimator.h"
+#include <cassert>
+
+using namespace tasm;
+
+class TileQualityProviderTestFixture : public testing::Test {
+public:
+    TileQualityProviderTestFixture() {}
+};
+
+TEST_F(TileQualityProviderTestFixture, testBackgroundTilesUseBackgroundQuality) {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+    // The fish stays in the first column during the first GOP, and moves into the second column in the second GOP.
+    semanticIndex->addMetadata("video", "fish", 5, 10, 10, 100, 100);
+    semanticIndex->addMetadata("video", "fish", 40, 350, 10, 400, 100);
+    // Cats are not part of the workload.
+    semanticIndex->addMetadata("video", "cat", 10, 700, 10, 800, 100);
+
+    auto workload = std::make_shared<Workload>(std::make_shared<SemanticDataManager>(semanticIndex, "video", std::make_shared<SingleMetadataSelection>("fish")));
+    SemanticTileQualityProvider provider(LayoutIntervals(30), workload, TileQuality{24, 40});
+    TileLayout layout(3, 1, {320, 320, 320}, {240});
+
+    // Every frame of the GOP uses the tiles that the object intersects in any of its frames.
+    assert(provider.quantizationParametersForFrame(0, layout) == std::vector<unsigned int>({24, 40, 40}));
+    assert(provider.quantizationParametersForFrame(29, layout) == std::vector<unsigned int>({24, 40, 40}));
+    assert(provider.quantizationParametersForFrame(30, layout) == std::vector<unsigned int>({40, 24, 40}));
+    assert(provider.quantizationParametersForFrame(60, layout) == std::vector<unsigned int>({40, 40, 40}));
+}
+
+TEST_F(TileQualityProviderTestFixture, testLayoutChangesWithinInterval) {
+    auto semanticIndex = SemanticIndexFactory::createInMemory();
+    semanticIndex->addMetadata("video", "fish", 5, 10, 10, 100, 100);
+
+    auto workload = std::make_shared<Workload>(std::make_shared<SemanticDataManager>(semanticIndex, "video", std::make_shared<SingleMetadataSelection>("fish")));
+    SemanticTileQualityProvider provider(LayoutIntervals(30), workload, TileQuality{24, 40});
+    TileLayout columns(3, 1, {320, 320, 320}, {240});
+    TileLayout rows(1, 2, {960}, {120, 120});
+
+    // The parameters for one layout must not be reused for another layout in the same interval.
+    assert(provider.quantizationParametersForFrame(0, columns) == std::vector<unsigned int>({24, 40, 40}));
+    assert(provider.quantizationParametersForFrame(1, columns) == std::vector<unsigned int>({24, 40, 40}));
+    assert(provider.quantizationParametersForFrame(2, rows) == std::vector<unsigned int>({24, 40}));
+    assert(provider.quantizationParametersForFrame(3, columns) == std::vector<unsigned int>({24, 40, 40}));
+    assert(provider.quantizationParametersForFrame(30, columns) == std::vector<unsigned int>({40, 40, 40}));
+}
+
+TEST_F(TileQualityProviderTestFixture, testQuantizationParametersAreRangeChecked) {
+    EnvironmentConfiguration configuration({{EnvironmentConfiguration::ObjectTileQP, "51"}, {EnvironmentConfiguration::BackgroundTileQP, "0"}});
+    assert(configuration.objectTileQP() == 51);
+    assert(configuration.backgroundTileQP() == 0);
+
+    for (const auto &option : {EnvironmentConfiguration::ObjectTileQP, EnvironmentConfiguration::BackgroundTileQP}) {
+        for (const auto &value : {"52", "-1"}) {
+            bool threw = false;
+            try {
+                EnvironmentConfiguration(std::unordered_map<std::string, std::string>{{option, value}});
+            } catch (const std::invalid_argument &) {
+                threw = true;
+            }
+            assert(threw);
+        }
+    }
+}
@@ -0,0 +1,147 @@
+#include "TileReadAhead.h"
+#include <gtest/gtest.h>
+
+#include <cassert>
+
+using namespace tasm;
+
+class TileReadAheadTestFixture : public testing::Test {
+public:
+    TileReadAheadTestFixture() {}
+};
+
+// A tile whose frames are all keyframes, and whose samples are `sampleSize` copies of the tile's id.
+class FakeSampleReader : public SampleReader {
+public:
+    FakeSampleReader(char id, unsigned int numberOfSamples, unsigned int sampleSize)
+        : id_(id), numberOfSamples_(numberOfSamples), sampleSize_(sampleSize), filename_(std::string(1, id))
+    {}
+
+    const std::experimental::filesystem::path &filename() const override { return filename_; }
+    void setNewFileWithSameKeyframes(const std::experimental::filesystem::path &filename) override { filename_ = filename; }
+    const std::vector<int> &keyframeNumbers() const override { return keyframeNumbers_; }
+    unsigned int numberOfSamples() const override { return numberOfSamples_; }
+    bool allFramesAreKeyframes() const override { return true; }
+
+    std::unique_ptr<std::vector<char>> dataForSamples(unsigned int firstSampleToRead, unsigned int lastSampleToRead) const override {
+        if (id_ == 'x')
+            throw std::runtime_error("Failed to read tile");
+        return std::make_unique<std::vector<char>>((lastSampleToRead - firstSampleToRead + 1) * sampleSize_, id_);
+    }
+
+private:
+    char id_;
+    unsigned int numberOfSamples_;
+    unsigned int sampleSize_;
+    std::experimental::filesystem::path filename_;
+    std::vector<int> keyframeNumbers_;
+};
+
+// Every other frame, so that each frame is read as its own GOP.
+static TileReadAhead::ReaderFactory tile(char id, unsigned int numberOfGOPs, unsigned int sampleSize = 10) {
+    return [=] {
+        auto frames = std::make_shared<std::vector<int>>();
+        for (auto i = 0u; i < numberOfGOPs; ++i)
+            frames->push_back(2 * i);
+        return std::make_unique<EncodedFrameReader>(std::make_unique<FakeSampleReader>(id, 2 * numberOfGOPs, sampleSize), frames);
+    };
+}
+
+TEST_F(TileReadAheadTestFixture, testReadsTilesInOrder) {
+    auto stats = std::make_shared<QueryStats>();
+    TileReadAhead readAhead(2, 1000, stats);
+    readAhead.addTile(tile('a', 3));
+    readAhead.addTile(tile('b', 2));
+    readAhead.addTile(tile('c', 1));
+
+    for (auto expected : std::vector<std::pair<char, unsigned int>>{{'a', 3}, {'b', 2}, {'c', 1}}) {
+        auto hasTile = readAhead.nextTile();
+        assert(hasTile);
+        for (auto i = 0u; i < expected.second; ++i) {
+            auto gop = readAhead.nextGOP();
+            assert(gop.has_value());
+            assert(gop->firstFrameIndex() == 2 * i);
+            assert(gop->data()->size() == 10);
+            assert(gop->data()->front() == expected.first);
+        }
+        auto gop = readAhead.nextGOP();
+        assert(!gop.has_value());
+    }
+    auto hasTile = readAhead.nextTile();
+    assert(!hasTile);
+    auto gop = readAhead.nextGOP();
+    assert(!gop.has_value());
+    assert(readAhead.bufferedBytes() == 0);
+
+    assert(stats->get(QueryStats::Counter::ReadAheadHits) + stats->get(QueryStats::Counter::ReadAheadStalls) == 6);
+}
+
+TEST_F(TileReadAheadTestFixture, testSkippingTileDiscardsItsGOPs) {
+    TileReadAhead readAhead(4, 1000);
+    readAhead.addTile(tile('a', 5));
+    readAhead.addTile(tile('b', 1));
+
+    auto hasTile = readAhead.nextTile();
+    assert(hasTile);
+    auto gop = readAhead.nextGOP();
+    assert(gop->data()->front() == 'a');
+    hasTile = readAhead.nextTile();
+    assert(hasTile);
+    gop = readAhead.nextGOP();
+    assert(gop->data()->front() == 'b');
+    gop = readAhead.nextGOP();
+    assert(!gop.has_value());
+    assert(readAhead.bufferedBytes() == 0);
+}
+
+TEST_F(TileReadAheadTestFixture, testCurrentTileIsReadPastBudget) {
+    // Each GOP is larger than the budget, so only the current tile can make progress.
+    TileReadAhead readAhead(2, 5);
+    readAhead.addTile(tile('a', 3, 100));
+    readAhead.addTile(tile('b', 3, 100));
+
+    for (auto id : {'a', 'b'}) {
+        auto hasTile = readAhead.nextTile();
+        assert(hasTile);
+        for (auto i = 0u; i < 3; ++i) {
+            auto gop = readAhead.nextGOP();
+            assert(gop->data()->front() == id);
+        }
+        auto gop = readAhead.nextGOP();
+        assert(!gop.has_value());
+    }
+}
+
+TEST_F(TileReadAheadTestFixture, testCurrentTileIsLimitedByBudget) {
+    TileReadAhead readAhead(1, 150);
+    readAhead.addTile(tile('a', 5, 100));
+    auto hasTile = readAhead.nextTile();
+    assert(hasTile);
+
+    // The thread reads GOPs until one takes it past the budget, and then waits for the consumer.
+    readAhead.waitForBlockedReaders(1);
+    assert(readAhead.bufferedBytes() == 200);
+
+    for (auto i = 0u; i < 5; ++i) {
+        auto gop = readAhead.nextGOP();
+        assert(gop->data()->front() == 'a');
+    }
+    auto gop = readAhead.nextGOP();
+    assert(!gop.has_value());
+    assert(readAhead.bufferedBytes() == 0);
+}
+
+TEST_F(TileReadAheadTestFixture, testErrorsAreRethrown) {
+    TileReadAhead readAhead(2, 1000);
+    readAhead.addTile(tile('x', 1));
+
+    auto hasTile = readAhead.nextTile();
+    assert(hasTile);
+    bool didThrow = false;
+    try {
+        readAhead.nextGOP();
+    } catch (const std::runtime_error &) {
+        didThrow = true;
+    }
+    assert(didThrow);
+}
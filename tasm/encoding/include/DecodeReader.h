@@ -4,6 +4,7 @@
 #include "GPUContext.h"
 #include "MP4Reader.h"
 #include "spsc_queue.h"
+#include "Trace.h"
 
 #include "nvcuvid.h"
 #include <experimental/filesystem>
@@ -241,8 +242,13 @@ public:
     // Assume frames is sorted.
     // Frames is in global frame numbers (e.g. starting from frameOffsetInFile, not 0).
     explicit EncodedFrameReader(const std::experimental::filesystem::path &filename, std::shared_ptr<std::vector<int>> frames, int frameOffsetInFile = 0, bool shouldReadEntireGOPs=false)
-            : filename_(filename),
-              mp4Reader_(filename_),
+            : EncodedFrameReader(std::make_unique<MP4Reader>(filename), frames, frameOffsetInFile, shouldReadEntireGOPs)
+    { }
+
+    // Reads from any sample source, such as a tile in a TilePack.
+    explicit EncodedFrameReader(std::unique_ptr<SampleReader> sampleReader, std::shared_ptr<std::vector<int>> frames, int frameOffsetInFile = 0, bool shouldReadEntireGOPs=false)
+            : filename_(sampleReader->filename()),
+              sampleReader_(std::move(sampleReader)),
               frames_(frames),
               numberOfSamplesRead_(0),
               shouldReadFramesExactly_(false),
@@ -257,19 +263,19 @@ public:
         }
 
         frameIterator_ = frames_->begin(); // In global frame numbers.
-        keyframeIterator_ = mp4Reader_.keyframeNumbers().begin(); // 0-indexed.
+        keyframeIterator_ = sampleReader_->keyframeNumbers().begin(); // 0-indexed.
     }
 
     void setNewFileWithSameKeyframes(const std::experimental::filesystem::path &newFilename) {
-        mp4Reader_.setNewFileWithSameKeyframes(newFilename);
+        sampleReader_->setNewFileWithSameKeyframes(newFilename);
 
         frameIterator_ = frames_->begin();
-        keyframeIterator_ = mp4Reader_.keyframeNumbers().begin();
+        keyframeIterator_ = sampleReader_->keyframeNumbers().begin();
     }
 
     void setNewFileWithSameKeyframesButNewFrames(const std::experimental::filesystem::path &newFilename, std::shared_ptr<std::vector<int>> frames, int frameOffsetInFile) {
         filename_ = newFilename;
-        mp4Reader_.setNewFileWithSameKeyframes(newFilename);
+        sampleReader_->setNewFileWithSameKeyframes(newFilename);
         frames_ = frames;
         frameOffsetInFile_ = frameOffsetInFile;
 
@@ -280,7 +286,7 @@ public:
         }
 
         frameIterator_ = frames_->begin();
-        keyframeIterator_ = mp4Reader_.keyframeNumbers().begin();
+        keyframeIterator_ = sampleReader_->keyframeNumbers().begin();
     }
 
     void setGlobalFrames(const std::vector<int> &globalFrames) {
@@ -300,6 +306,7 @@ public:
     bool isEos() const { return frameIterator_ == frames_->end(); }
 
     std::optional<GOPReaderPacket> read() {
+        TASM_TRACE_SPAN("EncodedFrameReader::read", "scan");
         // If we are reading all of the frames, return the frames for the next GOP.
         if (frameIterator_ == frames_->end())
             return {};
@@ -307,15 +314,15 @@ public:
         // Unideal, but frames_ is 0-indexed, but keyframes are 1-indexed because they are sample numbers.
         unsigned int firstSampleToRead = 0;
         unsigned int lastSampleToRead = 0;
-        if (mp4Reader_.allFramesAreKeyframes()) {
+        if (sampleReader_->allFramesAreKeyframes()) {
             // Read sequential portion of frames.
-            firstSampleToRead = MP4Reader::frameNumberToSampleNumber(*frameIterator_);
+            firstSampleToRead = SampleReader::frameNumberToSampleNumber(*frameIterator_);
 
             auto lastFrameIndex = *frameIterator_++;
             while (frameIterator_ != frames_->end() && *frameIterator_ == lastFrameIndex + 1)
                 lastFrameIndex = *frameIterator_++;
 
-            lastSampleToRead = MP4Reader::frameNumberToSampleNumber(*std::prev(frameIterator_));
+            lastSampleToRead = SampleReader::frameNumberToSampleNumber(*std::prev(frameIterator_));
         } else {
             // Find GOP that the current frame is in.
             while (haveMoreKeyframes() &&
@@ -337,15 +344,15 @@ public:
 
             // Now frameIterator_ is point to one past the last frame we are interested in.
             // Read frames from the previous GOP to the last frame we are interested in.
-            firstSampleToRead = MP4Reader::frameNumberToSampleNumber(shouldReadFramesExactly_ ? firstFrame : *std::prev(keyframeIterator_));
-            lastSampleToRead = MP4Reader::frameNumberToSampleNumber(*std::prev(frameIterator_));
+            firstSampleToRead = SampleReader::frameNumberToSampleNumber(shouldReadFramesExactly_ ? firstFrame : *std::prev(keyframeIterator_));
+            lastSampleToRead = SampleReader::frameNumberToSampleNumber(*std::prev(frameIterator_));
 
             if (shouldReadEntireGOPs_) {
                 // If there are more keyframes, then read to before the next one.
                 if (haveMoreKeyframes()) {
-                    lastSampleToRead = MP4Reader::frameNumberToSampleNumber(*keyframeIterator_ - 1);
+                    lastSampleToRead = SampleReader::frameNumberToSampleNumber(*keyframeIterator_ - 1);
                 } else {
-                    lastSampleToRead = mp4Reader_.numberOfSamples();
+                    lastSampleToRead = sampleReader_->numberOfSamples();
                 }
             }
 
@@ -354,13 +361,13 @@ public:
                 // Make the last sample the last global frame in this GOP.
                 // If there are no more keyframes, we're in the last GOP, so the last sample to read is the last frame in the global frames.
                 if (!haveMoreKeyframes())
-                    lastSampleToRead = MP4Reader::frameNumberToSampleNumber(globalFrames_.back());
+                    lastSampleToRead = SampleReader::frameNumberToSampleNumber(globalFrames_.back());
                 else {
                     // Move the global frames iterator forward until it's no longer in this GOP.
                     while (haveMoreGlobalFrames() && *globalFramesIterator_ < *keyframeIterator_)
                         globalFramesIterator_++;
 
-                    lastSampleToRead = MP4Reader::frameNumberToSampleNumber(*std::prev(globalFramesIterator_));
+                    lastSampleToRead = SampleReader::frameNumberToSampleNumber(*std::prev(globalFramesIterator_));
                 }
             }
 
@@ -376,16 +383,16 @@ public:
 
 private:
     bool haveMoreFrames() const { return frameIterator_ != frames_->end(); }
-    bool haveMoreKeyframes() const { return keyframeIterator_ != mp4Reader_.keyframeNumbers().end(); }
+    bool haveMoreKeyframes() const { return keyframeIterator_ != sampleReader_->keyframeNumbers().end(); }
     bool haveMoreGlobalFrames() const { return globalFramesIterator_ != globalFrames_.end(); }
 
     std::optional<GOPReaderPacket> dataForSamples(unsigned int firstSampleToRead, unsigned int lastSampleToRead) {
         // -1 from firstSampleToRead to go from sample number -> index.
-        return { GOPReaderPacket(mp4Reader_.dataForSamples(firstSampleToRead, lastSampleToRead), MP4Reader::sampleNumberToFrameNumber(firstSampleToRead + frameOffsetInFile_), lastSampleToRead - firstSampleToRead + 1) };
+        return { GOPReaderPacket(sampleReader_->dataForSamples(firstSampleToRead, lastSampleToRead), SampleReader::sampleNumberToFrameNumber(firstSampleToRead + frameOffsetInFile_), lastSampleToRead - firstSampleToRead + 1) };
     }
 
     std::experimental::filesystem::path filename_;
-    MP4Reader mp4Reader_;
+    std::unique_ptr<SampleReader> sampleReader_;
     std::shared_ptr<std::vector<int>> frames_;
     std::vector<int>::iterator frameIterator_;
     std::vector<int>::const_iterator keyframeIterator_;
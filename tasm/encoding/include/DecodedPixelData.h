@@ -3,6 +3,11 @@
 
 #include "EncodedData.h"
 
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
 namespace tasm {
 
 class GPUPixelData {
@@ -47,6 +52,66 @@ private:
     unsigned int yOffset_;
 };
 
+// Pixels in a buffer that it owns, such as an object that spans several tiles and is copied together from each of them.
+class GPUAssembledPixelData : public GPUPixelData {
+public:
+    GPUAssembledPixelData(unsigned int width, unsigned int height)
+            : width_(width), height_(height), pitch_(width * numChannels_) {
+        CUresult result;
+        if ((result = cuMemAlloc(&handle_, pitch_ * height_)) != CUDA_SUCCESS)
+            throw std::runtime_error("Failed to allocate assembled pixels (" + std::to_string(result) + ")");
+    }
+
+    GPUAssembledPixelData(const GPUAssembledPixelData&) = delete;
+
+    ~GPUAssembledPixelData() override {
+        CUresult result;
+        if ((result = cuMemFree(handle_)) != CUDA_SUCCESS)
+            std::cerr << "Swallowed failure to free assembled pixels (" << result << ")" << std::endl;
+    }
+
+    // Copies the width x height pixels at (sourceX, sourceY) in a 4-channel source on the device to (x, y).
+    void copyFrom(CUdeviceptr source, unsigned int sourcePitch, unsigned int sourceX, unsigned int sourceY,
+                  unsigned int x, unsigned int y, unsigned int width, unsigned int height) {
+        assert(x + width <= width_);
+        assert(y + height <= height_);
+
+        CUDA_MEMCPY2D m;
+        memset(&m, 0, sizeof(m));
+        m.WidthInBytes = width * numChannels_;
+        m.Height = height;
+        m.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+        m.srcDevice = source;
+        m.srcPitch = sourcePitch;
+        m.srcXInBytes = sourceX * numChannels_;
+        m.srcY = sourceY;
+        m.dstMemoryType = CU_MEMORYTYPE_DEVICE;
+        m.dstDevice = handle_;
+        m.dstPitch = pitch_;
+        m.dstXInBytes = x * numChannels_;
+        m.dstY = y;
+
+        CUresult result;
+        if ((result = cuMemcpy2D(&m)) != CUDA_SUCCESS)
+            throw std::runtime_error("Failed to copy pixels from a tile (" + std::to_string(result) + ")");
+    }
+
+    CUdeviceptr handle() const override { return handle_; }
+    unsigned int pitch() const override { return pitch_; }
+    unsigned int width() const override { return width_; }
+    unsigned int height() const override { return height_; }
+    unsigned int xOffset() const override { return 0; }
+    unsigned int yOffset() const override { return 0; }
+
+private:
+    static const unsigned int numChannels_ = 4;
+
+    CUdeviceptr handle_;
+    unsigned int width_;
+    unsigned int height_;
+    unsigned int pitch_;
+};
+
 } // namespace tasm
 
 #endif //TASM_DECODEDPIXELDATA_H
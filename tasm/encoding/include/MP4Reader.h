@@ -1,12 +1,14 @@
 #ifndef TASM_MP4READER_H
 #define TASM_MP4READER_H
 
+#include "SampleReader.h"
+
 #include "gpac/isomedia.h"
 #include "gpac/internal/isomedia_dev.h"
 #include "gpac/list.h"
 #include <experimental/filesystem>
 
-class MP4Reader {
+class MP4Reader : public SampleReader {
 public:
     explicit MP4Reader(const std::experimental::filesystem::path &filename)
             : filename_(filename),
@@ -62,7 +64,11 @@ public:
         }
     }
 
-    void setNewFileWithSameKeyframes(const std::experimental::filesystem::path &filename) {
+    const std::experimental::filesystem::path &filename() const override {
+        return filename_;
+    }
+
+    void setNewFileWithSameKeyframes(const std::experimental::filesystem::path &filename) override {
         closeFile();
         filename_ = filename;
         setUpGFIsomFile();
@@ -70,27 +76,19 @@ public:
         numberOfSamples_ = gf_isom_get_sample_count(file_, trackNumber_);
     }
 
-    const std::vector<int> &keyframeNumbers() const {
+    const std::vector<int> &keyframeNumbers() const override {
         return keyframeNumbers_;
     }
 
-    unsigned int numberOfSamples() const {
+    unsigned int numberOfSamples() const override {
         return numberOfSamples_;
     }
 
-    bool allFramesAreKeyframes() const {
+    bool allFramesAreKeyframes() const override {
         return filename_.extension() == ".mp4" && keyframeNumbers_.empty();
     }
 
-    static int sampleNumberToFrameNumber(unsigned int sampleNumber) {
-        return sampleNumber - 1;
-    }
-
-    static unsigned int frameNumberToSampleNumber(int frameNumber) {
-        return frameNumber + 1;
-    }
-
-    std::unique_ptr<std::vector<char>> dataForSamples(unsigned int firstSampleToRead, unsigned int lastSampleToRead) const;
+    std::unique_ptr<std::vector<char>> dataForSamples(unsigned int firstSampleToRead, unsigned int lastSampleToRead) const override;
 
 private:
     void setUpGFIsomFile() {
@@ -4,6 +4,8 @@
 #include "EncodeWriter.h"
 #include "VideoEncoder.h"
 #include "VideoEncoderSession.h"
+#include <algorithm>
+#include <optional>
 #include <queue>
 
 namespace tasm {
@@ -22,6 +24,8 @@ public:
     void encodeFrame(Frame &frame, unsigned int top, unsigned int left, bool isKeyframe);
     void flush();
 
+    unsigned int quantizationParameter() const { return encodeConfiguration_.quantization.quantizationParameter; }
+
 private:
     EncodeConfiguration encodeConfiguration_;
     VideoEncoder encoder_;
@@ -46,20 +50,30 @@ public:
         auto encoder = idToEncoder_.at(identifier);
         encoder->flush();
         idToEncoder_.erase(identifier);
-        availableEncoders_.push(encoder);
+        availableEncoders_[encoder->quantizationParameter()].push(encoder);
         return encoder->getEncodedFrames();
     }
 
-    void createEncoderWithConfiguration(unsigned int identifier, unsigned int newWidth, unsigned int newHeight) {
+    // Encoders default to the base configuration's quantization parameter. Reconfiguring an encoder can only change its
+    // resolution, so encoders are pooled separately for each quantization parameter. When no encoder with the
+    // quantization parameter is idle, an idle encoder with a different one is destroyed before a new encoder is
+    // created, so there are never more encoding sessions than encoders in use at once.
+    void createEncoderWithConfiguration(unsigned int identifier, unsigned int newWidth, unsigned int newHeight,
+                                        std::optional<unsigned int> quantizationParameter = {}) {
         assert(!idToEncoder_.count(identifier));
 
-        if (availableEncoders_.empty()) {
-            createEncoder(baseConfiguration_);
-            assert(!availableEncoders_.empty());
+        auto &availableEncoders = availableEncoders_[quantizationParameter.value_or(baseConfiguration_.quantization.quantizationParameter)];
+        if (availableEncoders.empty()) {
+            destroyAvailableEncoder();
+            auto configuration = baseConfiguration_;
+            if (quantizationParameter.has_value())
+                configuration.quantization.quantizationParameter = *quantizationParameter;
+            createEncoder(configuration);
+            assert(!availableEncoders.empty());
         }
 
-        idToEncoder_.emplace(identifier, availableEncoders_.front());
-        availableEncoders_.pop();
+        idToEncoder_.emplace(identifier, availableEncoders.front());
+        availableEncoders.pop();
 
         idToEncoder_.at(identifier)->updateConfiguration(newWidth, newHeight);
     }
@@ -70,10 +84,23 @@ public:
     }
 
 private:
+    void destroyAvailableEncoder() {
+        auto pool = std::find_if(availableEncoders_.begin(), availableEncoders_.end(), [](const auto &qpAndEncoders) {
+            return !qpAndEncoders.second.empty();
+        });
+        if (pool == availableEncoders_.end())
+            return;
+
+        auto encoder = pool->second.front();
+        pool->second.pop();
+        allEncoders_.erase(std::find(allEncoders_.begin(), allEncoders_.end(), encoder));
+        assert(encoder.use_count() == 1);
+    }
+
     void createEncoder(EncodeConfiguration configuration) {
         auto newEncoder = std::make_shared<TileEncoder>(configuration, context_, lock_);
         allEncoders_.emplace_back(newEncoder);
-        availableEncoders_.push(newEncoder);
+        availableEncoders_[newEncoder->quantizationParameter()].push(newEncoder);
     }
 
     EncodeConfiguration baseConfiguration_;
@@ -81,7 +108,7 @@ private:
     VideoLock &lock_;
 
     std::vector<std::shared_ptr<TileEncoder>> allEncoders_;
-    std::queue<std::shared_ptr<TileEncoder>> availableEncoders_;
+    std::unordered_map<unsigned int, std::queue<std::shared_ptr<TileEncoder>>> availableEncoders_;
     std::unordered_map<unsigned int, std::shared_ptr<TileEncoder>> idToEncoder_;
 };
 
@@ -0,0 +1,32 @@
+#ifndef TASM_SAMPLEREADER_H
+#define TASM_SAMPLEREADER_H
+
+#include <experimental/filesystem>
+#include <memory>
+#include <vector>
+
+// Reads the encoded samples of a single tile. Sample numbers start at 1, and keyframe numbers start at 0.
+class SampleReader {
+public:
+    virtual ~SampleReader() = default;
+
+    virtual const std::experimental::filesystem::path &filename() const = 0;
+    virtual void setNewFileWithSameKeyframes(const std::experimental::filesystem::path &filename) = 0;
+
+    virtual const std::vector<int> &keyframeNumbers() const = 0;
+    virtual unsigned int numberOfSamples() const = 0;
+    virtual bool allFramesAreKeyframes() const = 0;
+
+    // Returns the Annex B data for the samples, with parameter sets before each keyframe.
+    virtual std::unique_ptr<std::vector<char>> dataForSamples(unsigned int firstSampleToRead, unsigned int lastSampleToRead) const = 0;
+
+    static int sampleNumberToFrameNumber(unsigned int sampleNumber) {
+        return sampleNumber - 1;
+    }
+
+    static unsigned int frameNumberToSampleNumber(int frameNumber) {
+        return frameNumber + 1;
+    }
+};
+
+#endif //TASM_SAMPLEREADER_H
@@ -0,0 +1,120 @@
+#ifndef TASM_TILEPACK_H
+#define TASM_TILEPACK_H
+
+#include "Configuration.h"
+#include "SampleReader.h"
+#include "TileStorageFormat.h"
+
+#include <experimental/filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace tasm {
+
+// Stores every tile of a tile directory in a single file instead of one MP4 per tile.
+// The file holds each tile's samples contiguously in Annex B form, followed by a TilePackIndex that records each
+// tile's configuration, sample sizes, and keyframes, then the size of the index and a magic number.
+// Opening a pack reads the index once, and reading a range of samples from a tile is a single pread.
+class TilePack {
+public:
+    struct TileStream {
+        unsigned int tileNumber;
+        Configuration configuration;
+        // An Annex B HEVC stream, as written by the encoders.
+        std::experimental::filesystem::path path;
+    };
+
+    // An encoded sample's location in a stream.
+    struct Sample {
+        unsigned long long offset;
+        unsigned int size;
+        bool isKeyframe;
+    };
+
+    TilePack(const TilePack&) = delete;
+    ~TilePack();
+
+    // Throws if the pack does not exist or cannot be parsed.
+    static std::shared_ptr<const TilePack> open(const std::experimental::filesystem::path &tileDirectory);
+
+    // Splits each stream into samples and writes them all to the directory's pack. Parameter sets are copied before
+    // any keyframe that does not have its own so that every GOP can be decoded independently.
+    static void write(const std::experimental::filesystem::path &tileDirectory, const std::vector<TileStream> &tileStreams);
+
+    // Splits an HEVC Annex B stream into access units.
+    static std::vector<Sample> samplesInStream(const std::vector<char> &stream);
+
+    const std::experimental::filesystem::path &tileDirectory() const { return tileDirectory_; }
+    // One more than the largest tile number in the pack.
+    unsigned int numberOfTiles() const { return tiles_.size(); }
+    bool containsTile(unsigned int tileNumber) const;
+    const Configuration &configurationForTile(unsigned int tileNumber) const { return tile(tileNumber).configuration; }
+    const std::vector<int> &keyframeNumbersForTile(unsigned int tileNumber) const { return tile(tileNumber).keyframeNumbers; }
+    unsigned int numberOfSamplesForTile(unsigned int tileNumber) const { return tile(tileNumber).sampleOffsets.size() - 1; }
+
+    // Sample numbers start at 1 to match MP4Reader.
+    std::unique_ptr<std::vector<char>> dataForSamples(unsigned int tileNumber, unsigned int firstSampleToRead, unsigned int lastSampleToRead) const;
+
+private:
+    struct Tile {
+        Configuration configuration;
+        // Offsets of each sample in the file, followed by the offset of the end of the last sample.
+        std::vector<unsigned long long> sampleOffsets;
+        std::vector<int> keyframeNumbers;
+    };
+
+    TilePack(const std::experimental::filesystem::path &tileDirectory, int descriptor);
+
+    void readIndex();
+    const Tile &tile(unsigned int tileNumber) const;
+
+    std::experimental::filesystem::path tileDirectory_;
+    int descriptor_;
+    // Indexed by tile number. Tiles that are not in the pack have no sample offsets.
+    std::vector<Tile> tiles_;
+};
+
+// Reads a single tile from a TilePack.
+class PackedTileReader : public SampleReader {
+public:
+    PackedTileReader(std::shared_ptr<const TilePack> pack, unsigned int tileNumber);
+
+    const std::experimental::filesystem::path &filename() const override { return filename_; }
+    void setNewFileWithSameKeyframes(const std::experimental::filesystem::path &filename) override;
+
+    const std::vector<int> &keyframeNumbers() const override { return pack_->keyframeNumbersForTile(tileNumber_); }
+    unsigned int numberOfSamples() const override { return pack_->numberOfSamplesForTile(tileNumber_); }
+    bool allFramesAreKeyframes() const override { return keyframeNumbers().empty(); }
+
+    std::unique_ptr<std::vector<char>> dataForSamples(unsigned int firstSampleToRead, unsigned int lastSampleToRead) const override {
+        return pack_->dataForSamples(tileNumber_, firstSampleToRead, lastSampleToRead);
+    }
+
+private:
+    std::shared_ptr<const TilePack> pack_;
+    unsigned int tileNumber_;
+    std::experimental::filesystem::path filename_;
+};
+
+// Opens tiles in either storage format. Recently used packs are kept open so that reading several tiles from the same
+// directory opens its pack and parses its index once. Safe to use from multiple threads.
+class TilePackCache {
+public:
+    std::shared_ptr<const TilePack> pack(const std::experimental::filesystem::path &tileDirectory);
+
+    // tilePath is the path that the tile has as an MP4 file, whether or not it is packed.
+    std::unique_ptr<SampleReader> sampleReaderForTile(const std::experimental::filesystem::path &tilePath, unsigned int tileNumber, TileStorageFormat storageFormat);
+    Configuration configurationForTile(const std::experimental::filesystem::path &tilePath, unsigned int tileNumber, TileStorageFormat storageFormat);
+
+private:
+    static constexpr unsigned int MaximumOpenPacks = 32;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<const TilePack>> directoryToPack_;
+};
+
+} // namespace tasm
+
+#endif //TASM_TILEPACK_H
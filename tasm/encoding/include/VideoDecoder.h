@@ -8,10 +8,16 @@
 
 #include "cuviddec.h"
 #include "nvcuvid.h"
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
 
+namespace tasm {
+class QueryStats;
+}
+
 static const unsigned int NUMBER_OF_PREALLOCATED_FRAMES = 150;
 
 class VideoDecoder {
@@ -63,7 +69,9 @@ public:
     void preallocateArraysForDecodedFrames(unsigned int largestWidth, unsigned int largestHeight);
     bool reconfigureDecoderIfNecessary(CUVIDEOFORMAT *newFormat);
 
-    void mapFrame(CUVIDPARSERDISPINFO *frame, CUVIDEOFORMAT format);
+    // Adds the time spent mapping and copying the frame, but not the time spent waiting for the consumer to free a
+    // slot, to the stats' decode time.
+    void mapFrame(CUVIDPARSERDISPINFO *frame, CUVIDEOFORMAT format, const std::shared_ptr<tasm::QueryStats> &stats = nullptr);
     void unmapFrame(unsigned int picIndex);
     std::pair<CUdeviceptr, unsigned int> frameInfoForPicIndex(unsigned int picIndex) const;
 
@@ -74,6 +82,7 @@ public:
     CUVIDDECODECREATEINFO createInfo() const { return creationInfo_; }
     CUvideodecoder handle() const { return handle_; }
     CUVIDEOFORMAT currentFormat() const { return currentFormat_; }
+    unsigned int numberOfReconfigurations() const { return numberOfReconfigurations_; }
 
     struct DecodedDimensions {
         unsigned int displayWidth;
@@ -104,6 +113,7 @@ private:
     size_t heightOfPreallocatedFrameArrays_;
 
     CUVIDEOFORMAT currentFormat_;
+    std::atomic<unsigned int> numberOfReconfigurations_ = 0;
 
     mutable std::mutex picIndexMutex_;
     struct DecodedFrameInformation {
@@ -1,10 +1,13 @@
 #ifndef TASM_VIDEODECODERSESSION_H
 #define TASM_VIDEODECODERSESSION_H
 
+#include "CancellationToken.h"
 #include "EncodedData.h"
 #include "DecodeReader.h"
 #include "Frame.h"
 #include "Operator.h"
+#include "QueryStats.h"
+#include "Trace.h"
 #include "VideoDecoder.h"
 
 #include <cstring>
@@ -16,30 +19,48 @@ using EncodedReader = std::shared_ptr<Operator<CPUEncodedFrameDataPtr>>;
 
 class VideoDecoderSession {
 public:
-    VideoDecoderSession(VideoDecoder &decoder, EncodedReader reader)
+    // The time the worker spends decoding is added to the stats' decode time.
+    VideoDecoderSession(VideoDecoder &decoder, EncodedReader reader, std::shared_ptr<CancellationToken> cancellationToken = nullptr,
+            std::shared_ptr<QueryStats> stats = nullptr)
             : decoder_(decoder),
               nextDataQueue_(1000),
               isDoneReading_(false),
-              isComplete_(false) {
+              isComplete_(false),
+              cancellationToken_(cancellationToken ? cancellationToken : std::make_shared<CancellationToken>()) {
         reader_ = std::make_unique<std::thread>(&VideoDecoderSession::ReadNext, std::ref(decoder_), reader,
-                                                std::ref(nextDataQueue_), &isDoneReading_);
+                                                std::ref(nextDataQueue_), &isDoneReading_, cancellationToken_.get());
         worker_ = std::make_unique<std::thread>(&VideoDecoderSession::DecodeAll, std::ref(decoder_), std::ref(nextDataQueue_),
-                                                &isDoneReading_, &isComplete_);
+                                                &isDoneReading_, &isComplete_, cancellationToken_.get(), stats);
     }
 
     VideoDecoderSession(const VideoDecoderSession &) = delete;
     VideoDecoderSession(const VideoDecoderSession &&) = delete;
 
     ~VideoDecoderSession() {
-        worker_->join();
+        bool wasStopped = cancellationToken_->isCancelled();
+        // If the consumer went away before everything was decoded, stop reading and decoding rather than
+        // finishing the entire scan.
+        stop();
+
         reader_->join();
+        while (!isComplete_) {
+            // The worker may be blocked waiting for space in the decoded picture queue, which no one else will drain.
+            if (decoder_.decodedPictureQueue().read_available())
+                decoder_.decodedPictureQueue().pop();
+            else
+                std::this_thread::yield();
+        }
+        worker_->join();
 
-        assert(nextDataQueue_.empty());
+        assert(wasStopped || nextDataQueue_.empty());
         assert(isDoneReading_);
     }
 
     bool isComplete() { return isComplete_; }
 
+    // Asks the reader and worker threads to exit at their next opportunity.
+    void stop() { cancellationToken_->cancel(); }
+
     template<typename Rep, typename Period, size_t interval=4>
     std::shared_ptr<DecodedFrame> decode(std::chrono::duration<Rep, Period> duration) {
         std::shared_ptr<CUVIDPARSERDISPINFO> packet;
@@ -75,8 +96,16 @@ private:
     DataQueue nextDataQueue_;
     std::atomic_bool isDoneReading_;
     std::atomic_bool isComplete_;
+    std::shared_ptr<CancellationToken> cancellationToken_;
+
+    // Passed to the parser's callbacks, which run on the worker thread.
+    struct ParserContext {
+        VideoDecoder *decoder;
+        std::shared_ptr<QueryStats> stats;
+    };
 
-    static CUvideoparser CreateParser(VideoDecoder &decoder) {
+    static CUvideoparser CreateParser(ParserContext &context) {
+        auto &decoder = *context.decoder;
         CUresult status;
         CUvideoparser parser = nullptr;
         CUVIDPARSERPARAMS parameters = {
@@ -86,7 +115,7 @@ private:
                 .ulErrorThreshold = 0,
                 .ulMaxDisplayDelay = 1,
                 .uReserved1 = {},
-                .pUserData = &decoder,
+                .pUserData = &context,
                 .pfnSequenceCallback = HandleVideoSequence,
                 .pfnDecodePicture = HandlePictureDecode,
                 .pfnDisplayPicture = HandlePictureDisplay,
@@ -100,7 +129,7 @@ private:
     }
 
     static int CUDAAPI HandleVideoSequence(void *userData, CUVIDEOFORMAT *format) {
-        auto *decoder = static_cast<VideoDecoder *>(userData);
+        auto *decoder = static_cast<ParserContext *>(userData)->decoder;
 
         assert(format->display_area.bottom - format->display_area.top >= 0);
         assert(format->display_area.right - format->display_area.left >= 0);
@@ -120,11 +149,14 @@ private:
 
     static int CUDAAPI HandlePictureDecode(void *userData, CUVIDPICPARAMS *parameters) {
         CUresult status;
-        auto *decoder = static_cast<VideoDecoder *>(userData);
+        auto *context = static_cast<ParserContext *>(userData);
+        auto *decoder = context->decoder;
 
         if (decoder == nullptr)
             std::cerr << "Unexpected null decoder during video decode (HandlePictureDecode)" << std::endl;
         else {
+            TASM_TRACE_SPAN("cuvidDecodePicture", "decode");
+            QueryStats::ScopedTimer timer(context->stats, QueryStats::Counter::DecodeTimeNs);
             if ((status = cuvidDecodePicture(decoder->handle(), parameters)) != CUDA_SUCCESS)
                 std::cerr << "cuvidDecodePicture failed (" << status << ")" << std::endl;
         }
@@ -133,20 +165,23 @@ private:
     }
 
     static int CUDAAPI HandlePictureDisplay(void *userData, CUVIDPARSERDISPINFO *frame) {
-        auto *decoder = static_cast<VideoDecoder *>(userData);
+        auto *context = static_cast<ParserContext *>(userData);
+        auto *decoder = context->decoder;
 
         if (decoder == nullptr)
             std::cerr << "Unexpected null decoder during video decode (HandlePictureDisplay)" << std::endl;
         else {
             // TODO: This should happen on a separate thread than cuvidDecodePicture() for performance.
-            decoder->mapFrame(frame, decoder->currentFormat());
+            TASM_TRACE_SPAN("VideoDecoder::mapFrame", "decode");
+            decoder->mapFrame(frame, decoder->currentFormat(), context->stats);
         }
 
         return 1;
     }
 
     static void ReadNext(VideoDecoder &decoder, EncodedReader reader, DataQueue &nextDataQueue,
-                         std::atomic_bool *isDoneReading) {
+                         std::atomic_bool *isDoneReading, const CancellationToken *cancellationToken) {
+        Tracer::instance().setCurrentThreadName("decoder reader");
         do {
             std::shared_ptr<std::vector<unsigned char>> combinedData(new std::vector<unsigned char>());
             unsigned long flags = 0;
@@ -172,8 +207,10 @@ private:
                                 break;
                             } else {
                                 while (decoder.frameNumberQueue()->write_available() <
-                                       (long unsigned int) numberOfFrames)
+                                       (long unsigned int) numberOfFrames && !cancellationToken->isCancelled())
                                     std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                                if (cancellationToken->isCancelled())
+                                    break;
                             }
                         }
 
@@ -187,27 +224,32 @@ private:
                     combinedData->insert(combinedData->end(), packet.payload, packet.payload + packet.payload_size);
                     flags |= packet.flags;
                 }
-                while (!nextDataQueue.push(std::make_pair(combinedData, flags))) {
+                while (!cancellationToken->isCancelled() && !nextDataQueue.push(std::make_pair(combinedData, flags))) {
                     // We're getting too far ahead of the decoder. Sleep for a bit.
                     std::this_thread::sleep_for(std::chrono::milliseconds(10));
                 }
             }
-        } while (!reader->isComplete());
+        } while (!reader->isComplete() && !cancellationToken->isCancelled());
         *isDoneReading = true;
     }
 
     static void
-    DecodeAll(VideoDecoder &decoder, DataQueue &nextDataQueue, std::atomic_bool *isDoneReading, std::atomic_bool *isComplete) {
+    DecodeAll(VideoDecoder &decoder, DataQueue &nextDataQueue, std::atomic_bool *isDoneReading, std::atomic_bool *isComplete,
+              const CancellationToken *cancellationToken, std::shared_ptr<QueryStats> stats) {
         CUresult status;
-        auto parser = CreateParser(decoder);
+        Tracer::instance().setCurrentThreadName("decoder worker");
+        ParserContext context{&decoder, stats};
+        auto parser = CreateParser(context);
 
         do {
-            while (true) {
+            while (!cancellationToken->isCancelled()) {
                 if (nextDataQueue.read_available())
                     break;
                 else
                     std::this_thread::yield();
             }
+            if (cancellationToken->isCancelled())
+                break;
 
             auto combinedData = nextDataQueue.front().first;
             auto flags = nextDataQueue.front().second;
@@ -218,6 +260,7 @@ private:
             packet.flags = flags;
             packet.payload_size = combinedData->size();
             packet.payload = combinedData->data();
+            TASM_TRACE_SPAN("cuvidParseVideoData", "decode");
             if ((status = cuvidParseVideoData(parser, &packet)) != CUDA_SUCCESS) {
                 cuvidDestroyVideoParser(parser);
                 throw std::runtime_error("Call to cuvidParseVideoData failed: " + std::to_string(status));
@@ -1,5 +1,7 @@
 #include "MultipleEncoderManager.h"
 
+#include "Trace.h"
+
 namespace tasm {
 
 void TileEncoder::updateConfiguration(unsigned int newWidth, unsigned int newHeight) {
@@ -18,10 +20,12 @@ std::unique_ptr<std::vector<char>> TileEncoder::getEncodedFrames() {
 }
 
 void TileEncoder::encodeFrame(Frame &frame, unsigned int top, unsigned int left, bool isKeyframe) {
+    TASM_TRACE_SPAN("TileEncoder::encodeFrame", "encode");
     encodeSession_.Encode(frame, top, left, isKeyframe);
 }
 
 void TileEncoder::flush() {
+    TASM_TRACE_SPAN("TileEncoder::flush", "encode");
     encodeSession_.Flush();
 }
 
@@ -0,0 +1,323 @@
+#include "TilePack.h"
+
+#include "Files.h"
+#include "MP4Reader.h"
+#include "TileConfiguration.pb.h"
+#include "VideoConfiguration.h"
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tasm {
+
+static auto constexpr TILE_PACK_VERSION = 1u;
+// Written after the index so that a truncated pack is detected.
+static const char TILE_PACK_MAGIC[] = {'T', 'A', 'S', 'M', 'P', 'A', 'C', 'K'};
+
+namespace {
+
+enum HEVCNalType : unsigned int {
+    RAPStart = 16,
+    RAPEnd = 23,
+    VPS = 32,
+    SPS = 33,
+    PPS = 34,
+    AUD = 35,
+    PrefixSEI = 39,
+};
+
+struct NalUnit {
+    // Includes the start code.
+    std::size_t begin;
+    std::size_t end;
+    unsigned int type;
+    bool isFirstSliceInPicture;
+
+    bool isVCL() const { return type < VPS; }
+    bool isKeyframe() const { return type >= RAPStart && type <= RAPEnd; }
+    bool isParameterSet() const { return type == VPS || type == SPS || type == PPS; }
+
+    // The NAL types that may only appear before the first slice of an access unit (H.265 7.4.2.4.4).
+    bool canStartAccessUnit() const {
+        return (isVCL() && isFirstSliceInPicture)
+            || (type >= VPS && type <= AUD)
+            || type == PrefixSEI
+            || (type >= 41 && type <= 44)
+            || (type >= 48 && type <= 55);
+    }
+};
+
+std::vector<NalUnit> nalUnitsInStream(const std::vector<char> &stream) {
+    std::vector<NalUnit> nalUnits;
+    auto data = reinterpret_cast<const unsigned char*>(stream.data());
+    for (std::size_t i = 0; i + 3 < stream.size(); ++i) {
+        if (data[i] || data[i + 1] || data[i + 2] != 1)
+            continue;
+
+        // Include the leading zero of a four byte start code.
+        auto begin = i && !data[i - 1] ? i - 1 : i;
+        auto header = i + 3;
+        if (!nalUnits.empty())
+            nalUnits.back().end = begin;
+        nalUnits.push_back({begin, stream.size(), (data[header] >> 1u) & 0x3fu,
+                            header + 2 < stream.size() && (data[header + 2] & 0x80u)});
+        i = header;
+    }
+    return nalUnits;
+}
+
+// Reads with as many preads as it takes.
+void readFully(int descriptor, char *destination, std::size_t size, unsigned long long offset) {
+    while (size) {
+        auto result = pread(descriptor, destination, size, offset);
+        if (result < 0 && errno == EINTR)
+            continue;
+        else if (result <= 0)
+            throw std::runtime_error("Failed to read from tile pack: " + std::string(result ? std::strerror(errno) : "unexpected end of file"));
+
+        destination += result;
+        size -= result;
+        offset += result;
+    }
+}
+
+} // namespace
+
+std::vector<TilePack::Sample> TilePack::samplesInStream(const std::vector<char> &stream) {
+    std::vector<Sample> samples;
+    bool accessUnitHasSlice = false;
+    for (const auto &nalUnit : nalUnitsInStream(stream)) {
+        if (samples.empty() || (accessUnitHasSlice && nalUnit.canStartAccessUnit())) {
+            samples.push_back({nalUnit.begin, 0, false});
+            accessUnitHasSlice = false;
+        }
+
+        auto &sample = samples.back();
+        sample.size = nalUnit.end - sample.offset;
+        if (nalUnit.isVCL()) {
+            accessUnitHasSlice = true;
+            sample.isKeyframe |= nalUnit.isKeyframe();
+        }
+    }
+    return samples;
+}
+
+void TilePack::write(const std::experimental::filesystem::path &tileDirectory, const std::vector<TileStream> &tileStreams) {
+    auto packPath = TileFiles::tilePackFilename(tileDirectory);
+    std::ofstream output(packPath, std::ios::out | std::ios::trunc | std::ios::binary);
+
+    lightdb::serialization::TilePackIndex index;
+    index.set_version(TILE_PACK_VERSION);
+
+    unsigned long long offset = 0;
+    for (const auto &tileStream : tileStreams) {
+        std::ifstream input(tileStream.path, std::ios::in | std::ios::binary);
+        std::vector<char> stream((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        if (!input.eof() && input.fail())
+            throw std::runtime_error("Failed to read tile stream " + tileStream.path.string());
+
+        auto tile = index.add_tiles();
+        tile->set_tilenumber(tileStream.tileNumber);
+        tile->set_displaywidth(tileStream.configuration.displayWidth);
+        tile->set_displayheight(tileStream.configuration.displayHeight);
+        tile->set_codedwidth(tileStream.configuration.codedWidth);
+        tile->set_codedheight(tileStream.configuration.codedHeight);
+        tile->set_framerate(tileStream.configuration.frameRate);
+        tile->set_bitrate(tileStream.configuration.bitrate);
+        tile->set_firstsampleoffset(offset);
+
+        auto nalUnits = nalUnitsInStream(stream);
+        auto nalUnit = nalUnits.begin();
+        std::vector<char> parameterSets;
+        std::vector<unsigned int> keyframes;
+        auto samples = samplesInStream(stream);
+        for (auto i = 0u; i < samples.size(); ++i) {
+            const auto &sample = samples[i];
+
+            // Remember the most recent parameter sets, and note whether this sample has its own.
+            bool sampleHasParameterSets = false;
+            std::vector<char> sampleParameterSets;
+            for (; nalUnit != nalUnits.end() && nalUnit->begin < sample.offset + sample.size; ++nalUnit) {
+                if (nalUnit->isParameterSet()) {
+                    sampleHasParameterSets = true;
+                    sampleParameterSets.insert(sampleParameterSets.end(), stream.begin() + nalUnit->begin, stream.begin() + nalUnit->end);
+                }
+            }
+            if (sampleHasParameterSets)
+                parameterSets = std::move(sampleParameterSets);
+
+            auto size = sample.size;
+            if (sample.isKeyframe) {
+                keyframes.push_back(i);
+                if (!sampleHasParameterSets) {
+                    output.write(parameterSets.data(), parameterSets.size());
+                    size += parameterSets.size();
+                }
+            }
+            output.write(stream.data() + sample.offset, sample.size);
+            tile->add_samplesizes(size);
+            offset += size;
+        }
+
+        // Match MP4Reader, which has no keyframes when every sample is a keyframe.
+        if (keyframes.size() != samples.size()) {
+            for (auto keyframe : keyframes)
+                tile->add_keyframes(keyframe);
+        }
+    }
+
+    std::string serializedIndex;
+    if (!index.SerializeToString(&serializedIndex))
+        throw std::runtime_error("Failed to serialize tile pack index for " + tileDirectory.string());
+    unsigned long long indexSize = serializedIndex.size();
+    output.write(serializedIndex.data(), serializedIndex.size());
+    output.write(reinterpret_cast<const char*>(&indexSize), sizeof(indexSize));
+    output.write(TILE_PACK_MAGIC, sizeof(TILE_PACK_MAGIC));
+    if (!output.flush())
+        throw std::runtime_error("Failed to write tile pack " + packPath.string());
+}
+
+TilePack::TilePack(const std::experimental::filesystem::path &tileDirectory, int descriptor)
+    : tileDirectory_(tileDirectory),
+      descriptor_(descriptor)
+{ }
+
+TilePack::~TilePack() {
+    close(descriptor_);
+}
+
+std::shared_ptr<const TilePack> TilePack::open(const std::experimental::filesystem::path &tileDirectory) {
+    auto packPath = TileFiles::tilePackFilename(tileDirectory);
+    auto descriptor = ::open(packPath.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        throw std::runtime_error("Failed to open tile pack " + packPath.string());
+
+    // The constructor is private, so the pack cannot be created with make_shared.
+    std::shared_ptr<TilePack> pack(new TilePack(tileDirectory, descriptor));
+    pack->readIndex();
+    return pack;
+}
+
+void TilePack::readIndex() {
+    struct stat status;
+    if (fstat(descriptor_, &status))
+        throw std::runtime_error("Failed to stat tile pack in " + tileDirectory_.string());
+
+    unsigned long long indexSize;
+    char magic[sizeof(TILE_PACK_MAGIC)];
+    auto footerSize = sizeof(indexSize) + sizeof(magic);
+    if (static_cast<unsigned long long>(status.st_size) < footerSize)
+        throw std::runtime_error("Tile pack in " + tileDirectory_.string() + " is truncated");
+    readFully(descriptor_, reinterpret_cast<char*>(&indexSize), sizeof(indexSize), status.st_size - footerSize);
+    readFully(descriptor_, magic, sizeof(magic), status.st_size - sizeof(magic));
+    if (memcmp(magic, TILE_PACK_MAGIC, sizeof(magic)) || indexSize > status.st_size - footerSize)
+        throw std::runtime_error("Tile pack in " + tileDirectory_.string() + " is corrupt");
+
+    std::vector<char> serializedIndex(indexSize);
+    readFully(descriptor_, serializedIndex.data(), indexSize, status.st_size - footerSize - indexSize);
+    lightdb::serialization::TilePackIndex index;
+    if (!index.ParseFromArray(serializedIndex.data(), serializedIndex.size()))
+        throw std::runtime_error("Failed to parse tile pack index in " + tileDirectory_.string());
+
+    for (const auto &serializedTile : index.tiles()) {
+        if (serializedTile.tilenumber() >= tiles_.size())
+            tiles_.resize(serializedTile.tilenumber() + 1);
+
+        auto &tile = tiles_[serializedTile.tilenumber()];
+        // Tiles are always encoded with HEVC.
+        tile.configuration = Configuration(serializedTile.displaywidth(), serializedTile.displayheight(),
+                                           serializedTile.codedwidth(), serializedTile.codedheight(),
+                                           serializedTile.codedwidth(), serializedTile.codedheight(),
+                                           serializedTile.framerate(), Codec::HEVC, serializedTile.bitrate());
+
+        tile.sampleOffsets.reserve(serializedTile.samplesizes_size() + 1);
+        tile.sampleOffsets.push_back(serializedTile.firstsampleoffset());
+        for (auto size : serializedTile.samplesizes())
+            tile.sampleOffsets.push_back(tile.sampleOffsets.back() + size);
+        tile.keyframeNumbers.assign(serializedTile.keyframes().begin(), serializedTile.keyframes().end());
+    }
+}
+
+bool TilePack::containsTile(unsigned int tileNumber) const {
+    return tileNumber < tiles_.size() && !tiles_[tileNumber].sampleOffsets.empty();
+}
+
+const TilePack::Tile &TilePack::tile(unsigned int tileNumber) const {
+    if (!containsTile(tileNumber))
+        throw std::runtime_error("Tile pack in " + tileDirectory_.string() + " does not contain tile " + std::to_string(tileNumber));
+    return tiles_[tileNumber];
+}
+
+std::unique_ptr<std::vector<char>> TilePack::dataForSamples(unsigned int tileNumber, unsigned int firstSampleToRead, unsigned int lastSampleToRead) const {
+    const auto &offsets = tile(tileNumber).sampleOffsets;
+    assert(firstSampleToRead >= 1);
+    assert(firstSampleToRead <= lastSampleToRead);
+    assert(lastSampleToRead < offsets.size());
+
+    // A tile's samples are contiguous, so any range of them can be read at once.
+    auto begin = offsets[firstSampleToRead - 1];
+    auto end = offsets[lastSampleToRead];
+    auto data = std::make_unique<std::vector<char>>(end - begin);
+    readFully(descriptor_, data->data(), data->size(), begin);
+    return data;
+}
+
+PackedTileReader::PackedTileReader(std::shared_ptr<const TilePack> pack, unsigned int tileNumber)
+    : pack_(std::move(pack)),
+      tileNumber_(tileNumber),
+      filename_(TileFiles::tileFilename(pack_->tileDirectory(), tileNumber_))
+{ }
+
+void PackedTileReader::setNewFileWithSameKeyframes(const std::experimental::filesystem::path &filename) {
+    auto tileDirectory = filename.parent_path();
+    if (tileDirectory != pack_->tileDirectory())
+        pack_ = TilePack::open(tileDirectory);
+
+    // Tiles in a pack are identified by the path that they would have as MP4 files.
+    for (auto tileNumber = 0u; tileNumber < pack_->numberOfTiles(); ++tileNumber) {
+        if (pack_->containsTile(tileNumber) && TileFiles::tileFilename(tileDirectory, tileNumber) == filename) {
+            tileNumber_ = tileNumber;
+            filename_ = filename;
+            return;
+        }
+    }
+    throw std::runtime_error("Tile pack in " + tileDirectory.string() + " does not contain " + filename.string());
+}
+
+std::shared_ptr<const TilePack> TilePackCache::pack(const std::experimental::filesystem::path &tileDirectory) {
+    {
+        std::scoped_lock lock(mutex_);
+        auto cached = directoryToPack_.find(tileDirectory.string());
+        if (cached != directoryToPack_.end())
+            return cached->second;
+    }
+
+    // Open the pack without holding the lock so that packs can be opened in parallel.
+    auto pack = TilePack::open(tileDirectory);
+
+    std::scoped_lock lock(mutex_);
+    // Readers hold on to the packs that they use, so forgetting every pack only closes the ones that are not in use.
+    if (directoryToPack_.size() >= MaximumOpenPacks)
+        directoryToPack_.clear();
+    return directoryToPack_.emplace(tileDirectory.string(), pack).first->second;
+}
+
+std::unique_ptr<SampleReader> TilePackCache::sampleReaderForTile(const std::experimental::filesystem::path &tilePath, unsigned int tileNumber, TileStorageFormat storageFormat) {
+    if (storageFormat == TileStorageFormat::Packed)
+        return std::make_unique<PackedTileReader>(pack(tilePath.parent_path()), tileNumber);
+    else
+        return std::make_unique<MP4Reader>(tilePath);
+}
+
+Configuration TilePackCache::configurationForTile(const std::experimental::filesystem::path &tilePath, unsigned int tileNumber, TileStorageFormat storageFormat) {
+    if (storageFormat == TileStorageFormat::Packed)
+        return pack(tilePath.parent_path())->configurationForTile(tileNumber);
+    else
+        return *video::GetConfiguration(tilePath);
+}
+
+} // namespace tasm
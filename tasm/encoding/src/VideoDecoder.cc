@@ -1,6 +1,7 @@
 #include "VideoDecoder.h"
 #include "cuviddec.h"
 #include "Configuration.h"
+#include "QueryStats.h"
 
 #include <cstring>
 #include <nvcuvid.h>
@@ -152,14 +153,21 @@ bool VideoDecoder::reconfigureDecoderIfNecessary(CUVIDEOFORMAT *newFormat) {
         throw std::runtime_error("Failed to reconfigure decoder" + std::to_string(result));
     lock_->unlock();
 
+    ++numberOfReconfigurations_;
     return true;
 }
 
-void VideoDecoder::mapFrame(CUVIDPARSERDISPINFO *frame, CUVIDEOFORMAT format) {
+void VideoDecoder::mapFrame(CUVIDPARSERDISPINFO *frame, CUVIDEOFORMAT format, const std::shared_ptr<tasm::QueryStats> &stats) {
     while (!decodedPictureQueue_.write_available()) {
         std::this_thread::yield();
     }
 
+    // Frame arrays are freed as the consumer releases frames. Only this thread takes them, so one stays available.
+    while (!availableFrameArrays_.read_available())
+        std::this_thread::yield();
+
+    tasm::QueryStats::ScopedTimer timer(stats, tasm::QueryStats::Counter::DecodeTimeNs);
+
     CUresult result;
     CUdeviceptr mappedHandle;
     unsigned int pitch;
@@ -177,9 +185,6 @@ void VideoDecoder::mapFrame(CUVIDPARSERDISPINFO *frame, CUVIDEOFORMAT format) {
         auto width = format.display_area.right - format.display_area.left; // format.coded_width;
         auto height = format.display_area.bottom - format.display_area.top; // format.coded_height;
 
-        while (!availableFrameArrays_.read_available())
-            std::this_thread::yield();
-
         CUdeviceptr newHandle = availableFrameArrays_.front();
         availableFrameArrays_.pop();
 
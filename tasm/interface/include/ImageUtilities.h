@@ -1,7 +1,10 @@
 #ifndef TASM_IMAGEITERATOR_H
 #define TASM_IMAGEITERATOR_H
 
+#include "CancellationToken.h"
+#include "CostModel.h"
 #include "Operator.h"
+#include "QueryStats.h"
 
 #include <memory>
 
@@ -25,8 +28,18 @@ using ImagePtr = std::shared_ptr<Image>;
 
 class ImageIterator {
 public:
-    ImageIterator(std::shared_ptr<Operator<std::unique_ptr<std::vector<ImagePtr>>>> parent)
-    : parent_(parent) {}
+    ImageIterator(std::shared_ptr<Operator<std::unique_ptr<std::vector<ImagePtr>>>> parent,
+            std::shared_ptr<tasm::CancellationToken> cancellationToken = nullptr,
+            std::shared_ptr<tasm::QueryStats> stats = nullptr)
+    : parent_(parent), cancellationToken_(cancellationToken), stats_(stats), hasObservedCost_(false) {}
+
+    ImageIterator(const ImageIterator&) = delete;
+
+    ~ImageIterator() {
+        // Stop any scans and decodes that are still running on behalf of this iterator.
+        if (cancellationToken_)
+            cancellationToken_->cancel();
+    }
 
     ImagePtr next() {
         if (!currentImages_ || imageIterator_ == currentImages_->end())
@@ -40,6 +53,9 @@ public:
         return *imageIterator_++;
     }
 
+    // Statistics for the query that produced this iterator. They keep updating until the iterator is exhausted.
+    std::shared_ptr<tasm::QueryStats> stats() const { return stats_; }
+
 private:
     void getNextSetOfImages() {
         currentImages_.reset();
@@ -50,9 +66,23 @@ private:
         }
         if (currentImages_)
             imageIterator_ = currentImages_->begin();
+        else
+            observeCost();
+    }
+
+    // Refines the cost model with queries that ran to completion.
+    void observeCost() {
+        if (hasObservedCost_ || !stats_ || (cancellationToken_ && cancellationToken_->isCancelled()))
+            return;
+
+        hasObservedCost_ = true;
+        tasm::CostModel::instance().observe(*stats_);
     }
 
     std::shared_ptr<Operator<std::unique_ptr<std::vector<ImagePtr>>>> parent_;
+    std::shared_ptr<tasm::CancellationToken> cancellationToken_;
+    std::shared_ptr<tasm::QueryStats> stats_;
+    bool hasObservedCost_;
     std::unique_ptr<std::vector<ImagePtr>> currentImages_;
     std::vector<ImagePtr>::const_iterator imageIterator_;
 };
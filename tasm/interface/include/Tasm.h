@@ -4,6 +4,7 @@
 #include "SemanticIndex.h"
 #include "SemanticSelection.h"
 #include "TemporalSelection.h"
+#include "Trace.h"
 #include "VideoManager.h"
 
 #include <memory>
@@ -32,6 +33,12 @@ public:
             unsigned int y2);
 
     virtual void addBulkMetadata(const std::vector<MetadataInfo>&);
+    virtual void addBulkMetadata(const BulkMetadata&);
+
+    // Loads a CSV of video, label, frame, x1, y1, x2, y2 rows; see BulkMetadata::fromCSV.
+    virtual void addBulkMetadataFromCSV(const std::experimental::filesystem::path &path, unsigned int numberOfThreads = 0) {
+        addBulkMetadata(BulkMetadata::fromCSV(path, numberOfThreads));
+    }
 
     virtual void store(const std::string &videoPath, const std::string &savedName) {
         videoManager_.store(videoPath, savedName);
@@ -45,54 +52,148 @@ public:
         videoManager_.storeWithNonUniformLayout(videoPath, savedName, metadataIdentifier, std::make_shared<SingleMetadataSelection>(labelToTileAround), semanticIndex_, force);
     }
 
-    virtual std::unique_ptr<ImageIterator> select(const std::string &video, const std::string &label, const std::string &metadataIdentifier = "") {
-        return select(video, label, std::shared_ptr<TemporalSelection>(), metadataIdentifier);
+    // Chooses a layout for each GOP, or leaves it untiled, to minimize the estimated cost of running the workload.
+    // With adaptiveLayoutIntervals, the GOP boundaries are also chosen for the workload instead of every second.
+    virtual void storeWithWorkloadLayout(const std::string &videoPath, const std::string &savedName, std::shared_ptr<Workload> workload, bool adaptiveLayoutIntervals = false) {
+        videoManager_.storeWithWorkloadLayout(videoPath, savedName, workload, adaptiveLayoutIntervals);
     }
 
-    virtual std::unique_ptr<ImageIterator> select(const std::string &video, const std::string &label, unsigned int frame, const std::string &metadataIdentifier = "") {
-        return select(video, label, std::make_shared<EqualTemporalSelection>(frame), metadataIdentifier);
+    // A limit of 0 returns every matching object. Otherwise the scan and decode stop once `limit` images have been
+    // produced.
+    virtual std::unique_ptr<ImageIterator> select(const std::string &video, const std::string &label, const std::string &metadataIdentifier = "", unsigned int limit = 0) {
+        return select(video, label, std::shared_ptr<TemporalSelection>(), metadataIdentifier, SelectStrategy::Objects, limit);
+    }
+
+    virtual std::unique_ptr<ImageIterator> select(const std::string &video, const std::string &label, unsigned int frame, const std::string &metadataIdentifier = "", unsigned int limit = 0) {
+        return select(video, label, std::make_shared<EqualTemporalSelection>(frame), metadataIdentifier, SelectStrategy::Objects, limit);
     }
 
     virtual std::unique_ptr<ImageIterator> select(const std::string &video,
                          const std::string &label,
                          unsigned int firstFrameInclusive,
                          unsigned int lastFrameExclusive,
-                         const std::string &metadataIdentifier = "") {
-        return select(video, label, std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive), metadataIdentifier);
+                         const std::string &metadataIdentifier = "",
+                         unsigned int limit = 0) {
+        return select(video, label, std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive), metadataIdentifier, SelectStrategy::Objects, limit);
     }
 
     virtual std::unique_ptr<ImageIterator> selectTiles(const std::string &video,
                 const std::string &label,
-                const std::string &metadataIdentifier = "") {
-        return select(video, label, std::shared_ptr<TemporalSelection>(), metadataIdentifier, SelectStrategy::Tiles);
+                const std::string &metadataIdentifier = "",
+                unsigned int limit = 0) {
+        return select(video, label, std::shared_ptr<TemporalSelection>(), metadataIdentifier, SelectStrategy::Tiles, limit);
     }
 
     virtual std::unique_ptr<ImageIterator> selectTiles(const std::string &video,
                                                        const std::string &label,
                                                        unsigned int firstFrameInclusive,
                                                        unsigned int lastFrameExclusive,
-                                                       const std::string &metadataIdentifier = "") {
-        return select(video, label, std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive), metadataIdentifier, SelectStrategy::Tiles);
+                                                       const std::string &metadataIdentifier = "",
+                                                       unsigned int limit = 0) {
+        return select(video, label, std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive), metadataIdentifier, SelectStrategy::Tiles, limit);
     }
 
     virtual std::unique_ptr<ImageIterator> selectFrames(const std::string &video,
             const std::string &label,
-            const std::string &metadataIdentifier = "") {
-        return select(video, label, std::shared_ptr<TemporalSelection>(), metadataIdentifier, SelectStrategy::Frames);
+            const std::string &metadataIdentifier = "",
+            unsigned int limit = 0) {
+        return select(video, label, std::shared_ptr<TemporalSelection>(), metadataIdentifier, SelectStrategy::Frames, limit);
     }
 
     virtual std::unique_ptr<ImageIterator> selectFrames(const std::string &video,
                                                         const std::string &label,
                                                         unsigned int firstFrameInclusive,
                                                         unsigned int lastFrameExclusive,
-                                                        const std::string &metadataIdentifier = "") {
-        return select(video, label, std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive), metadataIdentifier, SelectStrategy::Frames);
+                                                        const std::string &metadataIdentifier = "",
+                                                        unsigned int limit = 0) {
+        return select(video, label, std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive), metadataIdentifier, SelectStrategy::Frames, limit);
+    }
+
+    // Sampled selections only read the frames that are needed from each GOP. Frames per GOP keeps the earliest
+    // matching frames in each GOP because they require the least decoding after the GOP's keyframe.
+    virtual std::unique_ptr<ImageIterator> selectEveryNthFrame(const std::string &video,
+                                                               const std::string &label,
+                                                               unsigned int n,
+                                                               const std::string &metadataIdentifier = "",
+                                                               unsigned int limit = 0) {
+        return select(video, label, std::make_shared<SampledTemporalSelection>(SampledTemporalSelection::Strategy::EveryNthFrame, n), metadataIdentifier, SelectStrategy::Objects, limit);
+    }
+
+    virtual std::unique_ptr<ImageIterator> selectEveryNthFrame(const std::string &video,
+                                                               const std::string &label,
+                                                               unsigned int n,
+                                                               unsigned int firstFrameInclusive,
+                                                               unsigned int lastFrameExclusive,
+                                                               const std::string &metadataIdentifier = "",
+                                                               unsigned int limit = 0) {
+        return select(video, label, std::make_shared<SampledTemporalSelection>(SampledTemporalSelection::Strategy::EveryNthFrame, n, 0, std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive)), metadataIdentifier, SelectStrategy::Objects, limit);
+    }
+
+    virtual std::unique_ptr<ImageIterator> selectFramesPerGOP(const std::string &video,
+                                                              const std::string &label,
+                                                              unsigned int framesPerGOP,
+                                                              const std::string &metadataIdentifier = "",
+                                                              unsigned int limit = 0) {
+        return select(video, label, std::make_shared<SampledTemporalSelection>(SampledTemporalSelection::Strategy::FramesPerGOP, framesPerGOP), metadataIdentifier, SelectStrategy::Objects, limit);
+    }
+
+    virtual std::unique_ptr<ImageIterator> selectFramesPerGOP(const std::string &video,
+                                                              const std::string &label,
+                                                              unsigned int framesPerGOP,
+                                                              unsigned int firstFrameInclusive,
+                                                              unsigned int lastFrameExclusive,
+                                                              const std::string &metadataIdentifier = "",
+                                                              unsigned int limit = 0) {
+        return select(video, label, std::make_shared<SampledTemporalSelection>(SampledTemporalSelection::Strategy::FramesPerGOP, framesPerGOP, 0, std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive)), metadataIdentifier, SelectStrategy::Objects, limit);
+    }
+
+    // Aggregate queries are answered by the semantic index alone; no pixels are decoded.
+    virtual unsigned int count(const std::string &video, const std::string &label, const std::string &metadataIdentifier = "") {
+        return semanticIndex_->countForSelection(metadataIdentifier.length() ? metadataIdentifier : video, std::make_shared<SingleMetadataSelection>(label), std::shared_ptr<TemporalSelection>());
+    }
+
+    virtual unsigned int count(const std::string &video,
+                               const std::string &label,
+                               unsigned int firstFrameInclusive,
+                               unsigned int lastFrameExclusive,
+                               const std::string &metadataIdentifier = "") {
+        return semanticIndex_->countForSelection(metadataIdentifier.length() ? metadataIdentifier : video, std::make_shared<SingleMetadataSelection>(label), std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive));
+    }
+
+    virtual std::unique_ptr<std::vector<int>> framesContaining(const std::string &video, const std::string &label, const std::string &metadataIdentifier = "") {
+        return semanticIndex_->orderedFramesForSelection(metadataIdentifier.length() ? metadataIdentifier : video, std::make_shared<SingleMetadataSelection>(label), std::shared_ptr<TemporalSelection>());
+    }
+
+    virtual std::unique_ptr<std::vector<int>> framesContaining(const std::string &video,
+                                                               const std::string &label,
+                                                               unsigned int firstFrameInclusive,
+                                                               unsigned int lastFrameExclusive,
+                                                               const std::string &metadataIdentifier = "") {
+        return semanticIndex_->orderedFramesForSelection(metadataIdentifier.length() ? metadataIdentifier : video, std::make_shared<SingleMetadataSelection>(label), std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive));
+    }
+
+    virtual std::unique_ptr<std::map<int, unsigned int>> histogram(const std::string &video, const std::string &label, unsigned int bucketFrames, const std::string &metadataIdentifier = "") {
+        return semanticIndex_->histogramForSelection(metadataIdentifier.length() ? metadataIdentifier : video, std::make_shared<SingleMetadataSelection>(label), bucketFrames, std::shared_ptr<TemporalSelection>());
+    }
+
+    virtual std::unique_ptr<std::map<int, unsigned int>> histogram(const std::string &video,
+                                                                   const std::string &label,
+                                                                   unsigned int bucketFrames,
+                                                                   unsigned int firstFrameInclusive,
+                                                                   unsigned int lastFrameExclusive,
+                                                                   const std::string &metadataIdentifier = "") {
+        return semanticIndex_->histogramForSelection(metadataIdentifier.length() ? metadataIdentifier : video, std::make_shared<SingleMetadataSelection>(label), bucketFrames, std::make_shared<RangeTemporalSelection>(firstFrameInclusive, lastFrameExclusive));
     }
 
     void retileVideoBasedOnRegret(const std::string &video) {
         videoManager_.retileVideoBasedOnRegret(video);
     }
 
+    // Re-tiles the GOPs of a stored video whose layout for the workload differs from their current layout.
+    void retileWithWorkloadLayout(const std::string &video, std::shared_ptr<Workload> workload) {
+        videoManager_.retileWithWorkloadLayout(video, workload);
+    }
+
     void activateRegretBasedTilingForVideo(const std::string &video, const std::string &metadataIdentifier = "", double threshold = 0) {
         videoManager_.activateRegretBasedRetilingForVideo(video, metadataIdentifier.length() ? metadataIdentifier : video, semanticIndex_, threshold);
     }
@@ -101,6 +202,28 @@ public:
         videoManager_.deactivateRegretBasedRetilingForVideo(video);
     }
 
+    // Re-tiles GOPs of videos with regret-based tiling activated on a background thread, highest regret first, within
+    // the budget. Each GOP is published as a new tile version, so running queries are not affected.
+    void startBackgroundRetiling(RetileBudget budget = RetileBudget()) {
+        videoManager_.startBackgroundRetiling(budget);
+    }
+
+    // Waits for the GOP that is being re-tiled, if any.
+    void stopBackgroundRetiling() {
+        videoManager_.stopBackgroundRetiling();
+    }
+
+    // Records spans from queries and stores that run until stopTracing() and writes them to `tracePath` as
+    // Chrome trace JSON.
+    void startTracing() {
+        Tracer::instance().start();
+    }
+
+    void stopTracing(const std::string &tracePath) {
+        Tracer::instance().stop();
+        Tracer::instance().writeChromeTrace(tracePath);
+    }
+
     virtual ~TASM() = default;
 
     std::shared_ptr<SemanticIndex> semanticIndex() const {
@@ -108,14 +231,15 @@ public:
     }
 
 private:
-    std::unique_ptr<ImageIterator> select(const std::string &video, const std::string &label, std::shared_ptr<TemporalSelection> temporalSelection, const std::string &metadataIdentifier, SelectStrategy strategy=SelectStrategy::Objects) {
+    std::unique_ptr<ImageIterator> select(const std::string &video, const std::string &label, std::shared_ptr<TemporalSelection> temporalSelection, const std::string &metadataIdentifier, SelectStrategy strategy=SelectStrategy::Objects, unsigned int limit=0) {
         return videoManager_.select(
                 video,
                 metadataIdentifier.length() ? metadataIdentifier : video,
                 std::make_shared<SingleMetadataSelection>(label),
                 temporalSelection,
                 semanticIndex_,
-                strategy);
+                strategy,
+                limit);
     }
 
     std::shared_ptr<SemanticIndex> semanticIndex_;
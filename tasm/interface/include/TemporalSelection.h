@@ -1,13 +1,33 @@
 #ifndef TASM_TEMPORALSELECTION_H
 #define TASM_TEMPORALSELECTION_H
 
+#include "LayoutIntervals.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace tasm {
 
 class TemporalSelection {
 public:
     virtual std::string frameConstraints() const = 0;
+
+    // Equal for selections that select the same frames.
+    virtual std::string description() const { return frameConstraints(); }
+
+    // Recreates a selection from its description. An empty description is no selection.
+    static std::shared_ptr<TemporalSelection> fromDescription(const std::string &description);
+
+    // Applied to the ascending list of distinct frames that satisfy frameConstraints() for selections that can't be
+    // expressed purely as SQL constraints.
+    virtual void filterOrderedFrames(std::vector<int> &frames) const {}
 };
 
 class EqualTemporalSelection : public TemporalSelection {
@@ -38,6 +58,154 @@ private:
     int upperBoundExclusive_;
 };
 
+class SampledTemporalSelection : public TemporalSelection {
+public:
+    enum class Strategy {
+        // Frames whose index is a multiple of the sampling rate.
+        EveryNthFrame,
+        // At most the sampling rate number of frames from each GOP. The earliest frames in each GOP are kept because
+        // they require decoding the fewest frames after the GOP's keyframe.
+        FramesPerGOP,
+    };
+
+    // A gopLength of 0 for FramesPerGOP is resolved to the stored video's GOPs when the selection is executed.
+    // baseSelection optionally restricts the frames that are sampled from (e.g., to a range).
+    SampledTemporalSelection(Strategy strategy,
+            unsigned int samplingRate,
+            unsigned int gopLength = 0,
+            std::shared_ptr<TemporalSelection> baseSelection = nullptr)
+        : SampledTemporalSelection(strategy, samplingRate,
+                gopLength ? std::make_optional<LayoutIntervals>(gopLength) : std::nullopt, baseSelection)
+    {}
+
+    SampledTemporalSelection(Strategy strategy,
+            unsigned int samplingRate,
+            std::optional<LayoutIntervals> gops,
+            std::shared_ptr<TemporalSelection> baseSelection = nullptr)
+        : strategy_(strategy),
+        samplingRate_(samplingRate),
+        gops_(std::move(gops)),
+        baseSelection_(baseSelection)
+    {
+        assert(samplingRate_);
+    }
+
+    Strategy strategy() const { return strategy_; }
+    unsigned int samplingRate() const { return samplingRate_; }
+    const std::optional<LayoutIntervals> &gops() const { return gops_; }
+    bool needsGOPs() const { return strategy_ == Strategy::FramesPerGOP && !gops_; }
+
+    // Videos that are stored with adaptive layout intervals have GOPs of different lengths.
+    std::shared_ptr<SampledTemporalSelection> withGOPs(LayoutIntervals gops) const {
+        return std::make_shared<SampledTemporalSelection>(strategy_, samplingRate_, std::move(gops), baseSelection_);
+    }
+
+    std::string frameConstraints() const override {
+        std::string constraints = strategy_ == Strategy::EveryNthFrame
+                ? "frame % " + std::to_string(samplingRate_) + " = 0"
+                : "frame >= 0";
+        if (baseSelection_)
+            constraints += " and " + baseSelection_->frameConstraints();
+        return constraints;
+    }
+
+    // frameConstraints() leaves out the sampling that filterOrderedFrames() does.
+    std::string description() const override {
+        std::string description;
+        if (strategy_ == Strategy::EveryNthFrame)
+            description = "every ";
+        else if (!gops_ || gops_->isUniform())
+            description = "per GOP of " + std::to_string(gops_ ? gops_->lengthAfterLastInterval() : 0) + ": ";
+        else {
+            description = "per GOPs at ";
+            for (auto firstFrame : gops_->firstFrames())
+                description += std::to_string(firstFrame) + ",";
+            description += " then " + std::to_string(gops_->lengthAfterLastInterval()) + ": ";
+        }
+        description += std::to_string(samplingRate_);
+        if (baseSelection_)
+            description += " and " + baseSelection_->description();
+        return description;
+    }
+
+    void filterOrderedFrames(std::vector<int> &frames) const override {
+        if (baseSelection_)
+            baseSelection_->filterOrderedFrames(frames);
+
+        if (strategy_ != Strategy::FramesPerGOP)
+            return;
+
+        assert(gops_);
+        // Frames are sorted, so the first samplingRate_ frames seen for each GOP are the ones closest to its keyframe.
+        auto currentGOP = -1;
+        auto numberOfFramesFromCurrentGOP = 0u;
+        auto end = std::remove_if(frames.begin(), frames.end(), [&](int frame) {
+            int gop = gops_->intervalForFrame(frame);
+            if (gop != currentGOP) {
+                currentGOP = gop;
+                numberOfFramesFromCurrentGOP = 0;
+            }
+            return ++numberOfFramesFromCurrentGOP > samplingRate_;
+        });
+        frames.erase(end, frames.end());
+    }
+
+private:
+    Strategy strategy_;
+    unsigned int samplingRate_;
+    std::optional<LayoutIntervals> gops_;
+    std::shared_ptr<TemporalSelection> baseSelection_;
+};
+
+inline std::shared_ptr<TemporalSelection> TemporalSelection::fromDescription(const std::string &description) {
+    if (description.empty())
+        return nullptr;
+
+    int frame, lowerBound, upperBound;
+    unsigned int samplingRate, gopLength;
+    int length = -1;
+    auto describes = [&](int numberOfValues, int numberScanned) {
+        return numberScanned == numberOfValues && length == static_cast<int>(description.length());
+    };
+    if (describes(1, sscanf(description.c_str(), "frame=%d%n", &frame, &length)))
+        return std::make_shared<EqualTemporalSelection>(frame);
+    length = -1;
+    if (describes(2, sscanf(description.c_str(), "frame >= %d and frame < %d%n", &lowerBound, &upperBound, &length)))
+        return std::make_shared<RangeTemporalSelection>(lowerBound, upperBound);
+
+    // The sampling comes before its base selection.
+    static const std::string separator = " and ";
+    auto separatorPosition = description.find(separator);
+    auto sampling = description.substr(0, separatorPosition);
+    auto base = separatorPosition == std::string::npos ? nullptr : fromDescription(description.substr(separatorPosition + separator.length()));
+    length = -1;
+    if (sscanf(sampling.c_str(), "every %u%n", &samplingRate, &length) == 1 && length == static_cast<int>(sampling.length()))
+        return std::make_shared<SampledTemporalSelection>(SampledTemporalSelection::Strategy::EveryNthFrame, samplingRate, 0, base);
+    length = -1;
+    if (sscanf(sampling.c_str(), "per GOP of %u: %u%n", &gopLength, &samplingRate, &length) == 2 && length == static_cast<int>(sampling.length()))
+        return std::make_shared<SampledTemporalSelection>(SampledTemporalSelection::Strategy::FramesPerGOP, samplingRate, gopLength, base);
+    // Long videos have thousands of GOPs, so their first frames are parsed without a fixed size buffer.
+    static const std::string gopsPrefix = "per GOPs at ";
+    static const std::string gopsSuffix = " then ";
+    auto suffixPosition = sampling.find(gopsSuffix);
+    if (!sampling.compare(0, gopsPrefix.length(), gopsPrefix) && suffixPosition != std::string::npos) {
+        auto firstFrames = sampling.substr(gopsPrefix.length(), suffixPosition - gopsPrefix.length());
+        auto lengthAndRate = sampling.substr(suffixPosition + gopsSuffix.length());
+        length = -1;
+        if (firstFrames.find_first_not_of("0123456789,") == std::string::npos
+                && sscanf(lengthAndRate.c_str(), "%u: %u%n", &gopLength, &samplingRate, &length) == 2
+                && length == static_cast<int>(lengthAndRate.length())) {
+            std::vector<unsigned int> gopFirstFrames;
+            std::istringstream frames(firstFrames);
+            for (std::string firstFrame; std::getline(frames, firstFrame, ',');)
+                gopFirstFrames.push_back(std::stoul(firstFrame));
+            return std::make_shared<SampledTemporalSelection>(SampledTemporalSelection::Strategy::FramesPerGOP, samplingRate, LayoutIntervals(std::move(gopFirstFrames), gopLength), base);
+        }
+    }
+
+    throw std::invalid_argument("Unknown temporal selection " + description);
+}
+
 } // namespace tasm
 
 #endif //TASM_TEMPORALSELECTION_H
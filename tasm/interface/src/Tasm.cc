@@ -16,4 +16,8 @@ void TASM::addBulkMetadata(const std::vector<MetadataInfo> &metadataInfo) {
     semanticIndex_->addBulkMetadata(metadataInfo);
 }
 
+void TASM::addBulkMetadata(const BulkMetadata &metadata) {
+    semanticIndex_->addBulkMetadata(metadata);
+}
+
 } // namespace tasm
\ No newline at end of file
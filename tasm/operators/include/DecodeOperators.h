@@ -3,7 +3,10 @@
 
 #include "Operator.h"
 
+#include "CancellationToken.h"
 #include "EncodedData.h"
+#include "QueryStats.h"
+#include "Trace.h"
 #include "VideoDecoder.h"
 #include "VideoDecoderSession.h"
 
@@ -16,7 +19,9 @@ public:
             std::shared_ptr<GPUContext> context,
             std::shared_ptr<VideoLock> lock,
             unsigned int largestWidth = 0,
-            unsigned int largestHeight = 0)
+            unsigned int largestHeight = 0,
+            std::shared_ptr<CancellationToken> cancellationToken = nullptr,
+            std::shared_ptr<QueryStats> stats = nullptr)
         : isComplete_(false),
         configuration_(configuration),
         frameNumberQueue_(std::make_shared<spsc_queue<int>>(50000)),
@@ -26,8 +31,10 @@ public:
         largestWidth_(largestWidth ?: configuration_.codedWidth),
         largestHeight_(largestHeight ?: configuration_.codedHeight),
         decoder_(configuration_, lock_, frameNumberQueue_, tileNumberQueue_),
-        session_(decoder_, scan),
-          numberOfFramesDecoded_(0)
+        session_(decoder_, scan, cancellationToken, stats),
+          cancellationToken_(cancellationToken),
+          stats_(stats),
+          numberOfReconfigurationsReported_(0)
     {
         decoder_.preallocateArraysForDecodedFrames(largestWidth_, largestHeight_);
     }
@@ -37,9 +44,18 @@ public:
     bool isComplete() override { return isComplete_; }
 
     std::optional<GPUDecodedFrameData> next() override {
+        QueryStats::ScopedTimer timer(stats_, "GPUDecodeFromCPU");
+        TASM_TRACE_SPAN("GPUDecodeFromCPU::next", "operator");
         if (isComplete_)
             return {};
 
+        if (cancellationToken_ && cancellationToken_->isCancelled()) {
+            // The session observes the same token and stops on its own. Frames that are already decoded are dropped
+            // when the session is destroyed.
+            isComplete_ = true;
+            return std::nullopt;
+        }
+
         auto frames = std::make_unique<std::vector<GPUFramePtr>>();
 
         if (!session_.isComplete() || decoder_.decodedPictureQueue().read_available()) {
@@ -52,17 +68,33 @@ public:
                      frames->size() <= decoder_.createInfo().ulNumOutputSurfaces / 4);
         }
 
+        recordStats(*frames);
+
         if (!frames->empty() || !session_.isComplete()) {
-            numberOfFramesDecoded_ += frames->size();
             return {GPUDecodedFrameData(configuration_, std::move(frames))};
         } else {
-            std::cout << "Num-frames-from-decoder: " << numberOfFramesDecoded_ << std::endl;
             isComplete_ = true;
             return std::nullopt;
         }
     }
 
 private:
+    void recordStats(const std::vector<GPUFramePtr> &frames) {
+        if (!stats_)
+            return;
+
+        stats_->add(QueryStats::Counter::FramesDecoded, frames.size());
+        unsigned long long pixels = 0;
+        for (const auto &frame : frames)
+            pixels += frame->width() * frame->height();
+        stats_->add(QueryStats::Counter::PixelsDecoded, pixels);
+
+        // The decoder is reconfigured on the decode thread, so report the change since the last call.
+        auto numberOfReconfigurations = decoder_.numberOfReconfigurations();
+        stats_->add(QueryStats::Counter::DecoderReconfigurations, numberOfReconfigurations - numberOfReconfigurationsReported_);
+        numberOfReconfigurationsReported_ = numberOfReconfigurations;
+    }
+
     bool isComplete_;
 
     const Configuration configuration_;
@@ -76,7 +108,9 @@ private:
 
     VideoDecoder decoder_;
     VideoDecoderSession session_;
-    int numberOfFramesDecoded_;
+    std::shared_ptr<CancellationToken> cancellationToken_;
+    std::shared_ptr<QueryStats> stats_;
+    unsigned int numberOfReconfigurationsReported_;
 };
 
 } // namespace tasm
@@ -3,8 +3,12 @@
 
 #include "Operator.h"
 
+#include "CancellationToken.h"
 #include "DecodedPixelData.h"
 #include "EncodedData.h"
+#include "QueryStats.h"
+
+#include <unordered_map>
 
 namespace tasm {
 class SemanticDataManager;
@@ -13,10 +17,12 @@ class TileLayoutProvider;
 class TransformToRGB : public Operator<GPUDecodedFrameData> {
 public:
     TransformToRGB(
-            std::shared_ptr<ConfigurationOperator<GPUDecodedFrameData>> parent
+            std::shared_ptr<ConfigurationOperator<GPUDecodedFrameData>> parent,
+            std::shared_ptr<QueryStats> stats = nullptr
     )
         : isComplete_(false),
-        parent_(parent)
+        parent_(parent),
+        stats_(stats)
     { }
 
     bool isComplete() override { return isComplete_; }
@@ -25,6 +31,7 @@ public:
 private:
     bool isComplete_;
     std::shared_ptr<ConfigurationOperator<GPUDecodedFrameData>> parent_;
+    std::shared_ptr<QueryStats> stats_;
 
     static const unsigned int numChannels_ = 4;
 };
@@ -34,25 +41,54 @@ public:
     MergeTilesOperator(
             std::shared_ptr<Operator<GPUDecodedFrameData>> parent,
             std::shared_ptr<SemanticDataManager> semanticDataManager,
-            std::shared_ptr<TileLayoutProvider> tileLayoutProvider)
+            std::shared_ptr<TileLayoutProvider> tileLayoutProvider,
+            unsigned int limit = 0,
+            std::shared_ptr<CancellationToken> cancellationToken = nullptr,
+            std::shared_ptr<QueryStats> stats = nullptr)
             : parent_(parent), semanticDataManager_(semanticDataManager),
-            tileLayoutProvider_(tileLayoutProvider), isComplete_(false) {}
+            tileLayoutProvider_(tileLayoutProvider), isComplete_(false),
+            limit_(limit), numberOfObjectsProduced_(0),
+            cancellationToken_(cancellationToken),
+            stats_(stats) {}
 
     bool isComplete() override { return isComplete_; }
     std::optional<GPUPixelDataContainer> next() override;
 
 private:
+    // An object that spans several tiles. The part in each tile is copied as the tile is decoded, which may be in a later
+    // batch than the object's other tiles, and the object is returned once every part has been copied.
+    struct PartialObject {
+        std::shared_ptr<GPUAssembledPixelData> pixels;
+        unsigned int numberOfRemainingTiles;
+    };
+
     std::shared_ptr<Operator<GPUDecodedFrameData>> parent_;
     std::shared_ptr<SemanticDataManager> semanticDataManager_;
     std::shared_ptr<TileLayoutProvider> tileLayoutProvider_;
     bool isComplete_;
+
+    // Keyed by frame number, and then by the object's index among the frame's bounding boxes.
+    std::unordered_map<int, std::unordered_map<unsigned int, PartialObject>> partialObjects_;
+
+    // A limit of 0 means that every object is returned.
+    unsigned int limit_;
+    unsigned int numberOfObjectsProduced_;
+    std::shared_ptr<CancellationToken> cancellationToken_;
+    std::shared_ptr<QueryStats> stats_;
 };
 
 class TilesToPixelsOperator : public Operator<GPUPixelDataContainer> {
 public:
-    TilesToPixelsOperator(std::shared_ptr<Operator<GPUDecodedFrameData>> parent)
+    TilesToPixelsOperator(std::shared_ptr<Operator<GPUDecodedFrameData>> parent,
+            unsigned int limit = 0,
+            std::shared_ptr<CancellationToken> cancellationToken = nullptr,
+            std::shared_ptr<QueryStats> stats = nullptr)
         : parent_(parent),
-        isComplete_(false) {}
+        isComplete_(false),
+        limit_(limit),
+        numberOfTilesProduced_(0),
+        cancellationToken_(cancellationToken),
+        stats_(stats) {}
 
     bool isComplete() override { return isComplete_; }
     std::optional<GPUPixelDataContainer> next() override;
@@ -61,6 +97,12 @@ private:
     std::shared_ptr<Operator<GPUDecodedFrameData>> parent_;
     std::shared_ptr<TileLayoutProvider> tileLayoutProvider_;
     bool isComplete_;
+
+    // A limit of 0 means that every tile is returned.
+    unsigned int limit_;
+    unsigned int numberOfTilesProduced_;
+    std::shared_ptr<CancellationToken> cancellationToken_;
+    std::shared_ptr<QueryStats> stats_;
 };
 
 } // namespace tasm
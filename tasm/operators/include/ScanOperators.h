@@ -5,6 +5,8 @@
 
 #include "DecodeReader.h"
 #include "EncodedData.h"
+#include "QueryStats.h"
+#include "Trace.h"
 #include "Video.h"
 
 namespace tasm {
@@ -18,6 +20,7 @@ public:
     {}
 
     std::optional<CPUEncodedFrameDataPtr> next() override {
+        TASM_TRACE_SPAN("ScanFileDecodeReader::next", "operator");
         auto packet = reader_.read();
         if (!packet.has_value()) {
             isComplete_ = true;
@@ -39,14 +42,16 @@ private:
 
 class ScanFramesFromFileDecodeReader : public ConfigurationOperator<CPUEncodedFrameDataPtr> {
 public:
-    ScanFramesFromFileDecodeReader(std::shared_ptr<Video> video, std::shared_ptr<std::vector<int>> framesToRead, bool shouldReadEntireGOPS=false)
+    ScanFramesFromFileDecodeReader(std::shared_ptr<Video> video, std::shared_ptr<std::vector<int>> framesToRead, bool shouldReadEntireGOPS=false,
+            std::shared_ptr<QueryStats> stats = nullptr)
         : video_(video), framesToRead_(framesToRead), shouldReadEntireGOPs_(shouldReadEntireGOPS),
         frameReader_(video_->path(), framesToRead_, 0, shouldReadEntireGOPs_),
-        isComplete_(false), numberOfFramesRead_(0) {}
+        isComplete_(false), stats_(stats) {}
 
     std::optional<CPUEncodedFrameDataPtr> next() override {
+        QueryStats::ScopedTimer timer(stats_, "ScanFramesFromFileDecodeReader");
+        TASM_TRACE_SPAN("ScanFramesFromFileDecodeReader::next", "operator");
         if (frameReader_.isEos()) {
-            std::cout << "Number of frames read: " << numberOfFramesRead_ << std::endl;
             isComplete_ = true;
             return {};
         }
@@ -59,7 +64,10 @@ public:
 
         auto data =std::make_shared<CPUEncodedFrameData>(video_->configuration(), DecodeReaderPacket(*gopPacket->data(), flags));
         data->setFirstFrameIndexAndNumberOfFrames(gopPacket->firstFrameIndex(), gopPacket->numberOfFrames());
-        numberOfFramesRead_ += gopPacket->numberOfFrames();
+        if (stats_) {
+            stats_->add(QueryStats::Counter::GOPsRead, 1);
+            stats_->add(QueryStats::Counter::BytesRead, gopPacket->data()->size());
+        }
         return {data};
     }
 
@@ -73,7 +81,7 @@ private:
     bool shouldReadEntireGOPs_;
     EncodedFrameReader frameReader_;
     bool isComplete_;
-    unsigned int numberOfFramesRead_;
+    std::shared_ptr<QueryStats> stats_;
 };
 
 } // namespace tasm
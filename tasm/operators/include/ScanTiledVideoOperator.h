@@ -3,10 +3,14 @@
 
 #include "Operator.h"
 
+#include "CancellationToken.h"
 #include "EncodedData.h"
+#include "QueryStats.h"
 #include "Rectangle.h"
 #include "SemanticDataManager.h"
 #include "TileLocationProvider.h"
+#include "TilePack.h"
+#include "TileReadAhead.h"
 #include "StitchContext.h"
 
 namespace tasm {
@@ -17,16 +21,27 @@ public:
             std::shared_ptr<TiledEntry> entry,
             std::shared_ptr<SemanticDataManager> semanticDataManager,
             std::shared_ptr<TileLocationProvider> tileLocationProvider,
-            bool shouldReadEntireGOPs = false)
+            bool shouldReadEntireGOPs = false,
+            bool shouldScanInFrameOrder = false,
+            std::shared_ptr<CancellationToken> cancellationToken = nullptr,
+            std::shared_ptr<QueryStats> stats = nullptr)
             : isComplete_(false), entry_(entry), semanticDataManager_(semanticDataManager),
             tileLocationProvider_(tileLocationProvider),
             shouldReadEntireGOPs_(shouldReadEntireGOPs),
+            shouldScanInFrameOrder_(shouldScanInFrameOrder),
+            cancellationToken_(cancellationToken),
+            stats_(stats),
             totalVideoWidth_(0), totalVideoHeight_(0),
-            totalNumberOfPixels_(0), totalNumberOfFrames_(0),
-            totalNumberOfBytes_(0), numberOfTilesRead_(0),
             didSignalEOS_(false),
-            currentTileNumber_(0), currentTileArea_(0)
+            frameIt_(semanticDataManager_->orderedFrames().cbegin()),
+            endFrameIt_(semanticDataManager_->orderedFrames().cend()),
+            currentStorageFormat_(TileStorageFormat::MP4),
+            currentTileNumber_(0)
     {
+        auto &environment = EnvironmentConfiguration::instance();
+        if (environment.readAheadBytes())
+            readAhead_ = std::make_unique<TileReadAhead>(environment.readAheadDepth(), environment.readAheadBytes(), stats_);
+
         preprocess();
     }
 
@@ -35,7 +50,9 @@ public:
 
 private:
     void preprocess();
-    void setUpNextEncodedFrameReader();
+    bool planNextGroupOfFrames();
+    bool setUpNextTile();
+    std::optional<GOPReaderPacket> readGOPFromCurrentTile();
     std::shared_ptr<std::vector<int>> nextGroupOfFramesWithTheSameLayoutAndFromTheSameFile(std::vector<int>::const_iterator &frameIt, std::vector<int>::const_iterator &endIt);
     std::unique_ptr<std::unordered_map<unsigned int, std::shared_ptr<std::vector<int>>>> filterToTileFramesThatContainObject(std::shared_ptr<std::vector<int>> possibleFrames);
 
@@ -45,23 +62,31 @@ private:
     std::shared_ptr<TileLocationProvider> tileLocationProvider_;
     bool shouldReadEntireGOPs_;
 
+    // When set, tiles are planned one group of frames at a time as they are read, so a query that stops early
+    // never plans (or reads) the rest of the video. Otherwise every read is planned up front and sorted by tile
+    // dimensions to minimize decoder reconfigurations.
+    bool shouldScanInFrameOrder_;
+    std::shared_ptr<CancellationToken> cancellationToken_;
+    std::shared_ptr<QueryStats> stats_;
+
     unsigned int totalVideoWidth_;
     unsigned int totalVideoHeight_;
 
-    unsigned long long int totalNumberOfPixels_;
-    unsigned long long int totalNumberOfFrames_;
-    unsigned long long int totalNumberOfBytes_;
-    unsigned int numberOfTilesRead_;
     bool didSignalEOS_;
+    std::vector<int>::const_iterator frameIt_;
+    std::vector<int>::const_iterator endFrameIt_;
 
     std::shared_ptr<const TileLayout> currentTileLayout_;
     std::unique_ptr<std::experimental::filesystem::path> currentTilePath_;
+    TileStorageFormat currentStorageFormat_;
     unsigned int currentTileNumber_;
     std::unique_ptr<EncodedFrameReader> currentEncodedFrameReader_;
     std::unordered_map<std::string, Configuration> tilePathToConfiguration_;
+    TilePackCache tilePacks_;
 
     struct TileInformation {
         std::experimental::filesystem::path filename;
+        TileStorageFormat storageFormat;
         int tileNumber;
         unsigned int width;
         unsigned int height;
@@ -82,9 +107,14 @@ private:
         }
     };
 
+    void readAhead(std::vector<TileInformation>::const_iterator begin, std::vector<TileInformation>::const_iterator end);
+
     std::vector<TileInformation> orderedTileInformation_;
     std::vector<TileInformation>::const_iterator orderedTileInformationIt_;
-    unsigned int currentTileArea_;
+
+    // Reads the planned tiles in the background when enabled. Declared last so that its threads stop before the
+    // members that they use are destroyed.
+    std::unique_ptr<TileReadAhead> readAhead_;
 };
 
 class ScanFullFramesFromTiledVideoOperator : public Operator<CPUEncodedFrameDataPtr> {
@@ -92,11 +122,15 @@ public:
     ScanFullFramesFromTiledVideoOperator(
             std::shared_ptr<TiledEntry> entry,
             std::shared_ptr<SemanticDataManager> semanticDataManager,
-            std::shared_ptr<TileLocationProvider> tileLocationProvider)
+            std::shared_ptr<TileLocationProvider> tileLocationProvider,
+            std::shared_ptr<CancellationToken> cancellationToken = nullptr,
+            std::shared_ptr<QueryStats> stats = nullptr)
                 : isComplete_(false),
                 entry_(entry),
                 semanticDataManager_(semanticDataManager),
                 tileLocationProvider_(tileLocationProvider),
+                cancellationToken_(cancellationToken),
+                stats_(stats),
                 didSignalEOS_(false),
                 frameIt_(semanticDataManager_->orderedFrames().begin()),
                 endFrameIt_(semanticDataManager_->orderedFrames().end()),
@@ -120,11 +154,14 @@ private:
     std::shared_ptr<TiledEntry> entry_;
     std::shared_ptr<SemanticDataManager> semanticDataManager_;
     std::shared_ptr<TileLocationProvider> tileLocationProvider_;
+    std::shared_ptr<CancellationToken> cancellationToken_;
+    std::shared_ptr<QueryStats> stats_;
     bool didSignalEOS_;
     std::vector<int>::const_iterator frameIt_;
     std::vector<int>::const_iterator endFrameIt_;
 
     std::vector<std::unique_ptr<EncodedFrameReader>> currentEncodedFrameReaders_;
+    TilePackCache tilePacks_;
     std::unique_ptr<stitching::StitchContext> currentContext_;
     unsigned int ppsId_;
 
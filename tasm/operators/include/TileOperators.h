@@ -3,9 +3,11 @@
 
 #include "EncodedData.h"
 #include "Files.h"
+#include "LayoutIntervals.h"
 #include "MultipleEncoderManager.h"
 #include "Operator.h"
 #include "TileConfigurationProvider.h"
+#include "TileQualityProvider.h"
 #include "Video.h"
 
 namespace tasm {
@@ -18,14 +20,31 @@ public:
             std::string outputEntryName,
             unsigned int layoutDuration,
             std::shared_ptr<GPUContext> context,
-            std::shared_ptr<VideoLock> lock)
+            std::shared_ptr<VideoLock> lock,
+            std::shared_ptr<TileQualityProvider> tileQualityProvider = nullptr)
+            : TileOperator(video, parent, tileConfigurationProvider, outputEntryName, LayoutIntervals(layoutDuration), context, lock, tileQualityProvider)
+    {}
+
+    // Each layout interval starts with a keyframe. When the intervals are not uniform, the encoders only insert
+    // keyframes where they are forced.
+    // Without a quality provider, every tile is encoded with the same quantization parameter.
+    TileOperator(std::shared_ptr<Video> video,
+            std::shared_ptr<ConfigurationOperator<GPUDecodedFrameData>> parent,
+            std::shared_ptr<TileLayoutProvider> tileConfigurationProvider,
+            std::string outputEntryName,
+            LayoutIntervals layoutIntervals,
+            std::shared_ptr<GPUContext> context,
+            std::shared_ptr<VideoLock> lock,
+            std::shared_ptr<TileQualityProvider> tileQualityProvider = nullptr)
             : isComplete_(false),
             video_(video),
             parent_(parent),
             tileConfigurationProvider_(tileConfigurationProvider),
+            tileQualityProvider_(tileQualityProvider),
           outputEntry_(new TiledEntry(outputEntryName)),
-          layoutDuration_(layoutDuration),
-          tileEncodersManager_(EncodeConfiguration(parent->configuration(), NV_ENC_HEVC, layoutDuration), *context, *lock),
+          layoutIntervals_(std::move(layoutIntervals)),
+          tileEncodersManager_(EncodeConfiguration(parent->configuration(), NV_ENC_HEVC,
+                  layoutIntervals_.isUniform() ? layoutIntervals_.lengthAfterLastInterval() : NVENC_INFINITE_GOPLENGTH), *context, *lock),
           firstFrameInGroup_(-1),
           lastFrameInGroup_(-1),
           frameNumber_(0)
@@ -35,7 +54,7 @@ public:
     std::optional<GPUDecodedFrameData> next() override;
 
 private:
-    void reconfigureEncodersForNewLayout(std::shared_ptr<const TileLayout> newLayout);
+    void reconfigureEncodersForNewLayout(std::shared_ptr<const TileLayout> newLayout, const std::vector<unsigned int> &quantizationParameters);
     void saveTileGroupsToDisk();
     void encodeFrameToTiles(GPUFramePtr frame, int frameNumber);
     void readDataFromEncoders(bool shouldFlush);
@@ -44,10 +63,12 @@ private:
     std::shared_ptr<Video> video_;
     std::shared_ptr<ConfigurationOperator<GPUDecodedFrameData>> parent_;
     std::shared_ptr<TileLayoutProvider> tileConfigurationProvider_;
+    std::shared_ptr<TileQualityProvider> tileQualityProvider_;
     std::shared_ptr<TiledEntry> outputEntry_;
-    const unsigned int layoutDuration_;
+    const LayoutIntervals layoutIntervals_;
     MultipleEncoderManager tileEncodersManager_;
     std::shared_ptr<const TileLayout> currentTileLayout_;
+    std::vector<unsigned int> currentQuantizationParameters_;
     int firstFrameInGroup_;
     int lastFrameInGroup_;
     unsigned int frameNumber_;
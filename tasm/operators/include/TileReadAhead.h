@@ -0,0 +1,91 @@
+#ifndef TASM_TILEREADAHEAD_H
+#define TASM_TILEREADAHEAD_H
+
+#include "DecodeReader.h"
+#include "QueryStats.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace tasm {
+
+// Reads the GOPs of upcoming tiles on background threads so that the decoder does not wait for I/O.
+// Tiles are consumed in the order that they are added. At most `depth` tiles, starting with the one being consumed,
+// are read at a time, and tiles stop reading once `byteBudget` bytes are buffered. The tile being consumed still reads
+// a GOP whenever it has none buffered so that the budget cannot stall the consumer. Each thread checks the budget
+// before it reads a GOP, so the buffer can exceed the budget by at most one GOP per thread.
+class TileReadAhead {
+public:
+    // Opens a tile's reader. Called on a read-ahead thread.
+    using ReaderFactory = std::function<std::unique_ptr<EncodedFrameReader>()>;
+
+    TileReadAhead(unsigned int depth, unsigned long long byteBudget, std::shared_ptr<QueryStats> stats = nullptr);
+    TileReadAhead(const TileReadAhead&) = delete;
+    ~TileReadAhead();
+
+    void addTile(ReaderFactory openReader);
+
+    // Moves on to the next tile that was added, discarding anything left of the current one. Returns false when
+    // there are no more tiles.
+    bool nextTile();
+
+    // Returns the current tile's next GOP, waiting for it to be read if necessary, or nothing when every GOP of the
+    // tile has been returned. Rethrows anything that was thrown while the tile was read.
+    std::optional<GOPReaderPacket> nextGOP();
+
+    unsigned long long bufferedBytes() const;
+
+    // Waits until `numberOfReaders` threads are blocked by the budget or by GOPs that the consumer has not taken yet.
+    // Only meaningful while nothing is consumed, so it is intended for tests.
+    void waitForBlockedReaders(unsigned int numberOfReaders);
+
+private:
+    struct Tile {
+        explicit Tile(ReaderFactory openReader)
+            : openReader(std::move(openReader)), isDone(false), isAbandoned(false)
+        {}
+
+        ReaderFactory openReader;
+        std::deque<GOPReaderPacket> gops;
+        bool isDone;
+        bool isAbandoned;
+        std::exception_ptr error;
+    };
+
+    static constexpr unsigned int MaximumNumberOfThreads = 4;
+
+    void readTiles();
+    void readTile(const std::shared_ptr<Tile> &tile);
+    bool isFirstTile(const std::shared_ptr<Tile> &tile) const { return !tiles_.empty() && tiles_.front() == tile; }
+
+    const unsigned int depth_;
+    const unsigned long long byteBudget_;
+    std::shared_ptr<QueryStats> stats_;
+
+    mutable std::mutex mutex_;
+    // Signals the read-ahead threads that a tile can be started or that the budget or current tile changed.
+    std::condition_variable readerCondition_;
+    // Signals the consumer that the current tile has a GOP or is done.
+    std::condition_variable consumerCondition_;
+    // Signals waitForBlockedReaders() that a thread blocked.
+    std::condition_variable blockedReadersCondition_;
+
+    // The front tile is the one being consumed.
+    std::deque<std::shared_ptr<Tile>> tiles_;
+    bool hasCurrentTile_;
+    // The number of tiles at the front of tiles_ that have been started.
+    unsigned int numberOfStartedTiles_;
+    unsigned long long bufferedBytes_;
+    unsigned int numberOfBlockedReaders_;
+    bool isStopped_;
+
+    std::vector<std::thread> threads_;
+};
+
+} // namespace tasm
+
+#endif //TASM_TILEREADAHEAD_H
@@ -5,6 +5,7 @@
 
 #include "DecodedPixelData.h"
 #include "ImageUtilities.h"
+#include "QueryStats.h"
 
 namespace tasm {
 
@@ -12,11 +13,13 @@ class TransformToImage : public Operator<std::unique_ptr<std::vector<ImagePtr>>>
 public:
     TransformToImage(std::shared_ptr<Operator<GPUPixelDataContainer>> parent,
             unsigned int maxWidth,
-            unsigned int maxHeight)
+            unsigned int maxHeight,
+            std::shared_ptr<QueryStats> stats = nullptr)
             : parent_(parent),
             maxWidth_(maxWidth),
             maxHeight_(maxHeight),
-            isComplete_(false)
+            isComplete_(false),
+            stats_(stats)
      {}
 
     bool isComplete() override { return isComplete_; }
@@ -27,6 +30,7 @@ private:
     unsigned int maxWidth_;
     unsigned int maxHeight_;
     bool isComplete_;
+    std::shared_ptr<QueryStats> stats_;
 
     static const unsigned int numChannels_ = 4;
 };
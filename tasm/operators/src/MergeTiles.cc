@@ -4,6 +4,7 @@
 #include "NvCodecUtils.h"
 #include "SemanticDataManager.h"
 #include "TileConfigurationProvider.h"
+#include "Trace.h"
 
 namespace tasm {
 
@@ -14,6 +15,8 @@ static std::pair<int, int> topAndLeftOffsets(const Rectangle &rect, const Rectan
 }
 
 std::optional<GPUDecodedFrameData> TransformToRGB::next() {
+    QueryStats::ScopedTimer timer(stats_, "TransformToRGB");
+    TASM_TRACE_SPAN("TransformToRGB::next", "operator");
     auto decodedData = parent_->next();
     if (parent_->isComplete()) {
         assert(!decodedData.has_value());
@@ -34,6 +37,16 @@ std::optional<GPUDecodedFrameData> TransformToRGB::next() {
 }
 
 std::optional<GPUPixelDataContainer> MergeTilesOperator::next() {
+    QueryStats::ScopedTimer timer(stats_, "MergeTilesOperator");
+    TASM_TRACE_SPAN("MergeTilesOperator::next", "operator");
+    if (isComplete_)
+        return std::nullopt;
+
+    if (limit_ && numberOfObjectsProduced_ >= limit_) {
+        isComplete_ = true;
+        return std::nullopt;
+    }
+
     auto decodedData = parent_->next();
     if (parent_->isComplete()) {
         assert(!decodedData.has_value());
@@ -45,6 +58,9 @@ std::optional<GPUPixelDataContainer> MergeTilesOperator::next() {
 
     auto pixelData = std::make_unique<std::vector<GPUPixelDataPtr>>();
     for (auto frame : decodedData->frames()) {
+        if (limit_ && numberOfObjectsProduced_ >= limit_)
+            break;
+
         // Create a pixel object for each bounding box that lies in the decoded tiles.
 
         int frameNumber;
@@ -52,31 +68,86 @@ std::optional<GPUPixelDataContainer> MergeTilesOperator::next() {
         int tileNumber = frame->tileNumber();
         assert(tileNumber != static_cast<int>(-1));
 
+        if (!semanticDataManager_->isFrameInSelection(frameNumber))
+            continue;
+
         auto &boundingBoxesForFrame = semanticDataManager_->rectanglesForFrame(frameNumber);
-        auto tileRect = tileLayoutProvider_->tileLayoutForFrame(frameNumber)->rectangleForTile(tileNumber);
+        auto tileLayout = tileLayoutProvider_->tileLayoutForFrame(frameNumber);
+        auto tileRect = tileLayout->rectangleForTile(tileNumber);
 
         // TODO: Cache this work. Because it's also done when determining which tiles to decode.
         // See if any of the rectangles intersect this tile.
+        auto objectIndex = 0u;
         for (auto &boundingBox : boundingBoxesForFrame) {
+            if (limit_ && numberOfObjectsProduced_ >= limit_)
+                break;
+
+            auto i = objectIndex++;
             if (!boundingBox.intersects(tileRect))
                 continue;
 
             auto overlappingRect = tileRect.overlappingRectangle(boundingBox);
-            // TODO: Migrate support for objects across tiles.
-            assert(overlappingRect == boundingBox);
-            auto offsetIntoTile = topAndLeftOffsets(boundingBox, tileRect);
+            if (overlappingRect == boundingBox) {
+                // The object lies within this tile, so its pixels are read from the decoded tile without copying.
+                auto offsetIntoTile = topAndLeftOffsets(boundingBox, tileRect);
+                pixelData->emplace_back(std::make_shared<GPUPixelDataFromDecodedFrame>(
+                        frame,
+                        boundingBox.width, boundingBox.height,
+                        offsetIntoTile.second, offsetIntoTile.first));
+                ++numberOfObjectsProduced_;
+                continue;
+            }
+
+            // The object spans several tiles, or extends past the frame, so copy the part that is in this tile.
+            // The scan decodes every tile that intersects a bounding box, so each of the object's tiles arrives.
+            auto objectRect = Rectangle(0, 0, 0, tileLayout->totalWidth(), tileLayout->totalHeight()).overlappingRectangle(boundingBox);
+            auto &partialObjectsForFrame = partialObjects_[frameNumber];
+            auto partialObject = partialObjectsForFrame.find(i);
+            if (partialObject == partialObjectsForFrame.end()) {
+                auto numberOfTiles = tileLayout->tilesForRectangles(std::vector<Rectangle>{objectRect}).count();
+                partialObject = partialObjectsForFrame.emplace(i, PartialObject{
+                        std::make_shared<GPUAssembledPixelData>(objectRect.width, objectRect.height),
+                        static_cast<unsigned int>(numberOfTiles)}).first;
+            }
+
+            auto offsetIntoTile = topAndLeftOffsets(overlappingRect, tileRect);
+            partialObject->second.pixels->copyFrom(
+                    frame->cuda()->handle(), frame->cuda()->pitch(),
+                    offsetIntoTile.second, offsetIntoTile.first,
+                    overlappingRect.x - objectRect.x, overlappingRect.y - objectRect.y,
+                    overlappingRect.width, overlappingRect.height);
+            if (--partialObject->second.numberOfRemainingTiles)
+                continue;
 
-            pixelData->emplace_back(std::make_shared<GPUPixelDataFromDecodedFrame>(
-                    frame,
-                    boundingBox.width, boundingBox.height,
-                    offsetIntoTile.second, offsetIntoTile.first));
+            pixelData->push_back(partialObject->second.pixels);
+            ++numberOfObjectsProduced_;
+            if (stats_)
+                stats_->add(QueryStats::Counter::ObjectsAssembled, 1);
 
+            partialObjectsForFrame.erase(partialObject);
+            if (partialObjectsForFrame.empty())
+                partialObjects_.erase(frameNumber);
         }
     }
+
+    // Stop scanning and decoding as soon as enough objects have been found rather than waiting for the next call.
+    if (limit_ && numberOfObjectsProduced_ >= limit_ && cancellationToken_)
+        cancellationToken_->cancel();
+
     return pixelData;
 }
 
 std::optional<GPUPixelDataContainer> TilesToPixelsOperator::next() {
+    QueryStats::ScopedTimer timer(stats_, "TilesToPixelsOperator");
+    TASM_TRACE_SPAN("TilesToPixelsOperator::next", "operator");
+    if (isComplete_)
+        return std::nullopt;
+
+    if (limit_ && numberOfTilesProduced_ >= limit_) {
+        isComplete_ = true;
+        return std::nullopt;
+    }
+
     auto decodedData = parent_->next();
     if (parent_->isComplete()) {
         assert(!decodedData.has_value());
@@ -88,11 +159,19 @@ std::optional<GPUPixelDataContainer> TilesToPixelsOperator::next() {
 
     auto pixelData = std::make_unique<std::vector<GPUPixelDataPtr>>();
     for (auto frame : decodedData->frames()) {
+        if (limit_ && numberOfTilesProduced_ >= limit_)
+            break;
+
         pixelData->emplace_back(std::make_shared<GPUPixelDataFromDecodedFrame>(
                 frame,
                 frame->width(), frame->height(),
                 0, 0)); // Fake a (0, 0) offset.
+        ++numberOfTilesProduced_;
     }
+
+    if (limit_ && numberOfTilesProduced_ >= limit_ && cancellationToken_)
+        cancellationToken_->cancel();
+
     return pixelData;
 }
 
@@ -2,6 +2,7 @@
 
 #include "VideoConfiguration.h"
 #include "Stitcher.h"
+#include "Trace.h"
 
 namespace tasm {
 
@@ -9,29 +10,44 @@ static const unsigned int MAX_PPS_ID = 64;
 static const unsigned int ALIGNMENT = 32;
 
 void ScanTiledVideoOperator::preprocess() {
-    auto frameIt = semanticDataManager_->orderedFrames().cbegin();
-    auto end = semanticDataManager_->orderedFrames().cend();
-    while (frameIt != end) {
-        auto possibleFramesToRead = nextGroupOfFramesWithTheSameLayoutAndFromTheSameFile(frameIt, end);
-        auto tileToFrames = filterToTileFramesThatContainObject(possibleFramesToRead);
-
-        for (auto tileNumberIt = tileToFrames->begin(); tileNumberIt != tileToFrames->end(); ++tileNumberIt) {
-            if (tileNumberIt->second->empty())
-                continue;
-            auto rectangleForTile = currentTileLayout_->rectangleForTile(tileNumberIt->first);
-            orderedTileInformation_.emplace_back<TileInformation>(
-                    {TileFiles::tileFilename(currentTilePath_->parent_path(), tileNumberIt->first),
-                     static_cast<int>(tileNumberIt->first),
-                     rectangleForTile.width,
-                     rectangleForTile.height,
-                     tileNumberIt->second,
-                     tileLocationProvider_->frameOffsetInTileFile(*currentTilePath_),
-                     rectangleForTile});
-        }
+    if (shouldScanInFrameOrder_) {
+        planNextGroupOfFrames();
+    } else {
+        while (planNextGroupOfFrames()) { }
+        std::sort(orderedTileInformation_.begin(), orderedTileInformation_.end());
     }
-
-    std::sort(orderedTileInformation_.begin(), orderedTileInformation_.end());
     orderedTileInformationIt_ = orderedTileInformation_.begin();
+    readAhead(orderedTileInformation_.begin(), orderedTileInformation_.end());
+}
+
+bool ScanTiledVideoOperator::planNextGroupOfFrames() {
+    if (frameIt_ == endFrameIt_)
+        return false;
+
+    auto possibleFramesToRead = nextGroupOfFramesWithTheSameLayoutAndFromTheSameFile(frameIt_, endFrameIt_);
+    auto tileToFrames = filterToTileFramesThatContainObject(possibleFramesToRead);
+
+    auto firstTileInGroup = orderedTileInformation_.size();
+    for (auto tileNumberIt = tileToFrames->begin(); tileNumberIt != tileToFrames->end(); ++tileNumberIt) {
+        if (tileNumberIt->second->empty())
+            continue;
+        auto rectangleForTile = currentTileLayout_->rectangleForTile(tileNumberIt->first);
+        orderedTileInformation_.emplace_back<TileInformation>(
+                {TileFiles::tileFilename(currentTilePath_->parent_path(), tileNumberIt->first),
+                 currentStorageFormat_,
+                 static_cast<int>(tileNumberIt->first),
+                 rectangleForTile.width,
+                 rectangleForTile.height,
+                 tileNumberIt->second,
+                 tileLocationProvider_->frameOffsetInTileFile(*currentTilePath_),
+                 rectangleForTile});
+    }
+
+    // Within a group, still order reads by dimensions to limit decoder reconfigurations.
+    if (shouldScanInFrameOrder_)
+        std::sort(std::next(orderedTileInformation_.begin(), firstTileInGroup), orderedTileInformation_.end());
+
+    return true;
 }
 
 std::shared_ptr<std::vector<int>> ScanTiledVideoOperator::nextGroupOfFramesWithTheSameLayoutAndFromTheSameFile(std::vector<int>::const_iterator &frameIt, std::vector<int>::const_iterator &endIt) {
@@ -42,6 +58,7 @@ std::shared_ptr<std::vector<int>> ScanTiledVideoOperator::nextGroupOfFramesWithT
     // While the path is the same, it must have the same configuration.
     currentTilePath_ = std::make_unique<std::experimental::filesystem::path>(tileLocationProvider_->locationOfTileForFrame(fakeTileNumber, *frameIt));
     currentTileLayout_ = tileLocationProvider_->tileLayoutForFrame(*frameIt);
+    currentStorageFormat_ = tileLocationProvider_->storageFormatForFrame(*frameIt);
 
     if (!totalVideoWidth_) {
         assert(!totalVideoHeight_);
@@ -71,87 +88,128 @@ std::unique_ptr<std::unordered_map<unsigned int, std::shared_ptr<std::vector<int
     }
 
     for (auto i = 0u; i < currentTileLayout_->numberOfTiles(); ++i) {
-        auto tileRect = currentTileLayout_->rectangleForTile(i);
-        if (!tileNumberToFrames->count(i))
-            (*tileNumberToFrames)[i] = std::make_shared<std::vector<int>>();
+        (*tileNumberToFrames)[i] = std::make_shared<std::vector<int>>();
         (*tileNumberToFrames)[i]->reserve(possibleFrames->size());
-        for (auto frame = possibleFrames->begin(); frame != possibleFrames->end(); ++frame) {
-            auto &rectanglesForFrame = semanticDataManager_->rectanglesForFrame(*frame);
-            bool anyIntersect = std::any_of(rectanglesForFrame.begin(), rectanglesForFrame.end(), [&](auto &rectangle) {
-                return tileRect.intersects(rectangle);
-            });
-            if (anyIntersect) {
-                (*tileNumberToFrames)[i]->push_back(*frame);
-            }
-        }
+    }
+
+    // Frames are visited in order, so each tile's frames stay in ascending order.
+    for (auto frame = possibleFrames->begin(); frame != possibleFrames->end(); ++frame) {
+        auto tiles = currentTileLayout_->tilesForRectangles(semanticDataManager_->rectanglesForFrame(*frame));
+        for (auto tile = tiles.find_first(); tile != TileMask::npos; tile = tiles.find_next(tile))
+            (*tileNumberToFrames)[tile]->push_back(*frame);
     }
     return tileNumberToFrames;
 }
 
-void ScanTiledVideoOperator::setUpNextEncodedFrameReader() {
+void ScanTiledVideoOperator::readAhead(std::vector<TileInformation>::const_iterator begin, std::vector<TileInformation>::const_iterator end) {
+    if (!readAhead_)
+        return;
+
+    for (auto tileInformation = begin; tileInformation != end; ++tileInformation) {
+        readAhead_->addTile([this, tileInformation = *tileInformation] {
+            return std::make_unique<EncodedFrameReader>(
+                    tilePacks_.sampleReaderForTile(tileInformation.filename, tileInformation.tileNumber, tileInformation.storageFormat),
+                    tileInformation.framesToRead,
+                    tileInformation.frameOffsetInFile,
+                    shouldReadEntireGOPs_);
+        });
+    }
+}
+
+bool ScanTiledVideoOperator::setUpNextTile() {
+    TASM_TRACE_SPAN("ScanTiledVideoOperator::openTile", "scan");
+    if (shouldScanInFrameOrder_ && orderedTileInformationIt_ == orderedTileInformation_.end()) {
+        // Plan the next group of frames that has any tiles to read.
+        orderedTileInformation_.clear();
+        while (orderedTileInformation_.empty() && planNextGroupOfFrames()) { }
+        orderedTileInformationIt_ = orderedTileInformation_.begin();
+        readAhead(orderedTileInformation_.begin(), orderedTileInformation_.end());
+    }
+
     if (orderedTileInformationIt_ == orderedTileInformation_.end()) {
         currentEncodedFrameReader_ = nullptr;
+        return false;
+    }
+
+    if (stats_)
+        stats_->add(QueryStats::Counter::TilesOpened, 1);
+    if (readAhead_) {
+        // The read-ahead was given the tiles in the same order.
+        auto hasTile = readAhead_->nextTile();
+        assert(hasTile);
     } else {
-        ++numberOfTilesRead_;
         currentEncodedFrameReader_ = std::make_unique<EncodedFrameReader>(
-                orderedTileInformationIt_->filename,
+                tilePacks_.sampleReaderForTile(orderedTileInformationIt_->filename, orderedTileInformationIt_->tileNumber, orderedTileInformationIt_->storageFormat),
                 orderedTileInformationIt_->framesToRead,
                 orderedTileInformationIt_->frameOffsetInFile,
                 shouldReadEntireGOPs_);
+    }
 
-        currentTileArea_ = orderedTileInformationIt_->width * orderedTileInformationIt_->height;
-        currentTilePath_ = std::make_unique<std::experimental::filesystem::path>(orderedTileInformationIt_->filename);
-        currentTileNumber_ = orderedTileInformationIt_->tileNumber;
+    currentTilePath_ = std::make_unique<std::experimental::filesystem::path>(orderedTileInformationIt_->filename);
+    currentTileNumber_ = orderedTileInformationIt_->tileNumber;
+    currentStorageFormat_ = orderedTileInformationIt_->storageFormat;
 
-        ++orderedTileInformationIt_;
-    }
+    ++orderedTileInformationIt_;
+    return true;
+}
+
+std::optional<GOPReaderPacket> ScanTiledVideoOperator::readGOPFromCurrentTile() {
+    if (!currentTilePath_)
+        return {};
+    else if (readAhead_)
+        return readAhead_->nextGOP();
+    else if (currentEncodedFrameReader_ && !currentEncodedFrameReader_->isEos())
+        return currentEncodedFrameReader_->read();
+    else
+        return {};
 }
 
 std::optional<CPUEncodedFrameDataPtr> ScanTiledVideoOperator::next() {
+    QueryStats::ScopedTimer timer(stats_, "ScanTiledVideoOperator");
+    TASM_TRACE_SPAN("ScanTiledVideoOperator::next", "operator");
     if (isComplete_)
         return {};
 
     if (didSignalEOS_) {
-        std::cout << "\nANALYSIS: num-pixels-decoded " << totalNumberOfPixels_ << std::endl;
-        std::cout << "ANALYSIS: num-frames-decoded " << totalNumberOfFrames_ << std::endl;
-        std::cout << "ANALYSIS: num-bytes-decoded " << totalNumberOfBytes_ << std::endl;
-        std::cout << "ANALYSIS: num-tiles-read " << numberOfTilesRead_ << std::endl;
         isComplete_ = true;
         return {};
     }
 
-    if (!currentEncodedFrameReader_ || currentEncodedFrameReader_->isEos()) {
-        setUpNextEncodedFrameReader();
-
-        // If the frame reader is still empty, then there are no more frames to read.
-        // Flush the decoder.
-        if (!currentEncodedFrameReader_) {
-            didSignalEOS_ = true;
-            CUVIDSOURCEDATAPACKET packet;
-            memset(&packet, 0, sizeof(packet));
-            packet.flags = CUVID_PKT_ENDOFSTREAM;
-            Configuration configuration;
-            return std::make_shared<CPUEncodedFrameData>(
-                    configuration,
-                    DecodeReaderPacket(packet));
-        }
+    std::optional<GOPReaderPacket> gopPacket;
+    if (cancellationToken_ && cancellationToken_->isCancelled()) {
+        currentEncodedFrameReader_ = nullptr;
+        readAhead_ = nullptr;
+    } else {
+        gopPacket = readGOPFromCurrentTile();
+        while (!gopPacket && setUpNextTile())
+            gopPacket = readGOPFromCurrentTile();
     }
 
-    // Otherwise, read and decode frames.
-    auto gopPacket = currentEncodedFrameReader_->read();
-    assert(gopPacket.has_value());
+    // If there is no GOP, then there are no more frames to read or the query was cancelled.
+    // Flush the decoder.
+    if (!gopPacket) {
+        didSignalEOS_ = true;
+        CUVIDSOURCEDATAPACKET packet;
+        memset(&packet, 0, sizeof(packet));
+        packet.flags = CUVID_PKT_ENDOFSTREAM;
+        Configuration configuration;
+        return std::make_shared<CPUEncodedFrameData>(
+                configuration,
+                DecodeReaderPacket(packet));
+    }
 
     Configuration configuration;
     if (tilePathToConfiguration_.count(*currentTilePath_))
         configuration = tilePathToConfiguration_.at(*currentTilePath_);
     else {
-        configuration = *tasm::video::GetConfiguration(*currentTilePath_);
+        configuration = tilePacks_.configurationForTile(*currentTilePath_, currentTileNumber_, currentStorageFormat_);
         tilePathToConfiguration_[*currentTilePath_] = configuration;
     }
 
-    totalNumberOfPixels_ += gopPacket->numberOfFrames() * currentTileArea_;
-    totalNumberOfFrames_ += gopPacket->numberOfFrames();
-    totalNumberOfBytes_ += gopPacket->data()->size();
+    if (stats_) {
+        stats_->add(QueryStats::Counter::GOPsRead, 1);
+        stats_->add(QueryStats::Counter::BytesRead, gopPacket->data()->size());
+    }
 
     unsigned long flags = 0;
     auto data = std::make_shared<CPUEncodedFrameData>(configuration, DecodeReaderPacket(*gopPacket->data(), flags));
@@ -168,6 +226,7 @@ static std::vector<unsigned int> ToCtbs(const std::vector<unsigned int> &pixelVa
 }
 
 void ScanFullFramesFromTiledVideoOperator::setUpNextEncodedFrameReaders() {
+    TASM_TRACE_SPAN("ScanFullFramesFromTiledVideoOperator::openTiles", "scan");
     currentEncodedFrameReaders_.clear();
     if (frameIt_ == endFrameIt_)
         return;
@@ -179,15 +238,20 @@ void ScanFullFramesFromTiledVideoOperator::setUpNextEncodedFrameReaders() {
     while (frameIt_ != endFrameIt_) {
         if (pathForFrame(*frameIt_) == pathOfNextFrameGroup)
             frames->push_back(*frameIt_++);
+        else
+            break;
     }
 
     // Create a reader for each tile.
     auto frame = frames->front();
     auto layout = tileLocationProvider_->tileLayoutForFrame(frame);
+    auto storageFormat = tileLocationProvider_->storageFormatForFrame(frame);
     for (auto t = 0u; t < layout->numberOfTiles(); ++t) {
         auto tilePath = TileFiles::tileFilename(pathOfNextFrameGroup, t);
+        if (stats_)
+            stats_->add(QueryStats::Counter::TilesOpened, 1);
         currentEncodedFrameReaders_.push_back(std::make_unique<EncodedFrameReader>(
-                tilePath,
+                tilePacks_.sampleReaderForTile(tilePath, t, storageFormat),
                 frames,
                 tileLocationProvider_->frameOffsetInTileFile(tilePath),
                 false));
@@ -217,6 +281,10 @@ GOPReaderPacket ScanFullFramesFromTiledVideoOperator::stitchedDataForNextGOP() {
     for (auto &reader : currentEncodedFrameReaders_) {
         auto gopPacket = reader->read();
         assert(gopPacket.has_value());
+        if (stats_) {
+            stats_->add(QueryStats::Counter::GOPsRead, 1);
+            stats_->add(QueryStats::Counter::BytesRead, gopPacket->data()->size());
+        }
         dataForGOP.push_back(std::shared_ptr(std::move(gopPacket->data())));
         if (numberOfFrames == -1) {
             numberOfFrames = gopPacket->numberOfFrames();
@@ -236,11 +304,15 @@ GOPReaderPacket ScanFullFramesFromTiledVideoOperator::stitchedDataForNextGOP() {
     }
 
     // Stitch the data for the different GOPs.
+    QueryStats::ScopedTimer stitchTimer(stats_, QueryStats::Counter::StitchTimeNs);
+    TASM_TRACE_SPAN("Stitcher::GetStitchedSegments", "stitch");
     stitching::Stitcher stitcher(*currentContext_, dataForGOP);
     return GOPReaderPacket(stitcher.GetStitchedSegments(), firstFrameIndex, numberOfFrames);
 }
 
 std::optional<CPUEncodedFrameDataPtr> ScanFullFramesFromTiledVideoOperator::next() {
+    QueryStats::ScopedTimer timer(stats_, "ScanFullFramesFromTiledVideoOperator");
+    TASM_TRACE_SPAN("ScanFullFramesFromTiledVideoOperator::next", "operator");
     if (isComplete_)
         return {};
 
@@ -249,6 +321,11 @@ std::optional<CPUEncodedFrameDataPtr> ScanFullFramesFromTiledVideoOperator::next
         return {};
     }
 
+    if (cancellationToken_ && cancellationToken_->isCancelled()) {
+        currentEncodedFrameReaders_.clear();
+        frameIt_ = endFrameIt_;
+    }
+
     // Set up frame readers for next group of frames with the same layout.
     if (currentEncodedFrameReaders_.empty()) {
         setUpNextEncodedFrameReaders();
@@ -279,7 +356,7 @@ std::optional<CPUEncodedFrameDataPtr> ScanFullFramesFromTiledVideoOperator::next
 }
 
 std::unique_ptr<Configuration> ScanFullFramesFromTiledVideoOperator::fullFrameConfig() {
-    auto firstTileConfig = tasm::video::GetConfiguration(tileLocationProvider_->locationOfTileForFrame(0, 0));
+    auto firstTileConfig = tilePacks_.configurationForTile(tileLocationProvider_->locationOfTileForFrame(0, 0), 0, tileLocationProvider_->storageFormatForFrame(0));
     auto layout = tileLocationProvider_->tileLayoutForFrame(0);
     auto fullFrameConfig = std::make_unique<Configuration>(
             layout->totalWidth(),
@@ -288,8 +365,8 @@ std::unique_ptr<Configuration> ScanFullFramesFromTiledVideoOperator::fullFrameCo
             layout->codedHeight(),
             layout->codedWidth(),
             layout->codedHeight(),
-            firstTileConfig->frameRate,
-            firstTileConfig->codec,
+            firstTileConfig.frameRate,
+            firstTileConfig.codec,
             0);
     return fullFrameConfig;
 }
@@ -1,11 +1,13 @@
 #include "TileOperators.h"
 
 #include "EncodeAPI.h"
+#include "Trace.h"
 #include "Transaction.h"
 
 namespace tasm {
 
 std::optional<GPUDecodedFrameData> TileOperator::next() {
+    TASM_TRACE_SPAN("TileOperator::next", "operator");
     auto decodedData = parent_->next();
     if (parent_->isComplete()) {
         readDataFromEncoders(true);
@@ -18,9 +20,13 @@ std::optional<GPUDecodedFrameData> TileOperator::next() {
         int frameNumber = -1;
         frameNumber = frame->getFrameNumber(frameNumber) ? frameNumber : frameNumber_++;
         auto tileLayout = tileConfigurationProvider_->tileLayoutForFrame(frameNumber);
+        auto quantizationParameters = tileQualityProvider_
+                ? tileQualityProvider_->quantizationParametersForFrame(frameNumber, *tileLayout)
+                : std::vector<unsigned int>();
 
-        // Reconfigure the encoders if the layout changed.
-        if (!currentTileLayout_ || *tileLayout != *currentTileLayout_ || frameNumber != lastFrameInGroup_ + 1) {
+        // Reconfigure the encoders if the layout or the quality of its tiles changed.
+        if (!currentTileLayout_ || *tileLayout != *currentTileLayout_ || quantizationParameters != currentQuantizationParameters_
+                || frameNumber != lastFrameInGroup_ + 1) {
             // Read the data that was flushed from the encoders because it has the rest of the frames
             // that were encoded with the last configuration.
             if (currentTileLayout_) {
@@ -31,9 +37,10 @@ std::optional<GPUDecodedFrameData> TileOperator::next() {
             tilesCurrentlyBeingEncoded_.clear();
 
             // Reconfigure the encoders.
-            reconfigureEncodersForNewLayout(tileLayout);
+            reconfigureEncodersForNewLayout(tileLayout, quantizationParameters);
 
             currentTileLayout_ = tileLayout;
+            currentQuantizationParameters_ = quantizationParameters;
             firstFrameInGroup_ = frameNumber;
         }
 
@@ -45,15 +52,20 @@ std::optional<GPUDecodedFrameData> TileOperator::next() {
     return decodedData;
 }
 
-void TileOperator::reconfigureEncodersForNewLayout(std::shared_ptr<const tasm::TileLayout> newLayout) {
+void TileOperator::reconfigureEncodersForNewLayout(std::shared_ptr<const tasm::TileLayout> newLayout, const std::vector<unsigned int> &quantizationParameters) {
+    assert(quantizationParameters.empty() || quantizationParameters.size() == newLayout->numberOfTiles());
     for (auto tileIndex = 0u; tileIndex < newLayout->numberOfTiles(); ++tileIndex) {
         Rectangle rect = newLayout->rectangleForTile(tileIndex);
-        tileEncodersManager_.createEncoderWithConfiguration(tileIndex, rect.width, rect.height);
+        auto quantizationParameter = quantizationParameters.empty()
+                ? std::optional<unsigned int>()
+                : std::make_optional(quantizationParameters[tileIndex]);
+        tileEncodersManager_.createEncoderWithConfiguration(tileIndex, rect.width, rect.height, quantizationParameter);
         tilesCurrentlyBeingEncoded_.push_back(tileIndex);
     }
 }
 
 void TileOperator::saveTileGroupsToDisk() {
+    TASM_TRACE_SPAN("TileOperator::saveTileGroupsToDisk", "encode");
     if (!currentTileLayout_ || *currentTileLayout_ == EmptyTileLayout) {
         return;
     }
@@ -80,6 +92,7 @@ void TileOperator::saveTileGroupsToDisk() {
 }
 
 void TileOperator::readDataFromEncoders(bool shouldFlush) {
+    TASM_TRACE_SPAN("TileOperator::readDataFromEncoders", "encode");
     for (auto &i : tilesCurrentlyBeingEncoded_) {
         auto encodedData = shouldFlush ? tileEncodersManager_.flushEncoderForIdentifier(i) : tileEncodersManager_.getEncodedFramesForIdentifier(i);
         if (!encodedData->empty())
@@ -88,9 +101,10 @@ void TileOperator::readDataFromEncoders(bool shouldFlush) {
 }
 
 void TileOperator::encodeFrameToTiles(GPUFramePtr frame, int frameNumber) {
+    auto isKeyframe = layoutIntervals_.isFirstFrameOfInterval(frameNumber);
     for (auto &tileIndex : tilesCurrentlyBeingEncoded_) {
         Rectangle rect = currentTileLayout_->rectangleForTile(tileIndex);
-        tileEncodersManager_.encodeFrameForIdentifier(tileIndex, *frame, rect.y, rect.x, false);
+        tileEncodersManager_.encodeFrameForIdentifier(tileIndex, *frame, rect.y, rect.x, isKeyframe);
     }
 }
 
@@ -0,0 +1,163 @@
+#include "TileReadAhead.h"
+
+#include "Trace.h"
+
+namespace tasm {
+
+TileReadAhead::TileReadAhead(unsigned int depth, unsigned long long byteBudget, std::shared_ptr<QueryStats> stats)
+    : depth_(std::max(depth, 1u)),
+      byteBudget_(byteBudget),
+      stats_(std::move(stats)),
+      hasCurrentTile_(false),
+      numberOfStartedTiles_(0),
+      bufferedBytes_(0),
+      numberOfBlockedReaders_(0),
+      isStopped_(false)
+{
+    for (auto i = 0u; i < std::min(depth_, MaximumNumberOfThreads); ++i)
+        threads_.emplace_back(&TileReadAhead::readTiles, this);
+}
+
+TileReadAhead::~TileReadAhead() {
+    {
+        std::scoped_lock lock(mutex_);
+        isStopped_ = true;
+    }
+    readerCondition_.notify_all();
+    for (auto &thread : threads_)
+        thread.join();
+}
+
+void TileReadAhead::addTile(ReaderFactory openReader) {
+    {
+        std::scoped_lock lock(mutex_);
+        tiles_.push_back(std::make_shared<Tile>(std::move(openReader)));
+    }
+    readerCondition_.notify_all();
+}
+
+bool TileReadAhead::nextTile() {
+    bool hasTile;
+    {
+        std::scoped_lock lock(mutex_);
+        if (hasCurrentTile_ && !tiles_.empty()) {
+            auto &tile = tiles_.front();
+            tile->isAbandoned = true;
+            for (const auto &gop : tile->gops)
+                bufferedBytes_ -= gop.data_->size();
+            tile->gops.clear();
+            tiles_.pop_front();
+            if (numberOfStartedTiles_)
+                --numberOfStartedTiles_;
+        }
+        hasCurrentTile_ = hasTile = !tiles_.empty();
+    }
+    // A new tile can be started, and the new current tile is no longer limited by the budget.
+    readerCondition_.notify_all();
+    return hasTile;
+}
+
+std::optional<GOPReaderPacket> TileReadAhead::nextGOP() {
+    std::unique_lock lock(mutex_);
+    if (!hasCurrentTile_)
+        return {};
+
+    auto tile = tiles_.front();
+    auto wasRead = !tile->gops.empty();
+    if (!wasRead && !tile->isDone) {
+        QueryStats::ScopedTimer stallTimer(stats_, QueryStats::Counter::ReadAheadStallTimeNs);
+        consumerCondition_.wait(lock, [&] { return !tile->gops.empty() || tile->isDone; });
+    }
+
+    if (tile->gops.empty()) {
+        if (tile->error)
+            std::rethrow_exception(tile->error);
+        return {};
+    }
+
+    // Only GOPs that are returned count, so waiting to find out that the tile is done is not a stall.
+    if (stats_)
+        stats_->add(wasRead ? QueryStats::Counter::ReadAheadHits : QueryStats::Counter::ReadAheadStalls, 1);
+
+    auto gop = std::move(tile->gops.front());
+    tile->gops.pop_front();
+    bufferedBytes_ -= gop.data_->size();
+    lock.unlock();
+    readerCondition_.notify_all();
+    return {std::move(gop)};
+}
+
+unsigned long long TileReadAhead::bufferedBytes() const {
+    std::scoped_lock lock(mutex_);
+    return bufferedBytes_;
+}
+
+void TileReadAhead::waitForBlockedReaders(unsigned int numberOfReaders) {
+    std::unique_lock lock(mutex_);
+    blockedReadersCondition_.wait(lock, [&] { return numberOfBlockedReaders_ >= numberOfReaders; });
+}
+
+void TileReadAhead::readTiles() {
+    Tracer::instance().setCurrentThreadName("tile read-ahead");
+    while (true) {
+        std::shared_ptr<Tile> tile;
+        {
+            std::unique_lock lock(mutex_);
+            readerCondition_.wait(lock, [&] {
+                return isStopped_ || (numberOfStartedTiles_ < tiles_.size() && numberOfStartedTiles_ < depth_);
+            });
+            if (isStopped_)
+                return;
+            tile = tiles_[numberOfStartedTiles_++];
+        }
+        readTile(tile);
+    }
+}
+
+void TileReadAhead::readTile(const std::shared_ptr<Tile> &tile) {
+    try {
+        std::unique_ptr<EncodedFrameReader> reader;
+        {
+            TASM_TRACE_SPAN("TileReadAhead::openTile", "scan");
+            reader = tile->openReader();
+        }
+
+        while (!reader->isEos()) {
+            {
+                std::unique_lock lock(mutex_);
+                // The current tile always has a GOP in flight so that the budget cannot stall the consumer.
+                auto canRead = [&] {
+                    return isStopped_ || tile->isAbandoned || bufferedBytes_ < byteBudget_
+                            || (isFirstTile(tile) && tile->gops.empty());
+                };
+                while (!canRead()) {
+                    ++numberOfBlockedReaders_;
+                    blockedReadersCondition_.notify_all();
+                    readerCondition_.wait(lock);
+                    --numberOfBlockedReaders_;
+                }
+                if (isStopped_ || tile->isAbandoned)
+                    return;
+            }
+
+            auto gop = reader->read();
+            assert(gop.has_value());
+
+            std::scoped_lock lock(mutex_);
+            if (tile->isAbandoned)
+                return;
+            bufferedBytes_ += gop->data_->size();
+            tile->gops.push_back(std::move(*gop));
+            consumerCondition_.notify_one();
+        }
+    } catch (...) {
+        std::scoped_lock lock(mutex_);
+        tile->error = std::current_exception();
+    }
+
+    std::scoped_lock lock(mutex_);
+    tile->isDone = true;
+    consumerCondition_.notify_one();
+}
+
+} // namespace tasm
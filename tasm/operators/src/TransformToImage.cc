@@ -1,5 +1,7 @@
 #include "TransformToImage.h"
 
+#include "Trace.h"
+
 #include <fstream>
 
 namespace tasm {
@@ -22,6 +24,8 @@ void GetImage(CUdeviceptr dpSrc, uint8_t *pDst, int nWidth, int nHeight, int src
 }
 
 std::optional<std::unique_ptr<std::vector<ImagePtr>>> TransformToImage::next() {
+    QueryStats::ScopedTimer timer(stats_, "TransformToImage");
+    TASM_TRACE_SPAN("TransformToImage::next", "operator");
     if (isComplete_)
         return std::nullopt;
 
@@ -0,0 +1,78 @@
+#ifndef TASM_BULKMETADATA_H
+#define TASM_BULKMETADATA_H
+
+#include <experimental/filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tasm {
+
+// Bounding boxes stored by column for loading many at once. Videos and labels are dictionary encoded, so each row
+// holds an index into videos() and labels() rather than its own strings.
+class BulkMetadata {
+public:
+    BulkMetadata() = default;
+
+    // Builds metadata from columns that are already dictionary encoded. Throws std::invalid_argument if the columns
+    // have different lengths or refer to videos or labels that are not in the dictionaries.
+    static BulkMetadata fromColumns(std::vector<std::string> videos,
+            std::vector<std::string> labels,
+            std::vector<unsigned int> videoIds,
+            std::vector<unsigned int> labelIds,
+            std::vector<unsigned int> frames,
+            std::vector<unsigned int> x1s,
+            std::vector<unsigned int> y1s,
+            std::vector<unsigned int> x2s,
+            std::vector<unsigned int> y2s);
+
+    // Parses a CSV file whose columns are video, label, frame, x1, y1, x2, y2. The first line is skipped if it is a
+    // header. Fields cannot be quoted. The file is split into chunks that are parsed in parallel; numberOfThreads = 0
+    // uses one thread per core. Throws std::runtime_error if the file cannot be read or a line is malformed.
+    static BulkMetadata fromCSV(const std::experimental::filesystem::path &path, unsigned int numberOfThreads = 0);
+
+    void add(const std::string &video, const std::string &label, unsigned int frame, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2);
+    // Appends other's rows, merging its dictionaries into this one's.
+    void append(const BulkMetadata &other);
+    void reserve(std::size_t numberOfRows);
+
+    std::size_t size() const { return frames_.size(); }
+    bool empty() const { return frames_.empty(); }
+
+    const std::vector<std::string> &videos() const { return videos_; }
+    const std::vector<std::string> &labels() const { return labels_; }
+    const std::string &video(std::size_t row) const { return videos_[videoIds_[row]]; }
+    const std::string &label(std::size_t row) const { return labels_[labelIds_[row]]; }
+    unsigned int frame(std::size_t row) const { return frames_[row]; }
+    unsigned int x1(std::size_t row) const { return x1s_[row]; }
+    unsigned int y1(std::size_t row) const { return y1s_[row]; }
+    unsigned int x2(std::size_t row) const { return x2s_[row]; }
+    unsigned int y2(std::size_t row) const { return y2s_[row]; }
+
+    // The rows ordered by (video, label, frame), which is the order of the index over the labels table.
+    std::vector<std::size_t> sortedRows() const;
+
+private:
+    unsigned int videoId(const std::string &video);
+    unsigned int labelId(const std::string &label);
+    static unsigned int idInDictionary(const std::string &value, std::vector<std::string> &dictionary, std::unordered_map<std::string, unsigned int> &ids);
+    // Parses the lines in [begin, end), which must start at the beginning of a line.
+    void parseCSV(const char *begin, const char *end, bool mayStartWithHeader);
+
+    std::vector<std::string> videos_;
+    std::vector<std::string> labels_;
+    std::unordered_map<std::string, unsigned int> videoToId_;
+    std::unordered_map<std::string, unsigned int> labelToId_;
+
+    std::vector<unsigned int> videoIds_;
+    std::vector<unsigned int> labelIds_;
+    std::vector<unsigned int> frames_;
+    std::vector<unsigned int> x1s_;
+    std::vector<unsigned int> y1s_;
+    std::vector<unsigned int> x2s_;
+    std::vector<unsigned int> y2s_;
+};
+
+} // namespace tasm
+
+#endif //TASM_BULKMETADATA_H
@@ -1,11 +1,15 @@
 #ifndef TASM_SEMANTICDATAMANAGER_H
 #define TASM_SEMANTICDATAMANAGER_H
 
+#include "QueryStats.h"
 #include "Rectangle.h"
 #include "SemanticIndex.h"
 #include "SemanticSelection.h"
 #include "TemporalSelection.h"
 
+#include <algorithm>
+#include <mutex>
+
 namespace tasm {
 
 class SemanticDataManager {
@@ -15,27 +19,39 @@ public:
             std::shared_ptr<MetadataSelection> metadataSelection,
             std::shared_ptr<TemporalSelection> temporalSelection = std::shared_ptr<TemporalSelection>(),
             unsigned int maxWidth = 0,
-            unsigned int maxHeight = 0)
+            unsigned int maxHeight = 0,
+            std::shared_ptr<QueryStats> stats = nullptr)
             : index_(index),
             video_(video),
             metadataSelection_(metadataSelection),
             temporalSelection_(temporalSelection),
             maxWidth_(maxWidth),
-            maxHeight_(maxHeight)
+            maxHeight_(maxHeight),
+            stats_(stats)
     {}
 
     const std::vector<int> &orderedFrames() {
         if (orderedFrames_)
             return *orderedFrames_;
 
+        QueryStats::ScopedTimer timer(stats_, QueryStats::Counter::IndexTimeNs);
         orderedFrames_ = index_->orderedFramesForSelection(video_, metadataSelection_, temporalSelection_);
         return *orderedFrames_;
     }
 
+    // Frames that precede a selected frame in its GOP are decoded too, but they are not part of the selection.
+    bool isFrameInSelection(int frame) {
+        auto &frames = orderedFrames();
+        return std::binary_search(frames.begin(), frames.end(), frame);
+    }
+
     const std::list<Rectangle> &rectanglesForFrame(int frame) {
+        // Scans may plan lazily on the decoder's reader thread while the merge operator reads rectangles.
+        std::scoped_lock lock(frameToRectanglesMutex_);
         if (frameToRectangles_.count(frame))
             return *frameToRectangles_.at(frame);
 
+        QueryStats::ScopedTimer timer(stats_, QueryStats::Counter::IndexTimeNs);
         frameToRectangles_.emplace(frame, std::move(index_->rectanglesForFrame(video_, metadataSelection_, frame, maxWidth_, maxHeight_)));
         return *frameToRectangles_.at(frame);
     }
@@ -45,6 +61,14 @@ public:
     }
 
     const std::vector<std::string> &labelsInQuery() const { return metadataSelection_->objects(); }
+    std::shared_ptr<TemporalSelection> temporalSelection() const { return temporalSelection_; }
+
+    // Equal for selections that select the same objects on the same frames.
+    std::string predicate() const {
+        return video_ + "\n" + metadataSelection_->labelConstraints() + "\n"
+                + (temporalSelection_ ? temporalSelection_->description() : "")
+                + "\n" + std::to_string(maxWidth_) + "x" + std::to_string(maxHeight_);
+    }
 
 private:
     std::shared_ptr<SemanticIndex> index_;
@@ -53,9 +77,11 @@ private:
     std::shared_ptr<TemporalSelection> temporalSelection_;
     unsigned int maxWidth_;
     unsigned int maxHeight_;
+    std::shared_ptr<QueryStats> stats_;
 
     std::unique_ptr<std::vector<int>> orderedFrames_;
     std::unordered_map<int, std::unique_ptr<std::list<Rectangle>>> frameToRectangles_;
+    std::mutex frameToRectanglesMutex_;
 };
 
 } // namespace tasm
@@ -1,12 +1,15 @@
 #ifndef TASM_SEMANTICINDEX_H
 #define TASM_SEMANTICINDEX_H
 
+#include "BulkMetadata.h"
 #include "EnvironmentConfiguration.h"
 #include "Rectangle.h"
 #include "SemanticSelection.h"
 #include "TemporalSelection.h"
 #include "sqlite3.h"
 #include <experimental/filesystem>
+#include <map>
+#include <mutex>
 #include <string>
 #include <iostream>
 
@@ -43,6 +46,7 @@ public:
             unsigned int y2) = 0;
 
     virtual void addBulkMetadata(const std::vector<MetadataInfo>&) = 0;
+    virtual void addBulkMetadata(const BulkMetadata&) = 0;
 
     virtual std::unique_ptr<std::vector<int>> orderedFramesForSelection(
             const std::string &video,
@@ -62,12 +66,38 @@ public:
             int firstFrameInclusive,
             int lastFrameExclusive) = 0;
 
+    // Returns the number of bounding boxes that match the selection.
+    virtual unsigned int countForSelection(
+            const std::string &video,
+            std::shared_ptr<MetadataSelection> metadataSelection,
+            std::shared_ptr<TemporalSelection> temporalSelection) = 0;
+
+    // Maps the first frame of each bucket of `bucketFrames` frames to the number of bounding boxes in that bucket
+    // that match the selection. Buckets without any matching boxes are omitted. Throws std::invalid_argument if
+    // `bucketFrames` is 0.
+    virtual std::unique_ptr<std::map<int, unsigned int>> histogramForSelection(
+            const std::string &video,
+            std::shared_ptr<MetadataSelection> metadataSelection,
+            unsigned int bucketFrames,
+            std::shared_ptr<TemporalSelection> temporalSelection) = 0;
+
     virtual ~SemanticIndex() {}
 };
 
 class SemanticIndexSQLiteBase : public SemanticIndex {
 public:
+    void addMetadata(const std::string &video,
+                     const std::string &label,
+                     unsigned int frame,
+                     unsigned int x1,
+                     unsigned int y1,
+                     unsigned int x2,
+                     unsigned int y2) override;
+
     void addBulkMetadata(const std::vector<MetadataInfo>&) override;
+    // Inserts the rows in index order, several rows per statement, in one transaction. When the load is at least as
+    // large as the table, the table's indexes are dropped first and rebuilt afterwards.
+    void addBulkMetadata(const BulkMetadata&) override;
     virtual void setup() {
         openDatabase(dbPath_);
         initializeStatements();
@@ -79,14 +109,42 @@ protected:
     { }
 
     virtual std::unique_ptr<std::list<Rectangle>> rectanglesForQuery(sqlite3_stmt *stmt, unsigned int maxWidth = 0, unsigned int maxHeight = 0) = 0;
+
+    // Finalizes the statement.
+    unsigned int countForQuery(sqlite3_stmt *stmt);
+    std::size_t approximateNumberOfRows();
+    std::unique_ptr<std::map<int, unsigned int>> histogramForQuery(sqlite3_stmt *stmt);
+
     virtual void openDatabase(const std::experimental::filesystem::path &dbPath) = 0;
     virtual void createTable() = 0;
     virtual void closeDatabase() = 0;
     virtual void initializeStatements() = 0;
     virtual void destroyStatements() = 0;
 
+    // An INSERT statement that adds numberOfRows rows.
+    virtual std::string insertQuery(unsigned int numberOfRows) const = 0;
+    virtual unsigned int numberOfInsertParameters() const = 0;
+    // Binds a row to the statement's parameters starting at firstParameter. The strings must outlive the statement's
+    // next step.
+    virtual void bindMetadata(sqlite3_stmt *stmt,
+                              int firstParameter,
+                              const std::string &video,
+                              const std::string &label,
+                              unsigned int frame,
+                              unsigned int x1,
+                              unsigned int y1,
+                              unsigned int x2,
+                              unsigned int y2) = 0;
+    // Indexes other than the primary key, which can be built after a bulk load.
+    virtual void createIndexes() {}
+    virtual void dropIndexes() {}
+
     sqlite3 *db_;
 
+    // Serializes writers, which share addMetadataStmt_ and the connection's transaction. Python releases the GIL
+    // while metadata is added, so writes can come from several threads.
+    std::mutex writeMutex_;
+
     // Statements.
     sqlite3_stmt *addMetadataStmt_;
 
@@ -96,14 +154,6 @@ protected:
 class SemanticIndexSQLite : public SemanticIndexSQLiteBase {
     friend class SemanticIndexFactory;
 public:
-    void addMetadata(const std::string &video,
-                     const std::string &label,
-                     unsigned int frame,
-                     unsigned int x1,
-                     unsigned int y1,
-                     unsigned int x2,
-                     unsigned int y2) override;
-
     std::unique_ptr<std::vector<int>> orderedFramesForSelection(
             const std::string &video,
             std::shared_ptr<MetadataSelection> metadataSelection,
@@ -111,6 +161,8 @@ public:
 
     std::unique_ptr<std::list<Rectangle>> rectanglesForFrame(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, int frame, unsigned int maxWidth = 0, unsigned int maxHeight = 0) override;
     std::unique_ptr<std::list<Rectangle>> rectanglesForFrames(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, int firstFrameInclusive, int lastFrameExclusive) override;
+    unsigned int countForSelection(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, std::shared_ptr<TemporalSelection> temporalSelection) override;
+    std::unique_ptr<std::map<int, unsigned int>> histogramForSelection(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, unsigned int bucketFrames, std::shared_ptr<TemporalSelection> temporalSelection) override;
 
     ~SemanticIndexSQLite() {
         destroyStatements();
@@ -130,6 +182,12 @@ protected:
     void closeDatabase() override;
     void initializeStatements() override;
     void destroyStatements() override;
+
+    std::string insertQuery(unsigned int numberOfRows) const override;
+    unsigned int numberOfInsertParameters() const override { return 7; }
+    void bindMetadata(sqlite3_stmt *stmt, int firstParameter, const std::string &video, const std::string &label, unsigned int frame, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2) override;
+    void createIndexes() override;
+    void dropIndexes() override;
 };
 
 class SemanticIndexSQLiteInMemory : public SemanticIndexSQLite {
@@ -143,14 +201,6 @@ protected:
 class SemanticIndexWH : public SemanticIndexSQLiteBase {
     friend class SemanticIndexFactory;
 public:
-    void addMetadata(const std::string &video,
-                     const std::string &label,
-                     unsigned int frame,
-                     unsigned int x1,
-                     unsigned int y1,
-                     unsigned int x2,
-                     unsigned int y2) override;
-
     std::unique_ptr<std::vector<int>> orderedFramesForSelection(
             const std::string &video,
             std::shared_ptr<MetadataSelection> metadataSelection,
@@ -158,6 +208,8 @@ public:
 
     std::unique_ptr<std::list<Rectangle>> rectanglesForFrame(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, int frame, unsigned int maxWidth = 0, unsigned int maxHeight = 0) override;
     std::unique_ptr<std::list<Rectangle>> rectanglesForFrames(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, int firstFrameInclusive, int lastFrameExclusive) override;
+    unsigned int countForSelection(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, std::shared_ptr<TemporalSelection> temporalSelection) override;
+    std::unique_ptr<std::map<int, unsigned int>> histogramForSelection(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, unsigned int bucketFrames, std::shared_ptr<TemporalSelection> temporalSelection) override;
 
     ~SemanticIndexWH() {
         destroyStatements();
@@ -177,6 +229,11 @@ protected:
     void closeDatabase() override;
     void initializeStatements() override;
     void destroyStatements() override;
+
+    // Each row's label, frame, and box make up the primary key, so there are no other indexes to defer.
+    std::string insertQuery(unsigned int numberOfRows) const override;
+    unsigned int numberOfInsertParameters() const override { return 6; }
+    void bindMetadata(sqlite3_stmt *stmt, int firstParameter, const std::string &video, const std::string &label, unsigned int frame, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2) override;
 };
 
 class SemanticIndexFactory {
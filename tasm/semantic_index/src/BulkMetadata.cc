@@ -0,0 +1,240 @@
+#include "BulkMetadata.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+namespace tasm {
+
+BulkMetadata BulkMetadata::fromColumns(std::vector<std::string> videos,
+        std::vector<std::string> labels,
+        std::vector<unsigned int> videoIds,
+        std::vector<unsigned int> labelIds,
+        std::vector<unsigned int> frames,
+        std::vector<unsigned int> x1s,
+        std::vector<unsigned int> y1s,
+        std::vector<unsigned int> x2s,
+        std::vector<unsigned int> y2s) {
+    auto numberOfRows = frames.size();
+    if (videoIds.size() != numberOfRows || labelIds.size() != numberOfRows || x1s.size() != numberOfRows
+            || y1s.size() != numberOfRows || x2s.size() != numberOfRows || y2s.size() != numberOfRows)
+        throw std::invalid_argument("Metadata columns must all have the same length");
+    if (std::any_of(videoIds.begin(), videoIds.end(), [&](auto id) { return id >= videos.size(); }))
+        throw std::invalid_argument("Metadata refers to a video that is not in the dictionary");
+    if (std::any_of(labelIds.begin(), labelIds.end(), [&](auto id) { return id >= labels.size(); }))
+        throw std::invalid_argument("Metadata refers to a label that is not in the dictionary");
+
+    BulkMetadata metadata;
+    for (auto i = 0u; i < videos.size(); ++i) {
+        if (!metadata.videoToId_.emplace(videos[i], i).second)
+            throw std::invalid_argument("Video \"" + videos[i] + "\" appears in the dictionary more than once");
+    }
+    for (auto i = 0u; i < labels.size(); ++i) {
+        if (!metadata.labelToId_.emplace(labels[i], i).second)
+            throw std::invalid_argument("Label \"" + labels[i] + "\" appears in the dictionary more than once");
+    }
+
+    metadata.videos_ = std::move(videos);
+    metadata.labels_ = std::move(labels);
+    metadata.videoIds_ = std::move(videoIds);
+    metadata.labelIds_ = std::move(labelIds);
+    metadata.frames_ = std::move(frames);
+    metadata.x1s_ = std::move(x1s);
+    metadata.y1s_ = std::move(y1s);
+    metadata.x2s_ = std::move(x2s);
+    metadata.y2s_ = std::move(y2s);
+    return metadata;
+}
+
+BulkMetadata BulkMetadata::fromCSV(const std::experimental::filesystem::path &path, unsigned int numberOfThreads) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Failed to open metadata file " + path.string());
+    std::vector<char> contents(std::experimental::filesystem::file_size(path));
+    if (!file.read(contents.data(), contents.size()))
+        throw std::runtime_error("Failed to read metadata file " + path.string());
+
+    if (!numberOfThreads)
+        numberOfThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    // Small files are not worth splitting.
+    static const std::size_t minimumChunkSize = 1u << 20u;
+    numberOfThreads = std::max<std::size_t>(1, std::min<std::size_t>(numberOfThreads, contents.size() / minimumChunkSize));
+
+    // Split the file into one chunk per thread, each ending at the end of a line.
+    const char *begin = contents.data();
+    const char *end = begin + contents.size();
+    std::vector<const char*> chunkBoundaries{begin};
+    for (auto i = 1u; i < numberOfThreads; ++i) {
+        auto boundary = std::max(chunkBoundaries.back(), begin + contents.size() * i / numberOfThreads);
+        boundary = std::find(boundary, end, '\n');
+        chunkBoundaries.push_back(boundary == end ? end : boundary + 1);
+    }
+    chunkBoundaries.push_back(end);
+
+    std::vector<BulkMetadata> chunks(numberOfThreads);
+    std::vector<std::exception_ptr> errors(numberOfThreads);
+    std::vector<std::thread> threads;
+    for (auto i = 0u; i < numberOfThreads; ++i) {
+        threads.emplace_back([&, i] {
+            try {
+                chunks[i].parseCSV(chunkBoundaries[i], chunkBoundaries[i + 1], !i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    for (auto &error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    auto metadata = std::move(chunks.front());
+    std::size_t numberOfRows = 0;
+    for (const auto &chunk : chunks)
+        numberOfRows += chunk.size();
+    metadata.reserve(numberOfRows);
+    for (auto chunk = std::next(chunks.begin()); chunk != chunks.end(); ++chunk)
+        metadata.append(*chunk);
+    return metadata;
+}
+
+void BulkMetadata::parseCSV(const char *begin, const char *end, bool mayStartWithHeader) {
+    static const unsigned int numberOfFields = 7;
+    std::size_t lineNumber = 0;
+    for (auto line = begin; line < end; ++lineNumber) {
+        auto lineEnd = std::find(line, end, '\n');
+        auto nextLine = lineEnd == end ? end : lineEnd + 1;
+        if (lineEnd != line && *(lineEnd - 1) == '\r')
+            --lineEnd;
+        if (lineEnd == line) {
+            line = nextLine;
+            continue;
+        }
+
+        const char *fields[numberOfFields + 1];
+        auto numberOfSeparators = 0u;
+        fields[0] = line;
+        for (auto c = line; c != lineEnd; ++c) {
+            if (*c == ',') {
+                if (++numberOfSeparators >= numberOfFields)
+                    break;
+                fields[numberOfSeparators] = c + 1;
+            }
+        }
+        if (numberOfSeparators != numberOfFields - 1)
+            throw std::runtime_error("Expected " + std::to_string(numberOfFields) + " fields in metadata line: " + std::string(line, lineEnd));
+        fields[numberOfFields] = lineEnd + 1;
+
+        unsigned int values[numberOfFields - 2];
+        bool isNumeric = true;
+        for (auto i = 2u; i < numberOfFields; ++i) {
+            auto fieldEnd = fields[i + 1] - 1;
+            auto result = std::from_chars(fields[i], fieldEnd, values[i - 2]);
+            if (result.ec != std::errc() || result.ptr != fieldEnd) {
+                isNumeric = false;
+                break;
+            }
+        }
+
+        if (!isNumeric) {
+            // Only the first line of the file can be a header.
+            if (!mayStartWithHeader || lineNumber)
+                throw std::runtime_error("Malformed metadata line: " + std::string(line, lineEnd));
+        } else {
+            videoIds_.push_back(videoId(std::string(fields[0], fields[1] - 1)));
+            labelIds_.push_back(labelId(std::string(fields[1], fields[2] - 1)));
+            frames_.push_back(values[0]);
+            x1s_.push_back(values[1]);
+            y1s_.push_back(values[2]);
+            x2s_.push_back(values[3]);
+            y2s_.push_back(values[4]);
+        }
+        line = nextLine;
+    }
+}
+
+void BulkMetadata::add(const std::string &video, const std::string &label, unsigned int frame, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2) {
+    videoIds_.push_back(videoId(video));
+    labelIds_.push_back(labelId(label));
+    frames_.push_back(frame);
+    x1s_.push_back(x1);
+    y1s_.push_back(y1);
+    x2s_.push_back(x2);
+    y2s_.push_back(y2);
+}
+
+void BulkMetadata::append(const BulkMetadata &other) {
+    std::vector<unsigned int> otherVideoIds(other.videos_.size());
+    for (auto i = 0u; i < other.videos_.size(); ++i)
+        otherVideoIds[i] = videoId(other.videos_[i]);
+    std::vector<unsigned int> otherLabelIds(other.labels_.size());
+    for (auto i = 0u; i < other.labels_.size(); ++i)
+        otherLabelIds[i] = labelId(other.labels_[i]);
+
+    for (auto id : other.videoIds_)
+        videoIds_.push_back(otherVideoIds[id]);
+    for (auto id : other.labelIds_)
+        labelIds_.push_back(otherLabelIds[id]);
+    frames_.insert(frames_.end(), other.frames_.begin(), other.frames_.end());
+    x1s_.insert(x1s_.end(), other.x1s_.begin(), other.x1s_.end());
+    y1s_.insert(y1s_.end(), other.y1s_.begin(), other.y1s_.end());
+    x2s_.insert(x2s_.end(), other.x2s_.begin(), other.x2s_.end());
+    y2s_.insert(y2s_.end(), other.y2s_.begin(), other.y2s_.end());
+}
+
+void BulkMetadata::reserve(std::size_t numberOfRows) {
+    videoIds_.reserve(numberOfRows);
+    labelIds_.reserve(numberOfRows);
+    frames_.reserve(numberOfRows);
+    x1s_.reserve(numberOfRows);
+    y1s_.reserve(numberOfRows);
+    x2s_.reserve(numberOfRows);
+    y2s_.reserve(numberOfRows);
+}
+
+std::vector<std::size_t> BulkMetadata::sortedRows() const {
+    // Sort the dictionaries once so that rows are compared by integer ranks rather than by strings.
+    auto ranksForDictionary = [](const std::vector<std::string> &dictionary) {
+        std::vector<unsigned int> ids(dictionary.size());
+        std::iota(ids.begin(), ids.end(), 0);
+        std::sort(ids.begin(), ids.end(), [&](auto left, auto right) { return dictionary[left] < dictionary[right]; });
+        std::vector<unsigned int> ranks(dictionary.size());
+        for (auto rank = 0u; rank < ids.size(); ++rank)
+            ranks[ids[rank]] = rank;
+        return ranks;
+    };
+    auto videoRanks = ranksForDictionary(videos_);
+    auto labelRanks = ranksForDictionary(labels_);
+
+    std::vector<std::size_t> rows(size());
+    std::iota(rows.begin(), rows.end(), 0);
+    std::stable_sort(rows.begin(), rows.end(), [&](auto left, auto right) {
+        return std::make_tuple(videoRanks[videoIds_[left]], labelRanks[labelIds_[left]], frames_[left])
+                < std::make_tuple(videoRanks[videoIds_[right]], labelRanks[labelIds_[right]], frames_[right]);
+    });
+    return rows;
+}
+
+unsigned int BulkMetadata::videoId(const std::string &video) {
+    return idInDictionary(video, videos_, videoToId_);
+}
+
+unsigned int BulkMetadata::labelId(const std::string &label) {
+    return idInDictionary(label, labels_, labelToId_);
+}
+
+unsigned int BulkMetadata::idInDictionary(const std::string &value, std::vector<std::string> &dictionary, std::unordered_map<std::string, unsigned int> &ids) {
+    auto inserted = ids.emplace(value, dictionary.size());
+    if (inserted.second)
+        dictionary.push_back(value);
+    return inserted.first->second;
+}
+
+} // namespace tasm
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <stdexcept>
 
 #define ASSERT_SQLITE_OK(i) (assert(i == SQLITE_OK))
 #define ASSERT_SQLITE_DONE(i) (assert(i == SQLITE_DONE))
@@ -10,10 +11,10 @@ namespace tasm {
 
 void SemanticIndexSQLite::openDatabase(const std::experimental::filesystem::path &dbPath) {
     if (!std::experimental::filesystem::exists(dbPath)) {
-      ASSERT_SQLITE_OK(sqlite3_open_v2(dbPath.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL));
+      ASSERT_SQLITE_OK(sqlite3_open_v2(dbPath.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL));
       createTable();
     } else {
-      ASSERT_SQLITE_OK(sqlite3_open_v2(dbPath.c_str(), &db_, SQLITE_OPEN_READWRITE, NULL));
+      ASSERT_SQLITE_OK(sqlite3_open_v2(dbPath.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX, NULL));
     }
 
     return;
@@ -39,30 +40,48 @@ void SemanticIndexSQLite::createTable() {
 
     ASSERT_SQLITE_OK(sqlite3_exec(db_, "PRAGMA journal_mode=WAL;", 0, 0, 0));
 
+    createIndexes();
+}
+
+void SemanticIndexSQLite::createIndexes() {
     // Create index on video, label, frame.
-    const char *createIndex = "CREATE INDEX video_index ON labels (video, label, frame)";
-    result = sqlite3_exec(db_, createIndex, NULL, NULL, &error);
+    const char *createIndex = "CREATE INDEX IF NOT EXISTS video_index ON labels (video, label, frame)";
+    char *error = nullptr;
+    auto result = sqlite3_exec(db_, createIndex, NULL, NULL, &error);
     if (result != SQLITE_OK) {
         std::cerr << "Error creating index" << std::endl;
         sqlite3_free(error);
     }
 }
 
+void SemanticIndexSQLite::dropIndexes() {
+    ASSERT_SQLITE_OK(sqlite3_exec(db_, "DROP INDEX IF EXISTS video_index", NULL, NULL, NULL));
+}
+
 void SemanticIndexSQLite::closeDatabase() {
     ASSERT_SQLITE_OK(sqlite3_close(db_));
 }
 
 void SemanticIndexSQLite::initializeStatements() {
     // addMetadataStmt_
-    std::string query = "INSERT INTO labels (video, label, frame, x1, y1, x2, y2) VALUES (?, ?, ?, ?, ?, ?, ?)";
+    std::string query = insertQuery(1);
     ASSERT_SQLITE_OK(sqlite3_prepare_v2(db_, query.c_str(), query.length(), &addMetadataStmt_, nullptr));
 }
 
+std::string SemanticIndexSQLite::insertQuery(unsigned int numberOfRows) const {
+    std::string query = "INSERT INTO labels (video, label, frame, x1, y1, x2, y2) VALUES (?, ?, ?, ?, ?, ?, ?)";
+    for (auto i = 1u; i < numberOfRows; ++i)
+        query += ", (?, ?, ?, ?, ?, ?, ?)";
+    return query;
+}
+
 void SemanticIndexSQLite::destroyStatements() {
     ASSERT_SQLITE_OK(sqlite3_finalize(addMetadataStmt_));
 }
 
-void SemanticIndexSQLite::addMetadata(
+void SemanticIndexSQLite::bindMetadata(
+        sqlite3_stmt *stmt,
+        int firstParameter,
         const std::string &video,
         const std::string &label,
         unsigned int frame,
@@ -71,25 +90,104 @@ void SemanticIndexSQLite::addMetadata(
         unsigned int x2,
         unsigned int y2) {
 
-    ASSERT_SQLITE_OK(sqlite3_bind_text(addMetadataStmt_, 1, video.c_str(), -1, SQLITE_STATIC));
-    ASSERT_SQLITE_OK(sqlite3_bind_text(addMetadataStmt_, 2, label.c_str(), -1, SQLITE_STATIC));
-    ASSERT_SQLITE_OK(sqlite3_bind_int(addMetadataStmt_, 3, frame));
-    ASSERT_SQLITE_OK(sqlite3_bind_int(addMetadataStmt_, 4, x1));
-    ASSERT_SQLITE_OK(sqlite3_bind_int(addMetadataStmt_, 5, y1));
-    ASSERT_SQLITE_OK(sqlite3_bind_int(addMetadataStmt_, 6, x2));
-    ASSERT_SQLITE_OK(sqlite3_bind_int(addMetadataStmt_, 7, y2));
+    ASSERT_SQLITE_OK(sqlite3_bind_text(stmt, firstParameter, video.c_str(), -1, SQLITE_STATIC));
+    ASSERT_SQLITE_OK(sqlite3_bind_text(stmt, firstParameter + 1, label.c_str(), -1, SQLITE_STATIC));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(stmt, firstParameter + 2, frame));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(stmt, firstParameter + 3, x1));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(stmt, firstParameter + 4, y1));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(stmt, firstParameter + 5, x2));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(stmt, firstParameter + 6, y2));
+}
+
+void SemanticIndexSQLiteBase::addMetadata(
+        const std::string &video,
+        const std::string &label,
+        unsigned int frame,
+        unsigned int x1,
+        unsigned int y1,
+        unsigned int x2,
+        unsigned int y2) {
+    std::scoped_lock lock(writeMutex_);
+    bindMetadata(addMetadataStmt_, 1, video, label, frame, x1, y1, x2, y2);
 
     ASSERT_SQLITE_DONE(sqlite3_step(addMetadataStmt_));
     ASSERT_SQLITE_OK(sqlite3_reset(addMetadataStmt_));
 }
 
 void SemanticIndexSQLiteBase::addBulkMetadata(const std::vector<MetadataInfo> &metadataInfo) {
-    sqlite3_exec(db_, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+    BulkMetadata metadata;
+    metadata.reserve(metadataInfo.size());
     for (const auto &m : metadataInfo)
-        addMetadata(m.video, m.label, m.frame, m.x1, m.y1, m.x2, m.y2);
+        metadata.add(m.video, m.label, m.frame, m.x1, m.y1, m.x2, m.y2);
+    addBulkMetadata(metadata);
+}
+
+void SemanticIndexSQLiteBase::addBulkMetadata(const BulkMetadata &metadata) {
+    if (metadata.empty())
+        return;
+
+    // Older versions of SQLite allow at most 999 parameters per statement.
+    static const unsigned int maximumNumberOfParameters = 999;
+    const auto parametersPerRow = numberOfInsertParameters();
+    const auto rowsPerInsert = maximumNumberOfParameters / parametersPerRow;
+    auto query = insertQuery(rowsPerInsert);
+    sqlite3_stmt *insertRows;
+    ASSERT_SQLITE_OK(sqlite3_prepare_v2(db_, query.c_str(), query.length(), &insertRows, nullptr));
+
+    auto bindRow = [&](sqlite3_stmt *stmt, int firstParameter, std::size_t row) {
+        bindMetadata(stmt, firstParameter, metadata.video(row), metadata.label(row), metadata.frame(row),
+                metadata.x1(row), metadata.y1(row), metadata.x2(row), metadata.y2(row));
+    };
+
+    std::scoped_lock lock(writeMutex_);
+    sqlite3_exec(db_, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+
+    // Maintaining an index row by row is slower than building it once the rows are loaded, unless the table is already
+    // much larger than the load.
+    bool shouldDeferIndexes = metadata.size() >= approximateNumberOfRows();
+    if (shouldDeferIndexes)
+        dropIndexes();
+
+    // Inserting in index order keeps the table and index pages that are being written in cache.
+    auto rows = metadata.sortedRows();
+    auto row = rows.begin();
+    for (; static_cast<std::size_t>(rows.end() - row) >= rowsPerInsert; row += rowsPerInsert) {
+        for (auto i = 0u; i < rowsPerInsert; ++i)
+            bindRow(insertRows, 1 + i * parametersPerRow, row[i]);
+        ASSERT_SQLITE_DONE(sqlite3_step(insertRows));
+        ASSERT_SQLITE_OK(sqlite3_reset(insertRows));
+    }
+    ASSERT_SQLITE_OK(sqlite3_finalize(insertRows));
+
+    for (; row != rows.end(); ++row) {
+        bindRow(addMetadataStmt_, 1, *row);
+        ASSERT_SQLITE_DONE(sqlite3_step(addMetadataStmt_));
+        ASSERT_SQLITE_OK(sqlite3_reset(addMetadataStmt_));
+    }
+
+    if (shouldDeferIndexes)
+        createIndexes();
+
     sqlite3_exec(db_, "END TRANSACTION;", NULL, NULL, NULL);
 }
 
+std::size_t SemanticIndexSQLiteBase::approximateNumberOfRows() {
+    // Rows are only ever appended, so the largest rowid is close to the number of rows and is found without a scan.
+    const char *query = "SELECT MAX(rowid) FROM labels";
+    sqlite3_stmt *select;
+    ASSERT_SQLITE_OK(sqlite3_prepare_v2(db_, query, -1, &select, nullptr));
+
+    std::size_t numberOfRows = 0;
+    int result;
+    while ((result = sqlite3_step(select)) == SQLITE_ROW)
+        numberOfRows = sqlite3_column_int64(select, 0);
+
+    ASSERT_SQLITE_DONE(result);
+    ASSERT_SQLITE_OK(sqlite3_finalize(select));
+
+    return numberOfRows;
+}
+
 std::unique_ptr<std::vector<int>> SemanticIndexSQLite::orderedFramesForSelection(
         const std::string &video,
         std::shared_ptr<MetadataSelection> metadataSelection,
@@ -113,6 +211,9 @@ std::unique_ptr<std::vector<int>> SemanticIndexSQLite::orderedFramesForSelection
     assert(result == SQLITE_DONE);
     ASSERT_SQLITE_OK(sqlite3_finalize(select));
 
+    if (temporalSelection)
+        temporalSelection->filterOrderedFrames(*frames);
+
     return frames;
 }
 
@@ -162,12 +263,66 @@ std::unique_ptr<std::list<Rectangle>> SemanticIndexSQLite::rectanglesForQuery(sq
     return rectangles;
 }
 
+unsigned int SemanticIndexSQLite::countForSelection(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, std::shared_ptr<TemporalSelection> temporalSelection) {
+    // Only the frame and label columns are referenced, so this is answered from video_index without visiting the table.
+    std::string query = "SELECT COUNT(*) FROM labels WHERE video = ? AND " + metadataSelection->labelConstraints();
+    if (temporalSelection)
+        query += " AND " + temporalSelection->frameConstraints();
+
+    sqlite3_stmt *select;
+    ASSERT_SQLITE_OK(sqlite3_prepare_v2(db_, query.c_str(), query.length(), &select, nullptr));
+    ASSERT_SQLITE_OK(sqlite3_bind_text(select, 1, video.c_str(), -1, SQLITE_STATIC));
+
+    return countForQuery(select);
+}
+
+std::unique_ptr<std::map<int, unsigned int>> SemanticIndexSQLite::histogramForSelection(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, unsigned int bucketFrames, std::shared_ptr<TemporalSelection> temporalSelection) {
+    if (!bucketFrames)
+        throw std::invalid_argument("Histogram buckets must contain at least one frame");
+    std::string query = "SELECT (frame / ?) * ? AS bucket, COUNT(*) FROM labels WHERE video = ? AND " + metadataSelection->labelConstraints();
+    if (temporalSelection)
+        query += " AND " + temporalSelection->frameConstraints();
+    query += " GROUP BY bucket ORDER BY bucket ASC";
+
+    sqlite3_stmt *select;
+    ASSERT_SQLITE_OK(sqlite3_prepare_v2(db_, query.c_str(), query.length(), &select, nullptr));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(select, 1, bucketFrames));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(select, 2, bucketFrames));
+    ASSERT_SQLITE_OK(sqlite3_bind_text(select, 3, video.c_str(), -1, SQLITE_STATIC));
+
+    return histogramForQuery(select);
+}
+
+unsigned int SemanticIndexSQLiteBase::countForQuery(sqlite3_stmt *select) {
+    unsigned int count = 0;
+    int result;
+    while ((result = sqlite3_step(select)) == SQLITE_ROW)
+        count = sqlite3_column_int(select, 0);
+
+    ASSERT_SQLITE_DONE(result);
+    ASSERT_SQLITE_OK(sqlite3_finalize(select));
+
+    return count;
+}
+
+std::unique_ptr<std::map<int, unsigned int>> SemanticIndexSQLiteBase::histogramForQuery(sqlite3_stmt *select) {
+    auto histogram = std::make_unique<std::map<int, unsigned int>>();
+    int result;
+    while ((result = sqlite3_step(select)) == SQLITE_ROW)
+        (*histogram)[sqlite3_column_int(select, 0)] = sqlite3_column_int(select, 1);
+
+    ASSERT_SQLITE_DONE(result);
+    ASSERT_SQLITE_OK(sqlite3_finalize(select));
+
+    return histogram;
+}
+
 void SemanticIndexWH::openDatabase(const std::experimental::filesystem::path &dbPath) {
     if (!std::experimental::filesystem::exists(dbPath)) {
-        ASSERT_SQLITE_OK(sqlite3_open_v2(dbPath.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL));
+        ASSERT_SQLITE_OK(sqlite3_open_v2(dbPath.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL));
         createTable();
     } else {
-        ASSERT_SQLITE_OK(sqlite3_open_v2(dbPath.c_str(), &db_, SQLITE_OPEN_READWRITE, NULL));
+        ASSERT_SQLITE_OK(sqlite3_open_v2(dbPath.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX, NULL));
     }
 }
 
@@ -194,15 +349,24 @@ void SemanticIndexWH::closeDatabase() {
 
 void SemanticIndexWH::initializeStatements() {
     // addMetadataStmt_
-    std::string query = "INSERT INTO labels (label, frame, x, y, width, height) VALUES (?, ?, ?, ?, ?, ?)";
+    std::string query = insertQuery(1);
     ASSERT_SQLITE_OK(sqlite3_prepare_v2(db_, query.c_str(), query.length(), &addMetadataStmt_, nullptr));
 }
 
+std::string SemanticIndexWH::insertQuery(unsigned int numberOfRows) const {
+    std::string query = "INSERT INTO labels (label, frame, x, y, width, height) VALUES (?, ?, ?, ?, ?, ?)";
+    for (auto i = 1u; i < numberOfRows; ++i)
+        query += ", (?, ?, ?, ?, ?, ?)";
+    return query;
+}
+
 void SemanticIndexWH::destroyStatements() {
     ASSERT_SQLITE_OK(sqlite3_finalize(addMetadataStmt_));
 }
 
-void SemanticIndexWH::addMetadata(
+void SemanticIndexWH::bindMetadata(
+        sqlite3_stmt *stmt,
+        int firstParameter,
         const std::string &video,
         const std::string &label,
         unsigned int frame,
@@ -210,15 +374,12 @@ void SemanticIndexWH::addMetadata(
         unsigned int y1,
         unsigned int x2,
         unsigned int y2) {
-    ASSERT_SQLITE_OK(sqlite3_bind_text(addMetadataStmt_, 1, label.c_str(), -1, SQLITE_STATIC));
-    ASSERT_SQLITE_OK(sqlite3_bind_int(addMetadataStmt_, 2, frame));
-    ASSERT_SQLITE_OK(sqlite3_bind_int(addMetadataStmt_, 3, x1));
-    ASSERT_SQLITE_OK(sqlite3_bind_int(addMetadataStmt_, 4, y1));
-    ASSERT_SQLITE_OK(sqlite3_bind_int(addMetadataStmt_, 5, x2 - x1));
-    ASSERT_SQLITE_OK(sqlite3_bind_int(addMetadataStmt_, 6, y2 - y1));
-
-    ASSERT_SQLITE_DONE(sqlite3_step(addMetadataStmt_));
-    ASSERT_SQLITE_OK(sqlite3_reset(addMetadataStmt_));
+    ASSERT_SQLITE_OK(sqlite3_bind_text(stmt, firstParameter, label.c_str(), -1, SQLITE_STATIC));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(stmt, firstParameter + 1, frame));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(stmt, firstParameter + 2, x1));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(stmt, firstParameter + 3, y1));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(stmt, firstParameter + 4, x2 - x1));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(stmt, firstParameter + 5, y2 - y1));
 }
 
 std::unique_ptr<std::vector<int>> SemanticIndexWH::orderedFramesForSelection(
@@ -243,6 +404,9 @@ std::unique_ptr<std::vector<int>> SemanticIndexWH::orderedFramesForSelection(
     assert(result == SQLITE_DONE);
     ASSERT_SQLITE_OK(sqlite3_finalize(select));
 
+    if (temporalSelection)
+        temporalSelection->filterOrderedFrames(*frames);
+
     return frames;
 }
 
@@ -284,4 +448,31 @@ std::unique_ptr<std::list<Rectangle>> SemanticIndexWH::rectanglesForQuery(sqlite
     return rectangles;
 }
 
+unsigned int SemanticIndexWH::countForSelection(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, std::shared_ptr<TemporalSelection> temporalSelection) {
+    std::string query = "SELECT COUNT(*) FROM labels WHERE " + metadataSelection->labelConstraints();
+    if (temporalSelection)
+        query += " AND " + temporalSelection->frameConstraints();
+
+    sqlite3_stmt *select;
+    ASSERT_SQLITE_OK(sqlite3_prepare_v2(db_, query.c_str(), query.length(), &select, nullptr));
+
+    return countForQuery(select);
+}
+
+std::unique_ptr<std::map<int, unsigned int>> SemanticIndexWH::histogramForSelection(const std::string &video, std::shared_ptr<MetadataSelection> metadataSelection, unsigned int bucketFrames, std::shared_ptr<TemporalSelection> temporalSelection) {
+    if (!bucketFrames)
+        throw std::invalid_argument("Histogram buckets must contain at least one frame");
+    std::string query = "SELECT (frame / ?) * ? AS bucket, COUNT(*) FROM labels WHERE " + metadataSelection->labelConstraints();
+    if (temporalSelection)
+        query += " AND " + temporalSelection->frameConstraints();
+    query += " GROUP BY bucket ORDER BY bucket ASC";
+
+    sqlite3_stmt *select;
+    ASSERT_SQLITE_OK(sqlite3_prepare_v2(db_, query.c_str(), query.length(), &select, nullptr));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(select, 1, bucketFrames));
+    ASSERT_SQLITE_OK(sqlite3_bind_int(select, 2, bucketFrames));
+
+    return histogramForQuery(select);
+}
+
 } // namespace tasm
\ No newline at end of file
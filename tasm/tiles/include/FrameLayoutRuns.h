@@ -0,0 +1,64 @@
+#ifndef TASM_FRAMELAYOUTRUNS_H
+#define TASM_FRAMELAYOUTRUNS_H
+
+#include "TileLayout.h"
+#include "TileManifest.h"
+#include "TileStorageFormat.h"
+
+#include <algorithm>
+#include <cassert>
+#include <experimental/filesystem>
+#include <memory>
+#include <vector>
+
+namespace tasm {
+
+// Maps frames to the most recent tile directory that contains them. Consecutive frames that are stored in the same
+// directory share a run, so there are at most twice as many runs as tile directories. It never changes after it is
+// built so that it can be read without locking. TileManifestCache builds one for each version of a video's manifest,
+// and every query that reads that version shares it.
+class FrameLayoutRuns {
+public:
+    struct Run {
+        unsigned int firstFrame;
+        // -1 when no tile directory contains the frames in the run.
+        int layoutId;
+        std::shared_ptr<TileLayout> layout;
+        std::experimental::filesystem::path directory;
+        TileStorageFormat storageFormat;
+    };
+
+    explicit FrameLayoutRuns(std::vector<Run> runs, unsigned int largestWidth = 0, unsigned int largestHeight = 0)
+        : runs_(std::move(runs)),
+        largestWidth_(largestWidth),
+        largestHeight_(largestHeight)
+    {}
+
+    static std::shared_ptr<const FrameLayoutRuns> forManifest(const std::experimental::filesystem::path &videoPath, const TileManifest &manifest);
+
+    const Run &runForFrame(unsigned int frame) const {
+        // Find the last run that starts at or before the frame.
+        auto it = std::upper_bound(runs_.begin(), runs_.end(), frame, [](unsigned int frame, const Run &run) {
+            return frame < run.firstFrame;
+        });
+        assert(it != runs_.begin());
+        const auto &run = *std::prev(it);
+        assert(run.layoutId != -1);
+        return run;
+    }
+
+    const std::vector<Run> &runs() const { return runs_; }
+
+    // The largest tile of any directory's layout, including directories that newer ones shadow.
+    unsigned int largestWidth() const { return largestWidth_; }
+    unsigned int largestHeight() const { return largestHeight_; }
+
+private:
+    std::vector<Run> runs_;
+    unsigned int largestWidth_;
+    unsigned int largestHeight_;
+};
+
+} // namespace tasm
+
+#endif //TASM_FRAMELAYOUTRUNS_H
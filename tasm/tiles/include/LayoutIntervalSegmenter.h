@@ -0,0 +1,41 @@
+#ifndef TASM_LAYOUTINTERVALSEGMENTER_H
+#define TASM_LAYOUTINTERVALSEGMENTER_H
+
+#include "CostModel.h"
+#include "LayoutIntervals.h"
+#include "WorkloadCostEstimator.h"
+
+namespace tasm {
+
+// Chooses layout intervals from how a workload's objects move. Frames are grouped into blocks of the minimum interval
+// length, and intervals are made of whole blocks.
+// An interval's decode cost follows OptimizedTileConfigurationProvider's model, where each query decodes the CTB-sized
+// cells that its objects cover anywhere in the interval, from the keyframe through the last frame with one of its
+// objects. Slow objects cover about the same cells over a long interval as over a short one, so long intervals cost
+// little more to decode. Fast objects sweep across more cells the longer an interval is. Each interval also has the
+// profile's fixed cost of encoding a GOP, so an interval is only split when that saves more decode time.
+// The cheapest segmentation is found by dynamic programming over the block boundaries.
+class LayoutIntervalSegmenter {
+public:
+    LayoutIntervalSegmenter(std::shared_ptr<Workload> workload,
+                            unsigned int frameWidth,
+                            unsigned int frameHeight,
+                            unsigned int minimumIntervalLength,
+                            unsigned int maximumIntervalLength,
+                            const CostProfile &costProfile = CostModel::instance().profile());
+
+    // Intervals after the last frame with objects are the maximum length.
+    LayoutIntervals segment() const;
+
+private:
+    std::shared_ptr<Workload> workload_;
+    unsigned int frameWidth_;
+    unsigned int frameHeight_;
+    unsigned int minimumIntervalLength_;
+    unsigned int maximumIntervalLength_;
+    CostProfile costProfile_;
+};
+
+} // namespace tasm
+
+#endif //TASM_LAYOUTINTERVALSEGMENTER_H
@@ -0,0 +1,55 @@
+#ifndef TASM_LAYOUTINTERVALS_H
+#define TASM_LAYOUTINTERVALS_H
+
+#include <experimental/filesystem>
+#include <vector>
+
+namespace tasm {
+
+// Divides a video into consecutive intervals that each have one tile layout and start with a keyframe, so every
+// interval is also a GOP. Intervals start at each of the explicit first frames, and after the last of those they
+// repeat every `lengthAfterLastInterval` frames.
+class LayoutIntervals {
+public:
+    // Intervals that are all `length` frames long, starting at frame 0.
+    explicit LayoutIntervals(unsigned int length)
+        : LayoutIntervals({0}, length)
+    {}
+
+    // firstFrames must start with 0 and be strictly increasing.
+    LayoutIntervals(std::vector<unsigned int> firstFrames, unsigned int lengthAfterLastInterval);
+
+    unsigned int intervalForFrame(unsigned int frame) const;
+    unsigned int firstFrameOfInterval(unsigned int interval) const;
+    unsigned int lengthOfInterval(unsigned int interval) const {
+        return firstFrameOfInterval(interval + 1) - firstFrameOfInterval(interval);
+    }
+    bool isFirstFrameOfInterval(unsigned int frame) const {
+        return firstFrameOfInterval(intervalForFrame(frame)) == frame;
+    }
+
+    bool isUniform() const { return firstFrames_.size() == 1; }
+    unsigned int longestInterval() const;
+
+    const std::vector<unsigned int> &firstFrames() const { return firstFrames_; }
+    unsigned int lengthAfterLastInterval() const { return lengthAfterLastInterval_; }
+
+    bool operator==(const LayoutIntervals &other) const {
+        return firstFrames_ == other.firstFrames_ && lengthAfterLastInterval_ == other.lengthAfterLastInterval_;
+    }
+
+    // Records the intervals in the video's catalog directory.
+    void write(const std::experimental::filesystem::path &videoPath) const;
+
+    // Returns the intervals that the video was stored with, or intervals of `defaultLength` frames for videos that did
+    // not record them.
+    static LayoutIntervals read(const std::experimental::filesystem::path &videoPath, unsigned int defaultLength);
+
+private:
+    std::vector<unsigned int> firstFrames_;
+    unsigned int lengthAfterLastInterval_;
+};
+
+} // namespace tasm
+
+#endif //TASM_LAYOUTINTERVALS_H
@@ -0,0 +1,68 @@
+#ifndef TASM_OPTIMIZEDTILECONFIGURATIONPROVIDER_H
+#define TASM_OPTIMIZEDTILECONFIGURATIONPROVIDER_H
+
+#include "CostModel.h"
+#include "TileConfigurationProvider.h"
+#include "WorkloadCostEstimator.h"
+
+namespace tasm {
+
+// Chooses each GOP's layout by minimizing the estimated cost of decoding a workload's objects, using the same model as
+// WorkloadCostEstimator: a query decodes every tile that one of its objects intersects, from the keyframe through the
+// last frame where an object intersects that tile.
+// Tile boundaries are searched at every CTB (32 pixel) boundary. With the rows fixed, the cost of a layout is a sum
+// over its columns, so the best columns are found exactly by dynamic programming over the boundaries, and vice versa.
+// The search alternates between the two until the cost stops improving. A single tile is always a candidate, so GOPs
+// where tiling does not pay off are not tiled.
+class OptimizedTileConfigurationProvider : public TileLayoutProvider {
+public:
+    OptimizedTileConfigurationProvider(unsigned int tileLayoutDuration,
+                                       std::shared_ptr<Workload> workload,
+                                       unsigned int frameWidth,
+                                       unsigned int frameHeight)
+        : OptimizedTileConfigurationProvider(LayoutIntervals(tileLayoutDuration), workload, frameWidth, frameHeight)
+    {}
+
+    OptimizedTileConfigurationProvider(LayoutIntervals layoutIntervals,
+                                       std::shared_ptr<Workload> workload,
+                                       unsigned int frameWidth,
+                                       unsigned int frameHeight);
+
+    std::shared_ptr<TileLayout> tileLayoutForFrame(unsigned int frame) override;
+
+    // The estimated cost for the workload to decode the frame's GOP with the layout that was chosen.
+    double estimatedCostForFrame(unsigned int frame);
+
+    // The layout with the lowest estimated cost for the GOP's objects. If cost is not null, it is set to that cost.
+    static std::shared_ptr<TileLayout> layoutForWorkload(const GOPWorkload &gopWorkload, unsigned int frameWidth, unsigned int frameHeight, const CostProfile &costProfile, double *cost = nullptr);
+
+    static double estimatedCost(const CostElements &costElements, const CostProfile &costProfile) {
+        return costProfile.decodeCost(costElements.numPixels, costElements.numTiles);
+    }
+
+    // Tiles are at least this large, matching FineGrainedTileConfigurationProvider.
+    static constexpr unsigned int MinimumTileWidth = 256;
+    static constexpr unsigned int MinimumTileHeight = 160;
+
+    // The most tile columns and rows that HEVC allows at the lowest level that supports a frame of this size.
+    static std::pair<unsigned int, unsigned int> maximumNumberOfColumnsAndRows(unsigned int frameWidth, unsigned int frameHeight);
+
+private:
+    struct GOPLayout {
+        std::shared_ptr<TileLayout> layout;
+        double cost;
+    };
+
+    const GOPLayout &layoutForGOP(unsigned int gop);
+
+    LayoutIntervals layoutIntervals_;
+    std::shared_ptr<Workload> workload_;
+    unsigned int frameWidth_;
+    unsigned int frameHeight_;
+    CostProfile costProfile_;
+    std::unordered_map<unsigned int, GOPLayout> gopToLayout_;
+};
+
+} // namespace tasm
+
+#endif //TASM_OPTIMIZEDTILECONFIGURATIONPROVIDER_H
@@ -1,29 +1,93 @@
 #ifndef TASM_REGRETACCUMULATOR_H
 #define TASM_REGRETACCUMULATOR_H
 
+#include "CostModel.h"
 #include "TileConfigurationProvider.h"
 #include "WorkloadCostEstimator.h"
+#include <experimental/filesystem>
+#include <fstream>
 #include <unordered_set>
 
 namespace tasm {
 class SemanticIndex;
 
+// A GOP whose regret for a layout exceeds the threshold.
+struct GOPRetileCandidate {
+    unsigned int gop;
+    std::string layoutIdentifier;
+    // How far the regret exceeds the threshold's share of the cost to re-encode the GOP.
+    double excessRegret;
+    // The estimated time to decode and re-encode the GOP, in milliseconds.
+    double estimatedCostToRetile;
+};
+
 class RegretAccumulator {
 public:
     RegretAccumulator(std::shared_ptr<SemanticIndex> semanticIndex, const std::string &metadataIdentifier,
             unsigned int width, unsigned int height, unsigned int gopLength, double threshold = 1.0)
+        : RegretAccumulator(semanticIndex, metadataIdentifier, width, height, LayoutIntervals(gopLength), threshold)
+    {}
+
+    RegretAccumulator(std::shared_ptr<SemanticIndex> semanticIndex, const std::string &metadataIdentifier,
+            unsigned int width, unsigned int height, LayoutIntervals gops, double threshold = 1.0)
         : semanticIndex_(semanticIndex), metadataIdentifier_(metadataIdentifier),
-        width_(width), height_(height), gopLength_(gopLength), threshold_(threshold),
-        gopSizeInPixels_(width_ * height_ * gopLength_),
-        gopTilingCost_(estimateCostToEncodeGOP(gopSizeInPixels_)),
+        width_(width), height_(height), gops_(std::move(gops)), threshold_(threshold),
+        costProfile_(CostModel::instance().profile()),
         queryIteration_(0),
-        noTilesConfiguration_(new SingleTileConfigurationProvider(width_, height_)) {}
+        numberOfLayoutCostEstimates_(0),
+        noTilesConfiguration_(new SingleTileConfigurationProvider(width_, height_)),
+        numberOfRecords_(0),
+        numberOfRecordsSinceSnapshot_(0),
+        isReplaying_(false) {}
 
     void addRegretForQuery(std::shared_ptr<Workload> workload, std::shared_ptr<TileLayoutProvider> currentLayout);
     std::unique_ptr<std::unordered_map<unsigned int, std::shared_ptr<TileLayoutProvider>>> getNewGOPLayouts();
 
+    // Lists the GOPs that getNewGOPLayouts() would re-tile without resetting their regret, so that they can be re-tiled
+    // one at a time.
+    std::vector<GOPRetileCandidate> retileCandidates() const;
+    // The layout to re-tile a candidate GOP with. Its regret is kept until gopWasRetiled().
+    std::shared_ptr<TileLayoutProvider> layoutForGOP(unsigned int gop, const std::string &layoutIdentifier);
+    // Resets the GOP's regret. Call this once the GOP's new tiles are committed so that a GOP whose re-tiling fails
+    // keeps its regret and is retried.
+    void gopWasRetiled(unsigned int gop);
+
+    // The number of times a layout's costs were estimated for a predicate rather than found in the cache.
+    unsigned int numberOfLayoutCostEstimates() const { return numberOfLayoutCostEstimates_; }
+
+    // Restores the state that was saved in the video's directory, if it was saved for the same metadata identifier and
+    // dimensions, and saves the state there from now on. Each query and re-tiled GOP is appended to a log, and every
+    // RecordsPerSnapshot records the whole state is written to a snapshot and the log is cleared.
+    // Regret in the snapshot is restored as it was accumulated, while queries in the log are replayed with the current
+    // cost profile.
+    void persistTo(const std::experimental::filesystem::path &videoPath);
+
+    static constexpr unsigned int RecordsPerSnapshot = 64;
+    static constexpr unsigned int SnapshotFormatVersion = 2;
+    // Past queries are kept to add their regret to layouts for objects that are queried later. Only the most recent
+    // ones are kept so that the state, and each snapshot of it, does not grow with the number of queries. The regret
+    // of a forgotten query stays with the layouts that existed when it was forgotten.
+    static constexpr unsigned int MaximumNumberOfRememberedQueries = 256;
+
 private:
-    bool shouldRetileGOP(unsigned int gop, std::string &layoutIdentifier);
+    using GOPCosts = std::unordered_map<unsigned int, CostElements>;
+    static constexpr auto NoTilesLayoutIdentifier = "";
+
+    std::shared_ptr<const GOPCosts> costsForLayout(const std::string &predicate, std::shared_ptr<Workload> workload, const std::string &layoutIdentifier);
+    void forgetIteration(unsigned int iteration);
+    void forgetOldestIterations();
+    void addRegretForQueryWithBaselineCosts(std::shared_ptr<Workload> workload, std::shared_ptr<GOPCosts> baselineCosts);
+    void addLayout(const std::string &label, const std::vector<std::string> &objects);
+
+    std::shared_ptr<Workload> workloadForQuery(const std::vector<std::string> &objects, const std::string &temporalSelection) const;
+    void loadState();
+    bool readSnapshot(std::istream &input);
+    bool replayRecord(std::istream &record, unsigned long long snapshotRecords);
+    void writeSnapshot();
+    void appendRecord(const std::string &record);
+
+    bool shouldRetileGOP(unsigned int gop, std::string &layoutIdentifier) const;
+    double maximumRegretForGOP(unsigned int gop, std::string &layoutIdentifier) const;
     void resetRegretForGOP(unsigned int gop);
     std::shared_ptr<TileLayoutProvider> configurationProviderForIdentifier(const std::string &identifier);
 
@@ -37,10 +101,10 @@ private:
             const std::vector<std::string> layouts);
     void addRegretToGOP(unsigned int gop, double regret, const std::string &layoutIdentifier);
     double estimateCostToEncodeGOP(long long int sizeInPixels) const {
-        static double pixelCoef = 3.206e-06;
-        static double pixelIntercept = 2.592;
-
-        return pixelCoef * gopSizeInPixels_ + pixelIntercept;
+        return costProfile_.encodeCostForGOP(sizeInPixels);
+    }
+    long long int sizeOfGOPInPixels(unsigned int gop) const {
+        return static_cast<long long int>(width_) * height_ * gops_.lengthOfInterval(gop);
     }
 
     std::shared_ptr<SemanticIndex> semanticIndex_;
@@ -48,24 +112,45 @@ private:
 
     unsigned int width_;
     unsigned int height_;
-    unsigned int gopLength_;
+    LayoutIntervals gops_;
 
     double threshold_;
+    // Refreshed for each query so that regret follows the cost model as queries refine it.
+    CostProfile costProfile_;
     std::vector<std::string> labels_;
     std::unordered_map<std::string, std::shared_ptr<TileLayoutProvider>> idToConfig_;
+    std::unordered_map<std::string, std::vector<std::string>> idToObjects_;
 
-    long long int gopSizeInPixels_;
-    double gopTilingCost_;
     std::unordered_map<unsigned int, std::unordered_map<std::string, double>> gopToRegret_;
 
     unsigned int queryIteration_;
     std::unordered_map<unsigned int, unsigned int> gopToClearedIteration_;
     std::unordered_map<unsigned int, std::shared_ptr<Workload>> iterationToWorkload_;
     std::unordered_map<unsigned int, std::shared_ptr<std::unordered_map<unsigned int, CostElements>>> iterationToBaselineCosts_;
+
+    // Queries with the same predicate decode the same tiles of a layout, so the estimated cost of each GOP that a
+    // predicate touches is computed once per layout and shared by every iteration with that predicate.
+    // predicateToLayoutCosts_[predicate][layout] is dropped once no remaining iteration has the predicate.
+    std::unordered_map<std::string, std::unordered_map<std::string, std::shared_ptr<const GOPCosts>>> predicateToLayoutCosts_;
+    std::unordered_map<std::string, unsigned int> predicateToNumberOfIterations_;
+    std::unordered_map<unsigned int, std::string> iterationToPredicate_;
+    // Consecutive queries with the same predicate usually have the same baseline costs, which they then share, so that
+    // the snapshot only writes them once.
+    std::unordered_map<std::string, unsigned int> predicateToLatestIteration_;
+    unsigned int numberOfLayoutCostEstimates_;
     std::unordered_set<std::string> allObjects_;
     std::unordered_set<std::string> singleObjects_;
 
     std::shared_ptr<SingleTileConfigurationProvider> noTilesConfiguration_;
+
+    // Empty when the state is not saved.
+    std::experimental::filesystem::path videoPath_;
+    std::ofstream log_;
+    // Records are numbered so that ones that are already in the snapshot are skipped if the process stopped after
+    // writing the snapshot but before clearing the log.
+    unsigned long long numberOfRecords_;
+    unsigned int numberOfRecordsSinceSnapshot_;
+    bool isReplaying_;
 };
 
 } // namespace tasm
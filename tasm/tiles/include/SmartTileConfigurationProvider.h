@@ -1,6 +1,7 @@
 #ifndef TASM_SMARTTILECONFIGURATIONPROVIDER_H
 #define TASM_SMARTTILECONFIGURATIONPROVIDER_H
 
+#include "OptimizedTileConfigurationProvider.h"
 #include "TileConfigurationProvider.h"
 #include "WorkloadCostEstimator.h"
 
@@ -14,11 +15,20 @@ public:
             std::shared_ptr<SemanticDataManager> semanticDataManager,
             unsigned int frameWidth,
             unsigned int frameHeight)
-            : fineGrainedLayoutProvider_(new FineGrainedTileConfigurationProvider(tileLayoutDuration, semanticDataManager, frameWidth, frameHeight)),
+            : SmartTileConfigurationProviderSingleSelection(LayoutIntervals(tileLayoutDuration), semanticDataManager, frameWidth, frameHeight)
+    {}
+
+    SmartTileConfigurationProviderSingleSelection(
+            const LayoutIntervals &layoutIntervals,
+            std::shared_ptr<SemanticDataManager> semanticDataManager,
+            unsigned int frameWidth,
+            unsigned int frameHeight)
+            : fineGrainedLayoutProvider_(new FineGrainedTileConfigurationProvider(layoutIntervals, semanticDataManager, frameWidth, frameHeight)),
             singleTileLayoutProvider_(new SingleTileConfigurationProvider(frameWidth, frameHeight)),
             workload_(new Workload(semanticDataManager)),
-            fineGrainedWorkloadCostEstimator_(new WorkloadCostEstimator(fineGrainedLayoutProvider_, workload_, tileLayoutDuration)),
-            untiledWorkloadCostEstimator_(new WorkloadCostEstimator(singleTileLayoutProvider_, workload_, tileLayoutDuration)),
+            fineGrainedWorkloadCostEstimator_(new WorkloadCostEstimator(fineGrainedLayoutProvider_, workload_, layoutIntervals)),
+            untiledWorkloadCostEstimator_(new WorkloadCostEstimator(singleTileLayoutProvider_, workload_, layoutIntervals)),
+            pixelThreshold_(CostModel::instance().profile().tilingPixelThreshold),
             fineGrainedLayoutCostByGOP_(new std::unordered_map<unsigned int, CostElements>()),
             untiledCostByGOP_(new std::unordered_map<unsigned int, CostElements>()) {
         // TODO: Do this work incrementally rather than in constructor.
@@ -36,12 +46,60 @@ private:
     std::shared_ptr<WorkloadCostEstimator> untiledWorkloadCostEstimator_;
 
     std::unordered_map<unsigned int, std::shared_ptr<TileLayout>> gopToLayout_;
-    constexpr static const double pixelThreshold_ = 0.8;
+    const double pixelThreshold_;
 
     std::unique_ptr<std::unordered_map<unsigned int, CostElements>> fineGrainedLayoutCostByGOP_;
     std::unique_ptr<std::unordered_map<unsigned int, CostElements>> untiledCostByGOP_;
 };
 
+// Chooses each GOP's layout, or no tiling, by the estimated cost of running every query in the workload against it,
+// weighted by how often each query runs. The candidates are a single tile, fine-grained tiles around all of the
+// workload's objects, fine-grained tiles around each query's objects, and the layout that
+// OptimizedTileConfigurationProvider searches for. A GOP's objects are read from the index once, and every candidate is
+// costed from them.
+class WorkloadTileConfigurationProvider : public TileLayoutProvider {
+public:
+    WorkloadTileConfigurationProvider(unsigned int tileLayoutDuration,
+                                      std::shared_ptr<Workload> workload,
+                                      unsigned int frameWidth,
+                                      unsigned int frameHeight)
+            : WorkloadTileConfigurationProvider(LayoutIntervals(tileLayoutDuration), workload, frameWidth, frameHeight)
+    {}
+
+    WorkloadTileConfigurationProvider(LayoutIntervals layoutIntervals,
+                                      std::shared_ptr<Workload> workload,
+                                      unsigned int frameWidth,
+                                      unsigned int frameHeight)
+            : layoutIntervals_(std::move(layoutIntervals)),
+            workload_(workload),
+            frameWidth_(frameWidth),
+            frameHeight_(frameHeight),
+            costProfile_(CostModel::instance().profile()),
+            singleTileLayout_(std::make_shared<TileLayout>(1, 1, std::vector<unsigned int>{frameWidth}, std::vector<unsigned int>{frameHeight}))
+    {}
+
+    std::shared_ptr<TileLayout> tileLayoutForFrame(unsigned int frame) override;
+
+    // The estimated cost for the workload to decode the frame's GOP with the layout that was chosen.
+    double estimatedCostForFrame(unsigned int frame);
+
+private:
+    struct GOPLayout {
+        std::shared_ptr<TileLayout> layout;
+        double cost;
+    };
+
+    const GOPLayout &layoutForGOP(unsigned int gop);
+
+    LayoutIntervals layoutIntervals_;
+    std::shared_ptr<Workload> workload_;
+    unsigned int frameWidth_;
+    unsigned int frameHeight_;
+    CostProfile costProfile_;
+    std::shared_ptr<TileLayout> singleTileLayout_;
+    std::unordered_map<unsigned int, GOPLayout> gopToLayout_;
+};
+
 } // namespace tasm
 
 #endif //TASM_SMARTTILECONFIGURATIONPROVIDER_H
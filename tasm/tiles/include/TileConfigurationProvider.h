@@ -3,8 +3,11 @@
 
 #include "Configuration.h"
 #include "Interval.h"
+#include "LayoutIntervals.h"
 #include "TileLayout.h"
 
+#include <mutex>
+
 namespace tasm {
 class SemanticDataManager;
 
@@ -76,36 +79,53 @@ public:
                                         std::shared_ptr<SemanticDataManager> semanticDataManager,
                                         unsigned int frameWidth,
                                         unsigned int frameHeight)
-        : tileLayoutDuration_(tileLayoutDuration),
+        : FineGrainedTileConfigurationProvider(LayoutIntervals(tileLayoutDuration), semanticDataManager, frameWidth, frameHeight)
+    {}
+
+    FineGrainedTileConfigurationProvider(LayoutIntervals layoutIntervals,
+                                        std::shared_ptr<SemanticDataManager> semanticDataManager,
+                                        unsigned int frameWidth,
+                                        unsigned int frameHeight)
+        : layoutIntervals_(std::move(layoutIntervals)),
         semanticDataManager_(semanticDataManager),
         frameWidth_(frameWidth),
         frameHeight_(frameHeight) {}
 
     std::shared_ptr<TileLayout> tileLayoutForFrame(unsigned int frame) override;
 
+    // The fine-grained layout around the rectangles.
+    static std::shared_ptr<TileLayout> layoutForRectangles(const std::vector<Rectangle> &rectangles, unsigned int frameWidth, unsigned int frameHeight);
+
 private:
-    std::vector<unsigned int> tileDimensions(const std::vector<interval::Interval<int>> &sortedIntervals, int minDistance, int totalDimension);
+    static std::vector<unsigned int> tileDimensions(const std::vector<interval::Interval<int>> &sortedIntervals, int minDistance, int totalDimension);
 
-    unsigned int tileLayoutDuration_;
+    LayoutIntervals layoutIntervals_;
     std::shared_ptr<SemanticDataManager> semanticDataManager_;
     unsigned int frameWidth_;
     unsigned int frameHeight_;
+
+    // Regret accounting and re-tiling share these providers, and re-tiling does not hold the regret lock.
+    std::mutex mutex_;
     std::unordered_map<unsigned int, std::shared_ptr<TileLayout>> tileGroupToTileLayout_;
 };
 
 class ConglomerationTileConfigurationProvider : public TileLayoutProvider {
 public:
     ConglomerationTileConfigurationProvider(std::unique_ptr<std::unordered_map<unsigned int, std::shared_ptr<TileLayoutProvider>>> gopToLayoutProvider, unsigned int gopLength)
+        : ConglomerationTileConfigurationProvider(std::move(gopToLayoutProvider), LayoutIntervals(gopLength))
+    {}
+
+    ConglomerationTileConfigurationProvider(std::unique_ptr<std::unordered_map<unsigned int, std::shared_ptr<TileLayoutProvider>>> gopToLayoutProvider, LayoutIntervals gops)
         : gopToLayoutProvider_(std::move(gopToLayoutProvider)),
-        gopLength_(gopLength) {}
+        gops_(std::move(gops)) {}
 
     std::shared_ptr<TileLayout> tileLayoutForFrame(unsigned int frame) override {
-        return gopToLayoutProvider_->at(frame / gopLength_)->tileLayoutForFrame(frame);
+        return gopToLayoutProvider_->at(gops_.intervalForFrame(frame))->tileLayoutForFrame(frame);
     }
 
 private:
     std::unique_ptr<std::unordered_map<unsigned int, std::shared_ptr<TileLayoutProvider>>> gopToLayoutProvider_;
-    unsigned int gopLength_;
+    LayoutIntervals gops_;
 };
 
 } // namespace tasm
@@ -2,9 +2,17 @@
 #define TASM_TILELAYOUT_H
 
 #include "Rectangle.h"
+#include <boost/dynamic_bitset.hpp>
 #include <numeric>
 
 namespace tasm {
+
+// Bit i is set when tile i is selected.
+using TileMask = boost::dynamic_bitset<>;
+
+// Layouts do not change after they are constructed, so the offsets of the columns and rows are computed once. This
+// makes finding a tile's rectangle constant time and finding the tiles that a rectangle intersects logarithmic in the
+// number of columns and rows.
 class TileLayout {
 public:
 
@@ -16,8 +24,10 @@ public:
               numberOfRows_(numberOfRows),
               widthsOfColumns_(widthsOfColumns),
               heightsOfRows_(heightsOfRows),
-              largestWidth_(0),
-              largestHeight_(0) {}
+              columnOffsets_(offsets(widthsOfColumns_)),
+              rowOffsets_(offsets(heightsOfRows_)),
+              largestWidth_(widthsOfColumns_.empty() ? 0 : *std::max_element(widthsOfColumns_.begin(), widthsOfColumns_.end())),
+              largestHeight_(heightsOfRows_.empty() ? 0 : *std::max_element(heightsOfRows_.begin(), heightsOfRows_.end())) {}
 
     TileLayout(const TileLayout &other) = default;
     TileLayout() = delete;
@@ -57,26 +67,18 @@ public:
     }
 
     unsigned int totalHeight() const {
-        return std::accumulate(heightsOfRows_.begin(), heightsOfRows_.end(), 0);
+        return rowOffsets_.back();
     }
 
     unsigned int totalWidth() const {
-        return std::accumulate(widthsOfColumns_.begin(), widthsOfColumns_.end(), 0);
+        return columnOffsets_.back();
     }
 
     unsigned int largestWidth() const {
-        if (largestWidth_)
-            return largestWidth_;
-
-        largestWidth_ = *std::max_element(widthsOfColumns_.begin(), widthsOfColumns_.end());
         return largestWidth_;
     }
 
     unsigned int largestHeight() const {
-        if (largestHeight_)
-            return largestHeight_;
-
-        largestHeight_ = *std::max_element(heightsOfRows_.begin(), heightsOfRows_.end());
         return largestHeight_;
     }
 
@@ -85,15 +87,21 @@ public:
         unsigned int column = tile % numberOfColumns_;
         unsigned int row = tile / numberOfColumns_;
 
-        // Create bounding rectangle for tile.
-        unsigned int leftXForTile = std::accumulate(widthsOfColumns_.begin(), widthsOfColumns_.begin() + column, 0);
-        unsigned int topYForTile = std::accumulate(heightsOfRows_.begin(), heightsOfRows_.begin() + row, 0);
-
-        return Rectangle{0, leftXForTile, topYForTile, widthsOfColumns_[column], heightsOfRows_[row]};
+        return Rectangle{0, columnOffsets_[column], rowOffsets_[row], widthsOfColumns_[column], heightsOfRows_[row]};
     }
 
+    // Returns the tiles that intersect the rectangle in ascending order. Matches Rectangle::intersects().
     std::vector<unsigned int> tilesForRectangle(const Rectangle &rectangle) const;
 
+    // Returns a mask with a bit set for every tile that intersects any of the rectangles.
+    template <typename Rectangles>
+    TileMask tilesForRectangles(const Rectangles &rectangles) const {
+        TileMask mask(numberOfTiles());
+        for (const auto &rectangle : rectangles)
+            addTilesForRectangle(rectangle, mask);
+        return mask;
+    }
+
     std::vector<unsigned int>
     rectangleIdsThatIntersectTile(const std::vector<Rectangle> &rectangles, unsigned int tile) const {
         Rectangle tileRectangle = rectangleForTile(tile);
@@ -128,10 +136,27 @@ protected:
     std::vector<unsigned int> widthsOfColumns_;
     std::vector<unsigned int> heightsOfRows_;
 
-    mutable unsigned int largestWidth_;
-    mutable unsigned int largestHeight_;
+    // offsets[i] is the position where column/row i starts, and offsets.back() is the total width/height.
+    std::vector<unsigned int> columnOffsets_;
+    std::vector<unsigned int> rowOffsets_;
+
+    unsigned int largestWidth_;
+    unsigned int largestHeight_;
 
 private:
+    void addTilesForRectangle(const Rectangle &rectangle, TileMask &mask) const;
+
+    // Returns the half-open range [first, last) of the columns/rows that overlap [start, start + length).
+    static std::pair<unsigned int, unsigned int> overlappingRange(const std::vector<unsigned int> &offsets, unsigned int start, unsigned int length);
+
+    static std::vector<unsigned int> offsets(const std::vector<unsigned int> &sizes) {
+        std::vector<unsigned int> offsets(1, 0);
+        offsets.reserve(sizes.size() + 1);
+        for (auto size : sizes)
+            offsets.push_back(offsets.back() + size);
+        return offsets;
+    }
+
     unsigned int aligned(unsigned int val) const {
         if (!(val % alignment_))
             return val;
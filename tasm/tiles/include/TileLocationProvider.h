@@ -10,6 +10,9 @@ namespace tasm {
 class TileLocationProvider : public TileLayoutProvider {
 public:
     virtual std::experimental::filesystem::path locationOfTileForFrame(unsigned int tileNumber, unsigned int frame) const = 0;
+    // Tiles that are packed are still identified by locationOfTileForFrame(), but are read from the directory's
+    // TilePack.
+    virtual TileStorageFormat storageFormatForFrame(unsigned int frame) const = 0;
 
     unsigned int frameOffsetInTileFile(const std::experimental::filesystem::path &tilePath) const {
         return TileFiles::firstAndLastFramesFromPath(tilePath.parent_path()).first;
@@ -20,19 +23,25 @@ public:
     virtual ~TileLocationProvider() {}
 };
 
+// Looks up the layout of a frame without locking. The runs of frames that share a layout are built once for each
+// version of the video's manifest and shared with other queries.
 class SingleTileLocationProvider : public TileLocationProvider {
 public:
     SingleTileLocationProvider(std::shared_ptr<const TiledVideoManager> tileLayoutsManager)
-            : tileLayoutsManager_(tileLayoutsManager)
-    { }
+            : tileLayoutsManager_(tileLayoutsManager),
+              runs_(tileLayoutsManager_->frameLayoutRuns())
+    {}
 
     std::experimental::filesystem::path locationOfTileForFrame(unsigned int tileNumber, unsigned int frame) const override {
-        return tileLayoutsManager_->locationOfTileForId(tileNumber, layoutIdForFrame(frame));
+        return TileFiles::tileFilename(runs_->runForFrame(frame).directory, tileNumber);
+    }
+
+    TileStorageFormat storageFormatForFrame(unsigned int frame) const override {
+        return runs_->runForFrame(frame).storageFormat;
     }
 
     std::shared_ptr<TileLayout> tileLayoutForFrame(unsigned int frame) override {
-        std::scoped_lock lock(mutex_);
-        return tileLayoutsManager_->tileLayoutForId(layoutIdForFrame(frame));
+        return runs_->runForFrame(frame).layout;
     }
 
     unsigned int lastFrameWithLayout() const override {
@@ -40,23 +49,8 @@ public:
     }
 
 private:
-    int layoutIdForFrame(unsigned int frame) const {
-        std::scoped_lock lock(mutex_);
-
-        if (frameToLayoutId_.count(frame))
-            return frameToLayoutId_.at(frame);
-
-        auto layoutIds = tileLayoutsManager_->tileLayoutIdsForFrame(frame);
-        // Pick the one with the largest value because it's the most recent layout.
-        auto layoutId = *std::max_element(layoutIds.begin(), layoutIds.end());
-
-        frameToLayoutId_[frame] = layoutId;
-        return layoutId;
-    }
-
     std::shared_ptr<const TiledVideoManager> tileLayoutsManager_;
-    mutable std::unordered_map<unsigned int, int> frameToLayoutId_;
-    mutable std::recursive_mutex mutex_;
+    const std::shared_ptr<const FrameLayoutRuns> runs_;
 };
 
 } // namespace tasm
@@ -0,0 +1,156 @@
+#ifndef TASM_TILEMANIFEST_H
+#define TASM_TILEMANIFEST_H
+
+#include "TileLayout.h"
+#include "TileStorageFormat.h"
+
+#include <climits>
+#include <experimental/filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tasm {
+class FrameLayoutRuns;
+
+struct TileDirectory {
+    unsigned int firstFrame;
+    unsigned int lastFrame;
+    unsigned int tileVersion;
+    // Directories with equal layouts share a layout.
+    std::shared_ptr<TileLayout> layout;
+    TileStorageFormat storageFormat = TileStorageFormat::MP4;
+};
+
+// Lists the committed tile directories of a tiled video along with their frame ranges, versions, and layouts.
+// Opening a video from its manifest avoids listing the video's directory and parsing one tile-metadata file per
+// directory.
+class TileManifest {
+public:
+    explicit TileManifest(std::vector<TileDirectory> directories = {})
+        : directories_(std::move(directories))
+    {}
+
+    const std::vector<TileDirectory> &directories() const { return directories_; }
+
+    // Returns a copy of this manifest that also contains `directory`.
+    std::shared_ptr<const TileManifest> withDirectory(const TileDirectory &directory) const;
+
+    // Returns a copy of this manifest without the directories with the same frames and versions as `directories`.
+    std::shared_ptr<const TileManifest> withoutDirectories(const std::vector<TileDirectory> &directories) const;
+
+    // The version of the newest directory, or 0 if there are none.
+    unsigned int newestTileVersion() const;
+
+    // Directories whose frames are all contained in newer directories, considering only the directories up to
+    // `newestTileVersion`. Readers use the newest directory that contains each frame, so they never read these.
+    std::vector<TileDirectory> shadowedDirectories(unsigned int newestTileVersion = UINT_MAX) const;
+
+    // Reads the manifest by memory-mapping it. Throws if it does not exist or cannot be parsed.
+    static std::shared_ptr<const TileManifest> read(const std::experimental::filesystem::path &videoPath);
+
+    // Builds the manifest of a video that was tiled before manifests existed by scanning its tile directories.
+    static std::shared_ptr<const TileManifest> scan(const std::experimental::filesystem::path &videoPath);
+
+    // Writes to a temporary file and renames it over the manifest so that readers never see a partial manifest.
+    void write(const std::experimental::filesystem::path &videoPath) const;
+
+    static TileDirectory tileDirectoryFromPath(const std::experimental::filesystem::path &tileDirectoryPath);
+
+private:
+    std::vector<TileDirectory> directories_;
+};
+
+// Keeps compaction in this process from deleting the directories in a manifest while it is held. Queries hold one for
+// as long as they may read tiles, and release it by destroying it.
+class TileVersionPin {
+public:
+    TileVersionPin(const TileVersionPin&) = delete;
+    ~TileVersionPin();
+
+    // The newest version in the pinned manifest.
+    unsigned int tileVersion() const { return manifest_->newestTileVersion(); }
+
+private:
+    friend class TileManifestCache;
+
+    TileVersionPin(std::string videoPath, std::shared_ptr<const TileManifest> manifest)
+        : videoPath_(std::move(videoPath)), manifest_(std::move(manifest))
+    {}
+
+    std::string videoPath_;
+    std::shared_ptr<const TileManifest> manifest_;
+};
+
+struct TileCompaction {
+    unsigned int numberOfDeletedDirectories = 0;
+    // Shadowed directories that were kept because a pinned manifest may still read them.
+    unsigned int numberOfPinnedDirectories = 0;
+};
+
+// Caches manifests across queries. A cached manifest is reused until the manifest file changes on disk, so commits
+// from other processes are picked up.
+class TileManifestCache {
+public:
+    static TileManifestCache &instance();
+
+    std::shared_ptr<const TileManifest> manifest(const std::experimental::filesystem::path &videoPath);
+
+    // Returns the video's manifest along with a pin on it.
+    std::shared_ptr<const TileManifest> pinnedManifest(const std::experimental::filesystem::path &videoPath, std::unique_ptr<const TileVersionPin> &pin);
+
+    // The frame layout runs of a manifest that this cache returned. They are built once for the video's current
+    // manifest and shared by every query that reads it.
+    std::shared_ptr<const FrameLayoutRuns> frameLayoutRuns(const std::experimental::filesystem::path &videoPath, const std::shared_ptr<const TileManifest> &manifest);
+
+    // Adds a committed tile directory to the video's manifest. The file is locked while it is updated so that
+    // concurrent commits from other processes are not lost.
+    void addDirectory(const std::experimental::filesystem::path &videoPath, const TileDirectory &directory);
+
+    // Removes the directories that newer versions shadow from the video's manifest and deletes them, except for ones
+    // that a pinned manifest may still read. The first version is kept because re-tiling reads from it.
+    // Pins only cover readers in this process, so compaction is only safe when no other process reads the video; see
+    // EnvironmentConfiguration::CompactTiles.
+    TileCompaction compact(const std::experimental::filesystem::path &videoPath);
+
+private:
+    // Every write renames a new file over the manifest, so the inode changes even when the modification time is too
+    // coarse to distinguish two writes.
+    struct FileVersion {
+        unsigned long long inode;
+        long long modificationTimeNs;
+
+        bool operator==(const FileVersion &other) const {
+            return inode == other.inode && modificationTimeNs == other.modificationTimeNs;
+        }
+    };
+
+    struct CachedManifest {
+        std::shared_ptr<const TileManifest> manifest;
+        FileVersion fileVersion;
+        // Built the first time that a query reads this version of the manifest.
+        std::shared_ptr<const FrameLayoutRuns> frameLayoutRuns;
+    };
+
+    TileManifestCache() = default;
+
+    friend class TileVersionPin;
+
+    static bool manifestFileVersion(const std::experimental::filesystem::path &videoPath, FileVersion &fileVersion);
+    std::shared_ptr<const TileManifest> manifestWithMutex(const std::experimental::filesystem::path &videoPath);
+    void unpin(const std::string &videoPath, const std::shared_ptr<const TileManifest> &manifest);
+    std::shared_ptr<const TileManifest> loadWithLock(const std::experimental::filesystem::path &videoPath);
+    void cache(const std::experimental::filesystem::path &videoPath, std::shared_ptr<const TileManifest> manifest);
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, CachedManifest> videoToManifest_;
+    // Pins hold the manifests themselves rather than their newest versions because commits from other writers can add
+    // a directory with an older version after a manifest was pinned, and the pinned manifest does not list it.
+    std::unordered_map<std::string, std::vector<std::shared_ptr<const TileManifest>>> videoToPinnedManifests_;
+};
+
+} // namespace tasm
+
+#endif //TASM_TILEMANIFEST_H
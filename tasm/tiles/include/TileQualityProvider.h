@@ -0,0 +1,55 @@
+#ifndef TASM_TILEQUALITYPROVIDER_H
+#define TASM_TILEQUALITYPROVIDER_H
+
+#include "LayoutIntervals.h"
+#include "Rectangle.h"
+#include "TileLayout.h"
+
+#include <optional>
+#include <vector>
+
+namespace tasm {
+class Workload;
+
+// The constant quantization parameters that tiles are encoded with. Higher values store tiles in fewer bytes, at a
+// lower quality.
+struct TileQuality {
+    unsigned int objectQuantizationParameter;
+    unsigned int backgroundQuantizationParameter;
+};
+
+class TileQualityProvider {
+public:
+    // One quantization parameter for each tile of the layout, for the layout interval that contains the frame.
+    virtual std::vector<unsigned int> quantizationParametersForFrame(unsigned int frame, const TileLayout &layout) = 0;
+    virtual ~TileQualityProvider() {}
+};
+
+// Encodes the tiles that intersect an object that the workload selects in any frame of the layout interval at the
+// object quality, and the rest at the background quality.
+class SemanticTileQualityProvider : public TileQualityProvider {
+public:
+    SemanticTileQualityProvider(LayoutIntervals layoutIntervals, std::shared_ptr<Workload> workload, TileQuality quality)
+        : layoutIntervals_(std::move(layoutIntervals)),
+        workload_(workload),
+        quality_(quality)
+    {}
+
+    std::vector<unsigned int> quantizationParametersForFrame(unsigned int frame, const TileLayout &layout) override;
+
+private:
+    LayoutIntervals layoutIntervals_;
+    std::shared_ptr<Workload> workload_;
+    TileQuality quality_;
+
+    // Tiles are encoded in frame order, so only the rectangles of the last interval are kept.
+    std::optional<unsigned int> cachedInterval_;
+    std::vector<Rectangle> rectanglesInInterval_;
+    // Every frame of an interval usually has the same layout, so the parameters are only recomputed when it changes.
+    std::optional<TileLayout> cachedLayout_;
+    std::vector<unsigned int> quantizationParameters_;
+};
+
+} // namespace tasm
+
+#endif //TASM_TILEQUALITYPROVIDER_H
@@ -1,52 +1,39 @@
 #ifndef TASM_TILEDVIDEOMANAGER_H
 #define TASM_TILEDVIDEOMANAGER_H
 
-#include "IntervalTree.h"
+#include "FrameLayoutRuns.h"
 #include "TileLayout.h"
+#include "TileManifest.h"
 #include "Video.h"
-#include <mutex>
 
 namespace tasm {
+
+// Describes the tiles of a video as of the manifest version that it loads. Everything that is derived from the
+// manifest is shared with other queries that read the same version, so creating one does not visit every directory.
 class TiledVideoManager {
 public:
-    TiledVideoManager(std::shared_ptr<TiledEntry> entry)
-            : entry_(entry),
-              totalWidth_(0),
-              totalHeight_(0),
-              largestWidth_(0),
-              largestHeight_(0),
-              maximumFrame_(0) {
-        loadAllTileConfigurations();
-    }
+    TiledVideoManager(std::shared_ptr<TiledEntry> entry);
 
     std::shared_ptr<TiledEntry> entry() const { return entry_; }
-    std::vector<int> tileLayoutIdsForFrame(unsigned int frameNumber) const;
-    std::shared_ptr<TileLayout> tileLayoutForId(int id) const { return directoryIdToTileLayout_.at(id); }
     std::experimental::filesystem::path locationOfTileForId(unsigned int tileNumber, int id) const;
 
+    std::shared_ptr<const FrameLayoutRuns> frameLayoutRuns() const { return frameLayoutRuns_; }
+
     unsigned int totalWidth() const { return totalWidth_; }
     unsigned int totalHeight() const { return totalHeight_; }
-    unsigned int largestWidth() const { return largestWidth_; }
-    unsigned int largestHeight() const { return largestHeight_; }
+    unsigned int largestWidth() const { return frameLayoutRuns_->largestWidth(); }
+    unsigned int largestHeight() const { return frameLayoutRuns_->largestHeight(); }
     unsigned int maximumFrame() const { return maximumFrame_; }
 
 private:
-    void loadAllTileConfigurations();
     std::shared_ptr<TiledEntry> entry_;
-    IntervalTree<unsigned int> intervalTree_;
-
-public: // For sake of measuring.
-    std::unordered_map<int, std::experimental::filesystem::path> directoryIdToTileDirectory_;
-    std::unordered_map<int, std::shared_ptr<TileLayout>> directoryIdToTileLayout_;
-    std::unordered_map <TileLayout, std::shared_ptr<TileLayout>> tileLayoutReferences_;
-
-private:
-    mutable std::mutex mutex_;
+    // Keeps the directories that this manager loaded from being deleted by compaction.
+    std::unique_ptr<const TileVersionPin> pin_;
+    std::shared_ptr<const TileManifest> manifest_;
+    std::shared_ptr<const FrameLayoutRuns> frameLayoutRuns_;
 
     unsigned int totalWidth_;
     unsigned int totalHeight_;
-    unsigned int largestWidth_;
-    unsigned int largestHeight_;
     unsigned int maximumFrame_;
 };
 
@@ -1,6 +1,7 @@
 #ifndef TASM_WORKLOADCOSTESTIMATOR_H
 #define TASM_WORKLOADCOSTESTIMATOR_H
 
+#include "LayoutIntervals.h"
 #include "TileConfigurationProvider.h"
 
 namespace tasm {
@@ -51,14 +52,42 @@ struct CostElements {
 
 std::ostream &operator<<(std::ostream &ostr, const CostElements &c);
 
+// The objects that each query in a workload selects from one GOP. They are read from the index once so that the cost
+// of many candidate layouts for the GOP can be estimated without querying it again.
+class GOPWorkload {
+public:
+    GOPWorkload(const Workload &workload, unsigned int firstFrameInclusive, unsigned int lastFrameExclusive);
+
+    unsigned int firstFrame() const { return firstFrame_; }
+    unsigned int numberOfQueries() const { return objectsForQuery_.size(); }
+    unsigned int numberOfTimesQueryIsExecuted(unsigned int queryNum) const { return queryCounts_[queryNum]; }
+    // Rectangle ids are the frames that the objects appear on.
+    const std::vector<Rectangle> &objectsForQuery(unsigned int queryNum) const { return objectsForQuery_[queryNum]; }
+    bool empty() const;
+
+    // Matches WorkloadCostEstimator::estimateCostForWorkload() restricted to this GOP.
+    CostElements estimateCost(const TileLayout &layout) const;
+
+private:
+    unsigned int firstFrame_;
+    std::vector<unsigned int> queryCounts_;
+    std::vector<std::vector<Rectangle>> objectsForQuery_;
+};
+
 class WorkloadCostEstimator {
 public:
     WorkloadCostEstimator(std::shared_ptr<TileLayoutProvider> tileLayoutProvider,
             std::shared_ptr<Workload> workload,
             unsigned int gopLength)
+            : WorkloadCostEstimator(tileLayoutProvider, workload, LayoutIntervals(gopLength))
+    {}
+
+    WorkloadCostEstimator(std::shared_ptr<TileLayoutProvider> tileLayoutProvider,
+            std::shared_ptr<Workload> workload,
+            LayoutIntervals gops)
             : tileLayoutProvider_(tileLayoutProvider),
             workload_(workload),
-            gopLength_(gopLength),
+            gops_(std::move(gops)),
             totalNumberOfPixels_(0),
             totalNumberOfTiles_(0) {}
 
@@ -66,11 +95,11 @@ public:
     CostElements estimateCostForWorkload();
 
     unsigned int gopForFrame(unsigned int frameNum) const {
-        return frameNum / gopLength_;
+        return gops_.intervalForFrame(frameNum);
     }
 private:
     unsigned int keyframeForFrame(unsigned int frameNum) const {
-        return gopForFrame(frameNum) * gopLength_;
+        return gops_.firstFrameOfInterval(gopForFrame(frameNum));
     }
 
     std::pair<int, CostElements> estimateCostForNextGOP(std::vector<int>::const_iterator &start,
@@ -79,7 +108,7 @@ private:
 
     std::shared_ptr<TileLayoutProvider> tileLayoutProvider_;
     std::shared_ptr<Workload> workload_;
-    unsigned int gopLength_;
+    LayoutIntervals gops_;
     unsigned int totalNumberOfPixels_;
     unsigned int totalNumberOfTiles_;
 };
@@ -0,0 +1,69 @@
+#include "FrameLayoutRuns.h"
+
+#include "Files.h"
+#include "IntervalTree.h"
+
+namespace tasm {
+
+std::shared_ptr<const FrameLayoutRuns> FrameLayoutRuns::forManifest(const std::experimental::filesystem::path &videoPath, const TileManifest &manifest) {
+    const auto &directories = manifest.directories();
+    if (directories.empty())
+        return std::make_shared<const FrameLayoutRuns>(std::vector<Run>());
+
+    std::vector<IntervalEntry<unsigned int>> directoryIntervals;
+    directoryIntervals.reserve(directories.size());
+    unsigned int lowerBound = UINT_MAX;
+    unsigned int upperBound = 0;
+    unsigned int largestWidth = 0;
+    unsigned int largestHeight = 0;
+    for (auto i = 0u; i < directories.size(); ++i) {
+        const auto &directory = directories[i];
+        // Identify directories by their index so that the run can find the directory's layout and location.
+        directoryIntervals.emplace_back(directory.firstFrame, directory.lastFrame, i);
+        lowerBound = std::min(lowerBound, directory.firstFrame);
+        upperBound = std::max(upperBound, directory.lastFrame);
+        largestWidth = std::max(largestWidth, directory.layout->largestWidth());
+        largestHeight = std::max(largestHeight, directory.layout->largestHeight());
+    }
+    IntervalTree<unsigned int> intervalTree(lowerBound, upperBound, directoryIntervals);
+
+    // The most recent layout can only change where a tile directory starts or ends.
+    std::vector<unsigned int> boundaries;
+    boundaries.reserve(2 * directories.size());
+    for (const auto &directory : directories) {
+        boundaries.push_back(directory.firstFrame);
+        boundaries.push_back(directory.lastFrame + 1);
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    std::vector<Run> runs;
+    std::vector<IntervalEntry<unsigned int>> overlappingIntervals;
+    for (auto boundary : boundaries) {
+        overlappingIntervals.clear();
+        intervalTree.query(boundary, overlappingIntervals);
+
+        // Pick the one with the largest version because it's the most recent layout.
+        const TileDirectory *newest = nullptr;
+        for (const auto &interval : overlappingIntervals) {
+            const auto &directory = directories[interval.id()];
+            if (!newest || directory.tileVersion > newest->tileVersion)
+                newest = &directory;
+        }
+        int layoutId = newest ? static_cast<int>(newest->tileVersion) : -1;
+
+        if (!runs.empty() && runs.back().layoutId == layoutId)
+            continue;
+
+        if (!newest)
+            runs.push_back({boundary, layoutId, nullptr, {}, TileStorageFormat::MP4});
+        else
+            runs.push_back({boundary, layoutId, newest->layout,
+                            TileFiles::directoryForTilesInFrames(videoPath, newest->firstFrame, newest->lastFrame, newest->tileVersion),
+                            newest->storageFormat});
+    }
+
+    return std::make_shared<const FrameLayoutRuns>(std::move(runs), largestWidth, largestHeight);
+}
+
+} // namespace tasm
@@ -0,0 +1,125 @@
+#include "LayoutIntervalSegmenter.h"
+
+#include "SemanticDataManager.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace tasm {
+
+namespace {
+
+static const unsigned int CellSize = 32;
+
+// The cells that a query's objects cover in one block, and the last frame in the block with one of its objects.
+struct BlockCoverage {
+    TileMask cells;
+    int lastFrame = -1;
+};
+
+} // namespace
+
+LayoutIntervalSegmenter::LayoutIntervalSegmenter(std::shared_ptr<Workload> workload,
+                                                 unsigned int frameWidth,
+                                                 unsigned int frameHeight,
+                                                 unsigned int minimumIntervalLength,
+                                                 unsigned int maximumIntervalLength,
+                                                 const CostProfile &costProfile)
+    : workload_(workload),
+    frameWidth_(frameWidth),
+    frameHeight_(frameHeight),
+    minimumIntervalLength_(minimumIntervalLength),
+    maximumIntervalLength_(maximumIntervalLength),
+    costProfile_(costProfile) {
+    if (!minimumIntervalLength_ || maximumIntervalLength_ < minimumIntervalLength_)
+        throw std::invalid_argument("The maximum interval length must be at least the minimum, which must be positive");
+}
+
+LayoutIntervals LayoutIntervalSegmenter::segment() const {
+    auto numberOfQueries = workload_->numberOfQueries();
+    auto numberOfColumns = (frameWidth_ + CellSize - 1) / CellSize;
+    auto numberOfRows = (frameHeight_ + CellSize - 1) / CellSize;
+
+    int lastFrameWithObjects = -1;
+    for (auto query = 0u; query < numberOfQueries; ++query) {
+        auto &frames = workload_->semanticDataManagerForQuery(query)->orderedFrames();
+        if (!frames.empty())
+            lastFrameWithObjects = std::max(lastFrameWithObjects, frames.back());
+    }
+    if (lastFrameWithObjects < 0)
+        return LayoutIntervals(maximumIntervalLength_);
+
+    // coverage[query * numberOfBlocks + block]
+    auto numberOfBlocks = lastFrameWithObjects / minimumIntervalLength_ + 1;
+    std::vector<BlockCoverage> coverage(numberOfQueries * numberOfBlocks);
+    for (auto &blockCoverage : coverage)
+        blockCoverage.cells.resize(numberOfColumns * numberOfRows);
+
+    for (auto query = 0u; query < numberOfQueries; ++query) {
+        auto semanticDataManager = workload_->semanticDataManagerForQuery(query);
+        auto rectangles = semanticDataManager->rectanglesForFrames(0, lastFrameWithObjects + 1);
+        for (const auto &rectangle : *rectangles) {
+            // Rectangle ids are the frames they appear on.
+            if (!semanticDataManager->isFrameInSelection(rectangle.id)
+                    || !rectangle.width || !rectangle.height
+                    || rectangle.x >= frameWidth_ || rectangle.y >= frameHeight_)
+                continue;
+
+            auto &blockCoverage = coverage[query * numberOfBlocks + rectangle.id / minimumIntervalLength_];
+            blockCoverage.lastFrame = std::max(blockCoverage.lastFrame, static_cast<int>(rectangle.id));
+            auto lastColumn = std::min((rectangle.x + rectangle.width - 1) / CellSize, numberOfColumns - 1);
+            auto lastRow = std::min((rectangle.y + rectangle.height - 1) / CellSize, numberOfRows - 1);
+            for (auto row = rectangle.y / CellSize; row <= lastRow; ++row) {
+                for (auto column = rectangle.x / CellSize; column <= lastColumn; ++column)
+                    blockCoverage.cells.set(row * numberOfColumns + column);
+            }
+        }
+    }
+
+    // costs[block] is the cheapest way to divide the blocks before `block` into intervals, and previousBoundaries[block]
+    // is where the last of those intervals starts.
+    auto maximumBlocksPerInterval = maximumIntervalLength_ / minimumIntervalLength_;
+    std::vector<double> costs(numberOfBlocks + 1, std::numeric_limits<double>::infinity());
+    std::vector<unsigned int> previousBoundaries(numberOfBlocks + 1, 0);
+    costs[0] = 0;
+    std::vector<TileMask> cellsInInterval(numberOfQueries, TileMask(numberOfColumns * numberOfRows));
+    std::vector<int> lastFrameInInterval(numberOfQueries);
+    for (auto first = 0u; first < numberOfBlocks; ++first) {
+        auto keyframe = first * minimumIntervalLength_;
+        for (auto query = 0u; query < numberOfQueries; ++query) {
+            cellsInInterval[query].reset();
+            lastFrameInInterval[query] = -1;
+        }
+
+        auto lastBoundary = std::min(numberOfBlocks, first + maximumBlocksPerInterval);
+        for (auto last = first + 1; last <= lastBoundary; ++last) {
+            double cost = costProfile_.encodeCostPerGOP;
+            for (auto query = 0u; query < numberOfQueries; ++query) {
+                const auto &blockCoverage = coverage[query * numberOfBlocks + last - 1];
+                if (blockCoverage.lastFrame >= 0) {
+                    cellsInInterval[query] |= blockCoverage.cells;
+                    lastFrameInInterval[query] = blockCoverage.lastFrame;
+                }
+                if (lastFrameInInterval[query] < 0)
+                    continue;
+
+                auto numberOfFrames = lastFrameInInterval[query] - keyframe + 1;
+                double pixelsPerFrame = cellsInInterval[query].count() * CellSize * CellSize;
+                cost += workload_->numberOfTimesQueryIsExecuted(query) * numberOfFrames * costProfile_.decodeCost(pixelsPerFrame, 1);
+            }
+
+            if (costs[first] + cost < costs[last]) {
+                costs[last] = costs[first] + cost;
+                previousBoundaries[last] = first;
+            }
+        }
+    }
+
+    std::vector<unsigned int> firstFrames;
+    for (auto boundary = numberOfBlocks; boundary; boundary = previousBoundaries[boundary])
+        firstFrames.push_back(previousBoundaries[boundary] * minimumIntervalLength_);
+    std::reverse(firstFrames.begin(), firstFrames.end());
+    return LayoutIntervals(std::move(firstFrames), maximumIntervalLength_);
+}
+
+} // namespace tasm
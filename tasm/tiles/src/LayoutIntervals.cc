@@ -0,0 +1,72 @@
+#include "LayoutIntervals.h"
+
+#include "Files.h"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+
+namespace tasm {
+
+LayoutIntervals::LayoutIntervals(std::vector<unsigned int> firstFrames, unsigned int lengthAfterLastInterval)
+    : firstFrames_(std::move(firstFrames)),
+    lengthAfterLastInterval_(lengthAfterLastInterval) {
+    if (firstFrames_.empty() || firstFrames_.front())
+        throw std::invalid_argument("Layout intervals must start at frame 0");
+    if (std::adjacent_find(firstFrames_.begin(), firstFrames_.end(), std::greater_equal<>()) != firstFrames_.end())
+        throw std::invalid_argument("Layout intervals must start at increasing frames");
+    if (!lengthAfterLastInterval_)
+        throw std::invalid_argument("Layout intervals must not be empty");
+}
+
+unsigned int LayoutIntervals::intervalForFrame(unsigned int frame) const {
+    if (frame >= firstFrames_.back())
+        return firstFrames_.size() - 1 + (frame - firstFrames_.back()) / lengthAfterLastInterval_;
+
+    // The last interval that starts at or before the frame.
+    return std::distance(firstFrames_.begin(), std::upper_bound(firstFrames_.begin(), firstFrames_.end(), frame)) - 1;
+}
+
+unsigned int LayoutIntervals::firstFrameOfInterval(unsigned int interval) const {
+    if (interval < firstFrames_.size())
+        return firstFrames_[interval];
+    return firstFrames_.back() + (interval - firstFrames_.size() + 1) * lengthAfterLastInterval_;
+}
+
+unsigned int LayoutIntervals::longestInterval() const {
+    auto longest = lengthAfterLastInterval_;
+    for (auto i = 1u; i < firstFrames_.size(); ++i)
+        longest = std::max(longest, firstFrames_[i] - firstFrames_[i - 1]);
+    return longest;
+}
+
+void LayoutIntervals::write(const std::experimental::filesystem::path &videoPath) const {
+    auto intervalsPath = TileFiles::layoutIntervalsFilename(videoPath);
+    auto temporaryPath = intervalsPath.string() + ".tmp";
+    {
+        std::ofstream output(temporaryPath, std::ios::out | std::ios::trunc);
+        output << lengthAfterLastInterval_ << "\n";
+        for (auto firstFrame : firstFrames_)
+            output << firstFrame << " ";
+        if (!output.flush())
+            throw std::runtime_error("Failed to write layout intervals " + intervalsPath.string());
+    }
+    std::experimental::filesystem::rename(temporaryPath, intervalsPath);
+}
+
+LayoutIntervals LayoutIntervals::read(const std::experimental::filesystem::path &videoPath, unsigned int defaultLength) {
+    auto intervalsPath = TileFiles::layoutIntervalsFilename(videoPath);
+    if (!std::experimental::filesystem::exists(intervalsPath))
+        return LayoutIntervals(defaultLength);
+
+    std::ifstream input(intervalsPath);
+    unsigned int lengthAfterLastInterval;
+    if (!(input >> lengthAfterLastInterval))
+        throw std::runtime_error("Failed to read layout intervals " + intervalsPath.string());
+    std::vector<unsigned int> firstFrames;
+    for (unsigned int firstFrame; input >> firstFrame; )
+        firstFrames.push_back(firstFrame);
+    return LayoutIntervals(std::move(firstFrames), lengthAfterLastInterval);
+}
+
+} // namespace tasm
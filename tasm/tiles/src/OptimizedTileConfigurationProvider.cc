@@ -0,0 +1,289 @@
+#include "OptimizedTileConfigurationProvider.h"
+
+#include <limits>
+#include <tuple>
+
+namespace tasm {
+
+namespace {
+
+static const unsigned int CellSize = 32;
+
+// Boundaries along one axis, in cells. Segment i covers cells [cuts[i], cuts[i + 1]).
+using Cuts = std::vector<unsigned int>;
+
+// The frame is divided into CTB-sized cells. For each query, a cell's depth is the number of frames from the keyframe
+// through the last frame where one of the query's objects intersects the cell, or 0 if none do. A tile's depth for a
+// query is the largest depth of its cells, which is the number of frames the query decodes from that tile.
+class LayoutSearch {
+public:
+    LayoutSearch(unsigned int frameWidth, unsigned int frameHeight, std::vector<double> queryWeights, const CostProfile &costProfile)
+        : frameWidth_(frameWidth),
+        frameHeight_(frameHeight),
+        numberOfColumns_((frameWidth + CellSize - 1) / CellSize),
+        numberOfRows_((frameHeight + CellSize - 1) / CellSize),
+        queryWeights_(std::move(queryWeights)),
+        costProfile_(costProfile),
+        depths_(queryWeights_.size() * numberOfColumns_ * numberOfRows_, 0),
+        transposedDepths_(depths_.size(), 0),
+        isEmpty_(true)
+    {
+        auto maximumColumnsAndRows = OptimizedTileConfigurationProvider::maximumNumberOfColumnsAndRows(frameWidth, frameHeight);
+        maximumNumberOfColumns_ = maximumColumnsAndRows.first;
+        maximumNumberOfRows_ = maximumColumnsAndRows.second;
+    }
+
+    void addObject(unsigned int query, const Rectangle &rectangle, unsigned int depth) {
+        if (!rectangle.width || !rectangle.height || rectangle.x >= frameWidth_ || rectangle.y >= frameHeight_)
+            return;
+
+        isEmpty_ = false;
+        auto lastColumn = std::min((rectangle.x + rectangle.width - 1) / CellSize, numberOfColumns_ - 1);
+        auto lastRow = std::min((rectangle.y + rectangle.height - 1) / CellSize, numberOfRows_ - 1);
+        for (auto row = rectangle.y / CellSize; row <= lastRow; ++row) {
+            for (auto column = rectangle.x / CellSize; column <= lastColumn; ++column) {
+                auto &cell = depths_[(query * numberOfRows_ + row) * numberOfColumns_ + column];
+                cell = std::max(cell, depth);
+                auto &transposedCell = transposedDepths_[(query * numberOfColumns_ + column) * numberOfRows_ + row];
+                transposedCell = std::max(transposedCell, depth);
+            }
+        }
+    }
+
+    // Returns the layout with the lowest estimated cost, and that cost.
+    std::pair<std::shared_ptr<TileLayout>, double> search() const {
+        Cuts wholeWidth{0, numberOfColumns_};
+        Cuts wholeHeight{0, numberOfRows_};
+        if (isEmpty_)
+            return std::make_pair(layoutForCuts(wholeWidth, wholeHeight), 0.0);
+
+        // Start from both axes, because the first axis that is cut constrains the other.
+        auto columnsFirst = alternate(wholeWidth, wholeHeight, true);
+        auto rowsFirst = alternate(wholeWidth, wholeHeight, false);
+        auto &best = columnsFirst.cost <= rowsFirst.cost ? columnsFirst : rowsFirst;
+        return std::make_pair(layoutForCuts(best.columns, best.rows), best.cost);
+    }
+
+private:
+    struct Search {
+        Cuts columns;
+        Cuts rows;
+        double cost;
+    };
+
+    Search alternate(Cuts columns, Cuts rows, bool shouldCutColumnsFirst) const {
+        static const unsigned int maximumIterations = 8;
+        auto bestCost = std::numeric_limits<double>::max();
+        bool shouldCutColumns = shouldCutColumnsFirst;
+        for (auto i = 0u; i < maximumIterations; ++i, shouldCutColumns = !shouldCutColumns) {
+            double cost;
+            if (shouldCutColumns)
+                columns = bestCuts(depths_, numberOfColumns_, numberOfRows_, frameWidth_, frameHeight_, rows, OptimizedTileConfigurationProvider::MinimumTileWidth, maximumNumberOfColumns_, cost);
+            else
+                rows = bestCuts(transposedDepths_, numberOfRows_, numberOfColumns_, frameHeight_, frameWidth_, columns, OptimizedTileConfigurationProvider::MinimumTileHeight, maximumNumberOfRows_, cost);
+
+            // Each step is optimal given the other axis, so the cost never increases.
+            if (i && cost >= bestCost)
+                break;
+            bestCost = cost;
+        }
+        return {columns, rows, bestCost};
+    }
+
+    // Returns the cuts along an axis that minimize the cost given the cuts along the other axis. depths is indexed by
+    // [query][cell along the other axis][cell along this axis].
+    Cuts bestCuts(const std::vector<unsigned int> &depths,
+                  unsigned int numberOfCells,
+                  unsigned int numberOfOtherCells,
+                  unsigned int length,
+                  unsigned int otherLength,
+                  const Cuts &otherCuts,
+                  unsigned int minimumSegmentLength,
+                  unsigned int maximumNumberOfSegments,
+                  double &cost) const {
+        auto numberOfQueries = queryWeights_.size();
+        auto numberOfOtherSegments = otherCuts.size() - 1;
+        auto numberOfProfiles = numberOfQueries * numberOfOtherSegments;
+
+        // The depth of each query in each segment along the other axis, at each cell along this axis.
+        std::vector<unsigned int> profiles(numberOfProfiles * numberOfCells, 0);
+        std::vector<double> otherSegmentLengths(numberOfOtherSegments);
+        for (auto segment = 0u; segment < numberOfOtherSegments; ++segment) {
+            otherSegmentLengths[segment] = pixelOffset(otherCuts[segment + 1], otherLength) - pixelOffset(otherCuts[segment], otherLength);
+            for (auto query = 0u; query < numberOfQueries; ++query) {
+                auto profile = profiles.begin() + (query * numberOfOtherSegments + segment) * numberOfCells;
+                for (auto otherCell = otherCuts[segment]; otherCell < otherCuts[segment + 1]; ++otherCell) {
+                    auto cells = depths.begin() + (query * numberOfOtherCells + otherCell) * numberOfCells;
+                    for (auto cell = 0u; cell < numberOfCells; ++cell)
+                        profile[cell] = std::max(profile[cell], cells[cell]);
+                }
+            }
+        }
+
+        // segmentCosts[first * (numberOfCells + 1) + last] is the cost of the tiles spanning cells [first, last).
+        auto infinity = std::numeric_limits<double>::infinity();
+        auto numberOfCuts = numberOfCells + 1;
+        std::vector<double> segmentCosts(numberOfCuts * numberOfCuts, infinity);
+        std::vector<unsigned int> segmentDepths(numberOfProfiles);
+        for (auto first = 0u; first < numberOfCells; ++first) {
+            std::fill(segmentDepths.begin(), segmentDepths.end(), 0);
+            for (auto last = first + 1; last <= numberOfCells; ++last) {
+                for (auto profile = 0u; profile < numberOfProfiles; ++profile)
+                    segmentDepths[profile] = std::max(segmentDepths[profile], profiles[profile * numberOfCells + last - 1]);
+
+                double segmentLength = pixelOffset(last, length) - pixelOffset(first, length);
+                bool isWholeAxis = !first && last == numberOfCells;
+                if (segmentLength < minimumSegmentLength && !isWholeAxis)
+                    continue;
+
+                double segmentCost = 0;
+                for (auto query = 0u; query < numberOfQueries; ++query) {
+                    for (auto segment = 0u; segment < numberOfOtherSegments; ++segment) {
+                        auto depth = segmentDepths[query * numberOfOtherSegments + segment];
+                        if (depth) {
+                            auto pixelsPerFrame = segmentLength * otherSegmentLengths[segment];
+                            segmentCost += queryWeights_[query] * depth * costProfile_.decodeCost(pixelsPerFrame, 1);
+                        }
+                    }
+                }
+                segmentCosts[first * numberOfCuts + last] = segmentCost;
+            }
+        }
+
+        // costs[segments * numberOfCuts + cut] is the cheapest way to cover cells [0, cut) with that many segments.
+        std::vector<double> costs((maximumNumberOfSegments + 1) * numberOfCuts, infinity);
+        std::vector<unsigned int> previousCuts(costs.size(), 0);
+        costs[0] = 0;
+        for (auto segments = 1u; segments <= maximumNumberOfSegments; ++segments) {
+            for (auto last = 1u; last <= numberOfCells; ++last) {
+                auto &best = costs[segments * numberOfCuts + last];
+                for (auto first = segments - 1; first < last; ++first) {
+                    auto previous = costs[(segments - 1) * numberOfCuts + first];
+                    auto candidate = previous + segmentCosts[first * numberOfCuts + last];
+                    if (candidate < best) {
+                        best = candidate;
+                        previousCuts[segments * numberOfCuts + last] = first;
+                    }
+                }
+            }
+        }
+
+        // Prefer fewer segments when costs are equal.
+        auto bestNumberOfSegments = 1u;
+        for (auto segments = 2u; segments <= maximumNumberOfSegments; ++segments) {
+            if (costs[segments * numberOfCuts + numberOfCells] < costs[bestNumberOfSegments * numberOfCuts + numberOfCells])
+                bestNumberOfSegments = segments;
+        }
+        cost = costs[bestNumberOfSegments * numberOfCuts + numberOfCells];
+
+        Cuts cuts(bestNumberOfSegments + 1);
+        cuts.back() = numberOfCells;
+        for (auto segments = bestNumberOfSegments; segments > 0; --segments)
+            cuts[segments - 1] = previousCuts[segments * numberOfCuts + cuts[segments]];
+        assert(!cuts.front());
+        return cuts;
+    }
+
+    static unsigned int pixelOffset(unsigned int cut, unsigned int length) {
+        return std::min(cut * CellSize, length);
+    }
+
+    static std::vector<unsigned int> dimensionsForCuts(const Cuts &cuts, unsigned int length) {
+        std::vector<unsigned int> dimensions(cuts.size() - 1);
+        for (auto i = 0u; i < dimensions.size(); ++i)
+            dimensions[i] = pixelOffset(cuts[i + 1], length) - pixelOffset(cuts[i], length);
+        return dimensions;
+    }
+
+    std::shared_ptr<TileLayout> layoutForCuts(const Cuts &columns, const Cuts &rows) const {
+        return std::make_shared<TileLayout>(columns.size() - 1, rows.size() - 1,
+                dimensionsForCuts(columns, frameWidth_),
+                dimensionsForCuts(rows, frameHeight_));
+    }
+
+    unsigned int frameWidth_;
+    unsigned int frameHeight_;
+    unsigned int numberOfColumns_;
+    unsigned int numberOfRows_;
+    unsigned int maximumNumberOfColumns_;
+    unsigned int maximumNumberOfRows_;
+    std::vector<double> queryWeights_;
+    const CostProfile &costProfile_;
+    // Indexed by [query][row][column].
+    std::vector<unsigned int> depths_;
+    // Indexed by [query][column][row].
+    std::vector<unsigned int> transposedDepths_;
+    bool isEmpty_;
+};
+
+} // namespace
+
+OptimizedTileConfigurationProvider::OptimizedTileConfigurationProvider(LayoutIntervals layoutIntervals,
+                                                                       std::shared_ptr<Workload> workload,
+                                                                       unsigned int frameWidth,
+                                                                       unsigned int frameHeight)
+    : layoutIntervals_(std::move(layoutIntervals)),
+    workload_(workload),
+    frameWidth_(frameWidth),
+    frameHeight_(frameHeight),
+    costProfile_(CostModel::instance().profile())
+{}
+
+std::shared_ptr<TileLayout> OptimizedTileConfigurationProvider::tileLayoutForFrame(unsigned int frame) {
+    return layoutForGOP(layoutIntervals_.intervalForFrame(frame)).layout;
+}
+
+double OptimizedTileConfigurationProvider::estimatedCostForFrame(unsigned int frame) {
+    return layoutForGOP(layoutIntervals_.intervalForFrame(frame)).cost;
+}
+
+const OptimizedTileConfigurationProvider::GOPLayout &OptimizedTileConfigurationProvider::layoutForGOP(unsigned int gop) {
+    auto existing = gopToLayout_.find(gop);
+    if (existing != gopToLayout_.end())
+        return existing->second;
+
+    GOPWorkload gopWorkload(*workload_, layoutIntervals_.firstFrameOfInterval(gop), layoutIntervals_.firstFrameOfInterval(gop + 1));
+    double cost;
+    auto layout = layoutForWorkload(gopWorkload, frameWidth_, frameHeight_, costProfile_, &cost);
+    return gopToLayout_.emplace(gop, GOPLayout{layout, cost}).first->second;
+}
+
+std::shared_ptr<TileLayout> OptimizedTileConfigurationProvider::layoutForWorkload(const GOPWorkload &gopWorkload, unsigned int frameWidth, unsigned int frameHeight, const CostProfile &costProfile, double *cost) {
+    std::vector<double> queryWeights(gopWorkload.numberOfQueries());
+    for (auto query = 0u; query < queryWeights.size(); ++query)
+        queryWeights[query] = gopWorkload.numberOfTimesQueryIsExecuted(query);
+
+    LayoutSearch search(frameWidth, frameHeight, std::move(queryWeights), costProfile);
+    for (auto query = 0u; query < gopWorkload.numberOfQueries(); ++query) {
+        for (const auto &object : gopWorkload.objectsForQuery(query))
+            search.addObject(query, object, object.id - gopWorkload.firstFrame() + 1);
+    }
+
+    auto layoutAndCost = search.search();
+    if (cost)
+        *cost = layoutAndCost.second;
+    return layoutAndCost.first;
+}
+
+std::pair<unsigned int, unsigned int> OptimizedTileConfigurationProvider::maximumNumberOfColumnsAndRows(unsigned int frameWidth, unsigned int frameHeight) {
+    // MaxLumaPs, MaxTileCols, and MaxTileRows from Table A.8 of the HEVC specification.
+    static const std::vector<std::tuple<unsigned long long, unsigned int, unsigned int>> levelLimits{
+            {36864, 1, 1},
+            {122880, 1, 1},
+            {245760, 1, 1},
+            {552960, 2, 2},
+            {983040, 3, 3},
+            {2228224, 5, 5},
+            {8912896, 10, 11},
+            {35651584, 20, 22},
+    };
+
+    auto lumaPictureSize = static_cast<unsigned long long>(frameWidth) * frameHeight;
+    for (const auto &limits : levelLimits) {
+        if (lumaPictureSize <= std::get<0>(limits))
+            return std::make_pair(std::get<1>(limits), std::get<2>(limits));
+    }
+    return std::make_pair(std::get<1>(levelLimits.back()), std::get<2>(levelLimits.back()));
+}
+
+} // namespace tasm
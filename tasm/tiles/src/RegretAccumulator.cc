@@ -1,10 +1,86 @@
 #include "RegretAccumulator.h"
 
+#include "Files.h"
 #include "SemanticDataManager.h"
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <sstream>
 
 namespace tasm {
 
+namespace {
+
+// The query's objects and temporal selection.
+void writeSelection(std::ostream &output, const SemanticDataManager &selection) {
+    const auto &objects = selection.labelsInQuery();
+    output << objects.size();
+    for (const auto &object : objects)
+        output << " " << std::quoted(object);
+
+    auto temporalSelection = selection.temporalSelection();
+    output << " " << std::quoted(temporalSelection ? temporalSelection->description() : "");
+}
+
+// The cost of each GOP that a query touched with the layout it ran on.
+void writeCosts(std::ostream &output, const std::unordered_map<unsigned int, CostElements> &baselineCosts) {
+    output << baselineCosts.size();
+    for (const auto &gopAndCosts : baselineCosts)
+        output << " " << gopAndCosts.first << " " << gopAndCosts.second.numPixels << " " << gopAndCosts.second.numTiles;
+}
+
+void writeQuery(std::ostream &output, const SemanticDataManager &selection, const std::unordered_map<unsigned int, CostElements> &baselineCosts) {
+    writeSelection(output, selection);
+    output << " ";
+    writeCosts(output, baselineCosts);
+}
+
+bool readSelection(std::istream &input, std::vector<std::string> &objects, std::string &temporalSelection) {
+    unsigned int numberOfObjects;
+    if (!(input >> numberOfObjects))
+        return false;
+    objects.resize(numberOfObjects);
+    for (auto &object : objects) {
+        if (!(input >> std::quoted(object)))
+            return false;
+    }
+
+    return static_cast<bool>(input >> std::quoted(temporalSelection));
+}
+
+bool readCosts(std::istream &input, std::unordered_map<unsigned int, CostElements> &baselineCosts) {
+    unsigned int numberOfGOPs;
+    if (!(input >> numberOfGOPs))
+        return false;
+    for (auto i = 0u; i < numberOfGOPs; ++i) {
+        unsigned int gop;
+        unsigned long long numPixels, numTiles;
+        if (!(input >> gop >> numPixels >> numTiles))
+            return false;
+        baselineCosts.emplace(gop, CostElements(numPixels, numTiles));
+    }
+    return true;
+}
+
+bool readQuery(std::istream &input, std::vector<std::string> &objects, std::string &temporalSelection, std::unordered_map<unsigned int, CostElements> &baselineCosts) {
+    return readSelection(input, objects, temporalSelection) && readCosts(input, baselineCosts);
+}
+
+bool haveSameCosts(const std::unordered_map<unsigned int, CostElements> &first, const std::unordered_map<unsigned int, CostElements> &second) {
+    return first.size() == second.size() && std::all_of(first.begin(), first.end(), [&](const auto &gopAndCosts) {
+        auto other = second.find(gopAndCosts.first);
+        return other != second.end()
+                && other->second.numPixels == gopAndCosts.second.numPixels
+                && other->second.numTiles == gopAndCosts.second.numTiles;
+    });
+}
+
+// Ends each log record so that one that was only partly written is not mistaken for a shorter one.
+static const std::string RecordTerminator = ";";
+
+} // namespace
+
 static std::string combineStrings(const std::vector<std::string> &strings) {
     static const std::string connector = "_";
     std::string combined = "";
@@ -19,20 +95,43 @@ static std::string combineStrings(const std::vector<std::string> &strings) {
 
  void RegretAccumulator::addRegretForQuery(std::shared_ptr<Workload> workload,
                                           std::shared_ptr<TileLayoutProvider> currentLayout) {
+    // Generate baseline costs based on the current layout.
+    WorkloadCostEstimator baselineCostEstimator(currentLayout, workload, gops_);
+    auto baselineCosts = std::make_shared<GOPCosts>();
+    baselineCostEstimator.estimateCostForQuery(0, baselineCosts.get());
+
+    addRegretForQueryWithBaselineCosts(workload, baselineCosts);
+}
+
+void RegretAccumulator::addRegretForQueryWithBaselineCosts(std::shared_ptr<Workload> workload, std::shared_ptr<GOPCosts> baselineCosts) {
     ++queryIteration_;
+    costProfile_ = CostModel::instance().profile();
     auto &queryObjects = workload->semanticDataManagerForQuery(0)->labelsInQuery();
+    auto predicate = workload->semanticDataManagerForQuery(0)->predicate();
+    iterationToPredicate_[queryIteration_] = predicate;
+    ++predicateToNumberOfIterations_[predicate];
 
-    addRegretForHistoricalQueries(queryObjects);
-
-    // Generate baseline costs based on the current layout.
-    WorkloadCostEstimator baselineCostEstimator(currentLayout, workload, gopLength_);
-    auto baselineCosts = std::make_shared<std::unordered_map<unsigned int, CostElements>>();
-    baselineCostEstimator.estimateCostForQuery(0, baselineCosts.get());
+    auto latestIteration = predicateToLatestIteration_.find(predicate);
+    if (latestIteration != predicateToLatestIteration_.end() && iterationToBaselineCosts_.count(latestIteration->second)) {
+        const auto &latestCosts = iterationToBaselineCosts_.at(latestIteration->second);
+        if (haveSameCosts(*latestCosts, *baselineCosts))
+            baselineCosts = latestCosts;
+    }
+    predicateToLatestIteration_[predicate] = queryIteration_;
 
+    addRegretForHistoricalQueries(queryObjects);
     addRegretForWorkload(queryIteration_, workload, baselineCosts, labels_);
 
     iterationToWorkload_[queryIteration_] = workload;
     iterationToBaselineCosts_[queryIteration_] = baselineCosts;
+    forgetOldestIterations();
+
+    if (!videoPath_.empty() && !isReplaying_) {
+        std::ostringstream record;
+        record << "query ";
+        writeQuery(record, *workload->semanticDataManagerForQuery(0), *baselineCosts);
+        appendRecord(record.str());
+    }
 }
 
 std::unique_ptr<std::unordered_map<unsigned int, std::shared_ptr<TileLayoutProvider>>> RegretAccumulator::getNewGOPLayouts() {
@@ -48,18 +147,50 @@ std::unique_ptr<std::unordered_map<unsigned int, std::shared_ptr<TileLayoutProvi
     return newGOPLayouts;
 }
 
-bool RegretAccumulator::shouldRetileGOP(unsigned int gop, std::string &layoutIdentifier) {
-    long long int maxRegret = 0;
-    std::string labelWithMaxRegret;
+std::vector<GOPRetileCandidate> RegretAccumulator::retileCandidates() const {
+    std::vector<GOPRetileCandidate> candidates;
+    for (auto it = gopToRegret_.begin(); it != gopToRegret_.end(); ++it) {
+        auto gop = it->first;
+        std::string layoutIdentifier;
+        auto maxRegret = maximumRegretForGOP(gop, layoutIdentifier);
+        auto encodeCost = estimateCostToEncodeGOP(sizeOfGOPInPixels(gop));
+        if (maxRegret > threshold_ * encodeCost) {
+            auto decodeCost = costProfile_.decodeCost(sizeOfGOPInPixels(gop), gops_.lengthOfInterval(gop));
+            candidates.push_back({gop, layoutIdentifier, maxRegret - threshold_ * encodeCost, encodeCost + decodeCost});
+        }
+    }
+    return candidates;
+}
+
+std::shared_ptr<TileLayoutProvider> RegretAccumulator::layoutForGOP(unsigned int gop, const std::string &layoutIdentifier) {
+    std::cout << "Retile GOP " << gop << " to " << layoutIdentifier << std::endl;
+    return configurationProviderForIdentifier(layoutIdentifier);
+}
+
+void RegretAccumulator::gopWasRetiled(unsigned int gop) {
+    resetRegretForGOP(gop);
+}
+
+double RegretAccumulator::maximumRegretForGOP(unsigned int gop, std::string &layoutIdentifier) const {
+    double maxRegret = 0;
+    auto regrets = gopToRegret_.find(gop);
+    if (regrets == gopToRegret_.end())
+        return maxRegret;
 
-    for (auto it = gopToRegret_[gop].begin(); it != gopToRegret_[gop].end(); ++it) {
+    for (auto it = regrets->second.begin(); it != regrets->second.end(); ++it) {
         if (it->second > maxRegret) {
             maxRegret = it->second;
-            labelWithMaxRegret = it->first;
+            layoutIdentifier = it->first;
         }
     }
+    return maxRegret;
+}
+
+bool RegretAccumulator::shouldRetileGOP(unsigned int gop, std::string &layoutIdentifier) const {
+    std::string labelWithMaxRegret;
+    auto maxRegret = maximumRegretForGOP(gop, labelWithMaxRegret);
 
-    if (maxRegret > threshold_ * gopTilingCost_) {
+    if (maxRegret > threshold_ * estimateCostToEncodeGOP(sizeOfGOPInPixels(gop))) {
         layoutIdentifier = labelWithMaxRegret;
         std::cout << "Retile GOP " << gop << " to " << layoutIdentifier << std::endl;
         return true;
@@ -72,6 +203,9 @@ void RegretAccumulator::resetRegretForGOP(unsigned int gop) {
         it->second = 0;
 
     gopToClearedIteration_[gop] = queryIteration_;
+
+    if (!videoPath_.empty() && !isReplaying_)
+        appendRecord("cleared " + std::to_string(gop));
 }
 
 std::shared_ptr<TileLayoutProvider> RegretAccumulator::configurationProviderForIdentifier(const std::string &identifier) {
@@ -87,15 +221,13 @@ void RegretAccumulator::addRegretForHistoricalQueries(const std::vector<std::str
     singleObjects_.insert(objects.begin(), objects.end());
 
     // Add a layout for new objects and new combined objects.
-    labels_.push_back(combinedObjects);
-    idToConfig_[combinedObjects] = tileLayoutForObjects(objects);
+    addLayout(combinedObjects, objects);
     std::vector<std::string> newLayouts{combinedObjects};
 
     if (labels_.size() > 1) {
         std::vector<std::string> newAllObjects(singleObjects_.begin(), singleObjects_.end());
         auto newAllObjectsLabel = combineStrings(newAllObjects);
-        labels_.push_back(newAllObjectsLabel);
-        idToConfig_[newAllObjectsLabel] = tileLayoutForObjects(newAllObjects);
+        addLayout(newAllObjectsLabel, newAllObjects);
         newLayouts.push_back(newAllObjectsLabel);
     }
 
@@ -106,8 +238,7 @@ void RegretAccumulator::addRegretForHistoricalQueries(const std::vector<std::str
             continue;
 
         if (!costsAreForGOPsThatHaveNotBeenRetiled(i, iterationToBaselineCosts_.at(i))) {
-            iterationToWorkload_.erase(i);
-            iterationToBaselineCosts_.erase(i);
+            forgetIteration(i);
             continue;
         }
 
@@ -116,11 +247,17 @@ void RegretAccumulator::addRegretForHistoricalQueries(const std::vector<std::str
     }
 }
 
+void RegretAccumulator::addLayout(const std::string &label, const std::vector<std::string> &objects) {
+    labels_.push_back(label);
+    idToConfig_[label] = tileLayoutForObjects(objects);
+    idToObjects_[label] = objects;
+}
+
 std::shared_ptr<TileLayoutProvider> RegretAccumulator::tileLayoutForObjects(const std::vector<std::string> &objects) {
     auto metadataSelection = std::make_shared<OrMetadataSelection>(objects);
     auto semanticDataManager = std::make_shared<SemanticDataManager>(semanticIndex_, metadataIdentifier_, metadataSelection);
     return std::make_shared<FineGrainedTileConfigurationProvider>(
-            gopLength_,
+            gops_,
             semanticDataManager,
             width_,
             height_);
@@ -141,34 +278,70 @@ bool RegretAccumulator::costsAreForGOPsThatHaveNotBeenRetiled(unsigned int itera
     return false;
 }
 
+void RegretAccumulator::forgetIteration(unsigned int iteration) {
+    iterationToWorkload_.erase(iteration);
+    iterationToBaselineCosts_.erase(iteration);
+
+    auto predicate = iterationToPredicate_.at(iteration);
+    iterationToPredicate_.erase(iteration);
+    if (!--predicateToNumberOfIterations_.at(predicate)) {
+        predicateToNumberOfIterations_.erase(predicate);
+        predicateToLayoutCosts_.erase(predicate);
+        predicateToLatestIteration_.erase(predicate);
+    }
+}
+
+void RegretAccumulator::forgetOldestIterations() {
+    while (iterationToWorkload_.size() > MaximumNumberOfRememberedQueries) {
+        auto oldest = std::min_element(iterationToWorkload_.begin(), iterationToWorkload_.end(), [](const auto &first, const auto &second) {
+            return first.first < second.first;
+        });
+        forgetIteration(oldest->first);
+    }
+}
+
+std::shared_ptr<const RegretAccumulator::GOPCosts> RegretAccumulator::costsForLayout(const std::string &predicate,
+                                                                                    std::shared_ptr<Workload> workload,
+                                                                                    const std::string &layoutIdentifier) {
+    auto &layoutCosts = predicateToLayoutCosts_[predicate];
+    auto cached = layoutCosts.find(layoutIdentifier);
+    if (cached != layoutCosts.end())
+        return cached->second;
+
+    auto layout = layoutIdentifier == NoTilesLayoutIdentifier
+            ? std::static_pointer_cast<TileLayoutProvider>(noTilesConfiguration_)
+            : idToConfig_.at(layoutIdentifier);
+    WorkloadCostEstimator estimator(layout, workload, gops_);
+    auto costs = std::make_shared<GOPCosts>();
+    estimator.estimateCostForQuery(0, costs.get());
+    ++numberOfLayoutCostEstimates_;
+
+    layoutCosts.emplace(layoutIdentifier, costs);
+    return costs;
+}
+
 void RegretAccumulator::addRegretForWorkload(unsigned int iteration, std::shared_ptr<Workload> workload,
                                              std::shared_ptr<std::unordered_map<unsigned int, CostElements>> baselineCosts,
                                              const std::vector<std::string> layouts) {
-    static const double pixelCostWeight = 1.608e-06;
-    static const double tileCostWeight = 1.703e-01;
+    const auto &predicate = iterationToPredicate_.at(iteration);
+    auto noTilesCosts = costsForLayout(predicate, workload, NoTilesLayoutIdentifier);
 
-    WorkloadCostEstimator noTilesLayoutEstimator(noTilesConfiguration_, workload, gopLength_);
-    auto noTilesCosts = std::make_unique<std::unordered_map<unsigned int, CostElements>>();
-    noTilesLayoutEstimator.estimateCostForQuery(0, noTilesCosts.get());
-    
     for (const auto &layoutId : layouts) {
-        WorkloadCostEstimator proposedLayoutEstimator(idToConfig_.at(layoutId), workload, gopLength_);
-        auto proposedCosts = std::make_unique<std::unordered_map<unsigned int, CostElements>>();
-        proposedLayoutEstimator.estimateCostForQuery(0, proposedCosts.get());
-        
+        auto proposedCosts = costsForLayout(predicate, workload, layoutId);
+
         assert(baselineCosts->size() == proposedCosts->size());
-        
+
         for (auto curIt = baselineCosts->begin(); curIt != baselineCosts->end(); ++curIt) {
             auto gop = curIt->first;
             if (gopToClearedIteration_.count(gop) && gopToClearedIteration_.at(gop) >= iteration)
                 continue;
-            
-            auto curCosts = curIt->second;
-            auto possibleCosts = proposedCosts->at(gop);
-            double regret = pixelCostWeight *
-                    (long long int)(curCosts.numPixels - possibleCosts.numPixels) +
-                    tileCostWeight * (int)(curCosts.numTiles - possibleCosts.numTiles);
-            if (possibleCosts.numPixels >= 0.8 * noTilesCosts->at(gop).numPixels)
+
+            const auto &curCosts = curIt->second;
+            const auto &possibleCosts = proposedCosts->at(gop);
+            double regret = costProfile_.decodeCost(
+                    (long long int)(curCosts.numPixels - possibleCosts.numPixels),
+                    (int)(curCosts.numTiles - possibleCosts.numTiles));
+            if (possibleCosts.numPixels >= costProfile_.tilingPixelThreshold * noTilesCosts->at(gop).numPixels)
                 regret = std::numeric_limits<double>::lowest();
 
             addRegretToGOP(gop, regret, layoutId);
@@ -183,4 +356,234 @@ void RegretAccumulator::addRegretToGOP(unsigned int gop, double regret, const st
     gopToRegret_[gop][layoutIdentifier] += regret;
 }
 
+void RegretAccumulator::persistTo(const std::experimental::filesystem::path &videoPath) {
+    assert(videoPath_.empty());
+    videoPath_ = videoPath;
+
+    isReplaying_ = true;
+    loadState();
+    isReplaying_ = false;
+
+    // Start a new log after the state that was loaded, which also drops a record that was only partly written.
+    writeSnapshot();
+}
+
+std::shared_ptr<Workload> RegretAccumulator::workloadForQuery(const std::vector<std::string> &objects, const std::string &temporalSelection) const {
+    std::shared_ptr<MetadataSelection> metadataSelection;
+    if (objects.size() == 1)
+        metadataSelection = std::make_shared<SingleMetadataSelection>(objects.front());
+    else {
+        std::vector<std::shared_ptr<MetadataSelection>> elements;
+        for (const auto &object : objects)
+            elements.push_back(std::make_shared<SingleMetadataSelection>(object));
+        metadataSelection = std::make_shared<OrMetadataSelection>(elements);
+    }
+
+    return std::make_shared<Workload>(std::make_shared<SemanticDataManager>(
+            semanticIndex_,
+            metadataIdentifier_,
+            metadataSelection,
+            TemporalSelection::fromDescription(temporalSelection),
+            width_,
+            height_));
+}
+
+void RegretAccumulator::loadState() {
+    // A log is only written after a snapshot, so without a snapshot there is nothing to load.
+    auto snapshotPath = TileFiles::regretSnapshotFilename(videoPath_);
+    if (!std::experimental::filesystem::exists(snapshotPath))
+        return;
+
+    std::ifstream snapshot(snapshotPath);
+    if (!readSnapshot(snapshot)) {
+        std::cout << "Discarding regret state that was saved for a different selection or in another format" << std::endl;
+        return;
+    }
+
+    auto snapshotRecords = numberOfRecords_;
+    std::ifstream log(TileFiles::regretLogFilename(videoPath_));
+    for (std::string line; std::getline(log, line); ) {
+        std::istringstream record(line);
+        // Stop at a record that was only partly written when the process stopped.
+        if (!replayRecord(record, snapshotRecords))
+            break;
+    }
+}
+
+bool RegretAccumulator::readSnapshot(std::istream &input) {
+    std::string keyword;
+    unsigned int version;
+    if (!(input >> keyword >> version) || keyword != "regret-state" || version != SnapshotFormatVersion)
+        return false;
+
+    std::string metadataIdentifier;
+    unsigned int width, height;
+    if (!(input >> keyword >> std::quoted(metadataIdentifier) >> width >> height) || keyword != "selection")
+        return false;
+    if (metadataIdentifier != metadataIdentifier_ || width != width_ || height != height_)
+        return false;
+
+    auto fail = [&] {
+        throw std::runtime_error("Failed to read regret state " + TileFiles::regretSnapshotFilename(videoPath_).string());
+    };
+
+    // Queries refer to the baseline costs that they share by the order in which the costs were written.
+    std::unordered_map<unsigned int, std::shared_ptr<GOPCosts>> identifierToCosts;
+
+    while (input >> keyword) {
+        if (keyword == "records") {
+            if (!(input >> numberOfRecords_))
+                fail();
+        } else if (keyword == "iteration") {
+            if (!(input >> queryIteration_))
+                fail();
+        } else if (keyword == "layout") {
+            std::string label;
+            unsigned int numberOfObjects;
+            if (!(input >> std::quoted(label) >> numberOfObjects))
+                fail();
+            std::vector<std::string> objects(numberOfObjects);
+            for (auto &object : objects) {
+                if (!(input >> std::quoted(object)))
+                    fail();
+            }
+            addLayout(label, objects);
+        } else if (keyword == "queried") {
+            std::string label;
+            if (!(input >> std::quoted(label)) || !idToObjects_.count(label))
+                fail();
+            allObjects_.insert(label);
+            singleObjects_.insert(idToObjects_.at(label).begin(), idToObjects_.at(label).end());
+        } else if (keyword == "regret") {
+            unsigned int gop;
+            std::string label;
+            double regret;
+            if (!(input >> gop >> std::quoted(label) >> regret))
+                fail();
+            gopToRegret_[gop][label] = regret;
+        } else if (keyword == "cleared") {
+            unsigned int gop, iteration;
+            if (!(input >> gop >> iteration))
+                fail();
+            gopToClearedIteration_[gop] = iteration;
+        } else if (keyword == "costs") {
+            unsigned int identifier;
+            auto baselineCosts = std::make_shared<GOPCosts>();
+            if (!(input >> identifier) || !readCosts(input, *baselineCosts))
+                fail();
+            identifierToCosts[identifier] = baselineCosts;
+        } else if (keyword == "query") {
+            unsigned int iteration, costsIdentifier;
+            std::vector<std::string> objects;
+            std::string temporalSelection;
+            if (!(input >> iteration) || !readSelection(input, objects, temporalSelection) || !(input >> costsIdentifier)
+                    || !identifierToCosts.count(costsIdentifier))
+                fail();
+
+            auto workload = workloadForQuery(objects, temporalSelection);
+            auto predicate = workload->semanticDataManagerForQuery(0)->predicate();
+            iterationToWorkload_[iteration] = workload;
+            iterationToBaselineCosts_[iteration] = identifierToCosts.at(costsIdentifier);
+            iterationToPredicate_[iteration] = predicate;
+            ++predicateToNumberOfIterations_[predicate];
+            auto &latestIteration = predicateToLatestIteration_[predicate];
+            latestIteration = std::max(latestIteration, iteration);
+        } else
+            fail();
+    }
+    return true;
+}
+
+bool RegretAccumulator::replayRecord(std::istream &record, unsigned long long snapshotRecords) {
+    unsigned long long number;
+    std::string kind;
+    if (!(record >> number >> kind))
+        return false;
+
+    std::string terminator;
+    if (kind == "query") {
+        std::vector<std::string> objects;
+        std::string temporalSelection;
+        auto baselineCosts = std::make_shared<GOPCosts>();
+        if (!readQuery(record, objects, temporalSelection, *baselineCosts) || !(record >> terminator) || terminator != RecordTerminator)
+            return false;
+        if (number > snapshotRecords)
+            addRegretForQueryWithBaselineCosts(workloadForQuery(objects, temporalSelection), baselineCosts);
+    } else if (kind == "cleared") {
+        unsigned int gop;
+        if (!(record >> gop >> terminator) || terminator != RecordTerminator)
+            return false;
+        if (number > snapshotRecords)
+            resetRegretForGOP(gop);
+    } else
+        return false;
+
+    numberOfRecords_ = std::max(numberOfRecords_, number);
+    return true;
+}
+
+void RegretAccumulator::writeSnapshot() {
+    auto snapshotPath = TileFiles::regretSnapshotFilename(videoPath_);
+    auto temporaryPath = snapshotPath.string() + ".tmp";
+    {
+        std::ofstream output(temporaryPath, std::ios::out | std::ios::trunc);
+        output << std::setprecision(std::numeric_limits<double>::max_digits10);
+        output << "regret-state " << SnapshotFormatVersion << "\n";
+        output << "selection " << std::quoted(metadataIdentifier_) << " " << width_ << " " << height_ << "\n";
+        output << "records " << numberOfRecords_ << "\n";
+        output << "iteration " << queryIteration_ << "\n";
+
+        // Layouts are written in the order that they were added because regret is added to them in that order.
+        for (const auto &label : labels_) {
+            const auto &objects = idToObjects_.at(label);
+            output << "layout " << std::quoted(label) << " " << objects.size();
+            for (const auto &object : objects)
+                output << " " << std::quoted(object);
+            output << "\n";
+        }
+        for (const auto &label : allObjects_)
+            output << "queried " << std::quoted(label) << "\n";
+
+        for (const auto &gopAndRegrets : gopToRegret_) {
+            // Regret that was made as low as possible may have overflowed to -inf, which cannot be read back.
+            for (const auto &labelAndRegret : gopAndRegrets.second)
+                output << "regret " << gopAndRegrets.first << " " << std::quoted(labelAndRegret.first) << " "
+                       << std::max(labelAndRegret.second, std::numeric_limits<double>::lowest()) << "\n";
+        }
+        for (const auto &gopAndIteration : gopToClearedIteration_)
+            output << "cleared " << gopAndIteration.first << " " << gopAndIteration.second << "\n";
+
+        std::unordered_map<const GOPCosts*, unsigned int> costsToIdentifier;
+        for (const auto &iterationAndCosts : iterationToBaselineCosts_) {
+            auto identifier = costsToIdentifier.emplace(iterationAndCosts.second.get(), costsToIdentifier.size());
+            if (!identifier.second)
+                continue;
+            output << "costs " << identifier.first->second << " ";
+            writeCosts(output, *iterationAndCosts.second);
+            output << "\n";
+        }
+        for (const auto &iterationAndWorkload : iterationToWorkload_) {
+            output << "query " << iterationAndWorkload.first << " ";
+            writeSelection(output, *iterationAndWorkload.second->semanticDataManagerForQuery(0));
+            output << " " << costsToIdentifier.at(iterationToBaselineCosts_.at(iterationAndWorkload.first).get()) << "\n";
+        }
+
+        if (!output.flush())
+            throw std::runtime_error("Failed to write regret state " + snapshotPath.string());
+    }
+    std::experimental::filesystem::rename(temporaryPath, snapshotPath);
+
+    log_.close();
+    log_.open(TileFiles::regretLogFilename(videoPath_), std::ios::out | std::ios::trunc);
+    numberOfRecordsSinceSnapshot_ = 0;
+}
+
+void RegretAccumulator::appendRecord(const std::string &record) {
+    log_ << ++numberOfRecords_ << " " << record << " " << RecordTerminator << "\n";
+    log_.flush();
+
+    if (++numberOfRecordsSinceSnapshot_ >= RecordsPerSnapshot)
+        writeSnapshot();
+}
+
 } // namespace tasm
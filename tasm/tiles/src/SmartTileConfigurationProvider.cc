@@ -1,6 +1,7 @@
 #include "SmartTileConfigurationProvider.h"
 
 #include <iostream>
+#include <limits>
 
 namespace tasm {
 
@@ -21,4 +22,42 @@ std::shared_ptr<TileLayout> SmartTileConfigurationProviderSingleSelection::tileL
     return layout;
 }
 
+std::shared_ptr<TileLayout> WorkloadTileConfigurationProvider::tileLayoutForFrame(unsigned int frame) {
+    return layoutForGOP(layoutIntervals_.intervalForFrame(frame)).layout;
+}
+
+double WorkloadTileConfigurationProvider::estimatedCostForFrame(unsigned int frame) {
+    return layoutForGOP(layoutIntervals_.intervalForFrame(frame)).cost;
+}
+
+const WorkloadTileConfigurationProvider::GOPLayout &WorkloadTileConfigurationProvider::layoutForGOP(unsigned int gop) {
+    auto existing = gopToLayout_.find(gop);
+    if (existing != gopToLayout_.end())
+        return existing->second;
+
+    GOPWorkload gopWorkload(*workload_, layoutIntervals_.firstFrameOfInterval(gop), layoutIntervals_.firstFrameOfInterval(gop + 1));
+    if (gopWorkload.empty())
+        return gopToLayout_.emplace(gop, GOPLayout{singleTileLayout_, 0}).first->second;
+
+    std::vector<std::shared_ptr<TileLayout>> candidates{singleTileLayout_};
+    std::vector<Rectangle> allObjects;
+    for (auto query = 0u; query < gopWorkload.numberOfQueries(); ++query) {
+        const auto &objects = gopWorkload.objectsForQuery(query);
+        allObjects.insert(allObjects.end(), objects.begin(), objects.end());
+        if (gopWorkload.numberOfQueries() > 1 && !objects.empty())
+            candidates.push_back(FineGrainedTileConfigurationProvider::layoutForRectangles(objects, frameWidth_, frameHeight_));
+    }
+    candidates.push_back(FineGrainedTileConfigurationProvider::layoutForRectangles(allObjects, frameWidth_, frameHeight_));
+    candidates.push_back(OptimizedTileConfigurationProvider::layoutForWorkload(gopWorkload, frameWidth_, frameHeight_, costProfile_));
+
+    // The single tile is first, so GOPs are only tiled when that is strictly cheaper.
+    GOPLayout best{nullptr, std::numeric_limits<double>::max()};
+    for (const auto &candidate : candidates) {
+        auto cost = OptimizedTileConfigurationProvider::estimatedCost(gopWorkload.estimateCost(*candidate), costProfile_);
+        if (cost < best.cost)
+            best = GOPLayout{candidate, cost};
+    }
+    return gopToLayout_.emplace(gop, best).first->second;
+}
+
 } // namespace tasm
\ No newline at end of file
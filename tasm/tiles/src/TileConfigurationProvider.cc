@@ -95,32 +95,37 @@ std::vector<unsigned int> FineGrainedTileConfigurationProvider::tileDimensions(c
 }
 
 std::shared_ptr<TileLayout> FineGrainedTileConfigurationProvider::tileLayoutForFrame(unsigned int frame) {
-    unsigned int tileGroupForFrame = frame / tileLayoutDuration_;
+    unsigned int tileGroupForFrame = layoutIntervals_.intervalForFrame(frame);
+    std::scoped_lock lock(mutex_);
     if (tileGroupToTileLayout_.count(tileGroupForFrame))
         return tileGroupToTileLayout_.at(tileGroupForFrame);
 
     // Get rectangles that are in the tile group.
-    auto firstFrameInGroup = tileGroupForFrame * tileLayoutDuration_;
-    auto lastFrameInGroupExclusive = (tileGroupForFrame + 1) * tileLayoutDuration_;
+    auto firstFrameInGroup = layoutIntervals_.firstFrameOfInterval(tileGroupForFrame);
+    auto lastFrameInGroupExclusive = layoutIntervals_.firstFrameOfInterval(tileGroupForFrame + 1);
     auto rectanglesForGroup = semanticDataManager_->rectanglesForFrames(firstFrameInGroup, lastFrameInGroupExclusive);
 
+    tileGroupToTileLayout_[tileGroupForFrame] = layoutForRectangles(std::vector<Rectangle>(rectanglesForGroup->begin(), rectanglesForGroup->end()), frameWidth_, frameHeight_);
+    return tileGroupToTileLayout_.at(tileGroupForFrame);
+}
+
+std::shared_ptr<TileLayout> FineGrainedTileConfigurationProvider::layoutForRectangles(const std::vector<Rectangle> &rectangles, unsigned int frameWidth, unsigned int frameHeight) {
     // Compute horizontal and vertical intervals for all of the rectangles.
-    std::vector<interval::Interval<int>> horizontalIntervals(rectanglesForGroup->size());
-    std::transform(rectanglesForGroup->begin(), rectanglesForGroup->end(), horizontalIntervals.begin(), [](Rectangle &rect) {
+    std::vector<interval::Interval<int>> horizontalIntervals(rectangles.size());
+    std::transform(rectangles.begin(), rectangles.end(), horizontalIntervals.begin(), [](const Rectangle &rect) {
         return interval::Interval<int>(rect.x, rect.x + rect.width);
     });
     std::sort(horizontalIntervals.begin(), horizontalIntervals.end());
-    auto tileWidths = horizontalIntervals.size() ? tileDimensions(horizontalIntervals, 256, frameWidth_) : std::vector<unsigned int>({ frameWidth_ });
+    auto tileWidths = horizontalIntervals.size() ? tileDimensions(horizontalIntervals, 256, frameWidth) : std::vector<unsigned int>({ frameWidth });
 
-    std::vector<interval::Interval<int>> verticalIntervals(rectanglesForGroup->size());
-    std::transform(rectanglesForGroup->begin(), rectanglesForGroup->end(), verticalIntervals.begin(), [](Rectangle &rect) {
+    std::vector<interval::Interval<int>> verticalIntervals(rectangles.size());
+    std::transform(rectangles.begin(), rectangles.end(), verticalIntervals.begin(), [](const Rectangle &rect) {
         return interval::Interval<int>(rect.y, rect.y + rect.height);
     });
     std::sort(verticalIntervals.begin(), verticalIntervals.end());
-    auto tileHeights = verticalIntervals.size() ? tileDimensions(verticalIntervals, 160, frameHeight_) : std::vector<unsigned int>({ frameHeight_ });
+    auto tileHeights = verticalIntervals.size() ? tileDimensions(verticalIntervals, 160, frameHeight) : std::vector<unsigned int>({ frameHeight });
 
-    tileGroupToTileLayout_[tileGroupForFrame] = std::make_shared<TileLayout>(tileWidths.size(), tileHeights.size(), tileWidths, tileHeights);
-    return tileGroupToTileLayout_.at(tileGroupForFrame);
+    return std::make_shared<TileLayout>(tileWidths.size(), tileHeights.size(), tileWidths, tileHeights);
 }
 
 } // namespace tasm
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include "TileLayout.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace tasm {
+
+std::pair<unsigned int, unsigned int> TileLayout::overlappingRange(const std::vector<unsigned int> &offsets, unsigned int start, unsigned int length) {
+    // The first column/row that ends after the start.
+    auto first = std::upper_bound(offsets.begin() + 1, offsets.end(), start) - (offsets.begin() + 1);
+    // One past the last column/row that begins before the end.
+    auto last = std::lower_bound(offsets.begin(), offsets.end() - 1, start + length) - offsets.begin();
+    return std::make_pair(first, std::max(first, last));
+}
+
+std::vector<unsigned int> TileLayout::tilesForRectangle(const Rectangle &rectangle) const {
+    auto columns = overlappingRange(columnOffsets_, rectangle.x, rectangle.width);
+    auto rows = overlappingRange(rowOffsets_, rectangle.y, rectangle.height);
+
+    std::vector<unsigned int> tiles;
+    tiles.reserve((columns.second - columns.first) * (rows.second - rows.first));
+    for (auto row = rows.first; row < rows.second; ++row) {
+        for (auto column = columns.first; column < columns.second; ++column)
+            tiles.push_back(row * numberOfColumns_ + column);
+    }
+    return tiles;
+}
+
+void TileLayout::addTilesForRectangle(const Rectangle &rectangle, TileMask &mask) const {
+    auto columns = overlappingRange(columnOffsets_, rectangle.x, rectangle.width);
+    auto rows = overlappingRange(rowOffsets_, rectangle.y, rectangle.height);
+    for (auto row = rows.first; row < rows.second; ++row) {
+        for (auto column = columns.first; column < columns.second; ++column)
+            mask.set(row * numberOfColumns_ + column);
+    }
+}
+
+unsigned int TileLayout::tileColumnForX(unsigned int x) const {
+    assert(x < totalWidth());
+    return std::upper_bound(columnOffsets_.begin() + 1, columnOffsets_.end(), x) - (columnOffsets_.begin() + 1);
+}
+
+unsigned int TileLayout::tileRowForY(unsigned int y) const {
+    assert(y < totalHeight());
+    return std::upper_bound(rowOffsets_.begin() + 1, rowOffsets_.end(), y) - (rowOffsets_.begin() + 1);
+}
+
+unsigned int TileLayout::tileNumberForCoordinate(unsigned int x, unsigned int y) const {
+    return tileRowForY(y) * numberOfColumns_ + tileColumnForX(x);
+}
+
+} // namespace tasm
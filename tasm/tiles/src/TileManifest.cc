@@ -0,0 +1,396 @@
+#include "TileManifest.h"
+
+#include "Files.h"
+#include "FrameLayoutRuns.h"
+#include "Gpac.h"
+#include "TileConfiguration.pb.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+
+namespace tasm {
+
+// Version 2 added each directory's storage format.
+static auto constexpr TILE_MANIFEST_VERSION = 2u;
+static auto constexpr TILE_CONFIGURATION_VERSION = 1u;
+
+namespace {
+
+// Serializes updates to a video's manifest across processes.
+class ManifestFileLock {
+public:
+    explicit ManifestFileLock(const std::experimental::filesystem::path &videoPath)
+        : descriptor_(open((TileFiles::tileManifestFilename(videoPath).string() + ".lock").c_str(), O_RDWR | O_CREAT, 0644)) {
+        if (descriptor_ < 0)
+            throw std::runtime_error("Failed to open the tile manifest lock for " + videoPath.string());
+        flock(descriptor_, LOCK_EX);
+    }
+
+    ManifestFileLock(const ManifestFileLock&) = delete;
+
+    ~ManifestFileLock() {
+        flock(descriptor_, LOCK_UN);
+        close(descriptor_);
+    }
+
+private:
+    int descriptor_;
+};
+
+} // namespace
+
+std::shared_ptr<const TileManifest> TileManifest::withDirectory(const TileDirectory &directory) const {
+    auto directories = directories_;
+    for (const auto &existing : directories) {
+        if (existing.firstFrame == directory.firstFrame && existing.lastFrame == directory.lastFrame && existing.tileVersion == directory.tileVersion)
+            return std::make_shared<const TileManifest>(std::move(directories));
+    }
+
+    // Share the layout with a directory that already uses it.
+    auto newDirectory = directory;
+    for (const auto &existing : directories) {
+        if (*existing.layout == *directory.layout) {
+            newDirectory.layout = existing.layout;
+            break;
+        }
+    }
+    directories.push_back(newDirectory);
+    return std::make_shared<const TileManifest>(std::move(directories));
+}
+
+std::shared_ptr<const TileManifest> TileManifest::withoutDirectories(const std::vector<TileDirectory> &directories) const {
+    std::vector<TileDirectory> remaining;
+    remaining.reserve(directories_.size());
+    for (const auto &existing : directories_) {
+        auto isRemoved = std::any_of(directories.begin(), directories.end(), [&](const TileDirectory &directory) {
+            return existing.firstFrame == directory.firstFrame && existing.lastFrame == directory.lastFrame && existing.tileVersion == directory.tileVersion;
+        });
+        if (!isRemoved)
+            remaining.push_back(existing);
+    }
+    return std::make_shared<const TileManifest>(std::move(remaining));
+}
+
+unsigned int TileManifest::newestTileVersion() const {
+    unsigned int newest = 0;
+    for (const auto &directory : directories_)
+        newest = std::max(newest, directory.tileVersion);
+    return newest;
+}
+
+std::vector<TileDirectory> TileManifest::shadowedDirectories(unsigned int newestTileVersion) const {
+    std::vector<const TileDirectory*> newestFirst;
+    for (const auto &directory : directories_) {
+        if (directory.tileVersion <= newestTileVersion)
+            newestFirst.push_back(&directory);
+    }
+    std::sort(newestFirst.begin(), newestFirst.end(), [](const TileDirectory *a, const TileDirectory *b) {
+        return a->tileVersion > b->tileVersion;
+    });
+
+    // Disjoint ranges of frames that newer directories contain, keyed by their first frame and mapped to their last.
+    std::map<unsigned int, unsigned int> covered;
+    std::vector<TileDirectory> shadowed;
+    for (const auto *directory : newestFirst) {
+        auto first = directory->firstFrame;
+        auto last = directory->lastFrame;
+
+        // The range that starts at or before the directory's first frame is the only one that can contain it.
+        auto containing = covered.upper_bound(first);
+        if (containing != covered.begin() && std::prev(containing)->second >= last) {
+            shadowed.push_back(*directory);
+            continue;
+        }
+
+        // Merge the directory's frames with the ranges that overlap or abut them.
+        auto it = covered.upper_bound(first);
+        if (it != covered.begin() && std::prev(it)->second + 1 >= first)
+            --it;
+        while (it != covered.end() && it->first <= last + 1) {
+            first = std::min(first, it->first);
+            last = std::max(last, it->second);
+            it = covered.erase(it);
+        }
+        covered[first] = last;
+    }
+    return shadowed;
+}
+
+std::shared_ptr<const TileManifest> TileManifest::read(const std::experimental::filesystem::path &videoPath) {
+    auto manifestPath = TileFiles::tileManifestFilename(videoPath);
+    auto descriptor = open(manifestPath.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        throw std::runtime_error("Failed to open tile manifest " + manifestPath.string());
+
+    struct stat status;
+    if (fstat(descriptor, &status)) {
+        close(descriptor);
+        throw std::runtime_error("Failed to stat tile manifest " + manifestPath.string());
+    }
+
+    lightdb::serialization::TileManifest serializedManifest;
+    if (status.st_size) {
+        auto data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        close(descriptor);
+        if (data == MAP_FAILED)
+            throw std::runtime_error("Failed to map tile manifest " + manifestPath.string());
+
+        auto parsed = serializedManifest.ParseFromArray(data, status.st_size);
+        munmap(data, status.st_size);
+        if (!parsed)
+            throw std::runtime_error("Failed to read tile manifest " + manifestPath.string());
+    } else
+        close(descriptor);
+
+    std::vector<std::shared_ptr<TileLayout>> layouts;
+    for (const auto &layout : serializedManifest.layouts()) {
+        std::vector<unsigned int> widthsOfColumns(layout.widthsofcolumns().begin(), layout.widthsofcolumns().end());
+        std::vector<unsigned int> heightsOfRows(layout.heightsofrows().begin(), layout.heightsofrows().end());
+        layouts.push_back(std::make_shared<TileLayout>(layout.numberofcolumns(), layout.numberofrows(), widthsOfColumns, heightsOfRows));
+    }
+
+    std::vector<TileDirectory> directories;
+    directories.reserve(serializedManifest.directories_size());
+    for (const auto &directory : serializedManifest.directories()) {
+        if (directory.layout() >= layouts.size())
+            throw std::runtime_error("Tile manifest " + manifestPath.string() + " refers to a missing layout");
+        directories.push_back({directory.firstframe(), directory.lastframe(), directory.tileversion(), layouts[directory.layout()],
+                               directory.storageformat() == lightdb::serialization::PACKED ? TileStorageFormat::Packed : TileStorageFormat::MP4});
+    }
+    return std::make_shared<const TileManifest>(std::move(directories));
+}
+
+std::shared_ptr<const TileManifest> TileManifest::scan(const std::experimental::filesystem::path &videoPath) {
+    std::unordered_map<TileLayout, std::shared_ptr<TileLayout>> layouts;
+    std::vector<TileDirectory> directories;
+    for (auto &dir : std::experimental::filesystem::directory_iterator(videoPath)) {
+        // Directories without tile metadata belong to transactions that did not commit.
+        if (!std::experimental::filesystem::is_directory(dir.status())
+                || !std::experimental::filesystem::exists(TileFiles::tileMetadataFilename(dir.path())))
+            continue;
+
+        auto directory = tileDirectoryFromPath(dir.path());
+        auto layout = layouts.emplace(*directory.layout, directory.layout).first;
+        directory.layout = layout->second;
+        directories.push_back(directory);
+    }
+    return std::make_shared<const TileManifest>(std::move(directories));
+}
+
+void TileManifest::write(const std::experimental::filesystem::path &videoPath) const {
+    lightdb::serialization::TileManifest serializedManifest;
+    serializedManifest.set_version(TILE_MANIFEST_VERSION);
+
+    std::unordered_map<TileLayout, unsigned int> layoutToIndex;
+    for (const auto &directory : directories_) {
+        auto layout = layoutToIndex.emplace(*directory.layout, layoutToIndex.size());
+        if (layout.second) {
+            auto serializedLayout = serializedManifest.add_layouts();
+            serializedLayout->set_version(TILE_CONFIGURATION_VERSION);
+            serializedLayout->set_numberofcolumns(directory.layout->numberOfColumns());
+            serializedLayout->set_numberofrows(directory.layout->numberOfRows());
+            for (auto width : directory.layout->widthsOfColumns())
+                serializedLayout->add_widthsofcolumns(width);
+            for (auto height : directory.layout->heightsOfRows())
+                serializedLayout->add_heightsofrows(height);
+        }
+
+        auto serializedDirectory = serializedManifest.add_directories();
+        serializedDirectory->set_firstframe(directory.firstFrame);
+        serializedDirectory->set_lastframe(directory.lastFrame);
+        serializedDirectory->set_tileversion(directory.tileVersion);
+        serializedDirectory->set_layout(layout.first->second);
+        serializedDirectory->set_storageformat(directory.storageFormat == TileStorageFormat::Packed ? lightdb::serialization::PACKED : lightdb::serialization::MP4);
+    }
+
+    auto manifestPath = TileFiles::tileManifestFilename(videoPath);
+    auto temporaryPath = manifestPath.string() + ".tmp";
+    {
+        std::fstream output(temporaryPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!serializedManifest.SerializeToOstream(&output) || !output.flush())
+            throw std::runtime_error("Failed to write tile manifest " + manifestPath.string());
+    }
+    std::experimental::filesystem::rename(temporaryPath, manifestPath);
+}
+
+TileDirectory TileManifest::tileDirectoryFromPath(const std::experimental::filesystem::path &tileDirectoryPath) {
+    auto firstAndLastFrame = TileFiles::firstAndLastFramesFromPath(tileDirectoryPath);
+    return {firstAndLastFrame.first,
+            firstAndLastFrame.second,
+            TileFiles::tileVersionFromPath(tileDirectoryPath),
+            std::make_shared<TileLayout>(gpac::load_tile_configuration(TileFiles::tileMetadataFilename(tileDirectoryPath))),
+            std::experimental::filesystem::exists(TileFiles::tilePackFilename(tileDirectoryPath)) ? TileStorageFormat::Packed : TileStorageFormat::MP4};
+}
+
+TileManifestCache &TileManifestCache::instance() {
+    static TileManifestCache cache;
+    return cache;
+}
+
+TileVersionPin::~TileVersionPin() {
+    TileManifestCache::instance().unpin(videoPath_, manifest_);
+}
+
+std::shared_ptr<const TileManifest> TileManifestCache::manifest(const std::experimental::filesystem::path &videoPath) {
+    std::scoped_lock lock(mutex_);
+    return manifestWithMutex(videoPath);
+}
+
+std::shared_ptr<const TileManifest> TileManifestCache::pinnedManifest(const std::experimental::filesystem::path &videoPath, std::unique_ptr<const TileVersionPin> &pin) {
+    // Pin while holding the mutex so that compaction cannot delete a directory between loading and pinning.
+    std::scoped_lock lock(mutex_);
+    auto manifest = manifestWithMutex(videoPath);
+    videoToPinnedManifests_[videoPath.string()].push_back(manifest);
+    pin.reset(new TileVersionPin(videoPath.string(), manifest));
+    return manifest;
+}
+
+std::shared_ptr<const FrameLayoutRuns> TileManifestCache::frameLayoutRuns(const std::experimental::filesystem::path &videoPath, const std::shared_ptr<const TileManifest> &manifest) {
+    {
+        std::scoped_lock lock(mutex_);
+        auto cached = videoToManifest_.find(videoPath.string());
+        if (cached != videoToManifest_.end() && cached->second.manifest == manifest && cached->second.frameLayoutRuns)
+            return cached->second.frameLayoutRuns;
+    }
+
+    // Build the runs without holding the mutex so that queries on other videos are not blocked. Queries that race to
+    // build the same runs all use the first ones that are cached.
+    auto runs = FrameLayoutRuns::forManifest(videoPath, *manifest);
+
+    std::scoped_lock lock(mutex_);
+    auto cached = videoToManifest_.find(videoPath.string());
+    if (cached == videoToManifest_.end() || cached->second.manifest != manifest)
+        return runs;
+    if (!cached->second.frameLayoutRuns)
+        cached->second.frameLayoutRuns = runs;
+    return cached->second.frameLayoutRuns;
+}
+
+void TileManifestCache::unpin(const std::string &videoPath, const std::shared_ptr<const TileManifest> &manifest) {
+    std::scoped_lock lock(mutex_);
+    auto &pinnedManifests = videoToPinnedManifests_.at(videoPath);
+    pinnedManifests.erase(std::find(pinnedManifests.begin(), pinnedManifests.end(), manifest));
+    if (pinnedManifests.empty())
+        videoToPinnedManifests_.erase(videoPath);
+}
+
+std::shared_ptr<const TileManifest> TileManifestCache::manifestWithMutex(const std::experimental::filesystem::path &videoPath) {
+    FileVersion fileVersion;
+    if (manifestFileVersion(videoPath, fileVersion)) {
+        auto cached = videoToManifest_.find(videoPath.string());
+        if (cached != videoToManifest_.end() && cached->second.fileVersion == fileVersion)
+            return cached->second.manifest;
+
+        auto manifest = TileManifest::read(videoPath);
+        videoToManifest_[videoPath.string()] = {manifest, fileVersion, nullptr};
+        return manifest;
+    }
+
+    // The video was tiled before manifests existed, so create its manifest.
+    ManifestFileLock fileLock(videoPath);
+    auto manifest = loadWithLock(videoPath);
+    if (!std::experimental::filesystem::exists(TileFiles::tileManifestFilename(videoPath)))
+        manifest->write(videoPath);
+    cache(videoPath, manifest);
+    return manifest;
+}
+
+void TileManifestCache::addDirectory(const std::experimental::filesystem::path &videoPath, const TileDirectory &directory) {
+    std::scoped_lock lock(mutex_);
+    ManifestFileLock fileLock(videoPath);
+
+    // Always start from the manifest on disk because other processes may have committed since it was cached.
+    auto manifest = loadWithLock(videoPath)->withDirectory(directory);
+    manifest->write(videoPath);
+    cache(videoPath, manifest);
+}
+
+TileCompaction TileManifestCache::compact(const std::experimental::filesystem::path &videoPath) {
+    TileCompaction compaction;
+    std::vector<TileDirectory> deletable;
+    {
+        std::scoped_lock lock(mutex_);
+        ManifestFileLock fileLock(videoPath);
+        auto manifest = loadWithLock(videoPath);
+
+        // A reader with a pinned manifest only reads the directories that the manifest lists and does not shadow.
+        using DirectoryKey = std::tuple<unsigned int, unsigned int, unsigned int>;
+        auto key = [](const TileDirectory &directory) {
+            return DirectoryKey(directory.firstFrame, directory.lastFrame, directory.tileVersion);
+        };
+        std::set<DirectoryKey> readable;
+        auto pinnedManifests = videoToPinnedManifests_.find(videoPath.string());
+        if (pinnedManifests != videoToPinnedManifests_.end()) {
+            std::set<const TileManifest*> visited;
+            for (const auto &pinned : pinnedManifests->second) {
+                if (!visited.insert(pinned.get()).second)
+                    continue;
+                std::set<DirectoryKey> shadowed;
+                for (const auto &directory : pinned->shadowedDirectories())
+                    shadowed.insert(key(directory));
+                for (const auto &directory : pinned->directories()) {
+                    if (!shadowed.count(key(directory)))
+                        readable.insert(key(directory));
+                }
+            }
+        }
+
+        for (const auto &directory : manifest->shadowedDirectories()) {
+            if (!directory.tileVersion)
+                continue;
+            if (readable.count(key(directory)))
+                ++compaction.numberOfPinnedDirectories;
+            else
+                deletable.push_back(directory);
+        }
+
+        if (deletable.empty())
+            return compaction;
+
+        // Readers only find directories through the manifest, so once it is rewritten no new reader can see them.
+        manifest = manifest->withoutDirectories(deletable);
+        manifest->write(videoPath);
+        cache(videoPath, manifest);
+    }
+
+    for (const auto &directory : deletable) {
+        auto directoryPath = TileFiles::directoryForTilesInFrames(videoPath, directory.firstFrame, directory.lastFrame, directory.tileVersion);
+        // Remove the metadata first so that a directory that is only partly removed looks uncommitted to scan().
+        std::experimental::filesystem::remove(TileFiles::tileMetadataFilename(directoryPath));
+        std::experimental::filesystem::remove_all(directoryPath);
+    }
+    compaction.numberOfDeletedDirectories = deletable.size();
+    return compaction;
+}
+
+std::shared_ptr<const TileManifest> TileManifestCache::loadWithLock(const std::experimental::filesystem::path &videoPath) {
+    if (std::experimental::filesystem::exists(TileFiles::tileManifestFilename(videoPath)))
+        return TileManifest::read(videoPath);
+    else
+        return TileManifest::scan(videoPath);
+}
+
+void TileManifestCache::cache(const std::experimental::filesystem::path &videoPath, std::shared_ptr<const TileManifest> manifest) {
+    FileVersion fileVersion;
+    if (manifestFileVersion(videoPath, fileVersion))
+        videoToManifest_[videoPath.string()] = {std::move(manifest), fileVersion, nullptr};
+}
+
+bool TileManifestCache::manifestFileVersion(const std::experimental::filesystem::path &videoPath, FileVersion &fileVersion) {
+    struct stat status;
+    if (stat(TileFiles::tileManifestFilename(videoPath).c_str(), &status))
+        return false;
+
+    fileVersion.inode = status.st_ino;
+    fileVersion.modificationTimeNs = static_cast<long long>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+    return true;
+}
+
+} // namespace tasm
@@ -0,0 +1,44 @@
+#include "TileQualityProvider.h"
+
+#include "SemanticDataManager.h"
+#include "WorkloadCostEstimator.h"
+
+#include <algorithm>
+
+namespace tasm {
+
+std::vector<unsigned int> SemanticTileQualityProvider::quantizationParametersForFrame(unsigned int frame, const TileLayout &layout) {
+    auto interval = layoutIntervals_.intervalForFrame(frame);
+    if (cachedInterval_ != interval) {
+        auto firstFrameInclusive = layoutIntervals_.firstFrameOfInterval(interval);
+        auto lastFrameExclusive = layoutIntervals_.firstFrameOfInterval(interval + 1);
+        rectanglesInInterval_.clear();
+        for (auto i = 0u; i < workload_->numberOfQueries(); ++i) {
+            auto semanticDataManager = workload_->semanticDataManagerForQuery(i);
+            auto rectangles = semanticDataManager->rectanglesForFrames(firstFrameInclusive, lastFrameExclusive);
+            std::copy_if(rectangles->begin(), rectangles->end(), std::back_inserter(rectanglesInInterval_), [&](const Rectangle &rectangle) {
+                return semanticDataManager->isFrameInSelection(rectangle.id);
+            });
+        }
+        cachedInterval_ = interval;
+        cachedLayout_.reset();
+    }
+
+    if (cachedLayout_ && *cachedLayout_ == layout)
+        return quantizationParameters_;
+
+    std::vector<unsigned int> quantizationParameters(layout.numberOfTiles(), quality_.backgroundQuantizationParameter);
+    for (auto tile = 0u; tile < layout.numberOfTiles(); ++tile) {
+        auto tileRectangle = layout.rectangleForTile(tile);
+        auto containsObject = std::any_of(rectanglesInInterval_.begin(), rectanglesInInterval_.end(), [&](const Rectangle &rectangle) {
+            return rectangle.intersects(tileRectangle);
+        });
+        if (containsObject)
+            quantizationParameters[tile] = quality_.objectQuantizationParameter;
+    }
+    cachedLayout_.emplace(layout);
+    quantizationParameters_ = quantizationParameters;
+    return quantizationParameters;
+}
+
+} // namespace tasm
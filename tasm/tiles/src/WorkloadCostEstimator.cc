@@ -2,6 +2,8 @@
 
 #include "SemanticDataManager.h"
 
+#include <algorithm>
+
 namespace tasm {
 
 
@@ -10,6 +12,53 @@ std::ostream &operator<<(std::ostream &ostr, const CostElements &c) {
     return ostr;
 }
 
+GOPWorkload::GOPWorkload(const Workload &workload, unsigned int firstFrameInclusive, unsigned int lastFrameExclusive)
+    : firstFrame_(firstFrameInclusive),
+    queryCounts_(workload.numberOfQueries()),
+    objectsForQuery_(workload.numberOfQueries()) {
+    for (auto i = 0u; i < workload.numberOfQueries(); ++i) {
+        queryCounts_[i] = workload.numberOfTimesQueryIsExecuted(i);
+        auto semanticDataManager = workload.semanticDataManagerForQuery(i);
+        auto rectangles = semanticDataManager->rectanglesForFrames(firstFrameInclusive, lastFrameExclusive);
+        auto &objects = objectsForQuery_[i];
+        objects.reserve(rectangles->size());
+        std::copy_if(rectangles->begin(), rectangles->end(), std::back_inserter(objects), [&](const Rectangle &rectangle) {
+            return semanticDataManager->isFrameInSelection(rectangle.id);
+        });
+    }
+}
+
+bool GOPWorkload::empty() const {
+    return std::all_of(objectsForQuery_.begin(), objectsForQuery_.end(), [](const auto &objects) {
+        return objects.empty();
+    });
+}
+
+CostElements GOPWorkload::estimateCost(const TileLayout &layout) const {
+    CostElements results(0, 0);
+    std::vector<int> maxFrameOverlappingTile(layout.numberOfTiles());
+    for (auto i = 0u; i < objectsForQuery_.size(); ++i) {
+        std::fill(maxFrameOverlappingTile.begin(), maxFrameOverlappingTile.end(), -1);
+        for (const auto &object : objectsForQuery_[i]) {
+            for (auto tile : layout.tilesForRectangle(object))
+                maxFrameOverlappingTile[tile] = std::max(maxFrameOverlappingTile[tile], static_cast<int>(object.id));
+        }
+
+        unsigned long long numPixels = 0;
+        unsigned long long numTiles = 0;
+        for (auto tile = 0u; tile < maxFrameOverlappingTile.size(); ++tile) {
+            if (maxFrameOverlappingTile[tile] < 0)
+                continue;
+
+            unsigned int numFrames = maxFrameOverlappingTile[tile] - firstFrame_ + 1;
+            numTiles += numFrames;
+            numPixels += static_cast<unsigned long long>(layout.rectangleForTile(tile).area()) * numFrames;
+        }
+        results.add(CostElements(queryCounts_[i] * numPixels, queryCounts_[i] * numTiles));
+    }
+    return results;
+}
+
 CostElements WorkloadCostEstimator::estimateCostForQuery(unsigned int queryNum, std::unordered_map<unsigned int, CostElements> *costByGOP) {
     auto semanticDataManager = workload_->semanticDataManagerForQuery(queryNum);
     auto start = semanticDataManager->orderedFrames().begin();
@@ -54,15 +103,9 @@ std::pair<int, CostElements> WorkloadCostEstimator::estimateCostForNextGOP(std::
     auto numberOfTiles = layoutForGOP->numberOfTiles();
     std::vector<int> maxFrameOverlappingTile(numberOfTiles, -1);
     while (currentFrame != end && gopForFrame(*currentFrame) == gopNum) {
-        auto &rectanglesForFrame = metadataManager->rectanglesForFrame(*currentFrame);
-        for (auto i = 0u; i < numberOfTiles; ++i) {
-            auto tileRect = layoutForGOP->rectangleForTile(i);
-            bool anyIntersect = std::any_of(rectanglesForFrame.begin(), rectanglesForFrame.end(), [&](auto &rectangle) {
-                return tileRect.intersects(rectangle);
-            });
-            if (anyIntersect)
-                maxFrameOverlappingTile[i] = *currentFrame;
-        }
+        auto tiles = layoutForGOP->tilesForRectangles(metadataManager->rectanglesForFrame(*currentFrame));
+        for (auto tile = tiles.find_first(); tile != TileMask::npos; tile = tiles.find_next(tile))
+            maxFrameOverlappingTile[tile] = *currentFrame;
         ++currentFrame;
     }
 
@@ -0,0 +1,27 @@
+#ifndef TASM_CANCELLATIONTOKEN_H
+#define TASM_CANCELLATIONTOKEN_H
+
+#include <atomic>
+
+namespace tasm {
+
+// Shared by the operators of a single query so that a consumer can stop the scan and decode threads before
+// the query has produced all of its results.
+class CancellationToken {
+public:
+    CancellationToken()
+        : isCancelled_(false)
+    {}
+
+    CancellationToken(const CancellationToken&) = delete;
+
+    void cancel() { isCancelled_ = true; }
+    bool isCancelled() const { return isCancelled_; }
+
+private:
+    std::atomic_bool isCancelled_;
+};
+
+} // namespace tasm
+
+#endif //TASM_CANCELLATIONTOKEN_H
@@ -0,0 +1,96 @@
+#ifndef TASM_COSTMODEL_H
+#define TASM_COSTMODEL_H
+
+#include <array>
+#include <experimental/filesystem>
+#include <mutex>
+
+namespace tasm {
+class QueryStats;
+
+// The coefficients of the models that estimate how long it takes to decode tiles and to encode GOPs, in milliseconds.
+// The defaults were fit on a single GPU; tasm_calibrate measures them on the current machine.
+struct CostProfile {
+    double decodeCostPerPixel = 1.608e-06;
+    // For each frame of each tile that is decoded.
+    double decodeCostPerTile = 1.703e-01;
+    // For each time the decoder is reconfigured for a tile with different dimensions. The layout estimators do not
+    // count reconfigurations, so this only keeps them from skewing the other coefficients when they are fit.
+    double decodeCostPerReconfiguration = 0;
+    double encodeCostPerPixel = 3.206e-06;
+    // The fixed cost of encoding a GOP.
+    double encodeCostPerGOP = 2.592;
+    // A layout is only worth switching to when it decodes at most this fraction of the pixels that not tiling does.
+    double tilingPixelThreshold = 0.8;
+
+    double decodeCost(double numPixels, double numTiles) const {
+        return decodeCostPerPixel * numPixels + decodeCostPerTile * numTiles;
+    }
+
+    double encodeCostForGOP(double numPixels) const {
+        return encodeCostPerPixel * numPixels + encodeCostPerGOP;
+    }
+
+    // Profiles are text files with a "name value" line for each coefficient. Coefficients that are missing keep their
+    // defaults.
+    void write(const std::experimental::filesystem::path &path) const;
+    static CostProfile read(const std::experimental::filesystem::path &path);
+};
+
+// The cost profile that the layout and regret estimators use. Queries refine its decode coefficients as they finish:
+// each query's decode time is fit against the pixels, tile frames, and decoder reconfigurations that it decoded, with
+// the profile that was loaded acting as a prior worth PriorObservations queries. Refinements are saved to the profile
+// every ObservationsPerSave queries.
+class CostModel {
+public:
+    // Does not save refinements.
+    explicit CostModel(CostProfile profile = CostProfile());
+
+    // Loads the profile at `path` if it exists, and saves refinements to it.
+    explicit CostModel(const std::experimental::filesystem::path &path);
+
+    CostModel(const CostModel&) = delete;
+
+    CostProfile profile() const;
+    // Replaces the profile, and discards the observations that refined the previous one.
+    void setProfile(const CostProfile &profile);
+
+    // Refines the decode coefficients from a finished query's statistics.
+    void observe(const QueryStats &stats);
+    unsigned int numberOfObservations() const;
+
+    // Loaded from EnvironmentConfiguration's cost profile path the first time it is used.
+    static CostModel &instance();
+
+    // The time that the decoder's worker thread spent decoding a query's frames. The scan that feeds the decoder runs on
+    // another thread, so operator times cannot separate the two.
+    static double decodeTimeInMilliseconds(const QueryStats &stats);
+
+    static constexpr double PriorObservations = 4;
+    static constexpr unsigned int ObservationsPerSave = 16;
+
+private:
+    static constexpr unsigned int NumberOfDecodeTerms = 3;
+    using DecodeTerms = std::array<double, NumberOfDecodeTerms>;
+
+    void resetObservations();
+    DecodeTerms decodeTermScales() const;
+    void refineDecodeCoefficients();
+
+    mutable std::mutex mutex_;
+    const std::experimental::filesystem::path path_;
+    // The profile that observations refine.
+    CostProfile priorProfile_;
+    CostProfile profile_;
+
+    // Observations are fit as multiples of each term's scale so that the terms are of similar magnitude.
+    // gram_[i * NumberOfDecodeTerms + j] sums the products of the scaled terms i and j, and moments_[i] sums the
+    // products of scaled term i with the decode time.
+    std::array<double, NumberOfDecodeTerms * NumberOfDecodeTerms> gram_;
+    DecodeTerms moments_;
+    unsigned int numberOfObservations_;
+};
+
+} // namespace tasm
+
+#endif //TASM_COSTMODEL_H
@@ -1,8 +1,11 @@
 #ifndef TASM_ENVIRONMENTCONFIGURATION_H
 #define TASM_ENVIRONMENTCONFIGURATION_H
 
+#include "TileStorageFormat.h"
+
 #include <experimental/filesystem>
 #include <optional>
+#include <stdexcept>
 #include <unordered_map>
 
 namespace tasm {
@@ -11,13 +14,46 @@ class EnvironmentConfiguration {
 public:
     static constexpr auto DefaultLabelsDB = "default_db_path";
     static constexpr auto CatalogPath = "catalog_path";
+    // Either "mp4" (the default) or "packed".
+    static constexpr auto TileFormat = "tile_storage_format";
+    // How many tiles ahead of the decoder to read, and how many bytes of GOPs to buffer. A budget of 0 disables reading
+    // ahead.
+    static constexpr auto ReadAheadDepth = "read_ahead_depth";
+    static constexpr auto ReadAheadBytes = "read_ahead_bytes";
+    // The cost profile that tasm_calibrate writes; see CostModel. Defaults to "cost-profile" in the catalog.
+    static constexpr auto CostProfilePath = "cost_profile_path";
+    // The quantization parameters that tiles are encoded with when a video is tiled around objects in the semantic
+    // index. Tiles without objects in a GOP use the background value, which defaults to the object value. Both must be
+    // between 0 and 51.
+    static constexpr auto ObjectTileQP = "object_tile_qp";
+    static constexpr auto BackgroundTileQP = "background_tile_qp";
+    // Whether to delete the tile directories that re-tiling shadows; "true" or "false" (the default). Only queries in
+    // this process keep the directories they read from being deleted, so only enable it when no other process reads
+    // the catalog.
+    static constexpr auto CompactTiles = "compact_tiles";
     EnvironmentConfiguration(const std::unordered_map<std::string, std::string> &configOptions = {})
         : labelsDatabasePath_(configOptions.count(DefaultLabelsDB) ? configOptions.at(DefaultLabelsDB) : defaultDBPath),
-        catalogPath_(configOptions.count(CatalogPath) ? configOptions.at(CatalogPath) : defaultCatalogPath)
+        catalogPath_(configOptions.count(CatalogPath) ? configOptions.at(CatalogPath) : defaultCatalogPath),
+        tileStorageFormat_(configOptions.count(TileFormat) ? tileStorageFormatFromString(configOptions.at(TileFormat)) : TileStorageFormat::MP4),
+        readAheadDepth_(configOptions.count(ReadAheadDepth) ? std::stoul(configOptions.at(ReadAheadDepth)) : defaultReadAheadDepth),
+        readAheadBytes_(configOptions.count(ReadAheadBytes) ? std::stoull(configOptions.at(ReadAheadBytes)) : defaultReadAheadBytes),
+        costProfilePath_(configOptions.count(CostProfilePath) ? std::experimental::filesystem::path(configOptions.at(CostProfilePath)) : catalogPath_ / defaultCostProfileFilename),
+        objectTileQP_(configOptions.count(ObjectTileQP) ? quantizationParameterFromString(ObjectTileQP, configOptions.at(ObjectTileQP)) : defaultTileQP),
+        backgroundTileQP_(configOptions.count(BackgroundTileQP) ? quantizationParameterFromString(BackgroundTileQP, configOptions.at(BackgroundTileQP)) : objectTileQP_),
+        compactTiles_(configOptions.count(CompactTiles) ? booleanFromString(CompactTiles, configOptions.at(CompactTiles)) : false)
     { }
 
     const std::experimental::filesystem::path &defaultLabelsDatabasePath() const { return labelsDatabasePath_; };
     const std::experimental::filesystem::path &catalogPath() const { return catalogPath_; }
+    // The format that new tile directories are written in. Existing directories are read in whatever format they were
+    // written in.
+    TileStorageFormat tileStorageFormat() const { return tileStorageFormat_; }
+    unsigned int readAheadDepth() const { return readAheadDepth_; }
+    unsigned long long readAheadBytes() const { return readAheadBytes_; }
+    const std::experimental::filesystem::path &costProfilePath() const { return costProfilePath_; }
+    unsigned int objectTileQP() const { return objectTileQP_; }
+    unsigned int backgroundTileQP() const { return backgroundTileQP_; }
+    bool compactTiles() const { return compactTiles_; }
 
     static const EnvironmentConfiguration & instance() {
         if (instance_.has_value())
@@ -30,10 +66,49 @@ public:
     static const EnvironmentConfiguration &instance(EnvironmentConfiguration config) { return instance_.emplace(config); }
 
 private:
+    static TileStorageFormat tileStorageFormatFromString(const std::string &format) {
+        if (format == "mp4")
+            return TileStorageFormat::MP4;
+        else if (format == "packed")
+            return TileStorageFormat::Packed;
+        else
+            throw std::invalid_argument("Unknown tile storage format: " + format);
+    }
+
+    static bool booleanFromString(const std::string &option, const std::string &value) {
+        if (value == "true")
+            return true;
+        else if (value == "false")
+            return false;
+        else
+            throw std::invalid_argument("Expected true or false for " + option + ": " + value);
+    }
+
+    static unsigned int quantizationParameterFromString(const std::string &option, const std::string &value) {
+        auto quantizationParameter = std::stoul(value);
+        if (quantizationParameter > maximumTileQP)
+            throw std::invalid_argument("Expected a quantization parameter between 0 and " + std::to_string(maximumTileQP) + " for " + option + ": " + value);
+        return quantizationParameter;
+    }
+
     std::experimental::filesystem::path labelsDatabasePath_;
     std::experimental::filesystem::path catalogPath_;
+    TileStorageFormat tileStorageFormat_;
+    unsigned int readAheadDepth_;
+    unsigned long long readAheadBytes_;
+    std::experimental::filesystem::path costProfilePath_;
+    unsigned int objectTileQP_;
+    unsigned int backgroundTileQP_;
+    bool compactTiles_;
     static constexpr auto defaultDBPath = "labels.db";
     static constexpr auto defaultCatalogPath = "resources";
+    static constexpr unsigned int defaultReadAheadDepth = 8;
+    static constexpr unsigned long long defaultReadAheadBytes = 64ull << 20u;
+    static constexpr auto defaultCostProfileFilename = "cost-profile";
+    // The quantization parameter that EncodeConfiguration uses.
+    static constexpr unsigned int defaultTileQP = 28;
+    // The largest quantization parameter that NVENC accepts for H.264 and HEVC.
+    static constexpr unsigned int maximumTileQP = 51;
 
     static std::optional<EnvironmentConfiguration> instance_;
 };
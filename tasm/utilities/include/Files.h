@@ -15,9 +15,34 @@ public:
         return path / tile_metadata_filename_;
     }
 
+    static std::experimental::filesystem::path tileManifestFilename(const std::experimental::filesystem::path &videoPath) {
+        return videoPath / tile_manifest_filename_;
+    }
+
+    // Records the layout intervals that a video was stored with.
+    static std::experimental::filesystem::path layoutIntervalsFilename(const std::experimental::filesystem::path &videoPath) {
+        return videoPath / layout_intervals_filename_;
+    }
+
+    // Regret-based tiling state: a snapshot, and a log of the queries and re-tiled GOPs since it was written.
+    static std::experimental::filesystem::path regretSnapshotFilename(const std::experimental::filesystem::path &videoPath) {
+        return videoPath / regret_snapshot_filename_;
+    }
+
+    static std::experimental::filesystem::path regretLogFilename(const std::experimental::filesystem::path &videoPath) {
+        return videoPath / regret_log_filename_;
+    }
+
     static std::experimental::filesystem::path directoryForTilesInFrames(const TiledEntry &entry, unsigned int firstFrame,
                                                            unsigned int lastFrame) {
-        return entry.path()  / (std::to_string(firstFrame) + separating_string_ + std::to_string(lastFrame) + separating_string_ + std::to_string(entry.tile_version()));
+        return directoryForTilesInFrames(entry.path(), firstFrame, lastFrame, entry.tile_version());
+    }
+
+    static std::experimental::filesystem::path directoryForTilesInFrames(const std::experimental::filesystem::path &videoPath,
+                                                                         unsigned int firstFrame,
+                                                                         unsigned int lastFrame,
+                                                                         unsigned int tileVersion) {
+        return videoPath / (std::to_string(firstFrame) + separating_string_ + std::to_string(lastFrame) + separating_string_ + std::to_string(tileVersion));
     }
 
     static std::experimental::filesystem::path temporaryTileFilename(const TiledEntry &entry, unsigned int tileNumber,
@@ -32,6 +57,11 @@ public:
         return directoryPath / (baseTileFilename(tileNumber) + muxedFilenameExtension());
     }
 
+    // The file that holds every tile of a directory that is stored as a TilePack.
+    static std::experimental::filesystem::path tilePackFilename(const std::experimental::filesystem::path &directoryPath) {
+        return directoryPath / tile_pack_filename_;
+    }
+
     static std::string muxedFilenameExtension() {
         return ".mp4";
     }
@@ -74,6 +104,11 @@ private:
 
     static constexpr auto tile_version_filename_ = "tile-version";
     static constexpr auto tile_metadata_filename_ = "tile-metadata.bin";
+    static constexpr auto tile_manifest_filename_ = "tile-manifest.bin";
+    static constexpr auto tile_pack_filename_ = "tiles.pack";
+    static constexpr auto layout_intervals_filename_ = "layout-intervals";
+    static constexpr auto regret_snapshot_filename_ = "regret-snapshot";
+    static constexpr auto regret_log_filename_ = "regret-log";
     static constexpr auto separating_string_ = "-";
 };
 
@@ -3,7 +3,6 @@
 
 #include <algorithm>
 #include <vector>
-#include <unordered_map>
 
 namespace tasm {
 
@@ -23,54 +22,87 @@ private:
     int id_;
 };
 
+// A centered interval tree over closed intervals.
+// Nodes are stored in a single array in pre-order, and the intervals that overlap each node's center are stored
+// contiguously in two arrays: one sorted by ascending left endpoint and one sorted by descending right endpoint.
+// Queries walk down the array and binary search within each node, so they take O(log n + k).
 // TODO: Won't work for floating point intervals because doesn't use epsilon=.
 template <typename T>
 class IntervalTree {
 public:
-    IntervalTree() {}
-
-    IntervalTree(T lowerBound, T upperBound, std::vector<IntervalEntry<T>> &intervals)
-            : id_(0),
-              lowerBound_(lowerBound),
-              upperBound_(upperBound)
+    IntervalTree()
+            : lowerBound_(), upperBound_()
+    {}
+
+    IntervalTree(T lowerBound, T upperBound, const std::vector<IntervalEntry<T>> &intervals)
+            : lowerBound_(lowerBound),
+              upperBound_(upperBound),
+              intervals_(intervals)
     {
-        root_ = build(lowerBound_, upperBound_, intervals);
+        rebuild();
     }
 
-    void query(T queryPoint, std::vector<IntervalEntry<T>> &results, int startingNode = 0) const {
-        auto center = nodeToCenterPoint_.at(startingNode);
-        auto &overlappingByAscendingLeft = nodeToSortedLeft_.at(startingNode);
-        if (queryPoint == center) {
-            // The query point is the center, so add all of the intervals that intersect the center node.
-            results.insert(results.end(), overlappingByAscendingLeft.begin(), overlappingByAscendingLeft.end());
-        } else if (queryPoint < center) {
-            // Look at intervals in the left subtree.
-            // First find the intervals that overlap the center point and also overlap the query point.
-            // it points to the first interval that starts after the query point, and therefor no following intervals could
-            // cover the query point.
-            auto it = std::find_if(overlappingByAscendingLeft.begin(), overlappingByAscendingLeft.end(), [&](const IntervalEntry<T> &entry) {
-                return entry.l() > queryPoint;
-            });
-            results.insert(results.end(), overlappingByAscendingLeft.begin(), it);
-            auto leftChild = nodeToLeftChild_.at(startingNode);
-            if (leftChild != -1)
-                query(queryPoint, results, leftChild);
-        } else {
-            // Find the first interval that ends before the query point.
-            auto &overlappingByDescendingRight = nodeToSortedRight_.at(startingNode);
-            auto it = std::find_if(overlappingByDescendingRight.begin(), overlappingByDescendingRight.end(), [&](const IntervalEntry<T> &entry) {
-                return entry.r() < queryPoint;
-            });
-            results.insert(results.end(), overlappingByDescendingRight.begin(), it);
-            auto rightChild = nodeToRightChild_.at(startingNode);
-            if (rightChild != -1)
-                query(queryPoint, results, rightChild);
+    std::size_t size() const { return intervals_.size(); }
+
+    void query(T queryPoint, std::vector<IntervalEntry<T>> &results) const {
+        int nodeId = nodes_.empty() ? -1 : 0;
+        while (nodeId != -1) {
+            const auto &node = nodes_[nodeId];
+            auto overlappingByAscendingLeftBegin = overlappingByAscendingLeft_.begin() + node.overlappingBegin;
+            auto overlappingByAscendingLeftEnd = overlappingByAscendingLeft_.begin() + node.overlappingEnd;
+            if (queryPoint == node.center) {
+                // The query point is the center, so add all of the intervals that intersect the center node.
+                results.insert(results.end(), overlappingByAscendingLeftBegin, overlappingByAscendingLeftEnd);
+                break;
+            } else if (queryPoint < node.center) {
+                // Look at intervals in the left subtree.
+                // First find the intervals that overlap the center point and also overlap the query point.
+                // it points to the first interval that starts after the query point, and therefore no following
+                // intervals could cover the query point.
+                auto it = std::partition_point(overlappingByAscendingLeftBegin, overlappingByAscendingLeftEnd, [&](const IntervalEntry<T> &entry) {
+                    return entry.l() <= queryPoint;
+                });
+                results.insert(results.end(), overlappingByAscendingLeftBegin, it);
+                nodeId = node.leftChild;
+            } else {
+                // Find the first interval that ends before the query point.
+                auto overlappingByDescendingRightBegin = overlappingByDescendingRight_.begin() + node.overlappingBegin;
+                auto overlappingByDescendingRightEnd = overlappingByDescendingRight_.begin() + node.overlappingEnd;
+                auto it = std::partition_point(overlappingByDescendingRightBegin, overlappingByDescendingRightEnd, [&](const IntervalEntry<T> &entry) {
+                    return entry.r() >= queryPoint;
+                });
+                results.insert(results.end(), overlappingByDescendingRightBegin, it);
+                nodeId = node.rightChild;
+            }
         }
     }
 
 private:
+    struct Node {
+        T center;
+        int leftChild;
+        int rightChild;
+        // The range of this node's intervals in overlappingByAscendingLeft_ and overlappingByDescendingRight_.
+        unsigned int overlappingBegin;
+        unsigned int overlappingEnd;
+    };
+
+    void rebuild() {
+        nodes_.clear();
+        overlappingByAscendingLeft_.clear();
+        overlappingByDescendingRight_.clear();
+        if (intervals_.empty())
+            return;
+
+        nodes_.reserve(intervals_.size());
+        overlappingByAscendingLeft_.reserve(intervals_.size());
+        overlappingByDescendingRight_.reserve(intervals_.size());
+        auto intervals = intervals_;
+        build(lowerBound_, upperBound_, intervals);
+    }
+
     int build(T lowerBound, T upperBound, std::vector<IntervalEntry<T>> &intervals) {
-        int id = id_++;
+        int id = nodes_.size();
         T center = lowerBound + (upperBound - lowerBound) / 2;
 
         std::vector<IntervalEntry<T>> intervalsToLeft;
@@ -95,37 +127,39 @@ private:
             }
         }
 
-        nodeToCenterPoint_[id] = center;
+        nodes_.push_back({center, -1, -1,
+                          static_cast<unsigned int>(overlappingByAscendingLeft_.size()),
+                          static_cast<unsigned int>(overlappingByAscendingLeft_.size() + intervalsIntersectingCenter.size())});
 
         // Sort left children by ascending starting point.
         std::sort(intervalsIntersectingCenter.begin(), intervalsIntersectingCenter.end(),
                   [](const IntervalEntry<T> &first, const IntervalEntry<T> &second) {
                       return first.l() < second.l();
                   });
-        nodeToSortedLeft_[id] = intervalsIntersectingCenter;
+        overlappingByAscendingLeft_.insert(overlappingByAscendingLeft_.end(), intervalsIntersectingCenter.begin(), intervalsIntersectingCenter.end());
 
-        // Sort right children by descending starting point.
+        // Sort right children by descending ending point.
         std::sort(intervalsIntersectingCenter.begin(), intervalsIntersectingCenter.end(),
                   [](const IntervalEntry<T> &first, const IntervalEntry<T> &second) {
                       return first.r() > second.r();
                   });
-        nodeToSortedRight_[id] = intervalsIntersectingCenter;
+        overlappingByDescendingRight_.insert(overlappingByDescendingRight_.end(), intervalsIntersectingCenter.begin(), intervalsIntersectingCenter.end());
 
-        // Set up children.
-        nodeToLeftChild_[id] = intervalsToLeft.size() ? build(lowerBoundToLeft, upperBoundToLeft, intervalsToLeft) : -1;
-        nodeToRightChild_[id] = intervalsToRight.size() ? build(lowerBoundToRight, upperBoundToRight, intervalsToRight) : -1;
+        // Set up children. Building a child appends to nodes_, so do not hold a reference to this node across it.
+        int leftChild = intervalsToLeft.size() ? build(lowerBoundToLeft, upperBoundToLeft, intervalsToLeft) : -1;
+        nodes_[id].leftChild = leftChild;
+        int rightChild = intervalsToRight.size() ? build(lowerBoundToRight, upperBoundToRight, intervalsToRight) : -1;
+        nodes_[id].rightChild = rightChild;
 
         return id;
     }
 
-    int id_;
-    int root_;
     T lowerBound_;
     T upperBound_;
-    std::unordered_map<int, int> nodeToLeftChild_;
-    std::unordered_map<int, int> nodeToRightChild_;
-    std::unordered_map<int, T> nodeToCenterPoint_;
-    std::unordered_map<int, std::vector<IntervalEntry<T>>> nodeToSortedLeft_, nodeToSortedRight_;
+    std::vector<IntervalEntry<T>> intervals_;
+    std::vector<Node> nodes_;
+    std::vector<IntervalEntry<T>> overlappingByAscendingLeft_;
+    std::vector<IntervalEntry<T>> overlappingByDescendingRight_;
 };
 
 } // namespace tasm
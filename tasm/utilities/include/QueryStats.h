@@ -0,0 +1,115 @@
+#ifndef TASM_QUERYSTATS_H
+#define TASM_QUERYSTATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace tasm {
+
+// Execution statistics for a single query. Operators update the statistics from the scan, decode, and consumer
+// threads, so all updates are thread-safe. Every update is also added to the process-wide statistics.
+class QueryStats {
+public:
+    enum class Counter : unsigned int {
+        BytesRead,
+        TilesOpened,
+        GOPsRead,
+        FramesDecoded,
+        PixelsDecoded,
+        DecoderReconfigurations,
+        // The time the decoder's worker thread spent decoding and mapping frames, excluding the time it waited for the
+        // consumer to take frames.
+        DecodeTimeNs,
+        StitchTimeNs,
+        IndexTimeNs,
+        // GOPs that the tile read-ahead had already read when the decoder asked for them.
+        ReadAheadHits,
+        // GOPs that the decoder had to wait for, and the total time spent waiting.
+        ReadAheadStalls,
+        ReadAheadStallTimeNs,
+        // Objects that spanned several tiles, whose pixels were copied from each tile into one buffer.
+        ObjectsAssembled,
+    };
+    static constexpr unsigned int NumberOfCounters = static_cast<unsigned int>(Counter::ObjectsAssembled) + 1;
+
+    QueryStats()
+        : QueryStats(false)
+    {}
+
+    QueryStats(const QueryStats&) = delete;
+
+    void add(Counter counter, unsigned long long value) {
+        counters_[static_cast<unsigned int>(counter)] += value;
+        if (!isProcessWide_)
+            processWide().add(counter, value);
+    }
+
+    unsigned long long get(Counter counter) const { return counters_[static_cast<unsigned int>(counter)]; }
+
+    // Operator times include the time spent pulling from the operators below them.
+    void addOperatorTime(const std::string &operatorName, std::chrono::nanoseconds duration);
+    std::unordered_map<std::string, unsigned long long> operatorTimesNs() const;
+
+    // Maps counter names (e.g., "bytes_read") to values.
+    std::unordered_map<std::string, unsigned long long> counters() const;
+
+    static std::string counterName(Counter counter);
+
+    // Accumulates the statistics of every query that has run in this process.
+    static QueryStats &processWide();
+
+    // Adds the time until destruction to either an operator's time or a time counter. A null QueryStats is allowed
+    // so that operators without statistics do not need to special-case timing.
+    class ScopedTimer {
+    public:
+        ScopedTimer(const std::shared_ptr<QueryStats> &stats, const char *operatorName)
+            : stats_(stats.get()), operatorName_(operatorName), counter_(Counter::BytesRead),
+            start_(std::chrono::steady_clock::now())
+        {}
+
+        ScopedTimer(const std::shared_ptr<QueryStats> &stats, Counter timeCounter)
+            : stats_(stats.get()), operatorName_(nullptr), counter_(timeCounter),
+            start_(std::chrono::steady_clock::now())
+        {}
+
+        ~ScopedTimer() {
+            if (!stats_)
+                return;
+
+            auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+            if (operatorName_)
+                stats_->addOperatorTime(operatorName_, duration);
+            else
+                stats_->add(counter_, duration.count());
+        }
+
+    private:
+        QueryStats *stats_;
+        const char *operatorName_;
+        Counter counter_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+private:
+    explicit QueryStats(bool isProcessWide)
+        : isProcessWide_(isProcessWide)
+    {
+        for (auto &counter : counters_)
+            counter = 0;
+    }
+
+    const bool isProcessWide_;
+    std::array<std::atomic<unsigned long long>, NumberOfCounters> counters_;
+
+    mutable std::mutex operatorTimesMutex_;
+    std::unordered_map<std::string, unsigned long long> operatorTimesNs_;
+};
+
+} // namespace tasm
+
+#endif //TASM_QUERYSTATS_H
@@ -0,0 +1,16 @@
+#ifndef TASM_TILESTORAGEFORMAT_H
+#define TASM_TILESTORAGEFORMAT_H
+
+namespace tasm {
+
+// How the tiles of a tile directory are stored.
+enum class TileStorageFormat {
+    // One MP4 file per tile.
+    MP4,
+    // Every tile in a single file with an index of each tile's samples. See TilePack.
+    Packed,
+};
+
+} // namespace tasm
+
+#endif //TASM_TILESTORAGEFORMAT_H
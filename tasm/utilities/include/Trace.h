@@ -0,0 +1,109 @@
+#ifndef TASM_TRACE_H
+#define TASM_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <experimental/filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tasm {
+
+// Records spans from the operator pipeline and writes them as Chrome trace JSON, which can be viewed in
+// chrome://tracing or ui.perfetto.dev. Each thread writes to its own ring buffer, so recording a span never contends
+// with other threads. Spans are only recorded between start() and stop(); building with TASM_DISABLE_TRACING removes
+// them entirely.
+class Tracer {
+public:
+    static Tracer &instance();
+
+    // Discards any previously recorded spans and starts recording.
+    void start();
+    void stop();
+    bool isEnabled() const { return isEnabled_.load(std::memory_order_relaxed); }
+
+    // Name and category must be string literals because only the pointers are stored.
+    void record(const char *name, const char *category,
+            std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+    // Labels the current thread's track in the trace.
+    void setCurrentThreadName(const std::string &name);
+
+    void writeChromeTrace(const std::experimental::filesystem::path &path) const;
+
+    // When a thread records more spans than this, its oldest spans are overwritten.
+    static constexpr unsigned int SpansPerThread = 1u << 14;
+
+private:
+    struct Span {
+        const char *name;
+        const char *category;
+        long long startNs;
+        long long durationNs;
+    };
+
+    struct ThreadBuffer {
+        explicit ThreadBuffer(unsigned int threadId)
+            : threadId(threadId), spans(SpansPerThread), numberOfSpansRecorded(0), isThreadAlive(true)
+        {}
+
+        const unsigned int threadId;
+        std::string threadName;
+        std::vector<Span> spans;
+        unsigned long long numberOfSpansRecorded;
+        std::atomic_bool isThreadAlive;
+
+        // Only contended while the trace is being written.
+        mutable std::mutex mutex;
+    };
+
+    class ThreadBufferHandle;
+
+    Tracer()
+        : isEnabled_(false), nextThreadId_(0)
+    {}
+
+    ThreadBuffer &bufferForCurrentThread();
+
+    std::atomic_bool isEnabled_;
+    mutable std::mutex buffersMutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+    unsigned int nextThreadId_;
+};
+
+class TraceSpan {
+public:
+    TraceSpan(const char *name, const char *category)
+        : name_(name), category_(category), isRecording_(Tracer::instance().isEnabled())
+    {
+        if (isRecording_)
+            start_ = std::chrono::steady_clock::now();
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+
+    ~TraceSpan() {
+        if (isRecording_)
+            Tracer::instance().record(name_, category_, start_, std::chrono::steady_clock::now());
+    }
+
+private:
+    const char *name_;
+    const char *category_;
+    bool isRecording_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace tasm
+
+#ifdef TASM_DISABLE_TRACING
+#define TASM_TRACE_SPAN(name, category)
+#else
+#define TASM_TRACE_CONCATENATE_(a, b) a##b
+#define TASM_TRACE_CONCATENATE(a, b) TASM_TRACE_CONCATENATE_(a, b)
+#define TASM_TRACE_SPAN(name, category) tasm::TraceSpan TASM_TRACE_CONCATENATE(traceSpan, __LINE__)(name, category)
+#endif
+
+#endif //TASM_TRACE_H
@@ -1,6 +1,7 @@
 #ifndef TASM_TRANSACTION_H
 #define TASM_TRANSACTION_H
 
+#include "EnvironmentConfiguration.h"
 #include "Files.h"
 #include "TileLayout.h"
 #include "Video.h"
@@ -16,6 +17,7 @@ public:
                  unsigned int lastFrame)
             : transaction_(transaction),
             entry_(entry),
+              tileNumber_(tileNumber),
               filename_(tasm::TileFiles::temporaryTileFilename(entry, tileNumber, firstFrame, lastFrame)),
               codec_(Codec::HEVC),
               stream_(filename_)
@@ -26,11 +28,13 @@ public:
 
     std::ofstream& stream() { return stream_; }
     const std::experimental::filesystem::path &filename() const { return filename_; }
+    unsigned int tileNumber() const { return tileNumber_; }
     const auto &codec() const { return codec_; }
 
 protected:
     const Transaction &transaction_;
     const tasm::TiledEntry &entry_;
+    const unsigned int tileNumber_;
     const std::experimental::filesystem::path filename_;
     const Codec codec_;
     std::ofstream stream_;
@@ -78,6 +82,7 @@ public:
               tileLayout_(tileLayout),
               firstFrame_(firstFrame),
               lastFrame_(lastFrame),
+              storageFormat_(tasm::EnvironmentConfiguration::instance().tileStorageFormat()),
               complete_(false)
     {
         prepareTileDirectory();
@@ -102,6 +107,8 @@ public:
 
 private:
     void prepareTileDirectory();
+    void muxTiles();
+    void packTiles();
     void writeTileMetadata();
 
     std::shared_ptr<tasm::TiledEntry> entry_;
@@ -109,6 +116,7 @@ private:
 
     int firstFrame_;
     int lastFrame_;
+    tasm::TileStorageFormat storageFormat_;
 
     bool complete_;
 };
@@ -0,0 +1,201 @@
+#include "CostModel.h"
+
+#include "EnvironmentConfiguration.h"
+#include "QueryStats.h"
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace tasm {
+
+namespace {
+
+std::unordered_map<std::string, std::function<double&(CostProfile&)>> coefficientsByName() {
+    return {
+        {"decode_cost_per_pixel", [](CostProfile &profile) -> double& { return profile.decodeCostPerPixel; }},
+        {"decode_cost_per_tile", [](CostProfile &profile) -> double& { return profile.decodeCostPerTile; }},
+        {"decode_cost_per_reconfiguration", [](CostProfile &profile) -> double& { return profile.decodeCostPerReconfiguration; }},
+        {"encode_cost_per_pixel", [](CostProfile &profile) -> double& { return profile.encodeCostPerPixel; }},
+        {"encode_cost_per_gop", [](CostProfile &profile) -> double& { return profile.encodeCostPerGOP; }},
+        {"tiling_pixel_threshold", [](CostProfile &profile) -> double& { return profile.tilingPixelThreshold; }},
+    };
+}
+
+} // namespace
+
+void CostProfile::write(const std::experimental::filesystem::path &path) const {
+    auto temporaryPath = path.string() + ".tmp";
+    {
+        std::ofstream output(temporaryPath, std::ios::out | std::ios::trunc);
+        output << std::setprecision(std::numeric_limits<double>::max_digits10);
+        // Write in a fixed order so that profiles are easy to compare.
+        CostProfile profile(*this);
+        auto coefficients = coefficientsByName();
+        for (const auto &name : {"decode_cost_per_pixel", "decode_cost_per_tile", "decode_cost_per_reconfiguration",
+                                 "encode_cost_per_pixel", "encode_cost_per_gop", "tiling_pixel_threshold"})
+            output << name << " " << coefficients.at(name)(profile) << "\n";
+        if (!output.flush())
+            throw std::runtime_error("Failed to write cost profile " + path.string());
+    }
+    std::experimental::filesystem::rename(temporaryPath, path);
+}
+
+CostProfile CostProfile::read(const std::experimental::filesystem::path &path) {
+    std::ifstream input(path);
+    if (!input)
+        throw std::runtime_error("Failed to open cost profile " + path.string());
+
+    CostProfile profile;
+    auto coefficients = coefficientsByName();
+    std::string name;
+    double value;
+    while (input >> name) {
+        if (!(input >> value) || !std::isfinite(value) || value < 0)
+            throw std::runtime_error("Invalid value for " + name + " in cost profile " + path.string());
+        auto coefficient = coefficients.find(name);
+        if (coefficient == coefficients.end())
+            throw std::runtime_error("Unknown coefficient " + name + " in cost profile " + path.string());
+        coefficient->second(profile) = value;
+    }
+    return profile;
+}
+
+CostModel::CostModel(CostProfile profile)
+    : priorProfile_(profile),
+    profile_(profile) {
+    resetObservations();
+}
+
+CostModel::CostModel(const std::experimental::filesystem::path &path)
+    : path_(path),
+    priorProfile_(std::experimental::filesystem::exists(path) ? CostProfile::read(path) : CostProfile()),
+    profile_(priorProfile_) {
+    resetObservations();
+}
+
+CostModel &CostModel::instance() {
+    static CostModel costModel(EnvironmentConfiguration::instance().costProfilePath());
+    return costModel;
+}
+
+double CostModel::decodeTimeInMilliseconds(const QueryStats &stats) {
+    return stats.get(QueryStats::Counter::DecodeTimeNs) / 1e6;
+}
+
+CostProfile CostModel::profile() const {
+    std::scoped_lock lock(mutex_);
+    return profile_;
+}
+
+void CostModel::setProfile(const CostProfile &profile) {
+    std::scoped_lock lock(mutex_);
+    priorProfile_ = profile;
+    profile_ = profile;
+    resetObservations();
+}
+
+unsigned int CostModel::numberOfObservations() const {
+    std::scoped_lock lock(mutex_);
+    return numberOfObservations_;
+}
+
+void CostModel::resetObservations() {
+    gram_.fill(0);
+    moments_.fill(0);
+    numberOfObservations_ = 0;
+}
+
+CostModel::DecodeTerms CostModel::decodeTermScales() const {
+    // A coefficient of 0 has no magnitude to scale by, so fall back to the defaults.
+    static const CostProfile defaults;
+    auto perPixel = priorProfile_.decodeCostPerPixel > 0 ? priorProfile_.decodeCostPerPixel : defaults.decodeCostPerPixel;
+    auto perTile = priorProfile_.decodeCostPerTile > 0 ? priorProfile_.decodeCostPerTile : defaults.decodeCostPerTile;
+    auto perReconfiguration = priorProfile_.decodeCostPerReconfiguration > 0 ? priorProfile_.decodeCostPerReconfiguration : perTile;
+    return {perPixel, perTile, perReconfiguration};
+}
+
+void CostModel::observe(const QueryStats &stats) {
+    auto decodeTime = decodeTimeInMilliseconds(stats);
+    if (decodeTime <= 0 || !stats.get(QueryStats::Counter::PixelsDecoded))
+        return;
+
+    std::scoped_lock lock(mutex_);
+    auto scales = decodeTermScales();
+    DecodeTerms terms{
+        scales[0] * stats.get(QueryStats::Counter::PixelsDecoded),
+        scales[1] * stats.get(QueryStats::Counter::FramesDecoded),
+        scales[2] * stats.get(QueryStats::Counter::DecoderReconfigurations),
+    };
+    for (auto i = 0u; i < NumberOfDecodeTerms; ++i) {
+        for (auto j = 0u; j < NumberOfDecodeTerms; ++j)
+            gram_[i * NumberOfDecodeTerms + j] += terms[i] * terms[j];
+        moments_[i] += terms[i] * decodeTime;
+    }
+    ++numberOfObservations_;
+
+    refineDecodeCoefficients();
+    if (!path_.empty() && !(numberOfObservations_ % ObservationsPerSave))
+        profile_.write(path_);
+}
+
+void CostModel::refineDecodeCoefficients() {
+    auto scales = decodeTermScales();
+    DecodeTerms priorMultiples{
+        priorProfile_.decodeCostPerPixel / scales[0],
+        priorProfile_.decodeCostPerTile / scales[1],
+        priorProfile_.decodeCostPerReconfiguration / scales[2],
+    };
+
+    // Terms that no query has exercised keep their prior coefficients.
+    std::vector<unsigned int> terms;
+    for (auto i = 0u; i < NumberOfDecodeTerms; ++i) {
+        if (gram_[i * NumberOfDecodeTerms + i] > 0)
+            terms.push_back(i);
+    }
+
+    // Ridge regression towards the prior: the prior adds PriorObservations average observations of each term alone.
+    auto n = terms.size();
+    auto priorWeight = PriorObservations / numberOfObservations_;
+    std::vector<double> system(n * (n + 1));
+    for (auto row = 0u; row < n; ++row) {
+        auto i = terms[row];
+        for (auto column = 0u; column < n; ++column)
+            system[row * (n + 1) + column] = gram_[i * NumberOfDecodeTerms + terms[column]];
+        auto prior = priorWeight * gram_[i * NumberOfDecodeTerms + i];
+        system[row * (n + 1) + row] += prior;
+        system[row * (n + 1) + n] = moments_[i] + prior * priorMultiples[i];
+    }
+
+    // Gaussian elimination with partial pivoting. The prior keeps the system positive definite.
+    for (auto pivot = 0u; pivot < n; ++pivot) {
+        auto best = pivot;
+        for (auto row = pivot + 1; row < n; ++row) {
+            if (std::abs(system[row * (n + 1) + pivot]) > std::abs(system[best * (n + 1) + pivot]))
+                best = row;
+        }
+        for (auto column = 0u; column <= n; ++column)
+            std::swap(system[pivot * (n + 1) + column], system[best * (n + 1) + column]);
+        for (auto row = 0u; row < n; ++row) {
+            if (row == pivot)
+                continue;
+            auto factor = system[row * (n + 1) + pivot] / system[pivot * (n + 1) + pivot];
+            for (auto column = pivot; column <= n; ++column)
+                system[row * (n + 1) + column] -= factor * system[pivot * (n + 1) + column];
+        }
+    }
+
+    DecodeTerms multiples = priorMultiples;
+    for (auto row = 0u; row < n; ++row)
+        multiples[terms[row]] = std::max(0.0, system[row * (n + 1) + n] / system[row * (n + 1) + row]);
+
+    profile_.decodeCostPerPixel = multiples[0] * scales[0];
+    profile_.decodeCostPerTile = multiples[1] * scales[1];
+    profile_.decodeCostPerReconfiguration = multiples[2] * scales[2];
+}
+
+} // namespace tasm
@@ -0,0 +1,69 @@
+#include "QueryStats.h"
+
+#include <cassert>
+
+namespace tasm {
+
+void QueryStats::addOperatorTime(const std::string &operatorName, std::chrono::nanoseconds duration) {
+    {
+        std::scoped_lock lock(operatorTimesMutex_);
+        operatorTimesNs_[operatorName] += duration.count();
+    }
+
+    if (!isProcessWide_)
+        processWide().addOperatorTime(operatorName, duration);
+}
+
+std::unordered_map<std::string, unsigned long long> QueryStats::operatorTimesNs() const {
+    std::scoped_lock lock(operatorTimesMutex_);
+    return operatorTimesNs_;
+}
+
+std::unordered_map<std::string, unsigned long long> QueryStats::counters() const {
+    std::unordered_map<std::string, unsigned long long> namesToValues;
+    for (auto i = 0u; i < NumberOfCounters; ++i) {
+        auto counter = static_cast<Counter>(i);
+        namesToValues[counterName(counter)] = get(counter);
+    }
+    return namesToValues;
+}
+
+std::string QueryStats::counterName(Counter counter) {
+    switch (counter) {
+        case Counter::BytesRead:
+            return "bytes_read";
+        case Counter::TilesOpened:
+            return "tiles_opened";
+        case Counter::GOPsRead:
+            return "gops_read";
+        case Counter::FramesDecoded:
+            return "frames_decoded";
+        case Counter::PixelsDecoded:
+            return "pixels_decoded";
+        case Counter::DecoderReconfigurations:
+            return "decoder_reconfigurations";
+        case Counter::DecodeTimeNs:
+            return "decode_time_ns";
+        case Counter::StitchTimeNs:
+            return "stitch_time_ns";
+        case Counter::IndexTimeNs:
+            return "index_time_ns";
+        case Counter::ReadAheadHits:
+            return "read_ahead_hits";
+        case Counter::ReadAheadStalls:
+            return "read_ahead_stalls";
+        case Counter::ReadAheadStallTimeNs:
+            return "read_ahead_stall_time_ns";
+        case Counter::ObjectsAssembled:
+            return "objects_assembled";
+    }
+    assert(false);
+    return "";
+}
+
+QueryStats &QueryStats::processWide() {
+    static QueryStats processWideStats(true);
+    return processWideStats;
+}
+
+} // namespace tasm
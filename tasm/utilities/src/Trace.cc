@@ -0,0 +1,147 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+namespace tasm {
+
+// Marks the thread's buffer as dead when the thread exits so that the next start() can release it. The spans the
+// thread recorded stay available until then.
+class Tracer::ThreadBufferHandle {
+public:
+    explicit ThreadBufferHandle(std::shared_ptr<ThreadBuffer> buffer)
+        : buffer_(std::move(buffer))
+    {}
+
+    ~ThreadBufferHandle() {
+        buffer_->isThreadAlive = false;
+    }
+
+    ThreadBuffer &buffer() { return *buffer_; }
+
+private:
+    std::shared_ptr<ThreadBuffer> buffer_;
+};
+
+static long long nanosecondsSinceEpoch(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+static std::string escapeForJSON(const std::string &value) {
+    std::string escaped;
+    for (auto c : value) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20)
+            escaped += c;
+    }
+    return escaped;
+}
+
+Tracer &Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::start() {
+    std::scoped_lock lock(buffersMutex_);
+    buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(), [](const auto &buffer) {
+        return !buffer->isThreadAlive;
+    }), buffers_.end());
+
+    for (auto &buffer : buffers_) {
+        std::scoped_lock bufferLock(buffer->mutex);
+        buffer->numberOfSpansRecorded = 0;
+    }
+
+    isEnabled_ = true;
+}
+
+void Tracer::stop() {
+    isEnabled_ = false;
+}
+
+Tracer::ThreadBuffer &Tracer::bufferForCurrentThread() {
+    thread_local std::unique_ptr<ThreadBufferHandle> handle;
+    if (!handle) {
+        std::scoped_lock lock(buffersMutex_);
+        auto buffer = std::make_shared<ThreadBuffer>(nextThreadId_++);
+        buffers_.push_back(buffer);
+        handle = std::make_unique<ThreadBufferHandle>(buffer);
+    }
+    return handle->buffer();
+}
+
+void Tracer::record(const char *name, const char *category,
+        std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    auto &buffer = bufferForCurrentThread();
+    std::scoped_lock lock(buffer.mutex);
+    buffer.spans[buffer.numberOfSpansRecorded % SpansPerThread] = {
+        name,
+        category,
+        nanosecondsSinceEpoch(start),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()
+    };
+    ++buffer.numberOfSpansRecorded;
+}
+
+void Tracer::setCurrentThreadName(const std::string &name) {
+    // Avoid allocating a buffer for threads that never record spans.
+    if (!isEnabled())
+        return;
+
+    auto &buffer = bufferForCurrentThread();
+    std::scoped_lock lock(buffer.mutex);
+    buffer.threadName = name;
+}
+
+void Tracer::writeChromeTrace(const std::experimental::filesystem::path &path) const {
+    std::vector<Span> spans;
+    std::vector<unsigned int> threadIds;
+    std::vector<std::pair<unsigned int, std::string>> threadNames;
+    {
+        std::scoped_lock lock(buffersMutex_);
+        for (const auto &buffer : buffers_) {
+            std::scoped_lock bufferLock(buffer->mutex);
+            auto numberOfSpans = std::min<unsigned long long>(buffer->numberOfSpansRecorded, SpansPerThread);
+            for (auto i = buffer->numberOfSpansRecorded - numberOfSpans; i < buffer->numberOfSpansRecorded; ++i) {
+                spans.push_back(buffer->spans[i % SpansPerThread]);
+                threadIds.push_back(buffer->threadId);
+            }
+            if (!buffer->threadName.empty())
+                threadNames.emplace_back(buffer->threadId, buffer->threadName);
+        }
+    }
+
+    // Chrome traces are in microseconds; start the trace at the first span.
+    auto firstStartNs = std::numeric_limits<long long>::max();
+    for (const auto &span : spans)
+        firstStartNs = std::min(firstStartNs, span.startNs);
+
+    std::ofstream trace(path);
+    if (!trace)
+        throw std::runtime_error("Failed to open trace file " + path.string());
+
+    trace << std::fixed << std::setprecision(3);
+    trace << "{\"traceEvents\":[";
+    bool isFirstEvent = true;
+    for (const auto &threadName : threadNames) {
+        trace << (isFirstEvent ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadName.first
+              << ",\"args\":{\"name\":\"" << escapeForJSON(threadName.second) << "\"}}";
+        isFirstEvent = false;
+    }
+    for (auto i = 0u; i < spans.size(); ++i) {
+        const auto &span = spans[i];
+        trace << (isFirstEvent ? "" : ",") << "\n{\"name\":\"" << span.name << "\",\"cat\":\"" << span.category
+              << "\",\"ph\":\"X\",\"ts\":" << (span.startNs - firstStartNs) / 1000.0
+              << ",\"dur\":" << span.durationNs / 1000.0
+              << ",\"pid\":1,\"tid\":" << threadIds[i] << "}";
+        isFirstEvent = false;
+    }
+    trace << "\n]}\n";
+}
+
+} // namespace tasm
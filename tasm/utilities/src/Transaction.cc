@@ -1,6 +1,9 @@
 #include "Transaction.h"
 
 #include "Gpac.h"
+#include "TileManifest.h"
+#include "TilePack.h"
+#include "VideoConfiguration.h"
 #include <iostream>
 
 void TileCrackingTransaction::prepareTileDirectory() {
@@ -19,18 +22,46 @@ void TileCrackingTransaction::abort() {
 void TileCrackingTransaction::commit() {
     complete_ = true;
 
-    for (auto &output : outputs()) {
+    for (auto &output : outputs())
         output.stream().close();
 
+    if (storageFormat_ == tasm::TileStorageFormat::Packed)
+        packTiles();
+    else
+        muxTiles();
+
+    writeTileMetadata();
+
+    // The directory is only visible to readers once it is in the manifest.
+    tasm::TileManifestCache::instance().addDirectory(entry_->path(), {
+            static_cast<unsigned int>(firstFrame_),
+            static_cast<unsigned int>(lastFrame_),
+            entry_->tile_version(),
+            std::make_shared<tasm::TileLayout>(tileLayout_),
+            storageFormat_});
+
+    entry_->incrementTileVersion();
+}
+
+void TileCrackingTransaction::muxTiles() {
+    for (auto &output : outputs()) {
         // Mux the outputs to mp4.
         auto muxedFile = output.filename();
         muxedFile.replace_extension(tasm::TileFiles::muxedFilenameExtension());
         tasm::gpac::mux_media(output.filename(), muxedFile);
     }
+}
 
-    writeTileMetadata();
+void TileCrackingTransaction::packTiles() {
+    std::vector<tasm::TilePack::TileStream> tileStreams;
+    tileStreams.reserve(outputs().size());
+    for (auto &output : outputs())
+        tileStreams.push_back({output.tileNumber(), *tasm::video::GetConfiguration(output.filename()), output.filename()});
 
-    entry_->incrementTileVersion();
+    tasm::TilePack::write(tasm::TileFiles::directoryForTilesInFrames(*entry_, firstFrame_, lastFrame_), tileStreams);
+
+    for (auto &output : outputs())
+        std::experimental::filesystem::remove(output.filename());
 }
 
 void TileCrackingTransaction::writeTileMetadata() {
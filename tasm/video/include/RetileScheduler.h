@@ -0,0 +1,105 @@
+#ifndef TASM_RETILESCHEDULER_H
+#define TASM_RETILESCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tasm {
+
+// Limits how much work background re-tiling does. Spending is counted over a sliding window.
+struct RetileBudget {
+    std::chrono::milliseconds window = std::chrono::seconds(60);
+    // Milliseconds of decoding and encoding per window. Re-tiling shares the GPU with queries, so this bounds how much
+    // of the GPU it takes from them.
+    double gpuMillisecondsPerWindow = 10000;
+    // Bytes of new tiles written per window.
+    unsigned long long bytesPerWindow = 1ull << 30;
+    // GOPs are only re-tiled once no query has started for this long, so that re-tiling runs between bursts of queries.
+    std::chrono::milliseconds quietPeriod = std::chrono::milliseconds(500);
+};
+
+// A GOP that has accumulated enough regret to be re-tiled.
+struct RetileTask {
+    std::string video;
+    unsigned int gop;
+    std::string layoutIdentifier;
+    // How far the GOP's regret exceeds the cost of re-tiling it. Higher priorities are re-tiled first.
+    double priority;
+    double estimatedMilliseconds;
+};
+
+struct RetileResult {
+    double milliseconds;
+    unsigned long long bytesWritten;
+};
+
+// Re-tiles GOPs on a background thread, one at a time, in order of priority and within a RetileBudget. Each GOP is
+// committed as its own tile version, so queries that are already running keep reading the tiles they started with.
+class RetileScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Lists the GOPs that should be re-tiled. Called at the start of each pass, so priorities follow the latest regret.
+    using CandidateSource = std::function<std::vector<RetileTask>()>;
+    // Re-tiles a single GOP and reports what it cost.
+    using Retiler = std::function<RetileResult(const RetileTask&)>;
+
+    RetileScheduler(CandidateSource candidates, Retiler retile, RetileBudget budget);
+    RetileScheduler(const RetileScheduler&) = delete;
+    // Waits for the GOP being re-tiled, if any, and stops the thread.
+    ~RetileScheduler();
+
+    void start();
+    void stop();
+
+    // Called when a query starts. Re-tiling waits for the quiet period after it, and the query may add regret.
+    void noteQuery();
+
+    // Re-tiles candidates in priority order until the budget is spent, a query starts, or none are left. Returns the
+    // number of GOPs that were re-tiled. The background thread runs passes; they can also be run directly.
+    unsigned int runPass(Clock::time_point now);
+
+    unsigned int numberOfRetiledGOPs() const;
+
+    // How long the thread sleeps between passes when nothing wakes it.
+    static constexpr std::chrono::milliseconds PollInterval = std::chrono::seconds(1);
+
+private:
+    struct Spend {
+        Clock::time_point time;
+        double milliseconds;
+        unsigned long long bytes;
+    };
+
+    void run();
+    void forgetSpendingBefore(Clock::time_point time);
+    bool fitsBudget(const RetileTask &task) const;
+    bool isQuiet(Clock::time_point now) const;
+
+    CandidateSource candidates_;
+    Retiler retile_;
+    const RetileBudget budget_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<Spend> spending_;
+    double millisecondsInWindow_;
+    unsigned long long bytesInWindow_;
+    Clock::time_point lastQuery_;
+    bool hasQueried_;
+    unsigned int numberOfRetiledGOPs_;
+    bool isStopped_;
+
+    // Passes are not run concurrently.
+    std::mutex passMutex_;
+    std::thread thread_;
+};
+
+} // namespace tasm
+
+#endif //TASM_RETILESCHEDULER_H
@@ -0,0 +1,64 @@
+#ifndef TASM_TILECOMPACTOR_H
+#define TASM_TILECOMPACTOR_H
+
+#include "TileManifest.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <experimental/filesystem>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace tasm {
+
+// Deletes the tile directories of re-tiled videos that newer tile versions shadow, on a background thread. Directories
+// that running queries have pinned are kept, and the video is compacted again on later passes until they are released.
+class TileCompactor {
+public:
+    using Compactor = std::function<TileCompaction(const std::experimental::filesystem::path&)>;
+
+    explicit TileCompactor(Compactor compact = [](const std::experimental::filesystem::path &videoPath) {
+        return TileManifestCache::instance().compact(videoPath);
+    });
+    TileCompactor(const TileCompactor&) = delete;
+    // Finishes the video being compacted, if any, and stops the thread.
+    ~TileCompactor();
+
+    // Compacts the video on the background thread, which the first request starts.
+    void requestCompaction(const std::experimental::filesystem::path &videoPath);
+
+    // Compacts each requested video once. Videos with pinned directories stay requested. Returns the number of
+    // directories that were deleted. The background thread runs passes; they can also be run directly.
+    unsigned int runPass();
+
+    void stop();
+
+    unsigned int numberOfDeletedDirectories() const;
+    bool hasRequestedVideos() const;
+
+    // How long the thread waits before compacting videos whose directories were pinned again.
+    static constexpr std::chrono::milliseconds PollInterval = std::chrono::seconds(1);
+
+private:
+    void run();
+
+    Compactor compact_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::set<std::string> requestedVideos_;
+    bool hasNewRequest_;
+    unsigned int numberOfDeletedDirectories_;
+    bool isStopped_;
+
+    // Passes are not run concurrently.
+    std::mutex passMutex_;
+    std::thread thread_;
+};
+
+} // namespace tasm
+
+#endif //TASM_TILECOMPACTOR_H
@@ -3,15 +3,20 @@
 
 #include "GPUContext.h"
 #include "ImageUtilities.h"
+#include "LayoutIntervals.h"
 #include "RegretAccumulator.h"
+#include "RetileScheduler.h"
+#include "TileCompactor.h"
 #include "VideoLock.h"
 #include <experimental/filesystem>
+#include <mutex>
 #include <TileConfigurationProvider.h>
 
 namespace tasm {
 class SemanticIndex;
 class MetadataSelection;
 class TemporalSelection;
+class TileQualityProvider;
 class Video;
 
 enum class SelectStrategy{
@@ -35,31 +40,58 @@ public:
                                     const std::string &metadataIdentifier,
                                     std::shared_ptr<MetadataSelection> metadataSelection,
                                     std::shared_ptr<SemanticIndex> semanticIndex,
-                                    bool force);
+                                    bool force,
+                                    bool adaptiveLayoutIntervals = false);
+    // Chooses each GOP's layout for the workload; see WorkloadTileConfigurationProvider.
+    // With adaptiveLayoutIntervals, GOP boundaries are chosen from how the objects move (see LayoutIntervalSegmenter)
+    // rather than every second.
+    void storeWithWorkloadLayout(const std::experimental::filesystem::path &path, const std::string &name, std::shared_ptr<Workload> workload, bool adaptiveLayoutIntervals = false);
 
     std::unique_ptr<ImageIterator> select(const std::string &video,
                                           const std::string &metadataIdentifier,
                                           std::shared_ptr<MetadataSelection> metadataSelection,
                                           std::shared_ptr<TemporalSelection> temporalSelection,
                                           std::shared_ptr<SemanticIndex> semanticIndex,
-                                          SelectStrategy selectStrategy=SelectStrategy::Objects);
+                                          SelectStrategy selectStrategy=SelectStrategy::Objects,
+                                          unsigned int limit=0);
 
     void retileVideoBasedOnRegret(const std::string &video);
+    // Re-tiles the GOPs whose layout for the workload differs from their current layout.
+    void retileWithWorkloadLayout(const std::string &video, std::shared_ptr<Workload> workload);
 
     void activateRegretBasedRetilingForVideo(const std::string &video, const std::string &metadataIdentifier, std::shared_ptr<SemanticIndex> semanticIndex, double threshold = 1.0);
     void deactivateRegretBasedRetilingForVideo(const std::string &video);
 
+    // Re-tiles GOPs that have accumulated enough regret on a background thread, within the budget, instead of waiting
+    // for retileVideoBasedOnRegret().
+    void startBackgroundRetiling(RetileBudget budget = RetileBudget());
+    void stopBackgroundRetiling();
+
 private:
     void createCatalogIfNecessary();
     void storeTiledVideo(std::shared_ptr<Video>, std::shared_ptr<TileLayoutProvider>, const std::string &savedName);
+    void storeTiledVideo(std::shared_ptr<Video>, std::shared_ptr<TileLayoutProvider>, const std::string &savedName, const LayoutIntervals &layoutIntervals, std::shared_ptr<TileQualityProvider> tileQualityProvider = nullptr);
     void setUpRegretBasedRetiling(const std::string &video, std::shared_ptr<SemanticDataManager> selection, std::shared_ptr<TileLayoutProvider> currentLayout);
     void accumulateRegret(const std::string &video, std::shared_ptr<SemanticDataManager> selection, std::shared_ptr<TileLayoutProvider> currentLayout);
-    void retileVideo(std::shared_ptr<Video> video, std::shared_ptr<std::vector<int>> framesToRead, std::shared_ptr<TileLayoutProvider> newLayoutProvider, const std::string &savedName);
+    void retileVideo(std::shared_ptr<Video> video, std::shared_ptr<std::vector<int>> framesToRead, std::shared_ptr<TileLayoutProvider> newLayoutProvider, const std::string &savedName, const LayoutIntervals &layoutIntervals, std::shared_ptr<TileQualityProvider> tileQualityProvider = nullptr);
+    std::vector<RetileTask> backgroundRetileCandidates();
+    RetileResult retileGOP(const RetileTask &task);
 
     std::shared_ptr<GPUContext> gpuContext_;
     std::shared_ptr<VideoLock> lock_;
 
+    // Guards the regret accumulators, which queries and background re-tiling share.
+    std::mutex regretMutex_;
     std::unordered_map<std::string, std::shared_ptr<RegretAccumulator>> videoToRegretAccumulator_;
+
+    // Re-tiles one at a time because each TiledEntry assigns tile versions from the version it loaded.
+    std::mutex retileMutex_;
+
+    // Deletes the tile versions that re-tiling shadows once no query reads them.
+    TileCompactor tileCompactor_;
+
+    // Declared last so that its thread stops before the rest of the manager is destroyed.
+    std::unique_ptr<RetileScheduler> retileScheduler_;
 };
 
 } // namespace tasm
@@ -0,0 +1,127 @@
+#include "RetileScheduler.h"
+
+#include <iostream>
+#include <queue>
+
+namespace tasm {
+
+RetileScheduler::RetileScheduler(CandidateSource candidates, Retiler retile, RetileBudget budget)
+    : candidates_(std::move(candidates)),
+      retile_(std::move(retile)),
+      budget_(budget),
+      millisecondsInWindow_(0),
+      bytesInWindow_(0),
+      hasQueried_(false),
+      numberOfRetiledGOPs_(0),
+      isStopped_(false)
+{}
+
+RetileScheduler::~RetileScheduler() {
+    stop();
+}
+
+void RetileScheduler::start() {
+    std::scoped_lock lock(mutex_);
+    if (thread_.joinable())
+        return;
+    isStopped_ = false;
+    thread_ = std::thread(&RetileScheduler::run, this);
+}
+
+void RetileScheduler::stop() {
+    {
+        std::scoped_lock lock(mutex_);
+        isStopped_ = true;
+    }
+    condition_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void RetileScheduler::noteQuery() {
+    std::scoped_lock lock(mutex_);
+    lastQuery_ = Clock::now();
+    hasQueried_ = true;
+}
+
+unsigned int RetileScheduler::numberOfRetiledGOPs() const {
+    std::scoped_lock lock(mutex_);
+    return numberOfRetiledGOPs_;
+}
+
+void RetileScheduler::run() {
+    std::unique_lock lock(mutex_);
+    while (!isStopped_) {
+        condition_.wait_for(lock, PollInterval, [this] { return isStopped_; });
+        if (isStopped_)
+            break;
+
+        lock.unlock();
+        try {
+            runPass(Clock::now());
+        } catch (const std::exception &e) {
+            // The GOP keeps its current tiles, so queries are unaffected; the next pass tries again.
+            std::cerr << "Background re-tiling failed: " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
+
+unsigned int RetileScheduler::runPass(Clock::time_point now) {
+    std::scoped_lock passLock(passMutex_);
+    auto passStart = Clock::now();
+    {
+        std::scoped_lock lock(mutex_);
+        forgetSpendingBefore(now - budget_.window);
+        if (!isQuiet(now))
+            return 0;
+    }
+
+    auto byPriority = [](const RetileTask &a, const RetileTask &b) { return a.priority < b.priority; };
+    std::priority_queue<RetileTask, std::vector<RetileTask>, decltype(byPriority)> tasks(byPriority, candidates_());
+
+    unsigned int numberOfRetiledGOPs = 0;
+    for (; !tasks.empty(); tasks.pop()) {
+        const auto &task = tasks.top();
+        {
+            std::scoped_lock lock(mutex_);
+            // Re-tiling in priority order means stopping at the first GOP that does not fit rather than skipping to
+            // cheaper ones.
+            auto queryStarted = hasQueried_ && lastQuery_ > passStart;
+            if (isStopped_ || queryStarted || !fitsBudget(task))
+                break;
+        }
+
+        auto result = retile_(task);
+        ++numberOfRetiledGOPs;
+
+        std::scoped_lock lock(mutex_);
+        spending_.push_back({now, result.milliseconds, result.bytesWritten});
+        millisecondsInWindow_ += result.milliseconds;
+        bytesInWindow_ += result.bytesWritten;
+        ++numberOfRetiledGOPs_;
+    }
+    return numberOfRetiledGOPs;
+}
+
+void RetileScheduler::forgetSpendingBefore(Clock::time_point time) {
+    while (!spending_.empty() && spending_.front().time < time) {
+        millisecondsInWindow_ -= spending_.front().milliseconds;
+        bytesInWindow_ -= spending_.front().bytes;
+        spending_.pop_front();
+    }
+}
+
+bool RetileScheduler::fitsBudget(const RetileTask &task) const {
+    // A GOP that costs more than the whole budget can still be re-tiled when nothing else has been spent in the window.
+    if (spending_.empty())
+        return true;
+    return millisecondsInWindow_ + task.estimatedMilliseconds <= budget_.gpuMillisecondsPerWindow
+            && bytesInWindow_ < budget_.bytesPerWindow;
+}
+
+bool RetileScheduler::isQuiet(Clock::time_point now) const {
+    return !hasQueried_ || now - lastQuery_ >= budget_.quietPeriod;
+}
+
+} // namespace tasm
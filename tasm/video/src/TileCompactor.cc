@@ -0,0 +1,97 @@
+#include "TileCompactor.h"
+
+#include <iostream>
+#include <vector>
+
+namespace tasm {
+
+TileCompactor::TileCompactor(Compactor compact)
+    : compact_(std::move(compact)),
+      hasNewRequest_(false),
+      numberOfDeletedDirectories_(0),
+      isStopped_(false)
+{}
+
+TileCompactor::~TileCompactor() {
+    stop();
+}
+
+void TileCompactor::requestCompaction(const std::experimental::filesystem::path &videoPath) {
+    {
+        std::scoped_lock lock(mutex_);
+        if (isStopped_)
+            return;
+        requestedVideos_.insert(videoPath.string());
+        hasNewRequest_ = true;
+        if (!thread_.joinable())
+            thread_ = std::thread(&TileCompactor::run, this);
+    }
+    condition_.notify_all();
+}
+
+void TileCompactor::stop() {
+    {
+        std::scoped_lock lock(mutex_);
+        isStopped_ = true;
+    }
+    condition_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+unsigned int TileCompactor::numberOfDeletedDirectories() const {
+    std::scoped_lock lock(mutex_);
+    return numberOfDeletedDirectories_;
+}
+
+bool TileCompactor::hasRequestedVideos() const {
+    std::scoped_lock lock(mutex_);
+    return !requestedVideos_.empty();
+}
+
+void TileCompactor::run() {
+    std::unique_lock lock(mutex_);
+    while (!isStopped_) {
+        condition_.wait_for(lock, PollInterval, [this] { return isStopped_ || hasNewRequest_; });
+        if (isStopped_)
+            break;
+        if (requestedVideos_.empty())
+            continue;
+
+        lock.unlock();
+        runPass();
+        lock.lock();
+    }
+}
+
+unsigned int TileCompactor::runPass() {
+    std::scoped_lock passLock(passMutex_);
+    std::set<std::string> videos;
+    {
+        std::scoped_lock lock(mutex_);
+        videos.swap(requestedVideos_);
+        hasNewRequest_ = false;
+    }
+
+    unsigned int numberOfDeletedDirectories = 0;
+    std::vector<std::string> pinnedVideos;
+    for (const auto &video : videos) {
+        try {
+            auto compaction = compact_(video);
+            numberOfDeletedDirectories += compaction.numberOfDeletedDirectories;
+            if (compaction.numberOfPinnedDirectories)
+                pinnedVideos.push_back(video);
+        } catch (const std::exception &e) {
+            // Directories are only deleted after they are removed from the manifest, so readers are unaffected. The
+            // video is compacted again the next time that it is re-tiled.
+            std::cerr << "Failed to compact tiles of " << video << ": " << e.what() << std::endl;
+        }
+    }
+
+    std::scoped_lock lock(mutex_);
+    requestedVideos_.insert(pinnedVideos.begin(), pinnedVideos.end());
+    numberOfDeletedDirectories_ += numberOfDeletedDirectories;
+    return numberOfDeletedDirectories;
+}
+
+} // namespace tasm
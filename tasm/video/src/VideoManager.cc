@@ -1,7 +1,10 @@
 #include "VideoManager.h"
 
+#include "CancellationToken.h"
 #include "ImageUtilities.h"
+#include "LayoutIntervalSegmenter.h"
 #include "MergeTiles.h"
+#include "QueryStats.h"
 #include "TileLocationProvider.h"
 #include "TiledVideoManager.h"
 #include "ScanOperators.h"
@@ -12,14 +15,42 @@
 #include "SmartTileConfigurationProvider.h"
 #include "TemporalSelection.h"
 #include "TileOperators.h"
+#include "TilePack.h"
+#include "TileQualityProvider.h"
 #include "TransformToImage.h"
 #include "Video.h"
 #include "VideoConfiguration.h"
 #include "WorkloadCostEstimator.h"
 
+#include <optional>
+
 
 namespace tasm {
 
+namespace {
+
+// Intervals are whole multiples of half a second, and at most four seconds long.
+LayoutIntervals adaptiveLayoutIntervalsForWorkload(std::shared_ptr<Workload> workload, const Configuration &configuration) {
+    auto minimumIntervalLength = std::max(1u, configuration.frameRate / 2);
+    return LayoutIntervalSegmenter(
+            workload,
+            configuration.displayWidth,
+            configuration.displayHeight,
+            minimumIntervalLength,
+            4 * configuration.frameRate / minimumIntervalLength * minimumIntervalLength).segment();
+}
+
+// Tiles that none of the workload's objects intersect in a GOP are encoded at the background quality.
+std::shared_ptr<TileQualityProvider> tileQualityProviderForWorkload(std::shared_ptr<Workload> workload, const LayoutIntervals &layoutIntervals) {
+    auto &environment = EnvironmentConfiguration::instance();
+    return std::make_shared<SemanticTileQualityProvider>(
+            layoutIntervals,
+            workload,
+            TileQuality{environment.objectTileQP(), environment.backgroundTileQP()});
+}
+
+} // namespace
+
 void VideoManager::createCatalogIfNecessary() {
     if (!std::experimental::filesystem::exists(CatalogConfiguration::CatalogPath()))
         std::experimental::filesystem::create_directory(CatalogConfiguration::CatalogPath());
@@ -43,71 +74,128 @@ void VideoManager::storeWithNonUniformLayout(const std::experimental::filesystem
                                                 const std::string &storedName,
                                                 const std::string &metadataIdentifier,
                                                 std::shared_ptr<MetadataSelection> metadataSelection,
-                                                std::shared_ptr<SemanticIndex> semanticIndex, bool force) {
+                                                std::shared_ptr<SemanticIndex> semanticIndex, bool force,
+                                                bool adaptiveLayoutIntervals) {
     std::shared_ptr<Video> video(new Video(path));
     auto semanticDataManager = std::make_shared<SemanticDataManager>(semanticIndex, metadataIdentifier, metadataSelection, std::shared_ptr<TemporalSelection>());
+    auto workload = std::make_shared<Workload>(semanticDataManager);
     std::shared_ptr<TileLayoutProvider> layoutProvider;
 
-    auto layoutDuration = video->configuration().frameRate;
+    auto layoutIntervals = adaptiveLayoutIntervals
+            ? adaptiveLayoutIntervalsForWorkload(workload, video->configuration())
+            : LayoutIntervals(video->configuration().frameRate);
     auto width = video->configuration().displayWidth;
     auto height = video->configuration().displayHeight;
 
     if (force) {
         layoutProvider = std::make_shared<FineGrainedTileConfigurationProvider>(
-                layoutDuration,
+                layoutIntervals,
                 semanticDataManager,
                 width,
                 height);
     } else {
         layoutProvider = std::make_shared<SmartTileConfigurationProviderSingleSelection>(
-                layoutDuration,
+                layoutIntervals,
                 semanticDataManager,
                 width,
                 height);
     }
-    storeTiledVideo(video, layoutProvider, storedName);
+    storeTiledVideo(video, layoutProvider, storedName, layoutIntervals, tileQualityProviderForWorkload(workload, layoutIntervals));
+}
+
+void VideoManager::storeWithWorkloadLayout(const std::experimental::filesystem::path &path, const std::string &name, std::shared_ptr<Workload> workload, bool adaptiveLayoutIntervals) {
+    std::shared_ptr<Video> video(new Video(path));
+    auto layoutIntervals = adaptiveLayoutIntervals
+            ? adaptiveLayoutIntervalsForWorkload(workload, video->configuration())
+            : LayoutIntervals(video->configuration().frameRate);
+    auto layoutProvider = std::make_shared<WorkloadTileConfigurationProvider>(
+            layoutIntervals,
+            workload,
+            video->configuration().displayWidth,
+            video->configuration().displayHeight);
+    storeTiledVideo(video, layoutProvider, name, layoutIntervals, tileQualityProviderForWorkload(workload, layoutIntervals));
 }
 
 void VideoManager::storeTiledVideo(std::shared_ptr<Video> video, std::shared_ptr<TileLayoutProvider> tileLayoutProvider, const std::string &savedName) {
+    storeTiledVideo(video, tileLayoutProvider, savedName, LayoutIntervals(video->configuration().frameRate));
+}
+
+void VideoManager::storeTiledVideo(std::shared_ptr<Video> video, std::shared_ptr<TileLayoutProvider> tileLayoutProvider, const std::string &savedName, const LayoutIntervals &layoutIntervals, std::shared_ptr<TileQualityProvider> tileQualityProvider) {
     std::shared_ptr<ScanFileDecodeReader> scan(new ScanFileDecodeReader(video));
     std::shared_ptr<GPUDecodeFromCPU> decode(new GPUDecodeFromCPU(scan, video->configuration(), gpuContext_, lock_));
 
-    TileOperator tile(video, decode, tileLayoutProvider, savedName, video->configuration().frameRate, gpuContext_, lock_);
+    // Record the intervals before encoding so that a stored video never has tiles without them.
+    layoutIntervals.write(TiledEntry(savedName).path());
+
+    TileOperator tile(video, decode, tileLayoutProvider, savedName, layoutIntervals, gpuContext_, lock_, tileQualityProvider);
     while (!tile.isComplete()) {
         tile.next();
     }
 }
 
 void VideoManager::retileVideoBasedOnRegret(const std::string &videoName) {
+    std::unique_lock regretLock(regretMutex_);
     assert(videoToRegretAccumulator_.count(videoName));
 
     auto tiledEntry = std::make_shared<TiledEntry>(videoName);
     auto tiledVideoManager = std::make_shared<TiledVideoManager>(tiledEntry);
     auto video = std::make_shared<Video>(tiledVideoManager->locationOfTileForId(0, 0));
-    auto gopLength = video->configuration().frameRate;
+    auto layoutIntervals = LayoutIntervals::read(tiledEntry->path(), video->configuration().frameRate);
 
     auto gopToLayouts = videoToRegretAccumulator_.at(videoName)->getNewGOPLayouts();
+    regretLock.unlock();
     // Because we re-tile the entire GOP, we only need to specify the first frame for each GOP.
     auto frames = std::make_shared<std::vector<int>>();
     for (auto it = gopToLayouts->begin(); it != gopToLayouts->end(); ++it)
-        frames->push_back(it->first * gopLength);
+        frames->push_back(layoutIntervals.firstFrameOfInterval(it->first));
 
     // Sort the frames because currently the way we scan goes in order of keyframes.
     // That should probably get more flexible, but for now sorting is easy.
     std::sort(frames->begin(), frames->end());
 
-    retileVideo(video, frames, std::make_shared<ConglomerationTileConfigurationProvider>(std::move(gopToLayouts), gopLength), videoName);
+    retileVideo(video, frames, std::make_shared<ConglomerationTileConfigurationProvider>(std::move(gopToLayouts), layoutIntervals), videoName, layoutIntervals);
+}
+
+void VideoManager::retileWithWorkloadLayout(const std::string &videoName, std::shared_ptr<Workload> workload) {
+    auto tiledEntry = std::make_shared<TiledEntry>(videoName);
+    auto tiledVideoManager = std::make_shared<TiledVideoManager>(tiledEntry);
+    auto video = std::make_shared<Video>(tiledVideoManager->locationOfTileForId(0, 0));
+    auto layoutIntervals = LayoutIntervals::read(tiledEntry->path(), video->configuration().frameRate);
+
+    auto currentLayoutProvider = std::make_shared<SingleTileLocationProvider>(tiledVideoManager);
+    auto newLayoutProvider = std::make_shared<WorkloadTileConfigurationProvider>(
+            layoutIntervals,
+            workload,
+            tiledVideoManager->totalWidth(),
+            tiledVideoManager->totalHeight());
+
+    // Only the first frame of each GOP needs to be specified because entire GOPs are re-tiled.
+    auto frames = std::make_shared<std::vector<int>>();
+    for (auto gop = 0u; layoutIntervals.firstFrameOfInterval(gop) <= tiledVideoManager->maximumFrame(); ++gop) {
+        auto frame = layoutIntervals.firstFrameOfInterval(gop);
+        if (*newLayoutProvider->tileLayoutForFrame(frame) != *currentLayoutProvider->tileLayoutForFrame(frame))
+            frames->push_back(frame);
+    }
+    if (frames->empty())
+        return;
+
+    retileVideo(video, frames, newLayoutProvider, videoName, layoutIntervals, tileQualityProviderForWorkload(workload, layoutIntervals));
 }
 
-void VideoManager::retileVideo(std::shared_ptr<Video> video, std::shared_ptr<std::vector<int>> framesToRead, std::shared_ptr<TileLayoutProvider> newLayoutProvider, const std::string &savedName) {
+void VideoManager::retileVideo(std::shared_ptr<Video> video, std::shared_ptr<std::vector<int>> framesToRead, std::shared_ptr<TileLayoutProvider> newLayoutProvider, const std::string &savedName, const LayoutIntervals &layoutIntervals, std::shared_ptr<TileQualityProvider> tileQualityProvider) {
+    std::scoped_lock lock(retileMutex_);
+
     // Set up scan of original video using specified frames. Re-tile entire GOPs, even if not every frame is specified.
     auto scan = std::make_shared<ScanFramesFromFileDecodeReader>(video, framesToRead, true);
     auto decode = std::make_shared<GPUDecodeFromCPU>(scan, video->configuration(), gpuContext_, lock_);
 
-    TileOperator tile(video, decode, newLayoutProvider, savedName, video->configuration().frameRate, gpuContext_, lock_);
+    TileOperator tile(video, decode, newLayoutProvider, savedName, layoutIntervals, gpuContext_, lock_, tileQualityProvider);
     while (!tile.isComplete()) {
         tile.next();
     }
+
+    if (EnvironmentConfiguration::instance().compactTiles())
+        tileCompactor_.requestCompaction(files::PathForVideo(savedName));
 }
 
 std::unique_ptr<ImageIterator> VideoManager::select(const std::string &video,
@@ -115,13 +203,25 @@ std::unique_ptr<ImageIterator> VideoManager::select(const std::string &video,
                                                     std::shared_ptr<MetadataSelection> metadataSelection,
                                                     std::shared_ptr<TemporalSelection> temporalSelection,
                                                     std::shared_ptr<SemanticIndex> semanticIndex,
-                                                    SelectStrategy selectStrategy) {
+                                                    SelectStrategy selectStrategy,
+                                                    unsigned int limit) {
     std::shared_ptr<TiledEntry> entry(new TiledEntry(video, metadataIdentifier));
+    // Shared by the operators so that the scan and decode stop as soon as the limit is reached or the iterator is
+    // destroyed.
+    auto cancellationToken = std::make_shared<CancellationToken>();
+    auto stats = std::make_shared<QueryStats>();
 
     // Set up scan of a tiled video.
     std::shared_ptr<TiledVideoManager> tiledVideoManager(new TiledVideoManager(entry));
     auto tileLocationProvider = std::make_shared<SingleTileLocationProvider>(tiledVideoManager);
-    auto semanticDataManager = std::make_shared<SemanticDataManager>(semanticIndex, metadataIdentifier, metadataSelection, temporalSelection, tiledVideoManager->totalWidth(), tiledVideoManager->totalHeight());
+    auto configuration = TilePackCache().configurationForTile(tileLocationProvider->locationOfTileForFrame(0, 0), 0, tileLocationProvider->storageFormatForFrame(0));
+
+    // Sampling per GOP defaults to the video's stored GOPs, which start at its keyframes.
+    auto sampledSelection = std::dynamic_pointer_cast<SampledTemporalSelection>(temporalSelection);
+    if (sampledSelection && sampledSelection->needsGOPs())
+        temporalSelection = sampledSelection->withGOPs(LayoutIntervals::read(entry->path(), configuration.frameRate));
+
+    auto semanticDataManager = std::make_shared<SemanticDataManager>(semanticIndex, metadataIdentifier, metadataSelection, temporalSelection, tiledVideoManager->totalWidth(), tiledVideoManager->totalHeight(), stats);
 
     std::shared_ptr<Operator<CPUEncodedFrameDataPtr>> scan;
     std::shared_ptr<TileLayoutProvider> tileLayoutProvider = tileLocationProvider;
@@ -137,12 +237,11 @@ std::unique_ptr<ImageIterator> VideoManager::select(const std::string &video,
     if (maxHeight % CodedDimension)
         maxHeight = (maxHeight / CodedDimension + 1) * CodedDimension;
 
-    auto configuration = *video::GetConfiguration(tileLocationProvider->locationOfTileForFrame(0, 0));
     configuration.maxWidth = maxWidth;
     configuration.maxHeight = maxHeight;
 
     if (selectStrategy == SelectStrategy::Frames) {
-        auto scanFullFrames = std::make_shared<ScanFullFramesFromTiledVideoOperator>(entry, semanticDataManager, tileLocationProvider);
+        auto scanFullFrames = std::make_shared<ScanFullFramesFromTiledVideoOperator>(entry, semanticDataManager, tileLocationProvider, cancellationToken, stats);
         scan = scanFullFrames;
 
         // Create a layout provider for the full frame.
@@ -154,30 +253,38 @@ std::unique_ptr<ImageIterator> VideoManager::select(const std::string &video,
         maxWidth = configuration.maxWidth;
         maxHeight = configuration.maxHeight;
     } else {
-        scan = std::make_shared<ScanTiledVideoOperator>(entry, semanticDataManager, tileLocationProvider);
+        // With a limit, plan reads lazily in frame order so that only the beginning of the video is read.
+        bool shouldReadEntireGOPs = false;
+        bool shouldScanInFrameOrder = limit > 0;
+        scan = std::make_shared<ScanTiledVideoOperator>(entry, semanticDataManager, tileLocationProvider, shouldReadEntireGOPs, shouldScanInFrameOrder, cancellationToken, stats);
     }
 
-    std::shared_ptr<GPUDecodeFromCPU> decode(new GPUDecodeFromCPU(scan, configuration, gpuContext_, lock_, maxWidth, maxHeight));
-    auto toRGB = std::make_shared<TransformToRGB>(decode);
+    std::shared_ptr<GPUDecodeFromCPU> decode(new GPUDecodeFromCPU(scan, configuration, gpuContext_, lock_, maxWidth, maxHeight, cancellationToken, stats));
+    auto toRGB = std::make_shared<TransformToRGB>(decode, stats);
 
     // Transform tiles to pixel blobs.
     std::shared_ptr<Operator<GPUPixelDataContainer>> mergeOperator;
     if (selectStrategy == SelectStrategy::Objects) {
         std::cout << "Merging pixels to recover objects" << std::endl;
-        mergeOperator = std::make_shared<MergeTilesOperator>(toRGB, semanticDataManager, tileLayoutProvider);
+        mergeOperator = std::make_shared<MergeTilesOperator>(toRGB, semanticDataManager, tileLayoutProvider, limit, cancellationToken, stats);
     } else {
         std::cout << "Returning raw tiles" << std::endl;
-        mergeOperator = std::make_shared<TilesToPixelsOperator>(toRGB);
+        mergeOperator = std::make_shared<TilesToPixelsOperator>(toRGB, limit, cancellationToken, stats);
     }
 
     // Transform pixels to RGB images.
-    std::shared_ptr<TransformToImage> transform(new TransformToImage(mergeOperator, maxWidth, maxHeight));
+    std::shared_ptr<TransformToImage> transform(new TransformToImage(mergeOperator, maxWidth, maxHeight, stats));
 
     // Accumulate regret for this query.
-    if (videoToRegretAccumulator_.count(video))
-        accumulateRegret(video, semanticDataManager, tileLocationProvider);
+    if (retileScheduler_)
+        retileScheduler_->noteQuery();
+    {
+        std::scoped_lock lock(regretMutex_);
+        if (videoToRegretAccumulator_.count(video))
+            accumulateRegret(video, semanticDataManager, tileLocationProvider);
+    }
 
-    return std::make_unique<ImageIterator>(transform);
+    return std::make_unique<ImageIterator>(transform, cancellationToken, stats);
 }
 
 void VideoManager::accumulateRegret(const std::string &video, std::shared_ptr<SemanticDataManager> selection, std::shared_ptr<TileLayoutProvider> currentLayout) {
@@ -195,17 +302,92 @@ void VideoManager::activateRegretBasedRetilingForVideo(const std::string &video,
     std::shared_ptr<TiledVideoManager> tiledVideoManager(new TiledVideoManager(entry));
     Video originalVideo(tiledVideoManager->locationOfTileForId(0, 0));
 
-    videoToRegretAccumulator_[video] = std::make_shared<RegretAccumulator>(
+    auto regretAccumulator = std::make_shared<RegretAccumulator>(
             semanticIndex,
             metadataIdentifier,
             tiledVideoManager->totalWidth(),
             tiledVideoManager->totalHeight(),
-            originalVideo.configuration().frameRate,
+            LayoutIntervals::read(entry->path(), originalVideo.configuration().frameRate),
             threshold);
+    regretAccumulator->persistTo(entry->path());
+
+    std::scoped_lock lock(regretMutex_);
+    videoToRegretAccumulator_[video] = regretAccumulator;
 }
 
 void VideoManager::deactivateRegretBasedRetilingForVideo(const std::string &video) {
+    std::scoped_lock lock(regretMutex_);
     videoToRegretAccumulator_.erase(video);
 }
 
+void VideoManager::startBackgroundRetiling(RetileBudget budget) {
+    stopBackgroundRetiling();
+    retileScheduler_ = std::make_unique<RetileScheduler>(
+            [this] { return backgroundRetileCandidates(); },
+            [this](const RetileTask &task) { return retileGOP(task); },
+            budget);
+    retileScheduler_->start();
+}
+
+void VideoManager::stopBackgroundRetiling() {
+    retileScheduler_.reset();
+}
+
+std::vector<RetileTask> VideoManager::backgroundRetileCandidates() {
+    std::scoped_lock lock(regretMutex_);
+    std::vector<RetileTask> tasks;
+    for (const auto &videoAndAccumulator : videoToRegretAccumulator_) {
+        for (const auto &candidate : videoAndAccumulator.second->retileCandidates())
+            tasks.push_back({videoAndAccumulator.first, candidate.gop, candidate.layoutIdentifier, candidate.excessRegret, candidate.estimatedCostToRetile});
+    }
+    return tasks;
+}
+
+RetileResult VideoManager::retileGOP(const RetileTask &task) {
+    std::shared_ptr<TileLayoutProvider> layout;
+    {
+        std::scoped_lock lock(regretMutex_);
+        // Regret-based tiling may have been deactivated since the candidates were listed.
+        if (!videoToRegretAccumulator_.count(task.video))
+            return {0, 0};
+        layout = videoToRegretAccumulator_.at(task.video)->layoutForGOP(task.gop, task.layoutIdentifier);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto tiledEntry = std::make_shared<TiledEntry>(task.video);
+    auto tiledVideoManager = std::make_shared<TiledVideoManager>(tiledEntry);
+    auto video = std::make_shared<Video>(tiledVideoManager->locationOfTileForId(0, 0));
+    auto layoutIntervals = LayoutIntervals::read(tiledEntry->path(), video->configuration().frameRate);
+
+    auto gopToLayout = std::make_unique<std::unordered_map<unsigned int, std::shared_ptr<TileLayoutProvider>>>();
+    gopToLayout->emplace(task.gop, layout);
+    auto firstFrame = layoutIntervals.firstFrameOfInterval(task.gop);
+    retileVideo(video, std::make_shared<std::vector<int>>(1, firstFrame), std::make_shared<ConglomerationTileConfigurationProvider>(std::move(gopToLayout), layoutIntervals), task.video, layoutIntervals);
+    auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Only clear the regret once the new tiles are committed, so that a GOP whose re-tiling throws is retried.
+    {
+        std::scoped_lock lock(regretMutex_);
+        if (videoToRegretAccumulator_.count(task.video))
+            videoToRegretAccumulator_.at(task.video)->gopWasRetiled(task.gop);
+    }
+
+    // The GOP's new tiles are in the most recent directory that starts at its first frame.
+    unsigned long long bytesWritten = 0;
+    auto manifest = TileManifestCache::instance().manifest(tiledEntry->path());
+    std::optional<TileDirectory> newest;
+    for (const auto &directory : manifest->directories()) {
+        if (directory.firstFrame == firstFrame && (!newest || directory.tileVersion > newest->tileVersion))
+            newest = directory;
+    }
+    if (newest) {
+        auto directoryPath = TileFiles::directoryForTilesInFrames(tiledEntry->path(), newest->firstFrame, newest->lastFrame, newest->tileVersion);
+        for (const auto &file : std::experimental::filesystem::recursive_directory_iterator(directoryPath)) {
+            if (std::experimental::filesystem::is_regular_file(file.path()))
+                bytesWritten += std::experimental::filesystem::file_size(file.path());
+        }
+    }
+    return {milliseconds, bytesWritten};
+}
+
 } // namespace tasm
\ No newline at end of file